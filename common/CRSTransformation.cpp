@@ -5,103 +5,326 @@
  */
 #include "CRSTransformation.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace {
+/*!
+ * \brief PROJ context of one thread and the projections created in it, by
+ *			transformation key. Projections are destroyed before the context.
+ */
+struct ThreadContext {
+	std::unique_ptr<PJ_CONTEXT, std::function<void(PJ_CONTEXT*)>> ctxt;
+	std::unordered_map<std::string, std::unique_ptr<PJ, std::function<void(PJ*)>>> projections;
+
+	ThreadContext() : ctxt(proj_context_create(), [](PJ_CONTEXT* ctxt){ proj_context_destroy(ctxt); }) {}
+};
+thread_local ThreadContext threadContext;
+
+/*!
+ * \brief Threads transforming the chunks of large batches. The threads are kept
+ *			for the life of the process, so that their thread local PROJ contexts
+ *			and projections are created once rather than for every batch.
+ */
+class WorkerPool {
+public:
+	explicit WorkerPool(const std::size_t nThreads) {
+		for (std::size_t i = 0; i < nThreads; ++i) {
+			threads.emplace_back(&WorkerPool::run, this);
+		}
+	}
+	~WorkerPool() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wakeup.notify_all();
+		for (auto& thread : threads) {
+			thread.join();
+		}
+	}
+	std::size_t size() const { return threads.size(); }
+	//! \brief Queues work for the next idle thread, and returns its result
+	std::future<void> submit(std::function<void()> work) {
+		std::packaged_task<void()> task(std::move(work));
+		auto result = task.get_future();
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			tasks.push_back(std::move(task));
+		}
+		wakeup.notify_one();
+		return result;
+	}
+private:
+	std::vector<std::thread> threads;
+	std::deque<std::packaged_task<void()>> tasks;
+	std::mutex mutex;
+	std::condition_variable wakeup;
+	bool stopping = false;
+
+	void run() {
+		while (true) {
+			std::packaged_task<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wakeup.wait(lock, [this]{ return stopping || !tasks.empty(); });
+				if (tasks.empty()) {
+					return;
+				}
+				task = std::move(tasks.front());
+				tasks.pop_front();
+			}
+			task();
+		}
+	}
+};
+
+//! \brief The process wide pool, started on first use with one thread per core besides the caller's
+WorkerPool& workers() {
+	static WorkerPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+	return pool;
+}
+
+//! \brief Pointer to element index of a strided array, or null if the array is null
+inline double* strided(double* first, const std::size_t stride, const std::size_t index) {
+	return first == nullptr ? nullptr
+		: reinterpret_cast<double*>(reinterpret_cast<char*>(first) + index * stride);
+}
+inline const double* strided(const double* first, const std::size_t stride, const std::size_t index) {
+	return strided(const_cast<double*>(first), stride, index);
+}
+}
+
 /**
  * @brief Construct a new CRSTransformation::CRSTransformation object to create a pipeline
  * 				between two known coordinate reference systems
- * 
+ *
  * @param fromCRS Coordinate reference system from
  * @param toCRS Coordinate reference system to
  */
-
-
 CRSTransformation::CRSTransformation(const std::string &fromCRS, const std::string &toCRS) :
- ctxt(proj_context_create(), [](PJ_CONTEXT* ctxt){ proj_context_destroy(ctxt); }),
-	projection(proj_create_crs_to_crs(ctxt.get(), fromCRS.c_str(), toCRS.c_str(), nullptr),
-		[](PJ* proj){ proj_destroy(proj); })
+	fromCRS(fromCRS),
+	toCRS(toCRS),
+	key(fromCRS + '\0' + toCRS)
 {
-	if (projection == nullptr) {
-		throw std::logic_error("Failed to create CRS conversion from " + fromCRS
-			+ " to " + toCRS + ": " + proj_context_errno_string(ctxt.get(),
-				proj_context_errno(ctxt.get())));
-	}
+	projection(); // Fail early on invalid reference systems
 }
 
 /**
- * @brief Apply transformation from fromCRS to toCRS
- * 
- * @param traj reference to trajectory to transform
+ * @brief Get the shared transformation between two coordinate reference systems
+ *
+ * @param fromCRS Coordinate reference system from
+ * @param toCRS Coordinate reference system to
+ * @return The same transformation for every call with the same reference systems
  */
-void CRSTransformation::apply(std::vector<ATOS::Trajectory::TrajectoryPoint> &trajPoints) {
-	// Put TrajPoints into array of PJ_POINTS
-	PJ_COORD in[trajPoints.size()];
-	auto arraySize = sizeof(in) / sizeof(in[0]);
-	for (int i = 0; i < arraySize; i++){
-		in[i].xyz.x = trajPoints[i].getXCoord();
-		in[i].xyz.y = trajPoints[i].getYCoord();
-		in[i].xyz.z = trajPoints[i].getZCoord();
+std::shared_ptr<const CRSTransformation> CRSTransformation::get(const std::string &fromCRS, const std::string &toCRS) {
+	static std::mutex cacheMutex;
+	static std::unordered_map<std::string, std::shared_ptr<const CRSTransformation>> cache;
+
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	auto& transformation = cache[fromCRS + '\0' + toCRS];
+	if (transformation == nullptr) {
+		try {
+			transformation = std::make_shared<const CRSTransformation>(fromCRS, toCRS);
+		}
+		catch (...) {
+			cache.erase(fromCRS + '\0' + toCRS);
+			throw;
+		}
 	}
+	return transformation;
+}
 
-	RCLCPP_DEBUG(logger, "Converting trajectory with %ld points", arraySize);
-	if (0 != proj_trans_array(projection.get(), PJ_FWD, arraySize, in)){
-		throw std::runtime_error("Failed to convert trajectory");
+/**
+ * @brief Get the projection of the calling thread, creating it in the thread's context
+ * 				on first use
+ */
+PJ* CRSTransformation::projection() const {
+	auto& pj = threadContext.projections[key];
+	if (pj == nullptr) {
+		auto ctxt = threadContext.ctxt.get();
+		pj = std::unique_ptr<PJ, std::function<void(PJ*)>>(
+			proj_create_crs_to_crs(ctxt, fromCRS.c_str(), toCRS.c_str(), nullptr),
+			[](PJ* proj){ proj_destroy(proj); });
+		if (pj == nullptr) {
+			threadContext.projections.erase(key);
+			throw std::logic_error("Failed to create CRS conversion from " + fromCRS
+				+ " to " + toCRS + ": " + proj_context_errno_string(ctxt, proj_context_errno(ctxt)));
+		}
 	}
+	return pj.get();
+}
 
-	// Put transformed PJ_POINTS back into TrajPoints
-	for (int i = 0; i < arraySize; i++){
-		trajPoints[i].setXCoord(in[i].xyz.x);
-		trajPoints[i].setYCoord(in[i].xyz.y);
-		trajPoints[i].setZCoord(in[i].xyz.z);
+/**
+ * @brief Apply transformation to the positions of trajectory points in place
+ *
+ * @param trajPoints reference to trajectory points to transform
+ * @param direction Which direction to transform, e.g. PJ_FWD or PJ_INV
+ */
+void CRSTransformation::apply(std::vector<ATOS::Trajectory::TrajectoryPoint> &trajPoints, PJ_DIRECTION direction) const {
+	if (trajPoints.empty()) {
+		return;
+	}
+	RCLCPP_DEBUG(logger, "Converting trajectory with %ld points", trajPoints.size());
+	// Points without z are transformed as if at zero height, and keep their missing z.
+	// Each run of consecutive points with or without z is transformed as one batch.
+	auto lacksZ = [](const ATOS::Trajectory::TrajectoryPoint& point) { return std::isnan(point.positionData()[2]); };
+	for (auto runStart = trajPoints.begin(); runStart != trajPoints.end();) {
+		const bool hasZ = !lacksZ(*runStart);
+		auto runEnd = std::find_if(runStart, trajPoints.end(),
+			[&](const ATOS::Trajectory::TrajectoryPoint& point) { return lacksZ(point) == hasZ; });
+		double* position = runStart->positionData();
+		apply(position, position + 1, hasZ ? position + 2 : nullptr,
+			sizeof (ATOS::Trajectory::TrajectoryPoint), static_cast<std::size_t>(runEnd - runStart), direction);
+		runStart = runEnd;
 	}
 }
 
 /**
  * @brief Apply a transform on a point
- * 
+ *
  * @param point The point to transform
  * @param direction Which direction to transform, e.g. PJ_FWD or PJ_INV
  */
-void CRSTransformation::apply(geometry_msgs::msg::Point &point, PJ_DIRECTION direction) {
+void CRSTransformation::apply(geometry_msgs::msg::Point &point, PJ_DIRECTION direction) const {
 	PJ_COORD in = proj_coord(point.x, point.y, point.z, 0);
-	PJ_COORD out = proj_trans(projection.get(), direction, in);
+	PJ_COORD out = proj_trans(projection(), direction, in);
 	point.x = out.xyz.x;
 	point.y = out.xyz.y;
 	point.z = out.xyz.z;
 }
 
+/**
+ * @brief Apply transformation to strided coordinate arrays in place. Batches of at
+ * 				least PARALLEL_MIN_POINTS points are split into chunks, which are
+ * 				transformed concurrently by the calling thread and a pool of threads
+ * 				kept for the process, each with its own projection.
+ *
+ * @param x First x coordinate
+ * @param y First y coordinate
+ * @param z First z coordinate, or null to transform as if at zero height
+ * @param stride Distance in bytes between consecutive coordinates
+ * @param count Number of points
+ * @param direction Which direction to transform, e.g. PJ_FWD or PJ_INV
+ */
+void CRSTransformation::apply(double *x, double *y, double *z, const std::size_t stride, const std::size_t count,
+		PJ_DIRECTION direction) const {
+	if (count < PARALLEL_MIN_POINTS) {
+		applyInThisThread(x, y, z, stride, count, direction);
+		return;
+	}
+	const std::size_t nThreads = std::min(workers().size() + 1, count / PARALLEL_MIN_CHUNK);
+	if (nThreads < 2) {
+		applyInThisThread(x, y, z, stride, count, direction);
+		return;
+	}
+
+	RCLCPP_DEBUG(logger, "Converting %zu points in %zu threads", count, nThreads);
+	const std::size_t chunkSize = (count + nThreads - 1) / nThreads;
+	std::vector<std::future<void>> chunks;
+	for (std::size_t first = chunkSize; first < count; first += chunkSize) {
+		chunks.push_back(workers().submit(std::bind(&CRSTransformation::applyInThisThread, this,
+			strided(x, stride, first), strided(y, stride, first), strided(z, stride, first),
+			stride, std::min(chunkSize, count - first), direction)));
+	}
+	// All chunks must be finished before returning, also when one of them fails
+	std::exception_ptr error;
+	try {
+		applyInThisThread(x, y, z, stride, chunkSize, direction);
+	}
+	catch (...) {
+		error = std::current_exception();
+	}
+	for (auto& chunk : chunks) {
+		try {
+			chunk.get();
+		}
+		catch (...) {
+			if (!error) {
+				error = std::current_exception();
+			}
+		}
+	}
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
+
+void CRSTransformation::applyInThisThread(double *x, double *y, double *z, const std::size_t stride,
+		const std::size_t count, PJ_DIRECTION direction) const {
+	auto proj = projection();
+	proj_errno_reset(proj);
+	proj_trans_generic(proj, direction,
+		x, stride, count,
+		y, stride, count,
+		z, z == nullptr ? 0 : stride, z == nullptr ? 0 : count,
+		nullptr, 0, 0);
+	if (int error = proj_errno(proj)) {
+		throw std::runtime_error(std::string("Failed to convert coordinates: ")
+			+ proj_context_errno_string(threadContext.ctxt.get(), error));
+	}
+}
+
 /**
  * @brief Get the origin lat, lon, height in the given datum from a proj string
- * 
+ *
  * @parameter: projString proj string to transform
- * @parameter: datum datum to transform to 
+ * @parameter: datum datum to transform to
  * @return std::vector<double> Vector with lat, lon, height
  */
 std::vector<double> CRSTransformation::projToLLH(const std::string &projString, const std::string &datum) {
-    auto *pjSrc = proj_create_crs_to_crs(NULL, projString.c_str(), datum.c_str(), NULL);
-    if (pjSrc == NULL) {
-        throw std::runtime_error("Failed to create projPJ object");
-    }
-
-    PJ_COORD src = proj_coord(0, 0, 0, 0);
-    PJ_COORD dst = proj_trans(pjSrc, PJ_FWD, src);
-
-	std::vector<double> result = {dst.xyz.x, dst.xyz.y, dst.xyz.z};
-    proj_destroy(pjSrc);
-
-    return result;
+	PJ_COORD src = proj_coord(0, 0, 0, 0);
+	PJ_COORD dst = proj_trans(get(projString, datum)->projection(), PJ_FWD, src);
+	return {dst.xyz.x, dst.xyz.y, dst.xyz.z};
 }
 
 /**
  * @brief Returns a new latitude, longitude, height after offsetting x, y, z meters
- * 
+ *
  * @param llh The latitude, longitude, height [degrees, degrees, meters]
  * @param xyzOffset Meters offset from llh [meters, meters, meters]
  */
 void CRSTransformation::llhOffsetMeters(double *llh, const double *xyzOffset) {
-	constexpr double EARTH_EQUATOR_RADIUS_M = 6378137.0;	// earth semimajor axis (WGS84) (m)
-	const auto [lat, lon, hgt] = std::make_tuple(llh[0], llh[1], llh[2]);
-	const auto [dx, dy, dz] = std::make_tuple(xyzOffset[0], xyzOffset[1], xyzOffset[2]);
+	llhOffsetMeters({llh[0], llh[1], llh[2]}, &xyzOffset[0], &xyzOffset[1], &xyzOffset[2], 0, 1, llh);
+}
 
-	llh[0] = lat + (dy / EARTH_EQUATOR_RADIUS_M) * (180 / M_PI);
-	llh[1] = lon + (dx / EARTH_EQUATOR_RADIUS_M) * (180 / M_PI) / std::cos(lat * M_PI / 180.0);
-	llh[2] = hgt + dz;
-}
\ No newline at end of file
+/**
+ * @brief Offsets an origin latitude, longitude, height by many x, y, z offsets
+ *
+ * @param llhOrigin The latitude, longitude, height of the origin [degrees, degrees, meters]
+ * @param x First x offset [meters]
+ * @param y First y offset [meters]
+ * @param z First z offset [meters], or null for offsets without height
+ * @param stride Distance in bytes between consecutive offsets
+ * @param count Number of offsets
+ * @param llh Latitude, longitude, height of each offset point [degrees, degrees, meters]
+ */
+void CRSTransformation::llhOffsetMeters(const std::array<double,3> &llhOrigin, const double *x, const double *y,
+		const double *z, const std::size_t stride, const std::size_t count, double *llh) {
+	const LLHOffset offset(llhOrigin);
+	for (std::size_t i = 0; i < count; ++i) {
+		offset.apply(*strided(x, stride, i), *strided(y, stride, i),
+			z == nullptr ? 0.0 : *strided(z, stride, i), &llh[3*i]);
+	}
+}
+
+/**
+ * @brief Precompute the scale factors of the flat earth approximation at an origin
+ *
+ * @param llhOrigin The latitude, longitude, height of the origin [degrees, degrees, meters]
+ */
+CRSTransformation::LLHOffset::LLHOffset(const std::array<double,3> &llhOrigin) :
+	llhOrigin(llhOrigin)
+{
+	constexpr double EARTH_EQUATOR_RADIUS_M = 6378137.0;	// earth semimajor axis (WGS84) (m)
+	degreesLatitudePerMeter = 180.0 / (M_PI * EARTH_EQUATOR_RADIUS_M);
+	degreesLongitudePerMeter = degreesLatitudePerMeter / std::cos(llhOrigin[0] * M_PI / 180.0);
+}
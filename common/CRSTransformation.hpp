@@ -5,25 +5,89 @@
  */
 #pragma once
 
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "proj.h"
 #include "trajectory.hpp"
 #include "rclcpp/logger.hpp"
 #include "geometry_msgs/msg/point.hpp"
 
+/*!
+ * \brief A transformation between two coordinate reference systems.
+ *
+ *			PROJ objects may only be used by one thread at a time, and creating
+ *			them involves a database lookup. Each thread therefore creates its own
+ *			projection in a thread local PROJ context the first time it uses a
+ *			transformation, and keeps it for later calls. Transformations are
+ *			immutable and should be obtained through ::get, which returns the same
+ *			instance for the same pair of reference systems.
+ */
 class CRSTransformation {
 
   public:
 
     CRSTransformation(const std::string &fromCRS, const std::string &toCRS);
-    void apply(std::vector<ATOS::Trajectory::TrajectoryPoint> &traj);
-    void apply(geometry_msgs::msg::Point &point, PJ_DIRECTION direction);
+
+    //! \brief Returns the process wide transformation from fromCRS to toCRS, creating it if needed
+    static std::shared_ptr<const CRSTransformation> get(const std::string &fromCRS, const std::string &toCRS);
+
+    void apply(std::vector<ATOS::Trajectory::TrajectoryPoint> &traj, PJ_DIRECTION direction = PJ_FWD) const;
+    void apply(geometry_msgs::msg::Point &point, PJ_DIRECTION direction) const;
+    /*!
+     * \brief Transforms count coordinates in place. Consecutive coordinates are
+     *			stride bytes apart, so that arrays of structs as well as plain
+     *			arrays can be transformed without copying. z may be null.
+     *			Large batches are split over a pool of threads kept for the process.
+     */
+    void apply(double *x, double *y, double *z, const std::size_t stride, const std::size_t count,
+               PJ_DIRECTION direction = PJ_FWD) const;
+
     static std::vector<double> projToLLH(const std::string &projString, const std::string &datum);
     static void llhOffsetMeters(double *llh, const double *xyzOffset);
+    /*!
+     * \brief Offsets an origin by count x, y, z offsets stride bytes apart, as ::llhOffsetMeters.
+     * \param llh Receives latitude, longitude, height of each point, three values per point
+     */
+    static void llhOffsetMeters(const std::array<double,3> &llhOrigin, const double *x, const double *y,
+                                const double *z, const std::size_t stride, const std::size_t count, double *llh);
+
+    /*!
+     * \brief Flat earth offsetting from a fixed origin as by ::llhOffsetMeters, with the
+     *			scale factors computed once for the origin.
+     */
+    class LLHOffset {
+      public:
+        LLHOffset() : LLHOffset({0.0, 0.0, 0.0}) {}
+        explicit LLHOffset(const std::array<double,3> &llhOrigin);
+        const std::array<double,3>& origin() const { return llhOrigin; }
+        //! \brief Latitude, longitude, height of the point x, y, z meters from the origin
+        void apply(const double x, const double y, const double z, double *llh) const {
+            llh[0] = llhOrigin[0] + y * degreesLatitudePerMeter;
+            llh[1] = llhOrigin[1] + x * degreesLongitudePerMeter;
+            llh[2] = llhOrigin[2] + z;
+        }
+      private:
+        std::array<double,3> llhOrigin;
+        double degreesLatitudePerMeter;
+        double degreesLongitudePerMeter;
+    };
 
   private:
 
-    std::unique_ptr<PJ_CONTEXT, std::function<void(PJ_CONTEXT*)>> ctxt;
-	  std::unique_ptr<PJ, std::function<void(PJ*)>> projection;
+    static constexpr std::size_t PARALLEL_MIN_POINTS = 1 << 20;	//!< Smallest batch split over threads
+    static constexpr std::size_t PARALLEL_MIN_CHUNK = 1 << 18;	//!< Smallest number of points per thread
+
+    const std::string fromCRS;
+    const std::string toCRS;
+    const std::string key;	//!< Identifies the projection in the thread local contexts
     rclcpp::Logger logger = rclcpp::get_logger("CRSTransformation");
 
+    //! \brief Returns the projection of the calling thread, creating it if needed
+    PJ* projection() const;
+    void applyInThisThread(double *x, double *y, double *z, const std::size_t stride, const std::size_t count,
+                           PJ_DIRECTION direction) const;
+
 };
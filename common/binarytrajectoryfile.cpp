@@ -0,0 +1,194 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include "binarytrajectoryfile.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace ATOS {
+
+namespace {
+//! Optional columns and the corresponding file field and validity flag
+struct OptionalColumn {
+	BinaryTrajectoryFile::Column column;
+	TrajectoryBinaryFieldType field;
+	TrajectoryColumns::ValidityFlag flag;
+	std::vector<double> TrajectoryColumns::* values;
+};
+const std::array<OptionalColumn, 5> optionalColumns = {{
+	{BinaryTrajectoryFile::Z, TRAJECTORY_FIELD_Z,
+	 TrajectoryColumns::Z_VALID, &TrajectoryColumns::z_m},
+	{BinaryTrajectoryFile::LONGITUDINAL_VELOCITY, TRAJECTORY_FIELD_LONGITUDINAL_VELOCITY,
+	 TrajectoryColumns::LONGITUDINAL_VELOCITY_VALID, &TrajectoryColumns::longitudinalVelocity_m_s},
+	{BinaryTrajectoryFile::LATERAL_VELOCITY, TRAJECTORY_FIELD_LATERAL_VELOCITY,
+	 TrajectoryColumns::LATERAL_VELOCITY_VALID, &TrajectoryColumns::lateralVelocity_m_s},
+	{BinaryTrajectoryFile::LONGITUDINAL_ACCELERATION, TRAJECTORY_FIELD_LONGITUDINAL_ACCELERATION,
+	 TrajectoryColumns::LONGITUDINAL_ACCELERATION_VALID, &TrajectoryColumns::longitudinalAcceleration_m_s2},
+	{BinaryTrajectoryFile::LATERAL_ACCELERATION, TRAJECTORY_FIELD_LATERAL_ACCELERATION,
+	 TrajectoryColumns::LATERAL_ACCELERATION_VALID, &TrajectoryColumns::lateralAcceleration_m_s2}
+}};
+
+//! Whether a column is stored in a file with the specified field mask
+bool isStored(const BinaryTrajectoryFile::Column column, const uint32_t fieldMask) {
+	for (const auto& optional : optionalColumns) {
+		if (optional.column == column) {
+			return fieldMask & optional.field;
+		}
+	}
+	return true;
+}
+
+/*!
+ * \brief Returns the values of a column as stored in a file, with NaN for points
+ *			lacking an optional value. Optional columns are assembled in buffer.
+ */
+const std::vector<double>& storedValues(
+		const TrajectoryColumns& columns,
+		const BinaryTrajectoryFile::Column column,
+		std::vector<double>& buffer) {
+	switch (column) {
+	case BinaryTrajectoryFile::X:
+		return columns.x_m;
+	case BinaryTrajectoryFile::Y:
+		return columns.y_m;
+	case BinaryTrajectoryFile::HEADING:
+		return columns.heading_rad;
+	case BinaryTrajectoryFile::CURVATURE:
+		return columns.curvature;
+	default:
+		break;
+	}
+	for (const auto& optional : optionalColumns) {
+		if (optional.column == column) {
+			const auto& values = columns.*optional.values;
+			buffer.resize(columns.size());
+			for (std::size_t i = 0; i < columns.size(); ++i) {
+				buffer[i] = columns.isValid(i, optional.flag) ? values[i] : std::nan("");
+			}
+			return buffer;
+		}
+	}
+	throw std::invalid_argument("Unknown binary trajectory column " + std::to_string(column));
+}
+} // namespace
+
+BinaryTrajectoryFile::BinaryTrajectoryFile(const std::string& path) : file(path) {
+	if (file.size() < sizeof (TrajectoryBinaryFileHeader)
+			|| std::memcmp(header().magic, TRAJECTORY_BINARY_MAGIC, sizeof (TRAJECTORY_BINARY_MAGIC)) != 0) {
+		throw std::invalid_argument("File <" + path + "> is not a binary trajectory file");
+	}
+	if (header().formatVersion != TRAJECTORY_BINARY_VERSION
+			|| header().headerSize != sizeof (TrajectoryBinaryFileHeader)) {
+		throw std::invalid_argument("Binary trajectory file <" + path + "> has unsupported version "
+									+ std::to_string(header().formatVersion));
+	}
+	if (std::memchr(header().name, '\0', sizeof (header().name)) == nullptr) {
+		throw std::invalid_argument("Name in binary trajectory file <" + path + "> is not terminated");
+	}
+	if (header().fieldMask & ~static_cast<uint32_t>(TRAJECTORY_BINARY_KNOWN_FIELDS)) {
+		throw std::invalid_argument("Binary trajectory file <" + path + "> has unknown fields, it may be"
+									" from a newer format version");
+	}
+	if (file.size() != UtilBinaryTrajectoryFileSize(&header())) {
+		throw std::invalid_argument("Size of binary trajectory file <" + path
+									+ "> does not match its header");
+	}
+
+	// Columns are multiples of 8 bytes long and follow the header, which keeps them aligned
+	auto data = file.data() + header().headerSize;
+	timeColumn = reinterpret_cast<const int64_t*>(data);
+	data += size() * sizeof (int64_t);
+	for (int column = 0; column < COLUMN_COUNT; ++column) {
+		if (isStored(static_cast<Column>(column), header().fieldMask)) {
+			columns[column] = reinterpret_cast<const double*>(data);
+			data += size() * sizeof (double);
+		}
+	}
+	modeColumn = reinterpret_cast<const uint8_t*>(data);
+}
+
+TrajectoryColumns BinaryTrajectoryFile::toColumns() const {
+	const auto n = size();
+	TrajectoryColumns result;
+	result.time_ms.assign(timeColumn, timeColumn + n);
+	result.x_m.assign(columns[X], columns[X] + n);
+	result.y_m.assign(columns[Y], columns[Y] + n);
+	result.heading_rad.assign(columns[HEADING], columns[HEADING] + n);
+	result.curvature.assign(columns[CURVATURE], columns[CURVATURE] + n);
+	result.mode.assign(modeColumn, modeColumn + n);
+	result.validity.assign(n, 0);
+	for (const auto& optional : optionalColumns) {
+		auto& values = result.*optional.values;
+		auto stored = columns[optional.column];
+		if (stored == nullptr) {
+			values.assign(n, 0.0);
+			continue;
+		}
+		values.resize(n);
+		for (std::size_t i = 0; i < n; ++i) {
+			const bool valid = !std::isnan(stored[i]);
+			values[i] = valid ? stored[i] : 0.0;
+			result.validity[i] |= valid ? optional.flag : 0;
+		}
+	}
+	return result;
+}
+
+bool BinaryTrajectoryFile::isBinaryTrajectoryFile(const std::string& path) {
+	char magic[sizeof (TRAJECTORY_BINARY_MAGIC)];
+	std::ifstream istrm(path, std::ios_base::in | std::ios_base::binary);
+	return istrm.read(magic, sizeof (magic))
+			&& std::memcmp(magic, TRAJECTORY_BINARY_MAGIC, sizeof (magic)) == 0;
+}
+
+/*!
+ * \brief BinaryTrajectoryFile::write Writes columns to a binary trajectory file.
+ *			Optional columns are only stored if at least one point has a value.
+ * \throws std::ios_base::failure if the file could not be written
+ */
+void BinaryTrajectoryFile::write(
+		const std::string& path,
+		const TrajectoryColumns& columns,
+		const uint32_t id,
+		const std::string& name,
+		const uint16_t version) {
+	TrajectoryBinaryFileHeader header = {};
+	std::memcpy(header.magic, TRAJECTORY_BINARY_MAGIC, sizeof (TRAJECTORY_BINARY_MAGIC));
+	header.formatVersion = TRAJECTORY_BINARY_VERSION;
+	header.headerSize = sizeof (header);
+	header.ID = id;
+	header.majorVersion = version;
+	header.numberOfPoints = columns.size();
+	name.copy(header.name, sizeof (header.name) - 1);
+	for (const auto& optional : optionalColumns) {
+		for (std::size_t i = 0; i < columns.size(); ++i) {
+			if (columns.isValid(i, optional.flag)) {
+				header.fieldMask |= optional.field;
+				break;
+			}
+		}
+	}
+
+	std::ofstream ostrm;
+	ostrm.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+	ostrm.open(path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+	auto writeColumn = [&ostrm](const auto& values) {
+		ostrm.write(reinterpret_cast<const char*>(values.data()),
+					static_cast<std::streamsize>(values.size() * sizeof (values[0])));
+	};
+	ostrm.write(reinterpret_cast<const char*>(&header), sizeof (header));
+	writeColumn(columns.time_ms);
+	std::vector<double> buffer;
+	for (int column = 0; column < COLUMN_COUNT; ++column) {
+		if (isStored(static_cast<Column>(column), header.fieldMask)) {
+			writeColumn(storedValues(columns, static_cast<Column>(column), buffer));
+		}
+	}
+	writeColumn(columns.mode);
+}
+
+} // namespace ATOS
@@ -0,0 +1,62 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#ifndef BINARYTRAJECTORYFILE_H
+#define BINARYTRAJECTORYFILE_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+#include "mappedfile.hpp"
+#include "trajectorycolumns.hpp"
+#include "util.h"
+
+namespace ATOS {
+/*!
+ * \brief Read-only view of a binary trajectory file (see TrajectoryBinaryFileHeader).
+ *			The file is memory mapped and its columns are read in place, so loading
+ *			costs little more than the page faults, and processes opening the same
+ *			file share its pages. Instances are not copyable; share them as
+ *			std::shared_ptr<const BinaryTrajectoryFile>.
+ */
+class BinaryTrajectoryFile {
+public:
+	//! Floating point columns of the file
+	typedef enum {
+		X,
+		Y,
+		Z,
+		HEADING,
+		LONGITUDINAL_VELOCITY,
+		LATERAL_VELOCITY,
+		LONGITUDINAL_ACCELERATION,
+		LATERAL_ACCELERATION,
+		CURVATURE,
+		COLUMN_COUNT
+	} Column;
+
+	explicit BinaryTrajectoryFile(const std::string& path);
+
+	const TrajectoryBinaryFileHeader& header() const { return *reinterpret_cast<const TrajectoryBinaryFileHeader*>(file.data()); }
+	std::size_t size() const { return header().numberOfPoints; }
+	const int64_t* time_ms() const { return timeColumn; }
+	//! \brief Returns the specified column, or nullptr if it is not stored in the file.
+	const double* column(const Column column) const { return columns[column]; }
+	const uint8_t* mode() const { return modeColumn; }
+	TrajectoryColumns toColumns() const;
+
+	static bool isBinaryTrajectoryFile(const std::string& path);
+	static void write(const std::string& path, const TrajectoryColumns& columns,
+					  const uint32_t id, const std::string& name, const uint16_t version);
+private:
+	MappedFile file;
+	const int64_t* timeColumn = nullptr;
+	std::array<const double*, COLUMN_COUNT> columns = {};
+	const uint8_t* modeColumn = nullptr;
+};
+} // namespace ATOS
+
+#endif
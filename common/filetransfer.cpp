@@ -0,0 +1,411 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include "filetransfer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <endian.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using Clock = std::chrono::steady_clock;
+
+namespace ATOS {
+namespace FileTransfer {
+
+static constexpr std::size_t BUFFER_SIZE = 1 << 20;			//!< Buffer size when data passes through user space
+static constexpr std::size_t PIPE_SIZE = 1 << 20;			//!< Requested size of the splice pipe
+static constexpr std::size_t MAX_SENDFILE_SIZE = 1 << 24;	//!< Largest chunk handed to one sendfile call
+
+namespace {
+//! \brief Closes the file descriptor on destruction
+class FileDescriptor {
+public:
+	explicit FileDescriptor(const int fd = -1) : fd(fd) {}
+	~FileDescriptor() { if (fd >= 0) ::close(fd); }
+	FileDescriptor(const FileDescriptor&) = delete;
+	FileDescriptor& operator=(const FileDescriptor&) = delete;
+	int get() const { return fd; }
+	int release() { int released = fd; fd = -1; return released; }
+private:
+	int fd;
+};
+
+//! \brief Makes the socket non-blocking for the lifetime of the guard
+class NonBlockingGuard {
+public:
+	explicit NonBlockingGuard(const int socket) : socket(socket), flags(fcntl(socket, F_GETFL)) {
+		if (flags >= 0 && !(flags & O_NONBLOCK)) {
+			fcntl(socket, F_SETFL, flags | O_NONBLOCK);
+		}
+	}
+	~NonBlockingGuard() {
+		if (flags >= 0 && !(flags & O_NONBLOCK)) {
+			fcntl(socket, F_SETFL, flags);
+		}
+	}
+private:
+	const int socket;
+	const int flags;
+};
+
+/*!
+ * \brief Blocks SIGPIPE in the calling thread for the lifetime of the guard, since
+ *			sendfile has no MSG_NOSIGNAL. A SIGPIPE raised meanwhile is consumed.
+ */
+class SigpipeGuard {
+public:
+	SigpipeGuard() {
+		sigemptyset(&sigpipe);
+		sigaddset(&sigpipe, SIGPIPE);
+		sigset_t pending;
+		sigpending(&pending);
+		wasPending = sigismember(&pending, SIGPIPE) == 1;
+		pthread_sigmask(SIG_BLOCK, &sigpipe, &previousMask);
+	}
+	~SigpipeGuard() {
+		sigset_t pending;
+		sigpending(&pending);
+		if (!wasPending && sigismember(&pending, SIGPIPE) == 1) {
+			const struct timespec noWait = {0, 0};
+			sigtimedwait(&sigpipe, nullptr, &noWait);
+		}
+		pthread_sigmask(SIG_SETMASK, &previousMask, nullptr);
+	}
+private:
+	sigset_t sigpipe;
+	sigset_t previousMask;
+	bool wasPending;
+};
+
+std::system_error systemError(const std::string& what) {
+	return std::system_error(errno, std::generic_category(), what);
+}
+
+bool isConnectionLoss(const int error) {
+	return error == ECONNRESET || error == EPIPE || error == ENOTCONN || error == ETIMEDOUT;
+}
+
+/*!
+ * \brief Waits until the socket is ready for the requested events.
+ * \return false if the deadline passed first
+ */
+bool waitFor(const int socket, const short events, const Clock::time_point deadline) {
+	while (true) {
+		auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - Clock::now());
+		if (remaining.count() <= 0) {
+			return false;
+		}
+		struct pollfd descriptor = {socket, events, 0};
+		int ready = poll(&descriptor, 1, static_cast<int>(remaining.count()));
+		if (ready > 0) {
+			// Errors and hangups are reported by the following read or write
+			return true;
+		}
+		if (ready < 0 && errno != EINTR) {
+			throw systemError("Failed to poll socket");
+		}
+	}
+}
+
+void writeAll(const int fd, const char* data, std::size_t length) {
+	while (length > 0) {
+		ssize_t written = write(fd, data, length);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			throw systemError("Failed to write file");
+		}
+		data += written;
+		length -= static_cast<std::size_t>(written);
+	}
+}
+
+//! \brief Creates a new, uniquely named file next to the destination
+int createTemporaryFile(const std::filesystem::path& destination, std::filesystem::path& temporaryPath) {
+	static std::atomic<unsigned int> counter(0);
+	while (true) {
+		temporaryPath = destination;
+		temporaryPath += ".part." + std::to_string(getpid()) + "." + std::to_string(counter++);
+		int fd = open(temporaryPath.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+		if (fd >= 0) {
+			return fd;
+		}
+		if (errno != EEXIST) {
+			throw systemError("Unable to create file <" + temporaryPath.string() + ">");
+		}
+	}
+}
+
+typedef std::array<std::array<uint32_t, 256>, 8> CrcTable;
+
+constexpr CrcTable makeCrcTable() {
+	CrcTable table = {};
+	for (uint32_t i = 0; i < 256; ++i) {
+		uint32_t crc = i;
+		for (int bit = 0; bit < 8; ++bit) {
+			crc = (crc & 1) ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+		}
+		table[0][i] = crc;
+	}
+	for (std::size_t k = 1; k < table.size(); ++k) {
+		for (uint32_t i = 0; i < 256; ++i) {
+			table[k][i] = (table[k - 1][i] >> 8) ^ table[0][table[k - 1][i] & 0xFF];
+		}
+	}
+	return table;
+}
+
+constexpr CrcTable crcTable = makeCrcTable();
+} // namespace
+
+uint32_t crc32(const uint32_t initialCrc, const void* data, std::size_t length) {
+	// Slicing-by-8: eight table lookups per eight bytes of input
+	auto bytes = static_cast<const unsigned char*>(data);
+	uint32_t crc = ~initialCrc;
+	for (; length >= 8; length -= 8, bytes += 8) {
+		uint32_t low, high;
+		std::memcpy(&low, bytes, sizeof (low));
+		std::memcpy(&high, bytes + 4, sizeof (high));
+		low = le32toh(low) ^ crc;
+		high = le32toh(high);
+		crc = crcTable[7][low & 0xFF] ^ crcTable[6][(low >> 8) & 0xFF]
+			^ crcTable[5][(low >> 16) & 0xFF] ^ crcTable[4][low >> 24]
+			^ crcTable[3][high & 0xFF] ^ crcTable[2][(high >> 8) & 0xFF]
+			^ crcTable[1][(high >> 16) & 0xFF] ^ crcTable[0][high >> 24];
+	}
+	for (; length > 0; --length, ++bytes) {
+		crc = crcTable[0][(crc ^ *bytes) & 0xFF] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+Result receive(const int socket, const std::filesystem::path& destination, const std::size_t size,
+			   const std::chrono::milliseconds idleTimeout, Statistics* statistics,
+			   const bool computeChecksum) {
+	const auto start = Clock::now();
+	NonBlockingGuard nonBlocking(socket);
+	std::filesystem::path temporaryPath;
+	FileDescriptor file(destination.empty() ? -1 : createTemporaryFile(destination, temporaryPath));
+
+	Result result = COMPLETE;
+	std::size_t received = 0;
+	uint32_t checksum = 0;
+	try {
+		if (file.get() >= 0 && size > 0) {
+			// Best effort: reserve the blocks up front to avoid fragmenting the file
+			posix_fallocate(file.get(), 0, static_cast<off_t>(size));
+		}
+
+		// Move data from the socket to the file through a pipe without copying it
+		// to user space, unless the data needs to be checksummed or discarded
+		int pipeEnds[2] = {-1, -1};
+		bool useSplice = file.get() >= 0 && !computeChecksum && pipe2(pipeEnds, O_CLOEXEC) == 0;
+		FileDescriptor pipeOut(pipeEnds[0]), pipeIn(pipeEnds[1]);
+		std::size_t maxSpliceSize = 0;
+		if (useSplice) {
+			// Pipe sizes are limited per user, so keep the default size if the request is refused
+			int pipeSize = fcntl(pipeIn.get(), F_SETPIPE_SZ, static_cast<int>(PIPE_SIZE));
+			if (pipeSize <= 0) {
+				pipeSize = fcntl(pipeIn.get(), F_GETPIPE_SZ);
+			}
+			useSplice = pipeSize > 0;
+			maxSpliceSize = static_cast<std::size_t>(std::max(pipeSize, 0));
+		}
+		std::vector<char> buffer;
+
+		auto deadline = start + idleTimeout;
+		while (received < size) {
+			ssize_t n;
+			if (useSplice) {
+				n = splice(socket, nullptr, pipeIn.get(), nullptr, std::min(size - received, maxSpliceSize),
+						   SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+				if (n < 0 && (errno == EINVAL || errno == ENOSYS)) {
+					// Splicing is not supported for this socket or file system
+					useSplice = false;
+					continue;
+				}
+				for (ssize_t remaining = n; remaining > 0;) {
+					ssize_t moved = splice(pipeOut.get(), nullptr, file.get(), nullptr,
+										   static_cast<std::size_t>(remaining), SPLICE_F_MOVE);
+					if (moved < 0) {
+						if (errno == EINTR) {
+							continue;
+						}
+						throw systemError("Failed to write file <" + temporaryPath.string() + ">");
+					}
+					remaining -= moved;
+				}
+			}
+			else {
+				if (buffer.empty()) {
+					buffer.resize(std::min(size, BUFFER_SIZE));
+				}
+				n = recv(socket, buffer.data(), std::min(size - received, buffer.size()), 0);
+				if (n > 0) {
+					if (computeChecksum) {
+						checksum = crc32(checksum, buffer.data(), static_cast<std::size_t>(n));
+					}
+					if (file.get() >= 0) {
+						writeAll(file.get(), buffer.data(), static_cast<std::size_t>(n));
+					}
+				}
+			}
+
+			if (n > 0) {
+				received += static_cast<std::size_t>(n);
+				deadline = Clock::now() + idleTimeout;
+			}
+			else if (n == 0) {
+				result = CONNECTION_CLOSED;
+				break;
+			}
+			else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				if (!waitFor(socket, POLLIN, deadline)) {
+					result = TIMED_OUT;
+					break;
+				}
+			}
+			else if (isConnectionLoss(errno)) {
+				result = CONNECTION_CLOSED;
+				break;
+			}
+			else if (errno != EINTR) {
+				throw systemError("Failed to receive file data");
+			}
+		}
+
+		if (result == COMPLETE && file.get() >= 0) {
+			if (::close(file.release()) < 0) {
+				throw systemError("Failed to write file <" + temporaryPath.string() + ">");
+			}
+			if (rename(temporaryPath.c_str(), destination.c_str()) < 0) {
+				throw systemError("Unable to replace file <" + destination.string() + ">");
+			}
+		}
+	}
+	catch (...) {
+		if (!temporaryPath.empty()) {
+			unlink(temporaryPath.c_str());
+		}
+		throw;
+	}
+	if (result != COMPLETE && !temporaryPath.empty()) {
+		unlink(temporaryPath.c_str());
+	}
+
+	if (statistics != nullptr) {
+		statistics->bytesTransferred = received;
+		statistics->duration = Clock::now() - start;
+		statistics->checksum = checksum;
+	}
+	return result;
+}
+
+Result send(const int socket, const std::filesystem::path& source,
+			const std::chrono::milliseconds idleTimeout, Statistics* statistics) {
+	const auto start = Clock::now();
+	FileDescriptor file(open(source.c_str(), O_RDONLY | O_CLOEXEC));
+	if (file.get() < 0) {
+		throw systemError("Unable to open file <" + source.string() + ">");
+	}
+	struct stat st;
+	if (fstat(file.get(), &st) < 0) {
+		throw systemError("Unable to read size of file <" + source.string() + ">");
+	}
+	const auto size = static_cast<std::size_t>(st.st_size);
+	posix_fadvise(file.get(), 0, 0, POSIX_FADV_SEQUENTIAL);
+
+	NonBlockingGuard nonBlocking(socket);
+	SigpipeGuard sigpipe;
+	Result result = COMPLETE;
+	off_t offset = 0;
+	bool useSendfile = true;
+	std::vector<char> buffer;
+	std::size_t bufferBegin = 0, bufferEnd = 0;	// Read but unsent part of the buffer
+
+	auto deadline = start + idleTimeout;
+	while (static_cast<std::size_t>(offset) < size) {
+		const std::size_t remaining = size - static_cast<std::size_t>(offset);
+		ssize_t n;
+		if (useSendfile) {
+			n = sendfile(socket, file.get(), &offset, std::min(remaining, MAX_SENDFILE_SIZE));
+			if (n < 0 && (errno == EINVAL || errno == ENOSYS)) {
+				// The file system does not support sendfile
+				useSendfile = false;
+				continue;
+			}
+		}
+		else {
+			if (bufferBegin == bufferEnd) {
+				if (buffer.empty()) {
+					buffer.resize(std::min(size, BUFFER_SIZE));
+				}
+				ssize_t nRead = pread(file.get(), buffer.data(), std::min(remaining, buffer.size()), offset);
+				if (nRead < 0) {
+					if (errno == EINTR) {
+						continue;
+					}
+					throw systemError("Failed to read file <" + source.string() + ">");
+				}
+				if (nRead == 0) {
+					throw std::system_error(std::make_error_code(std::errc::io_error),
+											"File <" + source.string() + "> was truncated while being sent");
+				}
+				bufferBegin = 0;
+				bufferEnd = static_cast<std::size_t>(nRead);
+			}
+			n = ::send(socket, buffer.data() + bufferBegin, bufferEnd - bufferBegin, MSG_NOSIGNAL);
+			if (n > 0) {
+				bufferBegin += static_cast<std::size_t>(n);
+				offset += n;
+			}
+		}
+
+		if (n > 0) {
+			deadline = Clock::now() + idleTimeout;
+		}
+		else if (n == 0) {
+			throw std::system_error(std::make_error_code(std::errc::io_error),
+									"File <" + source.string() + "> was truncated while being sent");
+		}
+		else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+			if (!waitFor(socket, POLLOUT, deadline)) {
+				result = TIMED_OUT;
+				break;
+			}
+		}
+		else if (isConnectionLoss(errno)) {
+			result = CONNECTION_CLOSED;
+			break;
+		}
+		else if (errno != EINTR) {
+			throw systemError("Failed to send file <" + source.string() + ">");
+		}
+	}
+
+	if (statistics != nullptr) {
+		statistics->bytesTransferred = static_cast<std::size_t>(offset);
+		statistics->duration = Clock::now() - start;
+	}
+	return result;
+}
+
+} // namespace FileTransfer
+} // namespace ATOS
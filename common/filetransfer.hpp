@@ -0,0 +1,72 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#ifndef FILETRANSFER_H
+#define FILETRANSFER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace ATOS {
+/*!
+ * \brief Streaming transfer of files over a connected stream socket. Data moves
+ *			between the socket and the file in the kernel where possible (splice
+ *			and sendfile), falling back to large buffered reads and writes.
+ *			Timeouts are measured from the last progress of the transfer, and
+ *			waiting is done in poll(), so a stalled peer costs no CPU.
+ */
+namespace FileTransfer {
+	typedef enum {
+		COMPLETE,			//!< All bytes were transferred
+		TIMED_OUT,			//!< No progress was made within the idle timeout
+		CONNECTION_CLOSED	//!< The peer closed or reset the connection
+	} Result;
+
+	typedef struct {
+		std::size_t bytesTransferred = 0;
+		std::chrono::steady_clock::duration duration = {};
+		uint32_t checksum = 0;		//!< CRC-32 of the transferred data, if requested
+	} Statistics;
+
+	/*!
+	 * \brief Receives exactly size bytes from the socket into a file. The data is
+	 *			written to a temporary file next to the destination, which is renamed
+	 *			over the destination only once all bytes have arrived; an existing
+	 *			destination is thus either kept or replaced in full. If destination
+	 *			is empty, the data is read and discarded.
+	 * \param socket Connected stream socket to read from
+	 * \param destination Path of the file to write
+	 * \param size Number of bytes to receive
+	 * \param idleTimeout Maximum time to wait for data
+	 * \param statistics Optional output of the transfer statistics
+	 * \param computeChecksum Compute a CRC-32 of the received data. This requires
+	 *			the data to pass through user space and disables splicing.
+	 * \return Result of the transfer
+	 * \throws std::system_error if the file could not be written
+	 */
+	Result receive(const int socket, const std::filesystem::path& destination, const std::size_t size,
+				   const std::chrono::milliseconds idleTimeout, Statistics* statistics = nullptr,
+				   const bool computeChecksum = false);
+
+	/*!
+	 * \brief Sends the full contents of a file over the socket.
+	 * \param socket Connected stream socket to write to
+	 * \param source Path of the file to send
+	 * \param idleTimeout Maximum time to wait for the socket to accept more data
+	 * \param statistics Optional output of the transfer statistics
+	 * \return Result of the transfer
+	 * \throws std::system_error if the file could not be read
+	 */
+	Result send(const int socket, const std::filesystem::path& source,
+				const std::chrono::milliseconds idleTimeout, Statistics* statistics = nullptr);
+
+	//! \brief Continues the CRC-32 (IEEE 802.3) crc with length bytes of data. Start from 0.
+	uint32_t crc32(const uint32_t crc, const void* data, const std::size_t length);
+} // namespace FileTransfer
+} // namespace ATOS
+
+#endif
@@ -0,0 +1,302 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include "geofence.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+namespace ATOS {
+
+static std::string trim(const std::string& s) {
+	const char* whitespace = " \t\r\n";
+	auto begin = s.find_first_not_of(whitespace);
+	if (begin == std::string::npos) {
+		return "";
+	}
+	return s.substr(begin, s.find_last_not_of(whitespace) - begin + 1);
+}
+
+static double toDouble(const std::string& token, const std::string& what) {
+	std::size_t parsed = 0;
+	double value = 0.0;
+	try {
+		value = std::stod(token, &parsed);
+	}
+	catch (std::logic_error&) {
+		parsed = 0;
+	}
+	if (parsed != token.size()) {
+		throw std::invalid_argument("Invalid " + what + " <" + token + ">");
+	}
+	return value;
+}
+
+Geofence Geofence::fromFile(const std::string& path) {
+	std::ifstream file(path);
+	if (!file.is_open()) {
+		throw std::ifstream::failure("Unable to open file <" + path + ">");
+	}
+	std::vector<std::string> tokens;
+	std::string token;
+	while (std::getline(file, token, ';')) {
+		token = trim(token);
+		if (!token.empty()) {
+			tokens.push_back(token);
+		}
+	}
+
+	Geofence fence;
+	std::size_t i = 0;
+	auto next = [&]() -> const std::string& {
+		if (i == tokens.size()) {
+			throw std::invalid_argument("Unexpected end of geofence file <" + path + ">");
+		}
+		return tokens[i++];
+	};
+	auto expect = [&](const std::string& keyword) {
+		if (next() != keyword) {
+			throw std::invalid_argument("Expected " + keyword + " in geofence file <" + path + ">");
+		}
+	};
+
+	expect("GEOFENCE");
+	fence.name = next();
+	const double nVertices = toDouble(next(), "number of vertices");
+	const std::string& type = next();
+	if (type == "permitted") {
+		fence.isPermitted = true;
+	}
+	else if (type == "forbidden") {
+		fence.isPermitted = false;
+	}
+	else {
+		throw std::invalid_argument("Invalid geofence type <" + type + "> in file <" + path + ">");
+	}
+	fence.minHeight_m = toDouble(next(), "minimum height");
+	fence.maxHeight_m = toDouble(next(), "maximum height");
+
+	while (next() == "LINE") {
+		Vertex vertex;
+		vertex.x_m = toDouble(next(), "x coordinate");
+		vertex.y_m = toDouble(next(), "y coordinate");
+		fence.vertices.push_back(vertex);
+		// Skip any further coordinates
+		while (next() != "ENDLINE") {}
+	}
+	if (tokens[i - 1] != "ENDGEOFENCE") {
+		throw std::invalid_argument("Expected LINE or ENDGEOFENCE in geofence file <" + path + ">");
+	}
+	if (fence.vertices.size() != nVertices || fence.vertices.size() < 3) {
+		throw std::invalid_argument("Geofence <" + fence.name + "> in file <" + path + "> declares "
+									+ std::to_string(static_cast<long>(nVertices)) + " vertices but has "
+									+ std::to_string(fence.vertices.size()) + ", at least 3 are needed");
+	}
+	return fence;
+}
+
+GeofenceEngine::GeofenceEngine(std::vector<Geofence> geofences) : fences(std::move(geofences)) {
+	cellOffsets.push_back(0);
+	for (const auto& fence : fences) {
+		const auto& vertices = fence.vertices;
+		const std::size_t nVertices = vertices.size();
+		FenceIndex fenceIndex = {};
+		fenceIndex.firstCell = cellOffsets.size() - 1;
+		if (nVertices < 3) {
+			// Degenerate polygon, contains nothing
+			fenceIndex.xMin = fenceIndex.yMin = std::numeric_limits<double>::infinity();
+			fenceIndex.xMax = fenceIndex.yMax = -std::numeric_limits<double>::infinity();
+			index.push_back(fenceIndex);
+			continue;
+		}
+
+		auto xRange = std::minmax_element(vertices.begin(), vertices.end(),
+				[](const Geofence::Vertex& a, const Geofence::Vertex& b) { return a.x_m < b.x_m; });
+		auto yRange = std::minmax_element(vertices.begin(), vertices.end(),
+				[](const Geofence::Vertex& a, const Geofence::Vertex& b) { return a.y_m < b.y_m; });
+		fenceIndex.xMin = xRange.first->x_m;
+		fenceIndex.xMax = xRange.second->x_m;
+		fenceIndex.yMin = yRange.first->y_m;
+		fenceIndex.yMax = yRange.second->y_m;
+		// With about 4n cells, most cells are crossed by few edges
+		const auto gridSize = std::clamp<std::size_t>(
+					static_cast<std::size_t>(std::ceil(2.0 * std::sqrt(nVertices))), 1, MAX_GRID_SIZE);
+		fenceIndex.nRows = fenceIndex.nColumns = gridSize;
+		const double width = fenceIndex.xMax - fenceIndex.xMin;
+		const double height = fenceIndex.yMax - fenceIndex.yMin;
+		fenceIndex.columnsPerMetre = width > 0.0 ? fenceIndex.nColumns / width : 0.0;
+		fenceIndex.rowsPerMetre = height > 0.0 ? fenceIndex.nRows / height : 0.0;
+		const std::size_t nCells = fenceIndex.nRows * fenceIndex.nColumns;
+
+		std::vector<std::size_t> cellEnd(nCells, 0);
+		std::vector<uint8_t> parity(nCells, 0);
+		// First counts the edges to test in each cell and the parity of edges certainly
+		// crossed, then copies the edges into the cells. Horizontal edges are left out
+		// since the ray never crosses them.
+		auto distributeEdges = [&](const bool copy) {
+			for (std::size_t v = 0; v < nVertices; ++v) {
+				const auto& a = vertices[v];
+				const auto& b = vertices[(v + 1) % nVertices];
+				if (a.y_m == b.y_m) {
+					continue;
+				}
+				const double slope = (b.x_m - a.x_m) / (b.y_m - a.y_m);
+				const double xLow = std::min(a.x_m, b.x_m), xHigh = std::max(a.x_m, b.x_m);
+				const std::size_t firstRow = binOf(std::min(a.y_m, b.y_m), fenceIndex.yMin, fenceIndex.rowsPerMetre, fenceIndex.nRows);
+				const std::size_t lastRow = binOf(std::max(a.y_m, b.y_m), fenceIndex.yMin, fenceIndex.rowsPerMetre, fenceIndex.nRows);
+				auto add = [&](const std::size_t cell) {
+					if (!copy) {
+						++cellEnd[cell];
+						return;
+					}
+					const std::size_t e = cellEnd[cell]++;
+					edgeX0[e] = a.x_m;
+					edgeY0[e] = a.y_m;
+					edgeY1[e] = b.y_m;
+					edgeSlope[e] = slope;
+				};
+
+				for (std::size_t row = firstRow; row <= lastRow; ++row) {
+					const std::size_t rowStart = row * fenceIndex.nColumns;
+					if (row == firstRow || row == lastRow) {
+						// The edge ends in this row, so whether the ray crosses it depends on y
+						const std::size_t lastColumn = binOf(xHigh, fenceIndex.xMin, fenceIndex.columnsPerMetre, fenceIndex.nColumns);
+						for (std::size_t column = 0; column <= lastColumn; ++column) {
+							add(rowStart + column);
+						}
+						continue;
+					}
+					// The edge spans the row: rays from cells left of its x range in the row cross
+					// it, and rays from cells right of it do not. The row is widened slightly so
+					// that rounding of the row of a point cannot place it outside the range.
+					const double rowHeight = 1.0 / fenceIndex.rowsPerMetre;
+					const double margin = 1e-6 * rowHeight;
+					const double rowBottom = fenceIndex.yMin + row * rowHeight - margin;
+					const double rowTop = fenceIndex.yMin + (row + 1) * rowHeight + margin;
+					const double xBottom = a.x_m + (rowBottom - a.y_m) * slope;
+					const double xTop = a.x_m + (rowTop - a.y_m) * slope;
+					const double rowXLow = std::clamp(std::min(xBottom, xTop), xLow, xHigh);
+					const double rowXHigh = std::clamp(std::max(xBottom, xTop), xLow, xHigh);
+					const std::size_t firstColumn = binOf(rowXLow, fenceIndex.xMin, fenceIndex.columnsPerMetre, fenceIndex.nColumns);
+					const std::size_t lastColumn = binOf(rowXHigh, fenceIndex.xMin, fenceIndex.columnsPerMetre, fenceIndex.nColumns);
+					if (!copy) {
+						for (std::size_t column = 0; column < firstColumn; ++column) {
+							parity[rowStart + column] ^= 1;
+						}
+					}
+					for (std::size_t column = firstColumn; column <= lastColumn; ++column) {
+						add(rowStart + column);
+					}
+				}
+			}
+		};
+
+		distributeEdges(false);
+		std::size_t offset = edgeX0.size();
+		for (auto& end : cellEnd) {
+			std::size_t count = end;
+			end = offset;		// Becomes the copy position of the cell
+			offset += count;
+			cellOffsets.push_back(offset);
+		}
+		edgeX0.resize(offset);
+		edgeY0.resize(offset);
+		edgeY1.resize(offset);
+		edgeSlope.resize(offset);
+		distributeEdges(true);
+		cellParity.insert(cellParity.end(), parity.begin(), parity.end());
+		index.push_back(fenceIndex);
+	}
+}
+
+GeofenceEngine GeofenceEngine::fromDirectory(const std::string& path, std::vector<std::string>* errors) {
+	std::vector<std::filesystem::path> files;
+	for (const auto& entry : std::filesystem::directory_iterator(path)) {
+		if (entry.is_regular_file()) {
+			files.push_back(entry.path());
+		}
+	}
+	std::sort(files.begin(), files.end());
+
+	std::vector<Geofence> geofences;
+	for (const auto& file : files) {
+		try {
+			geofences.push_back(Geofence::fromFile(file.string()));
+		}
+		catch (std::exception& e) {
+			if (errors != nullptr) {
+				errors->push_back(e.what());
+			}
+		}
+	}
+	return GeofenceEngine(std::move(geofences));
+}
+
+std::size_t GeofenceEngine::binOf(const double value, const double min, const double binsPerMetre,
+								 const std::size_t nBins) {
+	// Monotonic in value, so values between two others never fall outside their bins
+	const double bin = (value - min) * binsPerMetre;
+	if (!(bin > 0.0)) {
+		return 0;
+	}
+	return std::min(static_cast<std::size_t>(bin), nBins - 1);
+}
+
+std::size_t GeofenceEngine::cellOf(const FenceIndex& fence, const double x_m, const double y_m) const {
+	return fence.firstCell + binOf(y_m, fence.yMin, fence.rowsPerMetre, fence.nRows) * fence.nColumns
+			+ binOf(x_m, fence.xMin, fence.columnsPerMetre, fence.nColumns);
+}
+
+bool GeofenceEngine::contains(const std::size_t geofence, const double x_m, const double y_m) const {
+	const auto& fence = index[geofence];
+	if (!(x_m >= fence.xMin && x_m <= fence.xMax && y_m >= fence.yMin && y_m <= fence.yMax)) {
+		return false;
+	}
+	const std::size_t cell = cellOf(fence, x_m, y_m);
+	const std::size_t begin = cellOffsets[cell], end = cellOffsets[cell + 1];
+	const double* x0 = edgeX0.data();
+	const double* y0 = edgeY0.data();
+	const double* y1 = edgeY1.data();
+	const double* slope = edgeSlope.data();
+
+	// Count crossings of a ray in positive x direction with the edges of the cell.
+	// The comparison of y against both end points counts a vertex on the ray once.
+	unsigned int crossings = cellParity[cell];
+	for (std::size_t e = begin; e < end; ++e) {
+		const bool spansY = (y0[e] > y_m) != (y1[e] > y_m);
+		const double xCrossing = x0[e] + (y_m - y0[e]) * slope[e];
+		crossings += spansY & (x_m < xCrossing);
+	}
+	return crossings & 1u;
+}
+
+bool GeofenceEngine::isInside(const std::size_t geofence, const Position& position) const {
+	const auto& fence = fences[geofence];
+	// A fence without a height interval extends infinitely upwards and downwards
+	if (position.isZValid && fence.maxHeight_m > fence.minHeight_m
+			&& (position.z_m < fence.minHeight_m || position.z_m > fence.maxHeight_m)) {
+		return false;
+	}
+	return contains(geofence, position.x_m, position.y_m);
+}
+
+void GeofenceEngine::check(const std::vector<Position>& positions, std::vector<Breach>& breaches) const {
+	breaches.clear();
+	// Fences in the outer loop, so that the edges of each fence stay in cache for the whole batch
+	for (std::size_t g = 0; g < fences.size(); ++g) {
+		for (const auto& position : positions) {
+			if (isInside(g, position) != fences[g].isPermitted) {
+				breaches.push_back({position.objectId, g});
+			}
+		}
+	}
+}
+
+} // namespace ATOS
@@ -0,0 +1,125 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#ifndef GEOFENCE_H
+#define GEOFENCE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ATOS {
+/*!
+ * \brief A polygonal area in the test plane with a height interval. Objects
+ *			must stay inside every permitted geofence and outside every forbidden one.
+ */
+class Geofence {
+public:
+	typedef struct {
+		double x_m;
+		double y_m;
+	} Vertex;
+
+	std::string name;
+	bool isPermitted = true;
+	double minHeight_m = 0.0;
+	double maxHeight_m = 0.0;
+	std::vector<Vertex> vertices;	//!< Polygon vertices, implicitly closed
+
+	/*!
+	 * \brief Reads a geofence file of the form
+	 *			GEOFENCE;<name>;<number of vertices>;<permitted|forbidden>;<min height>;<max height>;
+	 *			LINE;<x>;<y>;ENDLINE;
+	 *			...
+	 *			ENDGEOFENCE;
+	 * \throws std::ifstream::failure if the file could not be read
+	 * \throws std::invalid_argument if the file is malformed
+	 */
+	static Geofence fromFile(const std::string& path);
+};
+
+/*!
+ * \brief Checks positions of many objects against a fixed set of geofences.
+ *
+ *			Each geofence is covered by a uniform grid. A containment test counts
+ *			crossings of a ray in positive x direction with the polygon edges. Edges
+ *			that cross the whole row of a cell to the right of the cell are crossed
+ *			by the ray of any point in the cell, so their parity is stored per cell,
+ *			and only the few remaining edges near the cell are tested. These are
+ *			stored per cell in struct-of-arrays form and tested in a loop without
+ *			branches that the compiler can vectorize. The cost of a test thus depends
+ *			on the local complexity of the polygon, not on its number of vertices.
+ *
+ *			The engine is immutable once built, so it may be queried from several
+ *			threads at once; replace it as a whole when the geofences change.
+ */
+class GeofenceEngine {
+public:
+	typedef struct {
+		uint32_t objectId;
+		double x_m;
+		double y_m;
+		double z_m;
+		bool isZValid;	//!< If false, the height interval of geofences is not checked
+	} Position;
+
+	typedef struct {
+		uint32_t objectId;
+		std::size_t geofence;	//!< Index of the breached geofence
+	} Breach;
+
+	GeofenceEngine() = default;
+	explicit GeofenceEngine(std::vector<Geofence> geofences);
+
+	/*!
+	 * \brief Builds an engine from all geofence files in a directory.
+	 * \param errors If not null, receives a description of each file that
+	 *			could not be read. Such files are skipped.
+	 */
+	static GeofenceEngine fromDirectory(const std::string& path, std::vector<std::string>* errors = nullptr);
+
+	const std::vector<Geofence>& geofences() const { return fences; }
+	bool empty() const { return fences.empty(); }
+
+	//! \brief Whether the point lies inside the polygon of a geofence, ignoring its height interval
+	bool contains(const std::size_t geofence, const double x_m, const double y_m) const;
+	//! \brief Whether the position is inside a geofence, including its height interval
+	bool isInside(const std::size_t geofence, const Position& position) const;
+	/*!
+	 * \brief Checks a batch of positions against all geofences. A permitted geofence
+	 *			is breached by a position outside it, and a forbidden one by a position
+	 *			inside it, so an object outside any permitted geofence is in breach.
+	 * \param positions Latest positions of the objects
+	 * \param breaches Cleared and filled with one entry per object and breached geofence
+	 */
+	void check(const std::vector<Position>& positions, std::vector<Breach>& breaches) const;
+
+private:
+	//! Bounding box and grid layout of one geofence
+	typedef struct {
+		double xMin, xMax, yMin, yMax;
+		double rowsPerMetre, columnsPerMetre;
+		std::size_t nRows, nColumns;
+		std::size_t firstCell;	//!< Index of the first cell of the geofence in cellOffsets
+	} FenceIndex;
+
+	static constexpr std::size_t MAX_GRID_SIZE = 256;	//!< Maximum number of rows and of columns
+
+	std::vector<Geofence> fences;
+	std::vector<FenceIndex> index;
+	std::vector<std::size_t> cellOffsets;	//!< Edges of cell c are [cellOffsets[c], cellOffsets[c+1])
+	std::vector<uint8_t> cellParity;		//!< Parity of the edges certainly crossed from cell c
+	// Edge arrays: start point, end y and inverse slope dx/dy
+	std::vector<double> edgeX0;
+	std::vector<double> edgeY0;
+	std::vector<double> edgeY1;
+	std::vector<double> edgeSlope;
+
+	static std::size_t binOf(const double value, const double min, const double binsPerMetre, const std::size_t nBins);
+	std::size_t cellOf(const FenceIndex& fence, const double x_m, const double y_m) const;
+};
+} // namespace ATOS
+
+#endif
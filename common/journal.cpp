@@ -13,6 +13,10 @@
 #include <ctime>
 #include <cerrno>
 #include <cstring>
+#include <cstdarg>
+#include <atomic>
+#include <memory>
+#include <thread>
 
 #define JOURNAL_LABEL_MAX_LENGTH 100
 #define FILENAME_DATESTR_MAX_LENGTH 100
@@ -23,117 +27,353 @@
 
 #define DAY_LENGTH_S (24*60*60)
 
+#define JOURNAL_QUEUE_CAPACITY 8192		// Must be a power of two
+#define JOURNAL_WRITE_BUFFER_SIZE (256*1024)
+#define JOURNAL_MAX_BATCH_SIZE 1024
+#define JOURNAL_IDLE_PERIOD std::chrono::milliseconds(10)
+
 using Clock = std::chrono::system_clock;
 using Days = std::chrono::duration<int, std::ratio_multiply<std::chrono::hours::period, std::ratio<24> >::type>;
 using Seconds = std::chrono::duration<double>;
 template<class Duration>
 using TimePoint = std::chrono::time_point<Clock, Duration>;
 
+/*!
+ * \brief A record waiting to be written by the journal writer thread. The time
+ *			of recording is stored so that queueing delays do not affect it.
+ */
+struct JournalRecord {
+	JournalRecordType type = JOURNAL_RECORD_STRING;
+	double recordTime = 0.0;
+	JournalBinaryMonitorRecord monitor;	//!< Set for monitor data records
+	std::string text;					//!< Set for all other records
+};
+
+/*!
+ * \brief Bounded lock-free queue with multiple producers and a single consumer.
+ *			Each slot carries a sequence number telling whether it is free for the
+ *			producer holding a given position, or filled for the consumer.
+ */
+class JournalQueue {
+public:
+	explicit JournalQueue(const size_t capacity) : slots(new Slot[capacity]), mask(capacity - 1) {
+		for (size_t i = 0; i < capacity; ++i) {
+			slots[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+	//! \brief Adds a record unless the queue is full. Safe to call from any thread.
+	bool tryPush(JournalRecord&& record) {
+		auto pos = enqueuePos.load(std::memory_order_relaxed);
+		while (true) {
+			auto& slot = slots[pos & mask];
+			auto seq = slot.sequence.load(std::memory_order_acquire);
+			auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+			if (diff == 0) {
+				if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					slot.record = std::move(record);
+					slot.sequence.store(pos + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (diff < 0) {
+				return false;
+			}
+			else {
+				pos = enqueuePos.load(std::memory_order_relaxed);
+			}
+		}
+	}
+	//! \brief Removes the oldest record. May only be called from the consumer thread.
+	bool tryPop(JournalRecord& record) {
+		auto& slot = slots[dequeuePos & mask];
+		auto seq = slot.sequence.load(std::memory_order_acquire);
+		if (static_cast<intptr_t>(seq) - static_cast<intptr_t>(dequeuePos + 1) < 0) {
+			return false;
+		}
+		record = std::move(slot.record);
+		slot.sequence.store(dequeuePos + mask + 1, std::memory_order_release);
+		++dequeuePos;
+		return true;
+	}
+private:
+	struct Slot {
+		std::atomic<size_t> sequence;
+		JournalRecord record;
+	};
+	std::unique_ptr<Slot[]> slots;
+	const size_t mask;
+	alignas(64) std::atomic<size_t> enqueuePos = {0};
+	alignas(64) size_t dequeuePos = 0;
+};
+
 static std::string journalPath;
 static std::string journalLabel;
 static TimePoint<Days> creationDate;
+static JournalFormatType journalFormat = JOURNAL_FORMAT_TEXT;
+static FILE* journalFile = nullptr;
+static FILE* indexFile = nullptr;
+static long lastIndexedOffset = 0;
+
+static JournalQueue recordQueue(JOURNAL_QUEUE_CAPACITY);
+static std::thread writerThread;
+static std::atomic<bool> isJournalActive(false);
+static std::atomic<bool> isStopRequested(false);
+static std::atomic<uint64_t> nDroppedRecords(0);
 
 static int reinitializeJournal(void);
 static int checkDate(void);
-static FILE* beginJournalEntry(void);
-static int endJournalEntry(FILE*);
+static void writeJournal(void);
+static int writeRecord(const JournalRecord&);
+static int writeMonitorText(FILE*, const JournalBinaryMonitorRecord&);
+static void indexRecord(const JournalRecord&);
+static int enqueueRecord(JournalRecord&&);
+static double currentTime(void);
 
 static std::string logName;
 
-int JournalInit(const char* journalName, rclcpp::Logger log) {
+//! Ensures queued records are written when the process exits
+static struct JournalCloser {
+	~JournalCloser() { JournalClose(); }
+} journalCloser;
+
+int JournalInit(const char* journalName, rclcpp::Logger log, JournalFormatType format) {
+	JournalClose();
 	logName = log.get_name();
 	journalLabel = journalName;
-	return reinitializeJournal();
+	journalFormat = format;
+	if (reinitializeJournal() == -1) {
+		return -1;
+	}
+	isStopRequested = false;
+	isJournalActive = true;
+	writerThread = std::thread(writeJournal);
+	return 0;
+}
+
+/*!
+ * \brief Stops the writer thread after it has written all queued records, and
+ *			closes the journal file.
+ */
+void JournalClose() {
+	isJournalActive = false;
+	if (writerThread.joinable()) {
+		isStopRequested.store(true, std::memory_order_release);
+		writerThread.join();
+	}
+	if (journalFile != nullptr) {
+		fclose(journalFile);
+		journalFile = nullptr;
+	}
+	if (indexFile != nullptr) {
+		fclose(indexFile);
+		indexFile = nullptr;
+	}
 }
 
 int JournalRecordData(const JournalRecordType type, const char* format, ...) {
-	va_list args;
-	FILE* fp;
-	checkDate();
-	fp = beginJournalEntry();
-	if (fp != nullptr) {
-		va_start(args, format);
-		switch (type) {
-		case JOURNAL_RECORD_EVENT:
-			fprintf(fp, EVENT_FLAG);
-			break;
-		case JOURNAL_RECORD_STRING:
-			// TODO: print some specifier
-			break;
-		case JOURNAL_RECORD_MONITOR_DATA:
-			// TODO: print some specifier
-			// TODO: call recordMonitorData with args somehow
-			break;
-		}
-		vfprintf(fp, format, args);
+	if (!isJournalActive) {
+		return -1;
+	}
+	JournalRecord record;
+	record.type = type;
+	record.recordTime = currentTime();
+
+	va_list args, argsCopy;
+	va_start(args, format);
+	va_copy(argsCopy, args);
+	auto length = vsnprintf(nullptr, 0, format, argsCopy);
+	va_end(argsCopy);
+	if (length < 0) {
 		va_end(args);
-		return endJournalEntry(fp);
+		return -1;
 	}
-	else {
-		RCLCPP_ERROR(rclcpp::get_logger(logName), "Unable to open journal file %s for writing", journalPath.c_str());
+	record.text.resize(static_cast<size_t>(length) + 1);
+	vsnprintf(&record.text[0], record.text.size(), format, args);
+	va_end(args);
+	record.text.resize(static_cast<size_t>(length));
+	return enqueueRecord(std::move(record));
+}
+
+/*!
+ * \brief Queues monitor data for writing. Formatting and file access happen on the
+ *			journal writer thread, so this is cheap enough to call for every MONR.
+ * \return 0 if the record was queued, -1 if the journal is closed or the queue full
+ */
+int JournalRecordMonitorData(const ObjectDataType* objectData) {
+	if (!isJournalActive) {
 		return -1;
 	}
+	JournalRecord record;
+	record.type = JOURNAL_RECORD_MONITOR_DATA;
+	record.recordTime = currentTime();
+	record.monitor.clientID = objectData->ClientID;
+	record.monitor.clientIP = objectData->ClientIP;
+	record.monitor.monitorData = objectData->MonrData;
+	return enqueueRecord(std::move(record));
 }
 
+int enqueueRecord(JournalRecord&& record) {
+	if (!recordQueue.tryPush(std::move(record))) {
+		nDroppedRecords.fetch_add(1, std::memory_order_relaxed);
+		return -1;
+	}
+	return 0;
+}
 
-int JournalRecordMonitorData(const ObjectDataType* objectData) {
-	FILE* fp;
-	char errorString[1024];
-	char ipString[INET_ADDRSTRLEN];
-	const ObjectMonitorType* data = &objectData->MonrData;
-	checkDate();
-	fp = beginJournalEntry();
-	if (fp != nullptr) {
-		data->isTimestampValid ? fprintf(fp, "%.6f" DELIMITER, data->timestamp.tv_sec + data->timestamp.tv_usec / 1000000.0)
-							   : fprintf(fp, "NaN" DELIMITER);
-		fprintf(fp, "%u" DELIMITER, objectData->ClientID);
-		fprintf(fp, "%s" DELIMITER, inet_ntop(AF_INET, &objectData->ClientIP, ipString, sizeof (ipString)));
-		data->position.isPositionValid	? fprintf(fp, "%.3f" DELIMITER "%.3f" DELIMITER "%.3f" DELIMITER,
-												 data->position.xCoord_m, data->position.yCoord_m, data->position.zCoord_m)
-										: fprintf(fp, "NaN" DELIMITER "NaN" DELIMITER "NaN" DELIMITER);
-		data->position.isHeadingValid ? fprintf(fp, "%.2f" DELIMITER, data->position.heading_rad)
-									  : fprintf(fp, "NaN" DELIMITER);
-		data->speed.isLongitudinalValid ? fprintf(fp, "%.2f" DELIMITER, data->speed.longitudinal_m_s)
-										: fprintf(fp, "NaN" DELIMITER);
-		data->speed.isLateralValid ? fprintf(fp, "%.2f" DELIMITER, data->speed.lateral_m_s)
-								   : fprintf(fp, "NaN" DELIMITER);
-		data->acceleration.isLongitudinalValid ? fprintf(fp, "%.3f" DELIMITER, data->acceleration.longitudinal_m_s2)
-											   : fprintf(fp, "NaN" DELIMITER);
-		data->acceleration.isLateralValid ? fprintf(fp, "%.3f" DELIMITER, data->acceleration.lateral_m_s2)
-											   : fprintf(fp, "NaN" DELIMITER);
-		switch (data->drivingDirection) {
-		case DriveDirectionType::OBJECT_DRIVE_DIRECTION_FORWARD:
-			fprintf(fp, "FWD" DELIMITER);
-			break;
-		case DriveDirectionType::OBJECT_DRIVE_DIRECTION_BACKWARD:
-			fprintf(fp, "REV" DELIMITER);
-			break;
-		case DriveDirectionType::OBJECT_DRIVE_DIRECTION_UNAVAILABLE:
-		default:
-			fprintf(fp, "NaN" DELIMITER);
-			break;
+double currentTime() {
+	return std::chrono::time_point_cast<Seconds>(Clock::now()).time_since_epoch().count();
+}
+
+/*!
+ * \brief Body of the writer thread. Drains the queue in batches into the open
+ *			journal file, and handles day rollover so producers never block on it.
+ */
+void writeJournal() {
+	JournalRecord record;
+	uint64_t nReportedDrops = 0;
+	while (true) {
+		// Read before draining, so records queued before the stop request are written
+		bool isStopping = isStopRequested.load(std::memory_order_acquire);
+		checkDate();
+		unsigned int nWritten = 0;
+		while (nWritten < JOURNAL_MAX_BATCH_SIZE && recordQueue.tryPop(record)) {
+			if (nWritten == 0) {
+				indexRecord(record);
+			}
+			if (writeRecord(record) == -1) {
+				RCLCPP_ERROR(rclcpp::get_logger(logName), "Unable to write to journal file %s", journalPath.c_str());
+			}
+			++nWritten;
 		}
-		fprintf(fp, "%s" DELIMITER, objectStateToASCII(data->state));
-		switch (data->armReadiness) {
-		case ObjectArmReadinessType::OBJECT_READY_TO_ARM:
-			fprintf(fp, "READY_TO_ARM" DELIMITER);
-			break;
-		case ObjectArmReadinessType::OBJECT_NOT_READY_TO_ARM:
-			fprintf(fp, "NOT_READY_TO_ARM" DELIMITER);
-			break;
-		case ObjectArmReadinessType::OBJECT_READY_TO_ARM_UNAVAILABLE:
-		default:
-			fprintf(fp, "NaN" DELIMITER);
-			break;
+		if (nWritten > 0 && journalFile != nullptr) {
+			fflush(journalFile);
+			if (indexFile != nullptr) {
+				fflush(indexFile);
+			}
+		}
+
+		auto nDropped = nDroppedRecords.load(std::memory_order_relaxed);
+		if (nDropped != nReportedDrops) {
+			RCLCPP_WARN(rclcpp::get_logger(logName), "Journal queue full, dropped %lu records",
+						nDropped - nReportedDrops);
+			nReportedDrops = nDropped;
+		}
+
+		if (nWritten == 0) {
+			if (isStopping) {
+				break;
+			}
+			std::this_thread::sleep_for(JOURNAL_IDLE_PERIOD);
 		}
-		errorStatusToASCII(data->error, errorString, sizeof (errorString));
-		fprintf(fp, "%s" DELIMITER, errorString);
-		return endJournalEntry(fp);
 	}
-	else {
-		RCLCPP_ERROR(rclcpp::get_logger(logName), "Unable to open journal file %s for writing", journalPath.c_str());
+}
+
+int writeRecord(const JournalRecord& record) {
+	if (journalFile == nullptr) {
 		return -1;
 	}
+	if (journalFormat == JOURNAL_FORMAT_BINARY) {
+		JournalBinaryRecordHeader header;
+		header.type = static_cast<uint8_t>(record.type);
+		header.recordTime = record.recordTime;
+		const void* payload;
+		if (record.type == JOURNAL_RECORD_MONITOR_DATA) {
+			header.length = sizeof (record.monitor);
+			payload = &record.monitor;
+		}
+		else {
+			header.length = static_cast<uint32_t>(record.text.size());
+			payload = record.text.data();
+		}
+		if (fwrite(&header, sizeof (header), 1, journalFile) != 1
+				|| fwrite(payload, 1, header.length, journalFile) != header.length) {
+			return -1;
+		}
+		return 0;
+	}
+
+	fprintf(journalFile, "%f: ", record.recordTime);
+	switch (record.type) {
+	case JOURNAL_RECORD_EVENT:
+		fprintf(journalFile, EVENT_FLAG);
+		fputs(record.text.c_str(), journalFile);
+		break;
+	case JOURNAL_RECORD_STRING:
+		// TODO: print some specifier
+		fputs(record.text.c_str(), journalFile);
+		break;
+	case JOURNAL_RECORD_MONITOR_DATA:
+		writeMonitorText(journalFile, record.monitor);
+		break;
+	}
+	fprintf(journalFile, "\n");
+	return ferror(journalFile) ? -1 : 0;
+}
+
+/*!
+ * \brief Adds an index entry for a record about to be written, if the journal has
+ *			grown by at least JOURNAL_INDEX_INTERVAL since the previous entry. Only
+ *			called for the first record of each batch, to limit the number of ftell calls.
+ */
+void indexRecord(const JournalRecord& record) {
+	if (indexFile == nullptr || journalFile == nullptr) {
+		return;
+	}
+	auto offset = ftell(journalFile);
+	if (offset >= 0 && (offset == 0 || offset - lastIndexedOffset >= JOURNAL_INDEX_INTERVAL)) {
+		fprintf(indexFile, "%f %ld\n", record.recordTime, offset);
+		lastIndexedOffset = offset;
+	}
+}
+
+int writeMonitorText(FILE* fp, const JournalBinaryMonitorRecord& record) {
+	char errorString[1024];
+	char ipString[INET_ADDRSTRLEN];
+	const ObjectMonitorType* data = &record.monitorData;
+	data->isTimestampValid ? fprintf(fp, "%.6f" DELIMITER, data->timestamp.tv_sec + data->timestamp.tv_usec / 1000000.0)
+						   : fprintf(fp, "NaN" DELIMITER);
+	fprintf(fp, "%u" DELIMITER, record.clientID);
+	fprintf(fp, "%s" DELIMITER, inet_ntop(AF_INET, &record.clientIP, ipString, sizeof (ipString)));
+	data->position.isPositionValid	? fprintf(fp, "%.3f" DELIMITER "%.3f" DELIMITER "%.3f" DELIMITER,
+											 data->position.xCoord_m, data->position.yCoord_m, data->position.zCoord_m)
+									: fprintf(fp, "NaN" DELIMITER "NaN" DELIMITER "NaN" DELIMITER);
+	data->position.isHeadingValid ? fprintf(fp, "%.2f" DELIMITER, data->position.heading_rad)
+								  : fprintf(fp, "NaN" DELIMITER);
+	data->speed.isLongitudinalValid ? fprintf(fp, "%.2f" DELIMITER, data->speed.longitudinal_m_s)
+									: fprintf(fp, "NaN" DELIMITER);
+	data->speed.isLateralValid ? fprintf(fp, "%.2f" DELIMITER, data->speed.lateral_m_s)
+							   : fprintf(fp, "NaN" DELIMITER);
+	data->acceleration.isLongitudinalValid ? fprintf(fp, "%.3f" DELIMITER, data->acceleration.longitudinal_m_s2)
+										   : fprintf(fp, "NaN" DELIMITER);
+	data->acceleration.isLateralValid ? fprintf(fp, "%.3f" DELIMITER, data->acceleration.lateral_m_s2)
+										   : fprintf(fp, "NaN" DELIMITER);
+	switch (data->drivingDirection) {
+	case DriveDirectionType::OBJECT_DRIVE_DIRECTION_FORWARD:
+		fprintf(fp, "FWD" DELIMITER);
+		break;
+	case DriveDirectionType::OBJECT_DRIVE_DIRECTION_BACKWARD:
+		fprintf(fp, "REV" DELIMITER);
+		break;
+	case DriveDirectionType::OBJECT_DRIVE_DIRECTION_UNAVAILABLE:
+	default:
+		fprintf(fp, "NaN" DELIMITER);
+		break;
+	}
+	fprintf(fp, "%s" DELIMITER, objectStateToASCII(data->state));
+	switch (data->armReadiness) {
+	case ObjectArmReadinessType::OBJECT_READY_TO_ARM:
+		fprintf(fp, "READY_TO_ARM" DELIMITER);
+		break;
+	case ObjectArmReadinessType::OBJECT_NOT_READY_TO_ARM:
+		fprintf(fp, "NOT_READY_TO_ARM" DELIMITER);
+		break;
+	case ObjectArmReadinessType::OBJECT_READY_TO_ARM_UNAVAILABLE:
+	default:
+		fprintf(fp, "NaN" DELIMITER);
+		break;
+	}
+	errorStatusToASCII(data->error, errorString, sizeof (errorString));
+	return fprintf(fp, "%s" DELIMITER, errorString);
 }
 
 int reinitializeJournal() {
@@ -152,7 +392,8 @@ int reinitializeJournal() {
 
 	// Form base filename from path and label
 	UtilGetJournalDirectoryPath(journalDirPath, sizeof (journalDirPath));
-	journalPath = journalDirPath + journalLabel + "-" + dateStr + JOURNAL_FILE_ENDING;
+	journalPath = journalDirPath + journalLabel + "-" + dateStr
+			+ (journalFormat == JOURNAL_FORMAT_BINARY ? JOURNAL_BINARY_FILE_ENDING : JOURNAL_FILE_ENDING);
 
 	// Check if log directory exists
 	if(stat(journalDirPath, &sb)) {
@@ -172,7 +413,8 @@ int reinitializeJournal() {
 	*cptr = '\0';
 
 	// Check if journal already exists
-	if (access(journalPath.c_str(), F_OK) != -1) {
+	bool isNewFile = access(journalPath.c_str(), F_OK) == -1;
+	if (!isNewFile) {
 		RCLCPP_DEBUG(rclcpp::get_logger(logName), "Found existing journal %s", journalPath.c_str());
 		printout = "Opened on ";
 		printout.append(dateStr);
@@ -183,8 +425,48 @@ int reinitializeJournal() {
 		printout.append(dateStr);
 	}
 
+	// Keep the file open until the next rollover, replacing any previous one
+	FILE* fp = fopen(journalPath.c_str(), JOURNAL_FILE_WRITE_MODE);
+	if (fp == nullptr) {
+		RCLCPP_ERROR(rclcpp::get_logger(logName), "Unable to open journal file %s for writing", journalPath.c_str());
+		return -1;
+	}
+	setvbuf(fp, nullptr, _IOFBF, JOURNAL_WRITE_BUFFER_SIZE);
+	if (journalFile != nullptr) {
+		fclose(journalFile);
+	}
+	journalFile = fp;
+	fseek(journalFile, 0, SEEK_END);
+
+	if (indexFile != nullptr) {
+		fclose(indexFile);
+		indexFile = nullptr;
+	}
+	if (journalFormat == JOURNAL_FORMAT_TEXT) {
+		auto indexPath = journalPath + JOURNAL_INDEX_FILE_ENDING;
+		indexFile = fopen(indexPath.c_str(), JOURNAL_FILE_WRITE_MODE);
+		if (indexFile == nullptr) {
+			RCLCPP_WARN(rclcpp::get_logger(logName), "Unable to open journal index %s", indexPath.c_str());
+		}
+		// Index the first record written by this process
+		lastIndexedOffset = ftell(journalFile) - JOURNAL_INDEX_INTERVAL;
+	}
+
+	if (journalFormat == JOURNAL_FORMAT_BINARY && isNewFile) {
+		JournalBinaryFileHeader header = {};
+		memcpy(header.magic, JOURNAL_BINARY_MAGIC, sizeof (JOURNAL_BINARY_MAGIC));
+		header.version = JOURNAL_BINARY_VERSION;
+		header.monitorRecordSize = sizeof (JournalBinaryMonitorRecord);
+		fwrite(&header, sizeof (header), 1, journalFile);
+	}
+
 	// Print initialization message to journal to catch errors
-	if (JournalRecordData(JOURNAL_RECORD_STRING,printout.c_str()) == -1) {
+	JournalRecord record;
+	record.type = JOURNAL_RECORD_STRING;
+	record.recordTime = currentTime();
+	record.text = printout;
+	indexRecord(record);
+	if (writeRecord(record) == -1 || fflush(journalFile) != 0) {
 		RCLCPP_ERROR(rclcpp::get_logger(logName), "Unable to write to file %s", journalPath.c_str());
 		return -1;
 	}
@@ -193,6 +475,10 @@ int reinitializeJournal() {
 	return 0;
 }
 
+/*!
+ * \brief Begins a new journal file if the day has changed. Only called from the
+ *			writer thread, so producers are not held up by the rollover.
+ */
 int checkDate() {
 	auto today = std::chrono::time_point_cast<Days>(Clock::now());
 	if (today == creationDate) {
@@ -205,17 +491,3 @@ int checkDate() {
 	}
 	return 0;
 }
-
-FILE* beginJournalEntry() {
-	FILE *fp = fopen(journalPath.c_str(), JOURNAL_FILE_WRITE_MODE);
-	if (fp != nullptr) {
-		auto now = std::chrono::time_point_cast<Seconds>(Clock::now());
-		fprintf(fp, "%f: ", now.time_since_epoch().count());
-	}
-	return fp;
-}
-
-int endJournalEntry(FILE* fp) {
-	fprintf(fp, "\n");
-	return fclose(fp);
-}
@@ -7,6 +7,10 @@
 #define __JOURNAL_HPP
 
 #define JOURNAL_FILE_ENDING ".jnl"
+#define JOURNAL_INDEX_FILE_ENDING ".idx"
+#define JOURNAL_BINARY_FILE_ENDING ".bjnl"
+#define JOURNAL_BINARY_MAGIC "ATOSJNL"
+#define JOURNAL_BINARY_VERSION 1
 
 #include "util.h"
 #include <rclcpp/logging.hpp>
@@ -17,8 +21,46 @@ typedef enum {
 	JOURNAL_RECORD_STRING
 } JournalRecordType;
 
-int JournalInit(const char* name, rclcpp::Logger logger);
+/*!
+ * Text journals are accompanied by a sparse index, named as the journal with
+ * JOURNAL_INDEX_FILE_ENDING appended. Each line holds the time of a record and
+ * its byte offset in the journal, separated by a space. Entries are at least
+ * JOURNAL_INDEX_INTERVAL bytes apart.
+ */
+#define JOURNAL_INDEX_INTERVAL (1024*1024)
+
+typedef enum {
+	JOURNAL_FORMAT_TEXT,	//!< Human readable lines, merged by JournalControl
+	JOURNAL_FORMAT_BINARY	//!< Length prefixed binary records, see below
+} JournalFormatType;
+
+/*!
+ * A binary journal starts with a JournalBinaryFileHeader, followed by records
+ * each consisting of a JournalBinaryRecordHeader and a payload. Monitor data
+ * records carry a JournalBinaryMonitorRecord, other records their text
+ * without event flag or newline.
+ */
+typedef struct __attribute__((packed)) {
+	char magic[8];				//!< JOURNAL_BINARY_MAGIC, null terminated
+	uint32_t version;			//!< JOURNAL_BINARY_VERSION
+	uint32_t monitorRecordSize;	//!< sizeof(JournalBinaryMonitorRecord) of the writer
+} JournalBinaryFileHeader;
+
+typedef struct __attribute__((packed)) {
+	uint8_t type;				//!< JournalRecordType
+	uint32_t length;			//!< Number of payload bytes following the header
+	double recordTime;			//!< Time of recording [s since epoch]
+} JournalBinaryRecordHeader;
+
+typedef struct {
+	uint32_t clientID;
+	in_addr_t clientIP;
+	ObjectMonitorType monitorData;
+} JournalBinaryMonitorRecord;
+
+int JournalInit(const char* name, rclcpp::Logger logger, JournalFormatType format = JOURNAL_FORMAT_TEXT);
 int JournalRecordData(JournalRecordType type, const char* format, ...);
 int JournalRecordMonitorData(const ObjectDataType* data);
+void JournalClose(void);
 
 #endif
@@ -0,0 +1,60 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <fstream>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ATOS {
+/*!
+ * \brief Read-only memory mapping of a file, unmapped on destruction. Pages of
+ *			the mapping are shared with other processes mapping the same file.
+ */
+class MappedFile {
+public:
+	explicit MappedFile(const std::string& path) {
+		int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0) {
+			throw std::ifstream::failure("Unable to open file <" + path + ">");
+		}
+		struct stat st;
+		if (fstat(fd, &st) < 0) {
+			close(fd);
+			throw std::ifstream::failure("Unable to read size of file <" + path + ">");
+		}
+		length = static_cast<size_t>(st.st_size);
+		if (length > 0) {
+			mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (mapping == MAP_FAILED) {
+				close(fd);
+				throw std::ifstream::failure("Unable to map file <" + path + ">");
+			}
+			madvise(mapping, length, MADV_SEQUENTIAL);
+		}
+		close(fd);
+	}
+	~MappedFile() {
+		if (mapping != MAP_FAILED) {
+			munmap(mapping, length);
+		}
+	}
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const char* data() const { return mapping != MAP_FAILED ? static_cast<const char*>(mapping) : ""; }
+	size_t size() const { return length; }
+private:
+	void* mapping = MAP_FAILED;
+	size_t length = 0;
+};
+} // namespace ATOS
+
+#endif
@@ -7,7 +7,7 @@
 #include "util.h"
 #include <iomanip>
 
-ObjectConfig::ObjectConfig(rclcpp::Logger lg) : Loggable(lg), trajectory(lg) {
+ObjectConfig::ObjectConfig(rclcpp::Logger lg) : Loggable(lg), trajectory(std::make_shared<const ATOS::Trajectory>(lg)) {
 	origin.latitude_deg = origin.longitude_deg = origin.altitude_m = 0.0;
 	origin.isLongitudeValid = origin.isLatitudeValid = origin.isAltitudeValid = false;
 }
@@ -36,7 +36,7 @@ std::string ObjectConfig::toString() const {
 	}
 
 	retval += "\n Object ID: " + std::to_string(transmitterID)
-			+ "\n IP: " + ipAddr + "\n Trajectory: " + trajectory.name.c_str()
+			+ "\n IP: " + ipAddr + "\n Trajectory: " + trajectory->name.c_str()
 			+ "\n OpenDRIVE: " + opendriveFile.filename().string().c_str()
 			+ "\n OpenSCENARIO: " + openscenarioFile.filename().string().c_str()
 			+ "\n Turning diameter: " + std::to_string(turningDiameter) + "\n Max speed: " + std::to_string(maximumSpeed)
@@ -134,8 +134,10 @@ void ObjectConfig::parseConfigurationFile(
 										+ " in file " + objectFile.string() + " not found");
 		}
 		this->trajectoryFile = trajFile;
-		this->trajectory.initializeFromFile(setting);
-		RCLCPP_DEBUG(get_logger(), "Loaded trajectory with %lu points", trajectory.points.size());
+		auto loadedTrajectory = std::make_shared<ATOS::Trajectory>(get_logger());
+		loadedTrajectory->initializeFromFile(setting);
+		this->trajectory = loadedTrajectory;
+		RCLCPP_DEBUG(get_logger(), "Loaded trajectory with %lu points", trajectory->points.size());
 	}
 	
 	// Get opendrive file setting
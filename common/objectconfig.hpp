@@ -40,8 +40,10 @@ public:
 	double getMaximumSpeed() const { return maximumSpeed; }
 	GeographicPositionType getOrigin() const { return origin; }
 	std::string getProjString() const;
-	ATOS::Trajectory getTrajectory() const { return trajectory; }
-	void setTrajectory(const ATOS::Trajectory& newTraj) { trajectory = newTraj; }
+	//! \brief The trajectory is shared read-only between copies of the configuration.
+	std::shared_ptr<const ATOS::Trajectory> getTrajectory() const { return trajectory; }
+	void setTrajectory(const ATOS::Trajectory& newTraj) { trajectory = std::make_shared<const ATOS::Trajectory>(newTraj); }
+	void setTrajectory(std::shared_ptr<const ATOS::Trajectory> newTraj) { trajectory = newTraj; }
 	uint32_t getTransmitterID() const { return transmitterID; }
 	void setTransmitterID(const uint32_t id) { transmitterID = id; }
 	double getTurningDiameter() const { return turningDiameter; }
@@ -64,7 +66,7 @@ private:
 	double maximumSpeed = 0;
 	bool hasMaximumSpeed = false;
 	GeographicPositionType origin;
-	ATOS::Trajectory trajectory;
+	std::shared_ptr<const ATOS::Trajectory> trajectory;
 	uint32_t transmitterID = 0;
 	bool turningDiameterKnown = false;
 	double turningDiameter = 0;
@@ -0,0 +1,27 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#pragma once
+
+#include "roschannel.hpp"
+#include <diagnostic_msgs/msg/diagnostic_array.hpp>
+
+namespace ROSChannels {
+    namespace Diagnostics {
+        const std::string topicName = "/diagnostics";
+        using message_type = diagnostic_msgs::msg::DiagnosticArray;
+        const rclcpp::QoS defaultQoS = rclcpp::QoS(rclcpp::KeepLast(10));
+
+        class Pub : public BasePub<message_type> {
+        public:
+            Pub(rclcpp::Node& node, const rclcpp::QoS& qos = defaultQoS) : BasePub<message_type>(node, topicName, qos) {}
+        };
+
+        class Sub : public BaseSub<message_type> {
+        public:
+            Sub(rclcpp::Node& node, std::function<void(const message_type::SharedPtr)> callback, const rclcpp::QoS& qos = defaultQoS) : BaseSub<message_type>(node, topicName, callback, qos) {}
+        };
+    }
+}
@@ -0,0 +1,361 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include <unistd.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <linux/limits.h>
+#include <cstring>
+#include <string>
+
+#include "seqlockmem.h"
+
+using namespace std;
+
+#define SEQLOCK_FILE_ENDING ".seq"
+#define SEQLOCK_NAME_MAX (NAME_MAX - sizeof (SEQLOCK_FILE_ENDING))
+#define SEQLOCK_MAGIC 0x4b434f4c51455341ULL	//!< "ASEQLOCK" in little endian
+#define SEQLOCK_ALIGNMENT 64				//!< Slots are aligned to cache lines
+#define SEQLOCK_MAX_READ_ATTEMPTS 10000		//!< Attempts before a reader gives up on a slot
+#define SEQLOCK_SPIN_ATTEMPTS 100			//!< Attempts before a reader starts yielding
+#define SEQLOCK_OPEN_ATTEMPTS 1000			//!< Attempts to open a memory under creation
+#define SEQLOCK_OPEN_INTERVAL_US 1000		//!< Interval between open attempts
+
+/*!
+ * \brief SeqlockMemoryHeader Layout information stored first in the memory. The magic
+ *			number is written last by the creating process, and marks the memory as ready.
+ */
+typedef struct {
+	uint64_t magic;					//!< ::SEQLOCK_MAGIC once the memory is initialized
+	uint64_t recordSize;			//!< Size of the records in the slots
+	uint64_t slotSize;				//!< Distance between consecutive slots
+	uint32_t numberOfSlots;			//!< Number of slots in the memory
+} SeqlockMemoryHeader;
+
+/*!
+ * \brief SeqlockMemory Process local handle to a seqlocked shared memory. Each slot
+ *			consists of a sequence counter on its own cache line followed by the
+ *			record. The counter is odd while the record is being written, and a
+ *			record's version is the number of completed writes to it.
+ */
+struct SeqlockMemory {
+	string name = "";								//!< Name of the memory file
+	int fd = -1;									//!< File descriptor for the memory file
+	void* address = nullptr;						//!< Address of the memory map
+	size_t mapSize = 0;								//!< Size of the memory map
+	SeqlockMemoryHeader* header = nullptr;			//!< Layout information of the memory
+	unsigned char* slots = nullptr;					//!< Address of the first slot
+
+	~SeqlockMemory() {
+		if (address != nullptr && munmap(address, mapSize) == -1) {
+			perror("munmap");
+		}
+		if (fd != -1 && close(fd) == -1) {
+			perror("close");
+		}
+	}
+
+	uint64_t* sequence(const unsigned int slot) const {
+		return reinterpret_cast<uint64_t*>(slots + slot*header->slotSize);
+	}
+	uint64_t* record(const unsigned int slot) const {
+		return reinterpret_cast<uint64_t*>(slots + slot*header->slotSize + SEQLOCK_ALIGNMENT);
+	}
+};
+
+/*********************************** STATIC FUNCTION DECLARATIONS ********************************************************/
+static size_t alignUp(const size_t size, const size_t alignment);
+static void copyToSlot(uint64_t* slotRecord, const void* record, const size_t size);
+static void copyFromSlot(void* record, const uint64_t* slotRecord, const size_t size);
+static int mapMemory(SeqlockMemory* memory, const size_t size);
+
+/*********************************** FUNCTION DEFINITIONS ****************************************************************/
+/*!
+ * \brief createSeqlockMemory Creates a seqlocked memory with the specified number of slots on the system and
+ *			maps it into the calling process' address space. If a memory with the specified name already exists,
+ *			it is opened instead, provided that its record size matches.
+ * \param memoryName Name of the memory. A file is created with ending ".seq" appended to this name
+ * \param numberOfSlots Number of slots if a preexisting memory is not found
+ * \param recordSize Size of the record stored in each slot
+ * \param wasCreated Boolean value indicating if the memory was created (as opposed to a preexisting memory was found)
+ * \return Handle to the memory, or NULL on failure
+ */
+SeqlockMemory* createSeqlockMemory(const char* memoryName, const unsigned int numberOfSlots,
+								   const size_t recordSize, int* wasCreated) {
+	if (wasCreated != nullptr) {
+		*wasCreated = 0;
+	}
+	if (memoryName == nullptr || recordSize == 0 || numberOfSlots == 0
+			|| (memoryName[0] == '/' && memoryName[1] == '\0')) {
+		errno = EINVAL;
+		perror(__FUNCTION__);
+		return nullptr;
+	}
+	if (strlen(memoryName) + 1 > SEQLOCK_NAME_MAX) {
+		errno = ENAMETOOLONG;
+		perror(__FUNCTION__);
+		return nullptr;
+	}
+
+	auto memory = new SeqlockMemory();
+	memory->name = memoryName;
+	// Calls to shm assume the file name starts with a forward slash; ensure this matches
+	if (memory->name.front() != '/') {
+		memory->name.insert(0, "/");
+	}
+	memory->name += SEQLOCK_FILE_ENDING;
+
+	memory->fd = shm_open(memory->name.c_str(), O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+	if (memory->fd != -1) {
+		// Memory did not exist: size it, write the layout and mark it as ready
+		const size_t slotSize = SEQLOCK_ALIGNMENT + alignUp(recordSize, SEQLOCK_ALIGNMENT);
+		const size_t size = SEQLOCK_ALIGNMENT + slotSize*numberOfSlots;
+		if (ftruncate(memory->fd, static_cast<off_t>(size)) == -1) {
+			perror("ftruncate");
+			shm_unlink(memory->name.c_str());
+			delete memory;
+			return nullptr;
+		}
+		if (mapMemory(memory, size) == -1) {
+			shm_unlink(memory->name.c_str());
+			delete memory;
+			return nullptr;
+		}
+		memory->header->recordSize = recordSize;
+		memory->header->slotSize = slotSize;
+		memory->header->numberOfSlots = numberOfSlots;
+		__atomic_store_n(&memory->header->magic, SEQLOCK_MAGIC, __ATOMIC_RELEASE);
+		if (wasCreated != nullptr) {
+			*wasCreated = 1;
+		}
+		return memory;
+	}
+	else if (errno != EEXIST) {
+		perror("shm_open");
+		delete memory;
+		return nullptr;
+	}
+
+	// Memory existed: wait for its creator to finish initializing it
+	if ((memory->fd = shm_open(memory->name.c_str(), O_RDWR, S_IRUSR | S_IWUSR)) == -1) {
+		perror("shm_open");
+		delete memory;
+		return nullptr;
+	}
+	struct stat fileInfo;
+	for (int attempt = 0; ; ++attempt) {
+		if (fstat(memory->fd, &fileInfo) == -1) {
+			perror("fstat");
+			delete memory;
+			return nullptr;
+		}
+		if (static_cast<size_t>(fileInfo.st_size) >= sizeof (SeqlockMemoryHeader)) {
+			break;
+		}
+		if (attempt == SEQLOCK_OPEN_ATTEMPTS) {
+			errno = ETIMEDOUT;
+			perror(__FUNCTION__);
+			delete memory;
+			return nullptr;
+		}
+		usleep(SEQLOCK_OPEN_INTERVAL_US);
+	}
+	if (mapMemory(memory, static_cast<size_t>(fileInfo.st_size)) == -1) {
+		delete memory;
+		return nullptr;
+	}
+	for (int attempt = 0; __atomic_load_n(&memory->header->magic, __ATOMIC_ACQUIRE) != SEQLOCK_MAGIC; ++attempt) {
+		if (attempt == SEQLOCK_OPEN_ATTEMPTS) {
+			errno = ETIMEDOUT;
+			perror(__FUNCTION__);
+			delete memory;
+			return nullptr;
+		}
+		usleep(SEQLOCK_OPEN_INTERVAL_US);
+	}
+	if (memory->header->recordSize != recordSize
+			|| SEQLOCK_ALIGNMENT + memory->header->slotSize*memory->header->numberOfSlots > memory->mapSize) {
+		errno = EINVAL;
+		perror(__FUNCTION__);
+		delete memory;
+		return nullptr;
+	}
+	return memory;
+}
+
+/*!
+ * \brief closeSeqlockMemory Unmaps the memory and frees the handle, but leaves the memory on the system.
+ * \param memory Handle to the memory.
+ */
+void closeSeqlockMemory(SeqlockMemory* memory) {
+	delete memory;
+}
+
+/*!
+ * \brief destroySeqlockMemory Unlinks and unmaps the memory and frees the handle. Other processes
+ *			keep their mappings, but the memory can no longer be opened.
+ * \param memory Handle to the memory.
+ */
+void destroySeqlockMemory(SeqlockMemory* memory) {
+	if (memory == nullptr) {
+		return;
+	}
+	if (shm_unlink(memory->name.c_str()) == -1) {
+		perror("shm_unlink");
+	}
+	delete memory;
+}
+
+/*!
+ * \brief getNumberOfSeqlockSlots Returns the number of slots in the memory.
+ * \param memory Handle to the memory.
+ * \return Number of slots
+ */
+unsigned int getNumberOfSeqlockSlots(const SeqlockMemory* memory) {
+	return memory->header->numberOfSlots;
+}
+
+/*!
+ * \brief getSeqlockRecordSize Returns the size of the records in the memory.
+ * \param memory Handle to the memory.
+ * \return Size of one record
+ */
+size_t getSeqlockRecordSize(const SeqlockMemory* memory) {
+	return memory->header->recordSize;
+}
+
+/*!
+ * \brief writeSeqlockSlot Overwrites the record in a slot. Only one thread or process may write
+ *			to each slot. The write never waits for readers.
+ * \param memory Handle to the memory.
+ * \param slot Index of the slot to write.
+ * \param record Record of size ::getSeqlockRecordSize to be copied into the slot.
+ * \return Version of the written record, or 0 on failure
+ */
+uint64_t writeSeqlockSlot(SeqlockMemory* memory, const unsigned int slot, const void* record) {
+	if (slot >= memory->header->numberOfSlots) {
+		errno = EINVAL;
+		return 0;
+	}
+	uint64_t* sequence = memory->sequence(slot);
+	const uint64_t seq = __atomic_load_n(sequence, __ATOMIC_RELAXED);
+	__atomic_store_n(sequence, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	copyToSlot(memory->record(slot), record, memory->header->recordSize);
+	__atomic_store_n(sequence, seq + 2, __ATOMIC_RELEASE);
+	return (seq + 2) / 2;
+}
+
+/*!
+ * \brief readSeqlockSlot Copies a consistent record from a slot. If the record is modified while
+ *			it is being copied, the copy is retried. If the slot stays locked, e.g. because its
+ *			writer terminated during a write, the read fails with errno set to EBUSY.
+ * \param memory Handle to the memory.
+ * \param slot Index of the slot to read.
+ * \param record Buffer of size ::getSeqlockRecordSize to copy the record into.
+ * \return Version of the read record, or 0 if the slot was never written or on failure
+ */
+uint64_t readSeqlockSlot(const SeqlockMemory* memory, const unsigned int slot, void* record) {
+	if (slot >= memory->header->numberOfSlots) {
+		errno = EINVAL;
+		return 0;
+	}
+	const uint64_t* sequence = memory->sequence(slot);
+	for (int attempt = 0; attempt < SEQLOCK_MAX_READ_ATTEMPTS; ++attempt) {
+		const uint64_t before = __atomic_load_n(sequence, __ATOMIC_ACQUIRE);
+		if (before & 1) {
+			if (attempt >= SEQLOCK_SPIN_ATTEMPTS) {
+				sched_yield();
+			}
+			continue;
+		}
+		copyFromSlot(record, memory->record(slot), memory->header->recordSize);
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (__atomic_load_n(sequence, __ATOMIC_RELAXED) == before) {
+			return before / 2;
+		}
+	}
+	errno = EBUSY;
+	return 0;
+}
+
+/*!
+ * \brief getSeqlockSlotVersion Returns the version of the last completed write to a slot, which
+ *			allows readers to skip copying records they have already read.
+ * \param memory Handle to the memory.
+ * \param slot Index of the slot.
+ * \return Version of the record in the slot, or 0 if the slot was never written or on failure
+ */
+uint64_t getSeqlockSlotVersion(const SeqlockMemory* memory, const unsigned int slot) {
+	if (slot >= memory->header->numberOfSlots) {
+		errno = EINVAL;
+		return 0;
+	}
+	return __atomic_load_n(memory->sequence(slot), __ATOMIC_ACQUIRE) / 2;
+}
+
+/*!
+ * \brief alignUp Rounds a size up to a multiple of the alignment
+ */
+size_t alignUp(const size_t size, const size_t alignment) {
+	return (size + alignment - 1) / alignment * alignment;
+}
+
+/*!
+ * \brief copyToSlot Copies a record into a slot one word at a time. The words are written
+ *			atomically, since readers may be copying them at the same time.
+ */
+void copyToSlot(uint64_t* slotRecord, const void* record, const size_t size) {
+	const unsigned char* source = static_cast<const unsigned char*>(record);
+	size_t i = 0;
+	for (; i + sizeof (uint64_t) <= size; i += sizeof (uint64_t)) {
+		uint64_t word;
+		memcpy(&word, source + i, sizeof (word));
+		__atomic_store_n(slotRecord++, word, __ATOMIC_RELAXED);
+	}
+	if (i < size) {
+		uint64_t word = 0;
+		memcpy(&word, source + i, size - i);
+		__atomic_store_n(slotRecord, word, __ATOMIC_RELAXED);
+	}
+}
+
+/*!
+ * \brief copyFromSlot Copies a record out of a slot one word at a time. The copy may be
+ *			inconsistent and must be validated against the sequence counter afterwards.
+ */
+void copyFromSlot(void* record, const uint64_t* slotRecord, const size_t size) {
+	unsigned char* destination = static_cast<unsigned char*>(record);
+	size_t i = 0;
+	for (; i + sizeof (uint64_t) <= size; i += sizeof (uint64_t)) {
+		const uint64_t word = __atomic_load_n(slotRecord++, __ATOMIC_RELAXED);
+		memcpy(destination + i, &word, sizeof (word));
+	}
+	if (i < size) {
+		const uint64_t word = __atomic_load_n(slotRecord, __ATOMIC_RELAXED);
+		memcpy(destination + i, &word, size - i);
+	}
+}
+
+/*!
+ * \brief mapMemory Maps the memory file into the address space of the calling process.
+ * \return 0 on success, -1 on failure
+ */
+int mapMemory(SeqlockMemory* memory, const size_t size) {
+	void* address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, memory->fd, 0);
+	if (address == MAP_FAILED) {
+		perror("mmap");
+		return -1;
+	}
+	memory->address = address;
+	memory->mapSize = size;
+	memory->header = static_cast<SeqlockMemoryHeader*>(address);
+	memory->slots = static_cast<unsigned char*>(address) + SEQLOCK_ALIGNMENT;
+	return 0;
+}
@@ -0,0 +1,42 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef SEQLOCKMEM_H
+#define SEQLOCKMEM_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+/*! ------------------------------------------------------------------------------
+ *  -- File			: seqlockmem.h
+ *  -- Description	: This file provides a shared memory segment made up of a fixed
+ *					  number of fixed size records, each guarded by its own sequence
+ *					  lock. Each slot must have a single writer. Readers never block
+ *					  the writer: they copy the record and retry if it was modified
+ *					  while being copied. A read always yields a consistent record
+ *					  and the version it was read at.
+ *  -- Reference	: manpage shm_overview
+ *  ------------------------------------------------------------------------------
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct SeqlockMemory SeqlockMemory;
+
+SeqlockMemory* createSeqlockMemory(const char* memoryName, const unsigned int numberOfSlots,
+								   const size_t recordSize, int* wasCreated);
+void closeSeqlockMemory(SeqlockMemory* memory);
+void destroySeqlockMemory(SeqlockMemory* memory);
+unsigned int getNumberOfSeqlockSlots(const SeqlockMemory* memory);
+size_t getSeqlockRecordSize(const SeqlockMemory* memory);
+uint64_t writeSeqlockSlot(SeqlockMemory* memory, const unsigned int slot, const void* record);
+uint64_t readSeqlockSlot(const SeqlockMemory* memory, const unsigned int slot, void* record);
+uint64_t getSeqlockSlotVersion(const SeqlockMemory* memory, const unsigned int slot);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
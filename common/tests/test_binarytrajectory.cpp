@@ -0,0 +1,211 @@
+#include "../trajectory.hpp"
+#include "../binarytrajectoryfile.hpp"
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+#include <rclcpp/logging.hpp>
+#define N_POINTS 1000
+using namespace ATOS;
+namespace fs = std::filesystem;
+static void text_round_trip_test(const fs::path& dir);
+static void missing_fields_test(const fs::path& dir);
+static void text_equality_test(const fs::path& dir);
+static void format_check_test(const fs::path& dir);
+static std::string read_file(const fs::path& path);
+
+int main(int argc, char** argv) {
+	auto dir = fs::temp_directory_path() / ("test_binarytrajectory_" + std::to_string(getpid()));
+	fs::create_directories(dir);
+	try {
+		text_round_trip_test(dir);
+		missing_fields_test(dir);
+		text_equality_test(dir);
+		format_check_test(dir);
+		fs::remove_all(dir);
+		exit(EXIT_SUCCESS);
+	}
+	catch (std::exception& e) {
+		std::cerr << "Test " << __FILE__ << " failed: " << std::endl
+				  << e.what() << std::endl;
+		fs::remove_all(dir);
+		exit(EXIT_FAILURE);
+	}
+}
+
+std::string read_file(const fs::path& path) {
+	std::ifstream istrm(path);
+	std::stringstream ss;
+	ss << istrm.rdbuf();
+	return ss.str();
+}
+
+/*!
+ * \brief Converts a text trajectory to binary and back, which should reproduce
+ *			the text file exactly.
+ */
+void text_round_trip_test(const fs::path& dir) {
+	Trajectory original(rclcpp::get_logger("test"));
+	original.id = 3;
+	original.name = "round_trip";
+	for (int i = 0; i < N_POINTS; ++i) {
+		Trajectory::TrajectoryPoint pt;
+		pt.setTime(i * 0.01);
+		pt.setXCoord(10.0 * std::cos(i * 0.01));
+		pt.setYCoord(-10.0 * std::sin(i * 0.01));
+		pt.setZCoord(0.5);
+		pt.setHeading(i * 0.01);
+		pt.setLongitudinalVelocity(2.5);
+		pt.setLongitudinalAcceleration(i % 2 ? 0.1 : -0.1);
+		pt.setCurvature(0.1);
+		pt.setMode(Trajectory::TrajectoryPoint::CONTROLLED_BY_DRIVE_FILE);
+		original.points.push_back(pt);
+	}
+	original.saveToPath(dir / "original.traj");
+
+	Trajectory text(rclcpp::get_logger("test"));
+	text.initializeFromPath(dir / "original.traj");
+	text.saveToPath(dir / "converted.btraj");
+	Trajectory binary(rclcpp::get_logger("test"));
+	binary.initializeFromPath(dir / "converted.btraj");
+	binary.saveToPath(dir / "converted.traj");
+
+	if (binary.id != original.id || binary.name != original.name || binary.size() != original.size()) {
+		throw std::runtime_error("Binary trajectory header differs from the text trajectory");
+	}
+	if (read_file(dir / "original.traj") != read_file(dir / "converted.traj")) {
+		throw std::runtime_error("Text trajectory converted to binary and back differs from the original");
+	}
+}
+
+/*!
+ * \brief Checks that values missing from some or all points remain missing after
+ *			a binary round trip, and that stored values are exact.
+ */
+void missing_fields_test(const fs::path& dir) {
+	Trajectory original(rclcpp::get_logger("test"));
+	for (int i = 0; i < N_POINTS; ++i) {
+		Trajectory::TrajectoryPoint pt;
+		pt.setTime(i * 0.01);
+		pt.setXCoord(i / 3.0);
+		pt.setYCoord(-i / 7.0);
+		pt.setHeading(0.1);
+		if (i % 2) {
+			pt.setLateralVelocity(i / 11.0);
+		}
+		pt.setCurvature(0.0);
+		original.points.push_back(pt);
+	}
+	original.saveToPath(dir / "missing.btraj");
+
+	BinaryTrajectoryFile file(dir / "missing.btraj");
+	if (file.column(BinaryTrajectoryFile::Z) != nullptr
+			|| file.column(BinaryTrajectoryFile::LATERAL_VELOCITY) == nullptr) {
+		throw std::runtime_error("Unexpected optional columns in binary trajectory");
+	}
+	Trajectory loaded(rclcpp::get_logger("test"));
+	loaded.initializeFromPath(dir / "missing.btraj");
+	for (unsigned long i = 0; i < original.size(); ++i) {
+		const auto& exp = original.points[i];
+		const auto& act = loaded.points[i];
+		if (exp.getTime() != act.getTime() || exp.getXCoord() != act.getXCoord()
+				|| exp.getYCoord() != act.getYCoord()
+				|| !std::isnan(act.getPosition()[2])
+				|| std::isnan(exp.getVelocity()[1]) != std::isnan(act.getVelocity()[1])
+				|| (!std::isnan(exp.getVelocity()[1]) && exp.getVelocity()[1] != act.getVelocity()[1])) {
+			std::stringstream ss;
+			ss << "Point " << i << " differs after binary round trip:" << std::endl;
+			ss << "exp: " << exp.toString() << std::endl;
+			ss << "act: " << act.toString();
+			throw std::runtime_error(ss.str());
+		}
+	}
+}
+
+/*!
+ * \brief Loads the same trajectory from a text file and from a binary file, which
+ *			should give identical points. Each optional quantity is missing from
+ *			some of the points.
+ */
+void text_equality_test(const fs::path& dir) {
+	{
+		std::ofstream ostrm(dir / "mixed.traj");
+		ostrm << "TRAJECTORY;5;mixed;0;" << N_POINTS << ";" << std::endl;
+		auto optional = [](const int i, const int bit, const double value) {
+			return i & (1 << bit) ? std::to_string(value) : "";
+		};
+		for (int i = 0; i < N_POINTS; ++i) {
+			ostrm << "LINE;" << i * 0.01 << ";" << i / 3.0 << ";" << -i / 7.0 << ";" << optional(i, 0, 0.1 * i)
+				  << ";" << 0.001 * i << ";" << optional(i, 1, 2.5) << ";" << optional(i, 2, -0.5 * i) << ";"
+				  << optional(i, 3, 0.2) << ";" << optional(i, 4, -0.1 * i) << ";" << 0.01 << ";" << i % 3
+				  << ";ENDLINE;" << std::endl;
+		}
+		ostrm << "ENDTRAJECTORY;" << std::endl;
+	}
+	Trajectory text(rclcpp::get_logger("test"));
+	text.initializeFromPath(dir / "mixed.traj");
+	text.saveToPath(dir / "mixed.btraj");
+	Trajectory binary(rclcpp::get_logger("test"));
+	binary.initializeFromPath(dir / "mixed.btraj");
+
+	if (binary.size() != text.size()) {
+		throw std::runtime_error("Binary load gave " + std::to_string(binary.size()) + " points, text load "
+								 + std::to_string(text.size()));
+	}
+	auto same = [](const double a, const double b) { return (std::isnan(a) && std::isnan(b)) || a == b; };
+	for (unsigned long i = 0; i < text.size(); ++i) {
+		const auto& exp = text.points[i];
+		const auto& act = binary.points[i];
+		bool isEqual = exp.getTime() == act.getTime() && exp.getHeading() == act.getHeading()
+				&& exp.getCurvature() == act.getCurvature() && exp.getMode() == act.getMode();
+		for (int j = 0; j < 3; ++j) {
+			isEqual = isEqual && same(exp.getPosition()[j], act.getPosition()[j]);
+		}
+		for (int j = 0; j < 2; ++j) {
+			isEqual = isEqual && same(exp.getVelocity()[j], act.getVelocity()[j])
+					&& same(exp.getAcceleration()[j], act.getAcceleration()[j]);
+		}
+		if (!isEqual) {
+			std::stringstream ss;
+			ss << "Point " << i << " differs between text and binary load:" << std::endl;
+			ss << "text:   " << exp.toString() << std::endl;
+			ss << "binary: " << act.toString();
+			throw std::runtime_error(ss.str());
+		}
+	}
+}
+
+/*!
+ * \brief Checks that the trajectory file check accepts binary trajectories and
+ *			rejects ones with unknown fields or which are truncated.
+ */
+void format_check_test(const fs::path& dir) {
+	auto path = dir / "missing.btraj";
+	if (UtilCheckTrajectoryFileFormat(path.c_str(), path.string().length()) != 0) {
+		throw std::runtime_error("Valid binary trajectory failed format check");
+	}
+	auto unknownFieldPath = dir / "unknownfield.btraj";
+	fs::copy_file(path, unknownFieldPath, fs::copy_options::overwrite_existing);
+	{
+		std::fstream file(unknownFieldPath, std::ios::in | std::ios::out | std::ios::binary);
+		uint32_t fieldMask = TRAJECTORY_FIELD_LATERAL_VELOCITY | (1u << 31);
+		file.seekp(offsetof(TrajectoryBinaryFileHeader, fieldMask));
+		file.write(reinterpret_cast<const char*>(&fieldMask), sizeof (fieldMask));
+	}
+	if (UtilCheckTrajectoryFileFormat(unknownFieldPath.c_str(), unknownFieldPath.string().length()) == 0) {
+		throw std::runtime_error("Binary trajectory with unknown fields passed format check");
+	}
+	try {
+		BinaryTrajectoryFile file(unknownFieldPath);
+		throw std::runtime_error("Binary trajectory with unknown fields was opened");
+	}
+	catch (std::invalid_argument&) {}
+	fs::resize_file(path, fs::file_size(path) - 1);
+	if (UtilCheckTrajectoryFileFormat(path.c_str(), path.string().length()) == 0) {
+		throw std::runtime_error("Truncated binary trajectory passed format check");
+	}
+}
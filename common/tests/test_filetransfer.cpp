@@ -0,0 +1,249 @@
+#include "filetransfer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#define FILE_SIZE (64 << 20)
+#define TIMEOUT std::chrono::milliseconds(3000)
+#define SHORT_TIMEOUT std::chrono::milliseconds(200)
+
+namespace fs = std::filesystem;
+using namespace ATOS;
+
+static void checksum_test();
+static void round_trip_test(const fs::path& directory);
+static void timeout_test(const fs::path& directory);
+static void connection_closed_test(const fs::path& directory);
+static void benchmark(const fs::path& directory);
+
+int main(int argc, char** argv) {
+	auto directory = fs::temp_directory_path() / ("test_filetransfer_" + std::to_string(getpid()));
+	fs::create_directory(directory);
+	try {
+		checksum_test();
+		round_trip_test(directory);
+		timeout_test(directory);
+		connection_closed_test(directory);
+		benchmark(directory);
+		fs::remove_all(directory);
+		exit(EXIT_SUCCESS);
+	}
+	catch (std::exception& e) {
+		fs::remove_all(directory);
+		std::cerr << "Test " << __FILE__ << " failed: " << std::endl
+				  << e.what() << std::endl;
+		exit(EXIT_FAILURE);
+	}
+}
+
+//! \brief Connects a pair of TCP sockets over loopback
+static void connect_loopback(int& sender, int& receiver) {
+	int listener = socket(AF_INET, SOCK_STREAM, 0);
+	struct sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	socklen_t length = sizeof (address);
+	if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof (address)) < 0
+			|| listen(listener, 1) < 0
+			|| getsockname(listener, reinterpret_cast<sockaddr*>(&address), &length) < 0) {
+		throw std::runtime_error("Failed to listen on loopback");
+	}
+	sender = socket(AF_INET, SOCK_STREAM, 0);
+	if (sender < 0 || connect(sender, reinterpret_cast<sockaddr*>(&address), sizeof (address)) < 0) {
+		throw std::runtime_error("Failed to connect over loopback");
+	}
+	receiver = accept(listener, nullptr, nullptr);
+	close(listener);
+	if (receiver < 0) {
+		throw std::runtime_error("Failed to accept loopback connection");
+	}
+}
+
+static std::vector<char> random_data(const std::size_t size) {
+	std::vector<char> data(size);
+	std::mt19937_64 generator(size);
+	for (std::size_t i = 0; i + 8 <= size; i += 8) {
+		uint64_t word = generator();
+		std::copy_n(reinterpret_cast<char*>(&word), 8, data.data() + i);
+	}
+	return data;
+}
+
+static void write_file(const fs::path& path, const std::vector<char>& data) {
+	std::ofstream(path, std::ios::binary).write(data.data(), static_cast<std::streamsize>(data.size()));
+}
+
+static std::vector<char> read_file(const fs::path& path) {
+	std::ifstream file(path, std::ios::binary);
+	return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+//! \brief Checks that no temporary files were left in the directory
+static void check_no_leftovers(const fs::path& directory, const std::size_t expectedFiles) {
+	auto nFiles = std::distance(fs::directory_iterator(directory), fs::directory_iterator());
+	if (static_cast<std::size_t>(nFiles) != expectedFiles) {
+		throw std::runtime_error("Expected " + std::to_string(expectedFiles) + " files in test directory but found "
+								 + std::to_string(nFiles));
+	}
+}
+
+void checksum_test() {
+	const std::string check = "123456789";
+	if (FileTransfer::crc32(0, check.data(), check.size()) != 0xCBF43926) {
+		throw std::runtime_error("CRC-32 of check string was wrong");
+	}
+	auto data = random_data(1001);
+	uint32_t incremental = FileTransfer::crc32(0, data.data(), 13);
+	incremental = FileTransfer::crc32(incremental, data.data() + 13, data.size() - 13);
+	if (incremental != FileTransfer::crc32(0, data.data(), data.size())) {
+		throw std::runtime_error("Incremental CRC-32 did not match CRC-32 of full data");
+	}
+}
+
+/*!
+ * \brief Sends a file with and without checksumming on the receiving side and
+ *			checks that the received file replaced the existing destination.
+ */
+void round_trip_test(const fs::path& directory) {
+	const auto source = directory / "source";
+	const auto destination = directory / "destination";
+	const auto data = random_data(FILE_SIZE);
+	const uint32_t expectedChecksum = FileTransfer::crc32(0, data.data(), data.size());
+	write_file(source, data);
+
+	for (bool computeChecksum : {false, true}) {
+		write_file(destination, std::vector<char>(10, 'x'));
+		int sender, receiver;
+		connect_loopback(sender, receiver);
+		FileTransfer::Result sendResult;
+		std::thread senderThread([&]() { sendResult = FileTransfer::send(sender, source, TIMEOUT); });
+		FileTransfer::Statistics statistics;
+		auto result = FileTransfer::receive(receiver, destination, data.size(), TIMEOUT, &statistics, computeChecksum);
+		senderThread.join();
+		close(sender);
+		close(receiver);
+
+		if (sendResult != FileTransfer::COMPLETE || result != FileTransfer::COMPLETE) {
+			throw std::runtime_error("Transfer did not complete");
+		}
+		if (statistics.bytesTransferred != data.size() || read_file(destination) != data) {
+			throw std::runtime_error("Received file did not match sent file");
+		}
+		if (computeChecksum && statistics.checksum != expectedChecksum) {
+			throw std::runtime_error("Checksum of received data was wrong");
+		}
+		check_no_leftovers(directory, 2);
+	}
+	fs::remove(source);
+	fs::remove(destination);
+}
+
+/*!
+ * \brief Sends part of a file and then stalls. The receiver must time out and
+ *			leave the existing destination untouched.
+ */
+void timeout_test(const fs::path& directory) {
+	const auto destination = directory / "destination";
+	const std::vector<char> previous(10, 'x');
+	write_file(destination, previous);
+	int sender, receiver;
+	connect_loopback(sender, receiver);
+	const auto data = random_data(4096);
+	if (write(sender, data.data(), data.size()) != static_cast<ssize_t>(data.size())) {
+		throw std::runtime_error("Failed to send partial file");
+	}
+	auto start = std::chrono::steady_clock::now();
+	auto result = FileTransfer::receive(receiver, destination, 2 * data.size(), SHORT_TIMEOUT);
+	auto elapsed = std::chrono::steady_clock::now() - start;
+	close(sender);
+	close(receiver);
+
+	if (result != FileTransfer::TIMED_OUT) {
+		throw std::runtime_error("Stalled transfer did not time out");
+	}
+	if (elapsed < SHORT_TIMEOUT || elapsed > 5 * SHORT_TIMEOUT) {
+		throw std::runtime_error("Timeout took " + std::to_string(
+			std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count()) + " ms");
+	}
+	if (read_file(destination) != previous) {
+		throw std::runtime_error("Timed out transfer modified the destination");
+	}
+	check_no_leftovers(directory, 1);
+	fs::remove(destination);
+}
+
+//! \brief Closes the connection halfway through a transfer
+void connection_closed_test(const fs::path& directory) {
+	const auto destination = directory / "destination";
+	int sender, receiver;
+	connect_loopback(sender, receiver);
+	const auto data = random_data(4096);
+	if (write(sender, data.data(), data.size()) != static_cast<ssize_t>(data.size())) {
+		throw std::runtime_error("Failed to send partial file");
+	}
+	close(sender);
+	auto result = FileTransfer::receive(receiver, destination, 2 * data.size(), TIMEOUT);
+	close(receiver);
+	if (result != FileTransfer::CONNECTION_CLOSED) {
+		throw std::runtime_error("Closed connection was not reported");
+	}
+	check_no_leftovers(directory, 0);
+}
+
+/*!
+ * \brief Reports the throughput over loopback of sendfile to splice, of sendfile
+ *			to checksummed buffered receive, and of buffered writes to splice as
+ *			a client sending packet by packet would.
+ */
+void benchmark(const fs::path& directory) {
+	using namespace std::chrono;
+	const auto source = directory / "source";
+	const auto destination = directory / "destination";
+	const auto data = random_data(FILE_SIZE);
+	write_file(source, data);
+
+	auto throughput = [&](bool useSendfile, bool computeChecksum) {
+		int sender, receiver;
+		connect_loopback(sender, receiver);
+		std::thread senderThread([&]() {
+			if (useSendfile) {
+				FileTransfer::send(sender, source, TIMEOUT);
+				return;
+			}
+			const std::size_t packetSize = 1280;
+			for (std::size_t sent = 0; sent < data.size(); sent += packetSize) {
+				if (write(sender, data.data() + sent, std::min(packetSize, data.size() - sent)) < 0) {
+					return;
+				}
+			}
+		});
+		FileTransfer::Statistics statistics;
+		FileTransfer::receive(receiver, destination, data.size(), TIMEOUT, &statistics, computeChecksum);
+		senderThread.join();
+		close(sender);
+		close(receiver);
+		return static_cast<double>(statistics.bytesTransferred) / (1 << 20)
+				/ duration<double>(statistics.duration).count();
+	};
+
+	auto spliced = throughput(true, false);
+	auto checksummed = throughput(true, true);
+	auto packetwise = throughput(false, false);
+	fs::remove(source);
+	fs::remove(destination);
+
+	std::cout << "Loopback transfer of " << (FILE_SIZE >> 20) << " MiB: sendfile to splice "
+			  << spliced << " MiB/s, sendfile to checksummed receive " << checksummed
+			  << " MiB/s, packetwise send to splice " << packetwise << " MiB/s" << std::endl;
+}
@@ -0,0 +1,196 @@
+#include "geofence.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#define N_RANDOM_POINTS 200000
+#define N_STAR_VERTICES 2000
+#define N_OBJECTS 64
+#define N_BENCHMARK_BATCHES 2000
+
+using namespace ATOS;
+
+static void parse_test();
+static void containment_test();
+static void breach_test();
+static void benchmark();
+
+int main(int argc, char** argv) {
+	try {
+		parse_test();
+		containment_test();
+		breach_test();
+		benchmark();
+		exit(EXIT_SUCCESS);
+	}
+	catch (std::exception& e) {
+		std::cerr << "Test " << __FILE__ << " failed: " << std::endl
+				  << e.what() << std::endl;
+		exit(EXIT_FAILURE);
+	}
+}
+
+//! \brief Plain crossing number test over all edges, as reference
+static bool reference_contains(const Geofence& fence, const double x, const double y) {
+	bool inside = false;
+	const auto& v = fence.vertices;
+	for (std::size_t i = 0, j = v.size() - 1; i < v.size(); j = i++) {
+		if ((v[i].y_m > y) != (v[j].y_m > y)
+				&& x < v[i].x_m + (y - v[i].y_m) * (v[j].x_m - v[i].x_m) / (v[j].y_m - v[i].y_m)) {
+			inside = !inside;
+		}
+	}
+	return inside;
+}
+
+//! \brief Star shaped polygon with many thin spikes, which has many edges per horizontal line
+static Geofence star(const std::size_t nVertices, const double innerRadius, const double outerRadius) {
+	Geofence fence;
+	fence.name = "star";
+	for (std::size_t i = 0; i < nVertices; ++i) {
+		const double angle = 2.0 * M_PI * i / nVertices;
+		const double radius = i % 2 ? innerRadius : outerRadius;
+		fence.vertices.push_back({radius * std::cos(angle), radius * std::sin(angle)});
+	}
+	return fence;
+}
+
+void parse_test() {
+	const std::string path = "/tmp/test_geofence_" + std::to_string(getpid()) + ".geofence";
+	std::ofstream(path) << "GEOFENCE;arena;4;permitted;0;10;\n"
+						<< "LINE;0;0;0;ENDLINE;\nLINE;100;0;0;ENDLINE;\n"
+						<< "LINE;100;50;0;ENDLINE;\r\nLINE;0;50;0;ENDLINE;\n"
+						<< "ENDGEOFENCE;\n";
+	auto fence = Geofence::fromFile(path);
+	if (fence.name != "arena" || !fence.isPermitted || fence.minHeight_m != 0.0 || fence.maxHeight_m != 10.0
+			|| fence.vertices.size() != 4 || fence.vertices[2].x_m != 100.0 || fence.vertices[2].y_m != 50.0) {
+		std::remove(path.c_str());
+		throw std::runtime_error("Parsed geofence did not match file");
+	}
+
+	std::ofstream(path) << "GEOFENCE;bad;4;forbidden;0;0;\nLINE;0;0;ENDLINE;\nLINE;1;0;ENDLINE;\nENDGEOFENCE;\n";
+	bool threw = false;
+	try {
+		Geofence::fromFile(path);
+	}
+	catch (std::invalid_argument&) {
+		threw = true;
+	}
+	std::remove(path.c_str());
+	if (!threw) {
+		throw std::runtime_error("Geofence with wrong number of vertices was accepted");
+	}
+}
+
+/*!
+ * \brief Compares containment of random points in a convex, a concave and a
+ *			star shaped polygon against the reference test.
+ */
+void containment_test() {
+	Geofence square;
+	square.vertices = {{0, 0}, {10, 0}, {10, 10}, {0, 10}};
+	Geofence concave;
+	concave.vertices = {{0, 0}, {10, 0}, {10, 10}, {5, 2}, {0, 10}};
+	std::vector<Geofence> fences = {square, concave, star(N_STAR_VERTICES, 20.0, 100.0)};
+	GeofenceEngine engine(fences);
+
+	std::mt19937 generator(1);
+	std::uniform_real_distribution<double> coordinate(-110.0, 110.0);
+	for (std::size_t g = 0; g < fences.size(); ++g) {
+		unsigned int nInside = 0;
+		for (int i = 0; i < N_RANDOM_POINTS; ++i) {
+			const double x = coordinate(generator) / (g < 2 ? 10.0 : 1.0);
+			const double y = coordinate(generator) / (g < 2 ? 10.0 : 1.0);
+			const bool expected = reference_contains(fences[g], x, y);
+			if (engine.contains(g, x, y) != expected) {
+				throw std::runtime_error("Containment of (" + std::to_string(x) + ", " + std::to_string(y)
+										 + ") in geofence " + std::to_string(g) + " differed from reference");
+			}
+			nInside += expected;
+		}
+		if (nInside == 0 || nInside == N_RANDOM_POINTS) {
+			throw std::runtime_error("Random points did not cover geofence " + std::to_string(g));
+		}
+	}
+	// Points on vertices, edges and the lines through them
+	for (std::size_t g = 0; g < 2; ++g) {
+		for (double x = -1.0; x <= 11.0; x += 0.5) {
+			for (double y = -1.0; y <= 11.0; y += 0.5) {
+				if (engine.contains(g, x, y) != reference_contains(fences[g], x, y)) {
+					throw std::runtime_error("Containment of (" + std::to_string(x) + ", " + std::to_string(y)
+											 + ") in geofence " + std::to_string(g) + " differed from reference");
+				}
+			}
+		}
+	}
+}
+
+//! \brief Checks breaches of permitted and forbidden geofences and of height intervals
+void breach_test() {
+	Geofence arena;
+	arena.vertices = {{0, 0}, {100, 0}, {100, 100}, {0, 100}};
+	arena.minHeight_m = -1.0;
+	arena.maxHeight_m = 5.0;
+	Geofence obstacle;
+	obstacle.isPermitted = false;
+	obstacle.vertices = {{40, 40}, {60, 40}, {60, 60}, {40, 60}};
+	GeofenceEngine engine({arena, obstacle});
+
+	std::vector<GeofenceEngine::Position> positions = {
+		{1, 10.0, 10.0, 0.0, true},		// Inside arena
+		{2, 50.0, 50.0, 0.0, true},		// Inside obstacle
+		{3, 150.0, 50.0, 0.0, true},	// Outside arena
+		{4, 10.0, 10.0, 8.0, true},		// Above arena
+		{5, 10.0, 10.0, 8.0, false}		// Unknown height
+	};
+	std::vector<GeofenceEngine::Breach> breaches;
+	engine.check(positions, breaches);
+	if (breaches.size() != 3
+			|| breaches[0].objectId != 3 || breaches[0].geofence != 0
+			|| breaches[1].objectId != 4 || breaches[1].geofence != 0
+			|| breaches[2].objectId != 2 || breaches[2].geofence != 1) {
+		throw std::runtime_error("Unexpected geofence breaches");
+	}
+}
+
+//! \brief Reports the time to check a batch of objects against a geofence with many vertices
+void benchmark() {
+	using namespace std::chrono;
+	const auto fence = star(N_STAR_VERTICES, 20.0, 100.0);
+	GeofenceEngine engine({fence});
+	std::mt19937 generator(2);
+	std::uniform_real_distribution<double> coordinate(-100.0, 100.0);
+	std::vector<GeofenceEngine::Position> positions;
+	for (uint32_t id = 1; id <= N_OBJECTS; ++id) {
+		positions.push_back({id, coordinate(generator), coordinate(generator), 0.0, false});
+	}
+
+	std::vector<GeofenceEngine::Breach> breaches;
+	std::size_t nBreaches = 0;
+	auto start = steady_clock::now();
+	for (int i = 0; i < N_BENCHMARK_BATCHES; ++i) {
+		positions[i % N_OBJECTS].x_m += 1e-9;
+		engine.check(positions, breaches);
+		nBreaches += breaches.size();
+	}
+	auto engineTime = duration<double, std::micro>(steady_clock::now() - start) / N_BENCHMARK_BATCHES;
+
+	start = steady_clock::now();
+	for (int i = 0; i < N_BENCHMARK_BATCHES; ++i) {
+		positions[i % N_OBJECTS].x_m += 1e-9;
+		for (const auto& position : positions) {
+			nBreaches += !reference_contains(fence, position.x_m, position.y_m);
+		}
+	}
+	auto referenceTime = duration<double, std::micro>(steady_clock::now() - start) / N_BENCHMARK_BATCHES;
+
+	std::cout << N_OBJECTS << " objects against " << N_STAR_VERTICES << " vertex geofence: "
+			  << engineTime.count() << " us per batch, all edge reference " << referenceTime.count()
+			  << " us (" << nBreaches << " breaches)" << std::endl;
+}
@@ -1,4 +1,5 @@
 #include "../trajectory.hpp"
+#include <chrono>
 #include <exception>
 #include <cmath>
 #include <vector>
@@ -9,6 +10,8 @@
 #define VEL_TOL_M_S 0.001
 #define ACC_TOL_M_S2 0.001
 #define HDG_TOL_DEG 0.1
+#define BENCHMARK_MIN_POINTS 10000
+#define BENCHMARK_MAX_POINTS 1000000
 using namespace ATOS;
 using traj_pt = Trajectory::TrajectoryPoint;
 static void time_test();
@@ -18,6 +21,9 @@ static void velocity_test();
 static void acceleration_test();
 static void curvature_test();
 static void mode_test();
+static void trajectory_test();
+static void interpolation_test();
+static void benchmark();
 static void set_default(traj_pt&);
 
 int main(int argc, char** argv) {
@@ -29,6 +35,9 @@ int main(int argc, char** argv) {
 		acceleration_test();
 		curvature_test();
 		mode_test();
+		trajectory_test();
+		interpolation_test();
+		benchmark();
 		exit(EXIT_SUCCESS);
 	}
 	catch (std::runtime_error& e) {
@@ -426,3 +435,132 @@ void mode_test() {
 		}
 	}
 }
+
+void trajectory_test() {
+	Trajectory t1(rclcpp::get_logger("test")), t2(rclcpp::get_logger("test"));
+	for (int i = 0; i < 5000; ++i) {
+		traj_pt p1(rclcpp::get_logger("test")), p2(rclcpp::get_logger("test"));
+		set_default(p1);
+		set_default(p2);
+		p1.setTime(std::chrono::milliseconds(10*i + i%3));
+		p1.setXCoord(std::sin(0.01*i) * 50.0);
+		p1.setYCoord(std::cos(0.02*i) * 20.0);
+		p1.setHeading(0.003*i);
+		p1.setLongitudinalVelocity(5.0 + std::sin(0.1*i));
+		p1.setLateralAcceleration(std::cos(0.1*i));
+		p2.setTime(std::chrono::milliseconds(23*i));
+		p2.setXCoord(0.5*i);
+		p2.setYCoord(-0.1*i);
+		p2.setHeading(-0.002*i);
+		p2.setLongitudinalVelocity(3.0);
+		p2.setLateralVelocity(std::sin(0.05*i));
+		t1.points.push_back(p1);
+		t2.points.push_back(p2);
+	}
+
+	// The trajectory should match its points relative to the nearest point in time
+	auto tRel = t1.relativeTo(t2);
+	for (unsigned long i = 0; i < t1.points.size(); ++i) {
+		const auto& p1 = t1.points[i];
+		auto t = std::chrono::duration<double>(p1.getTime()).count();
+		auto exp = p1.relativeTo(*Trajectory::getNearest(t2.points.begin(), t2.points.end(), t));
+		const auto& act = tRel.points[i];
+		auto hdgDiff = std::abs(exp.getHeading() - act.getHeading());
+		if (exp.getTime() != act.getTime()
+				|| (exp.getPosition() - act.getPosition()).norm() > POS_TOL_M
+				|| std::min(hdgDiff, 2*M_PI - hdgDiff)*180.0/M_PI > HDG_TOL_DEG
+				|| (exp.getVelocity() - act.getVelocity()).norm() > VEL_TOL_M_S
+				|| (exp.getAcceleration() - act.getAcceleration()).norm() > ACC_TOL_M_S2
+				|| std::abs(exp.getCurvature() - act.getCurvature()) > ACC_TOL_M_S2) {
+			std::stringstream ss;
+			ss << "Relative trajectory differs from relative point " << i << ":" << std::endl;
+			ss << "exp: " << exp.toString() << std::endl;
+			ss << "act: " << act.toString();
+			throw std::runtime_error(ss.str());
+		}
+	}
+}
+
+void interpolation_test() {
+	using namespace std::chrono_literals;
+	Trajectory t1(rclcpp::get_logger("test")), t2(rclcpp::get_logger("test"));
+	traj_pt p1(rclcpp::get_logger("test")), p2(rclcpp::get_logger("test"));
+	set_default(p1);
+	set_default(p2);
+	p1.setTime(50ms);
+	p1.setXCoord(5.0);
+	t1.points.push_back(p1);
+	p2.setTime(0ms);
+	p2.setHeading(0.1);
+	t2.points.push_back(p2);
+	p2.setTime(100ms);
+	p2.setXCoord(10.0);
+	p2.setHeading(2*M_PI - 0.1);
+	t2.points.push_back(p2);
+
+	// Halfway between the points the other is at x=5 with heading 0
+	auto pRel = t1.relativeTo(t2, Trajectory::AlignmentMode::LINEAR_INTERPOLATION).points.front();
+	if (std::abs(pRel.getXCoord()) > POS_TOL_M || std::abs(pRel.getYCoord()) > POS_TOL_M
+			|| std::min(pRel.getHeading(), 2*M_PI - pRel.getHeading())*180.0/M_PI > HDG_TOL_DEG) {
+		std::stringstream ss;
+		ss << "Relative position to interpolated point not within error tolerance:" << std::endl;
+		ss << "exp: (0,0,0), hdg: 0" << std::endl;
+		ss << "act: " << pRel.toString();
+		throw std::runtime_error(ss.str());
+	}
+}
+
+/*!
+ * \brief Reports the time taken to compute relative trajectories of 10k to 1M
+ *			points in both alignment modes, compared to looking up the nearest
+ *			point in time separately for each point.
+ */
+void benchmark() {
+	using namespace std::chrono;
+	for (int n = BENCHMARK_MIN_POINTS; n <= BENCHMARK_MAX_POINTS; n *= 10) {
+		Trajectory t1(rclcpp::get_logger("test")), t2(rclcpp::get_logger("test"));
+		t1.points.reserve(n);
+		t2.points.reserve(n);
+		for (int i = 0; i < n; ++i) {
+			traj_pt p1(rclcpp::get_logger("test")), p2(rclcpp::get_logger("test"));
+			set_default(p1);
+			set_default(p2);
+			p1.setTime(milliseconds(10*i));
+			p1.setXCoord(std::sin(1e-4*i) * 500.0);
+			p1.setYCoord(std::cos(1e-4*i) * 500.0);
+			p1.setHeading(std::fmod(1e-4*i, 2*M_PI));
+			p1.setLongitudinalVelocity(5.0);
+			p2.setTime(milliseconds(10*i + 3));
+			p2.setXCoord(0.05*i);
+			p2.setHeading(0.0);
+			p2.setLongitudinalVelocity(5.0);
+			t1.points.push_back(p1);
+			t2.points.push_back(p2);
+		}
+
+		auto start = steady_clock::now();
+		std::vector<traj_pt> perPoint;
+		perPoint.reserve(n);
+		for (const auto& p1 : t1.points) {
+			auto t = duration<double>(p1.getTime()).count();
+			perPoint.push_back(p1.relativeTo(*Trajectory::getNearest(t2.points.begin(), t2.points.end(), t)));
+		}
+		duration<double> perPointTime = steady_clock::now() - start;
+		start = steady_clock::now();
+		auto nearest = t1.relativeTo(t2);
+		duration<double> nearestTime = steady_clock::now() - start;
+		start = steady_clock::now();
+		auto interpolated = t1.relativeTo(t2, Trajectory::AlignmentMode::LINEAR_INTERPOLATION);
+		duration<double> interpolatedTime = steady_clock::now() - start;
+
+		if (nearest.size() != t1.size() || interpolated.size() != t1.size()
+				|| (nearest.points.back().getPosition() - perPoint.back().getPosition()).norm() > POS_TOL_M) {
+			throw std::runtime_error("Relative trajectory of " + std::to_string(n) + " points differs from per point result");
+		}
+		std::cout << n << " points relative to " << n << " points: nearest point " << nearestTime.count() * 1e3
+				  << " ms (" << n / nearestTime.count() << " points/s), interpolated "
+				  << interpolatedTime.count() * 1e3 << " ms (" << n / interpolatedTime.count()
+				  << " points/s), per point lookup " << perPointTime.count() * 1e3 << " ms ("
+				  << n / perPointTime.count() << " points/s)" << std::endl;
+	}
+}
@@ -0,0 +1,253 @@
+#include "seqlockmem.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define N_SLOTS 8
+#define N_WRITES 200000
+#define N_READER_THREADS 3
+#define RECORD_WORDS 29
+#define N_BENCHMARK_OPERATIONS 1000000
+
+/*!
+ * \brief Record whose words are all derived from its sequence number, so
+ *			that a torn read can be detected. The size is deliberately not a
+ *			multiple of 8 bytes.
+ */
+typedef struct {
+	uint64_t sequenceNumber;
+	uint64_t words[RECORD_WORDS];
+	uint32_t checksum;
+} TestRecord;
+
+static void fill_record(TestRecord& record, const uint64_t n, const unsigned int slot);
+static bool is_consistent(const TestRecord& record, const unsigned int slot);
+static void open_test(const std::string& name);
+static void stress_test(const std::string& name);
+static void benchmark(const std::string& name);
+
+int main(int argc, char** argv) {
+	auto name = "test_seqlockmemory_" + std::to_string(getpid());
+	try {
+		open_test(name);
+		stress_test(name);
+		benchmark(name);
+		exit(EXIT_SUCCESS);
+	}
+	catch (std::exception& e) {
+		std::cerr << "Test " << __FILE__ << " failed: " << std::endl
+				  << e.what() << std::endl;
+		exit(EXIT_FAILURE);
+	}
+}
+
+void fill_record(TestRecord& record, const uint64_t n, const unsigned int slot) {
+	record.sequenceNumber = n;
+	for (unsigned int i = 0; i < RECORD_WORDS; ++i) {
+		record.words[i] = n * 31 + i + slot;
+	}
+	record.checksum = static_cast<uint32_t>(n ^ slot);
+}
+
+bool is_consistent(const TestRecord& record, const unsigned int slot) {
+	for (unsigned int i = 0; i < RECORD_WORDS; ++i) {
+		if (record.words[i] != record.sequenceNumber * 31 + i + slot) {
+			return false;
+		}
+	}
+	return record.checksum == static_cast<uint32_t>(record.sequenceNumber ^ slot);
+}
+
+/*!
+ * \brief Creates a memory, opens it a second time and checks that records
+ *			and versions are shared between the two handles.
+ */
+void open_test(const std::string& name) {
+	int wasCreated = 0;
+	auto created = createSeqlockMemory(name.c_str(), N_SLOTS, sizeof (TestRecord), &wasCreated);
+	if (created == nullptr || !wasCreated) {
+		throw std::runtime_error("Failed to create memory");
+	}
+	auto opened = createSeqlockMemory(name.c_str(), N_SLOTS, sizeof (TestRecord), &wasCreated);
+	if (opened == nullptr || wasCreated) {
+		destroySeqlockMemory(created);
+		throw std::runtime_error("Failed to open existing memory");
+	}
+	if (createSeqlockMemory(name.c_str(), N_SLOTS, sizeof (TestRecord) + 1, nullptr) != nullptr) {
+		throw std::runtime_error("Opened memory with mismatching record size");
+	}
+	if (getNumberOfSeqlockSlots(opened) != N_SLOTS || getSeqlockRecordSize(opened) != sizeof (TestRecord)) {
+		throw std::runtime_error("Mismatching layout of opened memory");
+	}
+
+	TestRecord written, read;
+	if (readSeqlockSlot(opened, 0, &read) != 0) {
+		throw std::runtime_error("Unwritten slot had nonzero version");
+	}
+	fill_record(written, 42, 3);
+	if (writeSeqlockSlot(created, 3, &written) != 1 || writeSeqlockSlot(created, 3, &written) != 2) {
+		throw std::runtime_error("Unexpected version after write");
+	}
+	if (readSeqlockSlot(opened, 3, &read) != 2 || getSeqlockSlotVersion(opened, 3) != 2
+			|| read.sequenceNumber != 42 || !is_consistent(read, 3)) {
+		throw std::runtime_error("Record read through second handle did not match written record");
+	}
+	if (writeSeqlockSlot(created, N_SLOTS, &written) != 0 || readSeqlockSlot(opened, N_SLOTS, &read) != 0) {
+		throw std::runtime_error("Access to slot out of range succeeded");
+	}
+	closeSeqlockMemory(opened);
+	destroySeqlockMemory(created);
+}
+
+/*!
+ * \brief Writes all slots from a child process while several threads in this
+ *			process read them. Every read record must be consistent and the
+ *			versions seen in a slot must never decrease.
+ */
+void stress_test(const std::string& name) {
+	auto memory = createSeqlockMemory(name.c_str(), N_SLOTS, sizeof (TestRecord), nullptr);
+	if (memory == nullptr) {
+		throw std::runtime_error("Failed to create memory");
+	}
+
+	pid_t writer = fork();
+	if (writer == -1) {
+		destroySeqlockMemory(memory);
+		throw std::runtime_error("Failed to fork writer process");
+	}
+	if (writer == 0) {
+		// Open a separate mapping as an independent process would
+		auto writerMemory = createSeqlockMemory(name.c_str(), N_SLOTS, sizeof (TestRecord), nullptr);
+		if (writerMemory == nullptr) {
+			_exit(EXIT_FAILURE);
+		}
+		TestRecord record;
+		for (uint64_t n = 1; n <= N_WRITES; ++n) {
+			const unsigned int slot = n % N_SLOTS;
+			fill_record(record, n, slot);
+			if (writeSeqlockSlot(writerMemory, slot, &record) == 0) {
+				_exit(EXIT_FAILURE);
+			}
+		}
+		closeSeqlockMemory(writerMemory);
+		_exit(EXIT_SUCCESS);
+	}
+
+	std::atomic<bool> writerDone(false);
+	std::atomic<uint64_t> nTorn(0), nReordered(0), nReads(0);
+	std::vector<std::thread> readers;
+	for (int r = 0; r < N_READER_THREADS; ++r) {
+		readers.emplace_back([&]() {
+			std::vector<uint64_t> lastVersion(N_SLOTS, 0), lastSequenceNumber(N_SLOTS, 0);
+			TestRecord record;
+			uint64_t reads = 0;
+			bool lastPass = false;
+			while (!lastPass) {
+				lastPass = writerDone.load();
+				for (unsigned int slot = 0; slot < N_SLOTS; ++slot) {
+					auto version = readSeqlockSlot(memory, slot, &record);
+					if (version == 0) {
+						continue;
+					}
+					++reads;
+					if (!is_consistent(record, slot) || record.sequenceNumber % N_SLOTS != slot) {
+						++nTorn;
+					}
+					if (version < lastVersion[slot] || record.sequenceNumber < lastSequenceNumber[slot]) {
+						++nReordered;
+					}
+					lastVersion[slot] = version;
+					lastSequenceNumber[slot] = record.sequenceNumber;
+				}
+			}
+			nReads += reads;
+		});
+	}
+
+	int status;
+	waitpid(writer, &status, 0);
+	writerDone = true;
+	for (auto& reader : readers) {
+		reader.join();
+	}
+
+	TestRecord record;
+	for (unsigned int slot = 0; slot < N_SLOTS; ++slot) {
+		if (readSeqlockSlot(memory, slot, &record) != N_WRITES / N_SLOTS
+				|| record.sequenceNumber != N_WRITES - (N_SLOTS - slot) % N_SLOTS) {
+			destroySeqlockMemory(memory);
+			throw std::runtime_error("Final record in slot " + std::to_string(slot) + " was not the last written");
+		}
+	}
+	destroySeqlockMemory(memory);
+
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+		throw std::runtime_error("Writer process failed");
+	}
+	if (nTorn > 0) {
+		throw std::runtime_error(std::to_string(nTorn) + " of " + std::to_string(nReads) + " reads were torn");
+	}
+	if (nReordered > 0) {
+		throw std::runtime_error(std::to_string(nReordered) + " reads went back in version");
+	}
+	std::cout << "Stress test: " << nReads << " consistent reads during "
+			  << N_WRITES << " writes" << std::endl;
+}
+
+/*!
+ * \brief Reports the latency of uncontended writes and reads, and of reads
+ *			while another process writes to the same slot.
+ */
+void benchmark(const std::string& name) {
+	using namespace std::chrono;
+	auto memory = createSeqlockMemory(name.c_str(), N_SLOTS, sizeof (TestRecord), nullptr);
+	if (memory == nullptr) {
+		throw std::runtime_error("Failed to create memory");
+	}
+	TestRecord record;
+	fill_record(record, 1, 0);
+
+	auto start = steady_clock::now();
+	for (int i = 0; i < N_BENCHMARK_OPERATIONS; ++i) {
+		writeSeqlockSlot(memory, 0, &record);
+	}
+	auto writeTime = duration<double, std::nano>(steady_clock::now() - start) / N_BENCHMARK_OPERATIONS;
+
+	start = steady_clock::now();
+	for (int i = 0; i < N_BENCHMARK_OPERATIONS; ++i) {
+		readSeqlockSlot(memory, 0, &record);
+	}
+	auto readTime = duration<double, std::nano>(steady_clock::now() - start) / N_BENCHMARK_OPERATIONS;
+
+	pid_t writer = fork();
+	if (writer == 0) {
+		auto writerMemory = createSeqlockMemory(name.c_str(), N_SLOTS, sizeof (TestRecord), nullptr);
+		TestRecord written;
+		for (uint64_t n = 0; writerMemory != nullptr; n += N_SLOTS) {
+			fill_record(written, n, 0);
+			writeSeqlockSlot(writerMemory, 0, &written);
+		}
+		_exit(EXIT_FAILURE);
+	}
+	start = steady_clock::now();
+	for (int i = 0; i < N_BENCHMARK_OPERATIONS; ++i) {
+		readSeqlockSlot(memory, 0, &record);
+	}
+	auto contendedReadTime = duration<double, std::nano>(steady_clock::now() - start) / N_BENCHMARK_OPERATIONS;
+	if (writer != -1) {
+		kill(writer, SIGKILL);
+		waitpid(writer, nullptr, 0);
+	}
+	destroySeqlockMemory(memory);
+
+	std::cout << "Record size " << sizeof (TestRecord) << " bytes: write " << writeTime.count()
+			  << " ns, read " << readTime.count() << " ns, read during writes "
+			  << contendedReadTime.count() << " ns" << std::endl;
+}
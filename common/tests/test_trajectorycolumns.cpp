@@ -0,0 +1,214 @@
+#include "../trajectory.hpp"
+#include "../trajectorycolumns.hpp"
+#include <cmath>
+#include <exception>
+#include <iostream>
+#include <limits>
+#include <rclcpp/logging.hpp>
+#define N_POINTS 64
+using namespace ATOS;
+using traj_pt = Trajectory::TrajectoryPoint;
+using columns_t = TrajectoryColumns;
+static void round_trip_test();
+static void validity_test();
+static void nan_test();
+static void iterator_test();
+static Trajectory mixed_trajectory();
+static bool same_value(const double a, const double b);
+static void check_equal(const traj_pt& a, const traj_pt& b, const std::size_t index);
+
+int main(int argc, char** argv) {
+	try {
+		round_trip_test();
+		validity_test();
+		nan_test();
+		iterator_test();
+		exit(EXIT_SUCCESS);
+	}
+	catch (std::runtime_error& e) {
+		std::cerr << "Test " << __FILE__ << " failed: " << std::endl
+				  << e.what() << std::endl;
+		exit(EXIT_FAILURE);
+	}
+}
+
+/*!
+ * \brief Trajectory where point i has the optional quantities flagged in the
+ *			lowest five bits of i set, so that every combination occurs.
+ */
+Trajectory mixed_trajectory() {
+	Trajectory trajectory(rclcpp::get_logger("test"));
+	for (int i = 0; i < N_POINTS; ++i) {
+		traj_pt pt;
+		pt.setTime(std::chrono::milliseconds(10 * i));
+		pt.setXCoord(0.5 * i);
+		pt.setYCoord(-0.25 * i);
+		if (i & columns_t::Z_VALID)
+			pt.setZCoord(0.01 * i);
+		pt.setHeading(0.1 * i);
+		if (i & columns_t::LONGITUDINAL_VELOCITY_VALID)
+			pt.setLongitudinalVelocity(1.5 + i);
+		if (i & columns_t::LATERAL_VELOCITY_VALID)
+			pt.setLateralVelocity(-0.5 * i);
+		if (i & columns_t::LONGITUDINAL_ACCELERATION_VALID)
+			pt.setLongitudinalAcceleration(0.2 * i);
+		if (i & columns_t::LATERAL_ACCELERATION_VALID)
+			pt.setLateralAcceleration(-0.1 * i);
+		pt.setCurvature(0.001 * i);
+		pt.setMode(i % 3 ? traj_pt::CONTROLLED_BY_VEHICLE : traj_pt::CONTROLLED_BY_DRIVE_FILE);
+		trajectory.points.push_back(pt);
+	}
+	return trajectory;
+}
+
+bool same_value(const double a, const double b) {
+	return (std::isnan(a) && std::isnan(b)) || a == b;
+}
+
+void check_equal(const traj_pt& a, const traj_pt& b, const std::size_t index) {
+	auto pa = a.getPosition(), pb = b.getPosition();
+	auto va = a.getVelocity(), vb = b.getVelocity();
+	auto aa = a.getAcceleration(), ab = b.getAcceleration();
+	if (a.getTime() != b.getTime() || a.getHeading() != b.getHeading()
+			|| !same_value(a.getCurvature(), b.getCurvature()) || a.getMode() != b.getMode()) {
+		throw std::runtime_error("Time, heading, curvature or mode differ at point " + std::to_string(index));
+	}
+	for (int i = 0; i < 3; ++i) {
+		if (!same_value(pa[i], pb[i])) {
+			throw std::runtime_error("Position differs at point " + std::to_string(index));
+		}
+	}
+	for (int i = 0; i < 2; ++i) {
+		if (!same_value(va[i], vb[i]) || !same_value(aa[i], ab[i])) {
+			throw std::runtime_error("Velocity or acceleration differs at point " + std::to_string(index));
+		}
+	}
+}
+
+/*!
+ * \brief Converts a trajectory to columns and back, which should reproduce every
+ *			point including which optional quantities are missing.
+ */
+void round_trip_test() {
+	auto original = mixed_trajectory();
+	auto columns = original.toColumns();
+	if (columns->size() != original.size()) {
+		throw std::runtime_error("Columns hold " + std::to_string(columns->size()) + " points, expected "
+								 + std::to_string(original.size()));
+	}
+	Trajectory restored(rclcpp::get_logger("test"));
+	restored.initializeFromColumns(*columns);
+	if (restored.size() != original.size()) {
+		throw std::runtime_error("Trajectory restored from columns has " + std::to_string(restored.size()) + " points");
+	}
+	for (std::size_t i = 0; i < original.size(); ++i) {
+		check_equal(original.points[i], restored.points[i], i);
+	}
+
+	Trajectory empty(rclcpp::get_logger("test"));
+	if (!empty.toColumns()->empty()) {
+		throw std::runtime_error("Columns of an empty trajectory are not empty");
+	}
+	restored.initializeFromColumns(*empty.toColumns());
+	if (!restored.points.empty()) {
+		throw std::runtime_error("Initializing from empty columns kept points");
+	}
+}
+
+/*!
+ * \brief Checks that each optional quantity is flagged valid exactly where it was
+ *			set, and that missing values are stored as zero rather than NaN.
+ */
+void validity_test() {
+	auto columns = mixed_trajectory().toColumns();
+	const std::vector<std::pair<columns_t::ValidityFlag, const std::vector<double>*>> optional = {
+		{columns_t::Z_VALID, &columns->z_m},
+		{columns_t::LONGITUDINAL_VELOCITY_VALID, &columns->longitudinalVelocity_m_s},
+		{columns_t::LATERAL_VELOCITY_VALID, &columns->lateralVelocity_m_s},
+		{columns_t::LONGITUDINAL_ACCELERATION_VALID, &columns->longitudinalAcceleration_m_s2},
+		{columns_t::LATERAL_ACCELERATION_VALID, &columns->lateralAcceleration_m_s2}
+	};
+	for (std::size_t i = 0; i < columns->size(); ++i) {
+		if (columns->validity[i] != (i & 0x1F)) {
+			throw std::runtime_error("Validity mask of point " + std::to_string(i) + " is "
+									 + std::to_string(columns->validity[i]));
+		}
+		for (const auto& [flag, column] : optional) {
+			if (columns->isValid(i, flag) != static_cast<bool>(i & flag)) {
+				throw std::runtime_error("Validity flag " + std::to_string(flag) + " wrong at point " + std::to_string(i));
+			}
+			if (std::isnan((*column)[i]) || (!(i & flag) && (*column)[i] != 0.0)) {
+				throw std::runtime_error("Missing value not stored as zero at point " + std::to_string(i));
+			}
+		}
+	}
+}
+
+/*!
+ * \brief A NaN in an optional quantity marks it missing, so reading it from the
+ *			restored point throws as for the original. Quantities which are not
+ *			optional keep their NaN.
+ */
+void nan_test() {
+	Trajectory trajectory(rclcpp::get_logger("test"));
+	traj_pt pt;
+	pt.setXCoord(std::numeric_limits<double>::quiet_NaN());
+	pt.setYCoord(1.0);
+	pt.setZCoord(std::numeric_limits<double>::quiet_NaN());
+	pt.setLongitudinalVelocity(std::numeric_limits<double>::quiet_NaN());
+	pt.setLateralVelocity(0.0);
+	pt.setCurvature(std::numeric_limits<double>::quiet_NaN());
+	trajectory.points.push_back(pt);
+
+	auto columns = trajectory.toColumns();
+	if (columns->validity[0] != columns_t::LATERAL_VELOCITY_VALID) {
+		throw std::runtime_error("NaN optional quantities flagged valid");
+	}
+	if (!std::isnan(columns->x_m[0]) || !std::isnan(columns->curvature[0])) {
+		throw std::runtime_error("NaN in a quantity which is not optional was not kept");
+	}
+	auto restored = columns->at(0);
+	check_equal(pt, restored, 0);
+	bool threw = false;
+	try {
+		restored.getZCoord();
+	}
+	catch (std::out_of_range&) {
+		threw = true;
+	}
+	if (!threw || restored.getLateralVelocity() != 0.0) {
+		throw std::runtime_error("Missing z read from restored point, or zero lateral velocity lost");
+	}
+}
+
+/*!
+ * \brief Reads the columns through the point adapter: indexing, iterator
+ *			arithmetic and range construction.
+ */
+void iterator_test() {
+	auto original = mixed_trajectory();
+	auto columns = original.toColumns();
+	if (columns->end() - columns->begin() != static_cast<std::ptrdiff_t>(original.size())) {
+		throw std::runtime_error("Iterator distance differs from the number of points");
+	}
+	std::size_t i = 0;
+	for (auto it = columns->begin(); it != columns->end(); ++it, ++i) {
+		check_equal(original.points[i], *it, i);
+		check_equal(original.points[i], columns->at(i), i);
+	}
+	auto it = columns->begin() + 10;
+	check_equal(original.points[15], it[5], 15);
+	if (it.position() != 10 || !(columns->begin() < it)) {
+		throw std::runtime_error("Iterator arithmetic gave the wrong position");
+	}
+	bool threw = false;
+	try {
+		columns->at(columns->size());
+	}
+	catch (std::out_of_range&) {
+		threw = true;
+	}
+	if (!threw) {
+		throw std::runtime_error("Reading past the last point did not throw");
+	}
+}
@@ -0,0 +1,301 @@
+#include "../trajectory.hpp"
+#include "../regexpatterns.hpp"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <regex>
+#include <string>
+#include <vector>
+#include <rclcpp/logging.hpp>
+#define N_SMALL_POINTS 1000
+#define N_PARALLEL_POINTS 100000
+#define N_BENCHMARK_POINTS 1000000
+#define VALUE_TOL 1e-6
+using namespace ATOS;
+namespace fs = std::filesystem;
+using traj_pt = Trajectory::TrajectoryPoint;
+static void round_trip_test(const std::size_t nPoints);
+static void line_format_test();
+static void file_error_test();
+static void error_precedence_test();
+static void benchmark();
+static Trajectory circle(const std::size_t nPoints);
+static std::string point_line(const std::size_t index);
+static void write_file(const std::string& fileName, const std::string& contents);
+static std::string load_error(const std::string& fileName);
+static std::string traj_path(const std::string& fileName);
+
+/*!
+ * \brief Checks that trajectory files are parsed as before the parser was
+ *			rewritten without regex, and reports the parsing throughput. Files
+ *			are written to a temporary home directory.
+ */
+int main(int argc, char** argv) {
+	char home[] = "/tmp/test_trajectoryparser_XXXXXX";
+	if (mkdtemp(home) == nullptr) {
+		std::cerr << "Unable to create temporary directory" << std::endl;
+		exit(EXIT_FAILURE);
+	}
+	setenv("HOME", home, 1);
+	int retval = EXIT_SUCCESS;
+	try {
+		fs::create_directories(traj_path(""));
+		round_trip_test(N_SMALL_POINTS);
+		round_trip_test(N_PARALLEL_POINTS);
+		line_format_test();
+		file_error_test();
+		error_precedence_test();
+		benchmark();
+	}
+	catch (std::exception& e) {
+		std::cerr << "Test " << __FILE__ << " failed: " << std::endl
+				  << e.what() << std::endl;
+		retval = EXIT_FAILURE;
+	}
+	fs::remove_all(home);
+	exit(retval);
+}
+
+std::string traj_path(const std::string& fileName) {
+	char trajDirPath[PATH_MAX];
+	UtilGetTrajDirectoryPath(trajDirPath, sizeof (trajDirPath));
+	return std::string(trajDirPath) + fileName;
+}
+
+Trajectory circle(const std::size_t nPoints) {
+	Trajectory trajectory(rclcpp::get_logger("test"));
+	trajectory.id = 7;
+	trajectory.name = "parser_test";
+	for (std::size_t i = 0; i < nPoints; ++i) {
+		traj_pt pt;
+		pt.setTime(std::chrono::milliseconds(10 * i));
+		pt.setXCoord(std::round(50.0 * std::cos(i * 1e-3) * 1e6) / 1e6);
+		pt.setYCoord(std::round(-50.0 * std::sin(i * 1e-3) * 1e6) / 1e6);
+		pt.setZCoord(0.25);
+		pt.setHeading(std::round(std::fmod(i * 1e-3, 2 * M_PI) * 1e6) / 1e6);
+		pt.setLongitudinalVelocity(5.0);
+		pt.setLongitudinalAcceleration(i % 2 ? 0.125 : -0.125);
+		pt.setCurvature(0.02);
+		pt.setMode(i % 2 ? traj_pt::CONTROLLED_BY_VEHICLE : traj_pt::CONTROLLED_BY_DRIVE_FILE);
+		trajectory.points.push_back(pt);
+	}
+	return trajectory;
+}
+
+//! \brief A well formatted line as written by Trajectory::saveToFile
+std::string point_line(const std::size_t index) {
+	return "LINE;" + std::to_string(index * 0.01) + ";1.000000;2.000000;0.000000;0.500000;1.000000;;0.000000;;0.000000;1;ENDLINE;";
+}
+
+void write_file(const std::string& fileName, const std::string& contents) {
+	std::ofstream ostrm(traj_path(fileName));
+	ostrm << contents;
+}
+
+//! \brief Loads the file and returns the message of the exception this raises.
+std::string load_error(const std::string& fileName) {
+	Trajectory trajectory(rclcpp::get_logger("test"));
+	try {
+		trajectory.initializeFromFile(fileName);
+	}
+	catch (std::invalid_argument& e) {
+		return e.what();
+	}
+	throw std::runtime_error("Loading " + fileName + " did not fail");
+}
+
+/*!
+ * \brief Saves a trajectory and loads it again, which should give the same points.
+ *			Above 16384 points, the lines are decoded on several threads.
+ */
+void round_trip_test(const std::size_t nPoints) {
+	auto original = circle(nPoints);
+	original.saveToFile("roundtrip.traj");
+	Trajectory loaded(rclcpp::get_logger("test"));
+	loaded.initializeFromFile("roundtrip.traj");
+
+	if (loaded.id != original.id || loaded.name != original.name || loaded.size() != original.size()) {
+		throw std::runtime_error("Loaded trajectory header differs from the saved trajectory");
+	}
+	for (std::size_t i = 0; i < nPoints; ++i) {
+		const auto& a = original.points[i];
+		const auto& b = loaded.points[i];
+		// Times are saved in seconds and truncated to milliseconds when loaded
+		if (std::chrono::abs(a.getTime() - b.getTime()) > std::chrono::milliseconds(1) || a.getMode() != b.getMode()
+				|| (a.getPosition() - b.getPosition()).norm() > VALUE_TOL
+				|| std::abs(a.getHeading() - b.getHeading()) > VALUE_TOL
+				|| std::abs(a.getLongitudinalVelocity() - b.getLongitudinalVelocity()) > VALUE_TOL
+				|| std::abs(a.getLongitudinalAcceleration() - b.getLongitudinalAcceleration()) > VALUE_TOL
+				|| std::abs(a.getCurvature() - b.getCurvature()) > VALUE_TOL) {
+			throw std::runtime_error("Point " + std::to_string(i) + " of " + std::to_string(nPoints)
+									 + " differs after saving and loading");
+		}
+		// Lateral quantities are not saved, and should remain missing
+		if (!std::isnan(b.getVelocity()[1]) || !std::isnan(b.getAcceleration()[1])) {
+			throw std::runtime_error("Missing lateral quantities of point " + std::to_string(i) + " were set");
+		}
+	}
+}
+
+/*!
+ * \brief Loads single line files and checks that exactly the lines matching the
+ *			regex which the parser replaced are accepted, reporting the others
+ *			with the same message.
+ */
+void line_format_test() {
+	using RegexPatterns::floatPattern, RegexPatterns::intPattern;
+	const std::regex fileLinePattern("LINE;(" + floatPattern + ");(" + floatPattern + ");(" + floatPattern + ");("
+									 + floatPattern + ")?;(" + floatPattern + ");(" + floatPattern + ")?;("
+									 + floatPattern + ")?;(" + floatPattern + ")?;(" + floatPattern + ")?;("
+									 + floatPattern + ");(" + intPattern + ");ENDLINE;");
+	const std::vector<std::string> lines = {
+		point_line(0),
+		"LINE;0.1;1;2;;0.5;;;;;0;1;ENDLINE;",
+		"LINE;+0.1;-1;.5;-.25;0;+3;-0;1;2;0.01;0;ENDLINE;",
+		"  LINE;0.1;1;2;3;0.5;;;;;0;1;ENDLINE;\r",
+		"LINE;0.1;1;2;3;0.5;;;;;0;1;ENDLINE;trailing",
+		"",
+		"LINE;",
+		"LINE;0.1;1.;2;3;0.5;;;;;0;1;ENDLINE;",
+		"LINE;0.1;1e3;2;3;0.5;;;;;0;1;ENDLINE;",
+		"LINE;0.1;abc;2;3;0.5;;;;;0;1;ENDLINE;",
+		"LINE;0.1; 1;2;3;0.5;;;;;0;1;ENDLINE;",
+		"LINE;0.1;;2;3;0.5;;;;;0;1;ENDLINE;",
+		"LINE;0.1;1;2;3;;;;;;0;1;ENDLINE;",
+		"LINE;0.1;1;2;x;0.5;;;;;0;1;ENDLINE;",
+		"LINE;0.1;1;2;3;0.5;;;;-;0;1;ENDLINE;",
+		"LINE;0.1;1;2;3;0.5;;;;;;1;ENDLINE;",
+		"LINE;0.1;1;2;3;0.5;;;;;0;-1;ENDLINE;",
+		"LINE;0.1;1;2;3;0.5;;;;;0;1.0;ENDLINE;",
+		"LINE;0.1;1;2;3;0.5;;;;;0;;ENDLINE;",
+		"LINE;0.1;1;2;3;0.5;;;;;0;1;",
+		"LINE;0.1;1;2;3;0.5;;;;;0;1;ENDLINE",
+		"LINE;0.1;1;2;3;0.5;;;;0;1;ENDLINE;",
+		"LINE;0.1;1;2;3;0.5;;;;;;0;1;ENDLINE;",
+		"line;0.1;1;2;3;0.5;;;;;0;1;ENDLINE;"
+	};
+	for (const auto& line : lines) {
+		write_file("line.traj", "TRAJECTORY;1;line;0;1;\n" + line + "\nENDTRAJECTORY;\n");
+		const bool isWellFormatted = std::regex_search(line, fileLinePattern);
+		Trajectory trajectory(rclcpp::get_logger("test"));
+		std::string error;
+		try {
+			trajectory.initializeFromFile("line.traj");
+		}
+		catch (std::invalid_argument& e) {
+			error = e.what();
+		}
+		if (isWellFormatted && !error.empty()) {
+			throw std::runtime_error("Well formatted line \"" + line + "\" was rejected: " + error);
+		}
+		const auto expected = "Line 1 of trajectory file <" + traj_path("line.traj") + "> badly formatted";
+		if (!isWellFormatted && error != expected) {
+			throw std::runtime_error("Badly formatted line \"" + line + "\" gave \""
+									 + (error.empty() ? "no error" : error) + "\"");
+		}
+	}
+}
+
+/*!
+ * \brief Checks the messages for files which are badly formatted outside of the
+ *			point lines.
+ */
+void file_error_test() {
+	const auto eofError = [](const std::string& fileName) {
+		return "Encountered unexpected end of file while reading file <" + traj_path(fileName) + ">";
+	};
+	const std::vector<std::pair<std::string, std::string>> files = {
+		{"", eofError("error.traj")},
+		{"TRAJECTORY;1;bad name;0;1;\n" + point_line(0) + "\nENDTRAJECTORY;\n",
+		 "The header of trajectory file <" + traj_path("error.traj") + "> is badly formatted"},
+		{"TRAJECTORY;1;short;0;3;\n" + point_line(0) + "\n" + point_line(1) + "\n", eofError("error.traj")},
+		{"TRAJECTORY;1;nofooter;0;2;\n" + point_line(0) + "\n" + point_line(1) + "\n", eofError("error.traj")},
+		{"TRAJECTORY;1;badfooter;0;2;\n" + point_line(0) + "\n" + point_line(1) + "\nENDTRAJ;\n",
+		 "Final line of trajectory file <" + traj_path("error.traj") + "> badly formatted"},
+		{"TRAJECTORY;1;extraline;0;1;\n" + point_line(0) + "\n" + point_line(1) + "\nENDTRAJECTORY;\n",
+		 "Final line of trajectory file <" + traj_path("error.traj") + "> badly formatted"}
+	};
+	for (const auto& [contents, expected] : files) {
+		write_file("error.traj", contents);
+		auto error = load_error("error.traj");
+		if (error != expected) {
+			throw std::runtime_error("Loading file gave \"" + error + "\", expected \"" + expected + "\"");
+		}
+	}
+
+	Trajectory trajectory(rclcpp::get_logger("test"));
+	try {
+		trajectory.initializeFromFile("missing.traj");
+		throw std::runtime_error("Loading a missing file did not fail");
+	}
+	catch (std::ifstream::failure& e) {
+		if (std::string(e.what()).find("Unable to open file <" + traj_path("missing.traj") + ">") == std::string::npos) {
+			throw std::runtime_error("Loading a missing file gave \"" + std::string(e.what()) + "\"");
+		}
+	}
+}
+
+/*!
+ * \brief Where several lines are bad, the first is reported, also when they are
+ *			decoded on different threads, and a bad line is reported before a
+ *			missing or bad final line.
+ */
+void error_precedence_test() {
+	auto file = [](const std::size_t nPoints, const std::vector<std::size_t>& badLines,
+			const std::size_t nWritten, const std::string& footer) {
+		std::string contents = "TRAJECTORY;1;precedence;0;" + std::to_string(nPoints) + ";\n";
+		for (std::size_t i = 0; i < nWritten; ++i) {
+			bool isBad = std::find(badLines.begin(), badLines.end(), i) != badLines.end();
+			contents += (isBad ? "LINE;bad;ENDLINE;" : point_line(i)) + "\n";
+		}
+		return contents + footer;
+	};
+	const auto lineError = [](const std::size_t line) {
+		return "Line " + std::to_string(line) + " of trajectory file <" + traj_path("precedence.traj") + "> badly formatted";
+	};
+	const std::vector<std::pair<std::string, std::string>> files = {
+		{file(10, {6, 2}, 10, "ENDTRAJECTORY;\n"), lineError(3)},
+		{file(10, {4}, 10, "ENDTRAJ;\n"), lineError(5)},
+		{file(10, {4}, 6, ""), lineError(5)},
+		{file(N_PARALLEL_POINTS, {N_PARALLEL_POINTS - 10, N_PARALLEL_POINTS / 3, N_PARALLEL_POINTS / 2}, N_PARALLEL_POINTS,
+			  "ENDTRAJECTORY;\n"), lineError(N_PARALLEL_POINTS / 3 + 1)},
+		{file(N_PARALLEL_POINTS, {N_PARALLEL_POINTS - 1}, N_PARALLEL_POINTS, ""), lineError(N_PARALLEL_POINTS)}
+	};
+	for (const auto& [contents, expected] : files) {
+		write_file("precedence.traj", contents);
+		auto error = load_error("precedence.traj");
+		if (error != expected) {
+			throw std::runtime_error("Loading file gave \"" + error + "\", expected \"" + expected + "\"");
+		}
+	}
+}
+
+/*!
+ * \brief Reports the time taken to save and to load a trajectory of a million points.
+ */
+void benchmark() {
+	using namespace std::chrono;
+	auto original = circle(N_BENCHMARK_POINTS);
+	auto start = steady_clock::now();
+	original.saveToFile("benchmark.traj");
+	duration<double> saveTime = steady_clock::now() - start;
+
+	Trajectory loaded(rclcpp::get_logger("test"));
+	start = steady_clock::now();
+	loaded.initializeFromFile("benchmark.traj");
+	duration<double> loadTime = steady_clock::now() - start;
+	if (loaded.size() != original.size()) {
+		throw std::runtime_error("Loaded " + std::to_string(loaded.size()) + " of "
+								 + std::to_string(original.size()) + " points");
+	}
+	const double size_MB = fs::file_size(traj_path("benchmark.traj")) / 1e6;
+	std::cout << "Saved " << N_BENCHMARK_POINTS << " points (" << size_MB << " MB) in "
+			  << saveTime.count() * 1e3 << " ms, loaded in " << loadTime.count() * 1e3 << " ms: "
+			  << size_MB / loadTime.count() << " MB/s, " << N_BENCHMARK_POINTS / loadTime.count()
+			  << " points/s" << std::endl;
+}
@@ -0,0 +1,216 @@
+#include "../trajectory.hpp"
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <iostream>
+#include <rclcpp/logging.hpp>
+
+#define TIME_STEP std::chrono::milliseconds(100)
+#define BENCHMARK_DURATION std::chrono::hours(3)
+
+using namespace ATOS;
+using traj_pt = Trajectory::TrajectoryPoint;
+static void straight_line_test();
+static void tolerance_test();
+static void mode_test();
+static void small_trajectory_test();
+static void benchmark();
+static Trajectory drive(const std::chrono::milliseconds duration);
+static void check_within_tolerances(const Trajectory& original, const Trajectory& simplified,
+									const Trajectory::SimplificationTolerances& tolerances);
+
+int main(int argc, char** argv) {
+	try {
+		straight_line_test();
+		tolerance_test();
+		mode_test();
+		small_trajectory_test();
+		benchmark();
+		exit(EXIT_SUCCESS);
+	}
+	catch (std::runtime_error& e) {
+		std::cerr << "Test " << __FILE__ << " failed: " << std::endl
+				  << e.what() << std::endl;
+		exit(EXIT_FAILURE);
+	}
+}
+
+/*!
+ * \brief Trajectory driving with slowly varying speed and turn rate, with the
+ *			curvature of a road network: straights, wide bends and junction turns.
+ */
+Trajectory drive(const std::chrono::milliseconds duration) {
+	Trajectory trajectory(rclcpp::get_logger("test"));
+	double x = 0.0, y = 0.0, heading = 0.0;
+	const double dt = std::chrono::duration<double>(TIME_STEP).count();
+	for (auto t = std::chrono::milliseconds(0); t <= duration; t += TIME_STEP) {
+		const double s = std::chrono::duration<double>(t).count();
+		const double speed = 12.0 + 4.0 * std::sin(s / 97.0);
+		const double phase = std::fmod(s, 120.0);
+		const double turnRate = phase < 60.0 ? 0.0 : phase < 90.0 ? 0.02 * std::sin(s / 13.0) : (phase < 95.0 ? 0.3 : 0.0);
+		traj_pt pt;
+		pt.setTime(t);
+		pt.setXCoord(x);
+		pt.setYCoord(y);
+		pt.setZCoord(0.0);
+		pt.setHeading(heading);
+		pt.setLongitudinalVelocity(speed);
+		pt.setLateralVelocity(0.0);
+		pt.setLongitudinalAcceleration(0.0);
+		pt.setLateralAcceleration(0.0);
+		pt.setCurvature(turnRate / speed);
+		trajectory.points.push_back(pt);
+		x += speed * dt * std::cos(heading);
+		y += speed * dt * std::sin(heading);
+		heading += turnRate * dt;
+	}
+	return trajectory;
+}
+
+/*!
+ * \brief Checks that every point of the original is within the tolerances of the
+ *			simplified trajectory interpolated linearly in time.
+ */
+void check_within_tolerances(
+		const Trajectory& original,
+		const Trajectory& simplified,
+		const Trajectory::SimplificationTolerances& tolerances) {
+	const double eps = 1e-9;
+	auto next = simplified.points.begin();
+	for (const auto& pt : original.points) {
+		while (next != simplified.points.end() && next->getTime() < pt.getTime()) {
+			++next;
+		}
+		if (next == simplified.points.end()) {
+			throw std::runtime_error("Simplified trajectory ends before original");
+		}
+		if (next->getTime() == pt.getTime()) {
+			continue;
+		}
+		auto prev = next - 1;
+		if ((next->getTime() - prev->getTime()) > tolerances.maxPointInterval) {
+			throw std::runtime_error("Simplified points further apart than the maximum interval");
+		}
+		const double f = std::chrono::duration<double>(pt.getTime() - prev->getTime()).count()
+						 / std::chrono::duration<double>(next->getTime() - prev->getTime()).count();
+		const Eigen::Vector3d position = prev->getPosition() + f * (next->getPosition() - prev->getPosition());
+		const double turn = std::remainder(next->getHeading() - prev->getHeading(), 2 * M_PI);
+		const double heading = prev->getHeading() + f * turn;
+		const Eigen::Vector2d velocity = prev->getVelocity() + f * (next->getVelocity() - prev->getVelocity());
+		if ((position - pt.getPosition()).norm() > tolerances.position_m + eps) {
+			throw std::runtime_error("Position deviation exceeds tolerance at time "
+									 + std::to_string(pt.getTime().count()) + " ms");
+		}
+		if (std::abs(std::remainder(heading - pt.getHeading(), 2 * M_PI)) > tolerances.heading_rad + eps) {
+			throw std::runtime_error("Heading deviation exceeds tolerance at time "
+									 + std::to_string(pt.getTime().count()) + " ms");
+		}
+		if ((velocity - pt.getVelocity()).norm() > tolerances.velocity_m_s + eps) {
+			throw std::runtime_error("Velocity deviation exceeds tolerance at time "
+									 + std::to_string(pt.getTime().count()) + " ms");
+		}
+	}
+}
+
+void straight_line_test() {
+	Trajectory line(rclcpp::get_logger("test"));
+	for (int i = 0; i <= 1000; ++i) {
+		traj_pt pt;
+		pt.setTime(TIME_STEP * i);
+		pt.setXCoord(0.5 * i);
+		pt.setYCoord(0.25 * i);
+		pt.setZCoord(0.0);
+		pt.setHeading(std::atan2(0.25, 0.5));
+		pt.setLongitudinalVelocity(std::hypot(5.0, 2.5));
+		pt.setLateralVelocity(0.0);
+		line.points.push_back(pt);
+	}
+	Trajectory::SimplificationTolerances tolerances;
+	tolerances.maxPointInterval = std::chrono::milliseconds(0);
+	Trajectory::SimplificationResult result;
+	auto simplified = line.simplified(tolerances, &result);
+	if (simplified.size() != 2 || result.inputPoints != 1001 || result.outputPoints != 2) {
+		throw std::runtime_error("Straight line not simplified to its end points, "
+								 + std::to_string(simplified.size()) + " points remain");
+	}
+	if (result.maxPositionDeviation_m > 1e-9 || result.compressionRatio() != 1001.0 / 2.0) {
+		throw std::runtime_error("Unexpected simplification result for straight line");
+	}
+
+	tolerances.maxPointInterval = std::chrono::seconds(1);
+	simplified = line.simplified(tolerances);
+	if (simplified.size() != 101) {
+		throw std::runtime_error("Maximum point interval not respected, "
+								 + std::to_string(simplified.size()) + " points remain");
+	}
+	check_within_tolerances(line, simplified, tolerances);
+}
+
+void tolerance_test() {
+	auto original = drive(std::chrono::minutes(10));
+	for (double scale : {0.1, 1.0, 10.0}) {
+		Trajectory::SimplificationTolerances tolerances;
+		tolerances.position_m *= scale;
+		tolerances.heading_rad *= scale;
+		tolerances.velocity_m_s *= scale;
+		tolerances.maxPointInterval *= static_cast<int>(scale * 10);
+		Trajectory::SimplificationResult result;
+		auto simplified = original.simplified(tolerances, &result);
+		check_within_tolerances(original, simplified, tolerances);
+		if (result.maxPositionDeviation_m > tolerances.position_m
+				|| result.maxHeadingDeviation_rad > tolerances.heading_rad
+				|| result.maxVelocityDeviation_m_s > tolerances.velocity_m_s) {
+			throw std::runtime_error("Reported deviation exceeds tolerance");
+		}
+		if (result.outputPoints >= result.inputPoints / 2) {
+			throw std::runtime_error("Trajectory barely simplified, "
+									 + std::to_string(result.outputPoints) + " points remain");
+		}
+	}
+}
+
+void mode_test() {
+	auto original = drive(std::chrono::seconds(60));
+	const std::size_t switchIndex = 200;
+	for (std::size_t i = switchIndex; i < original.size(); ++i) {
+		original.points[i].setMode(traj_pt::CONTROLLED_BY_DRIVE_FILE);
+	}
+	auto simplified = original.simplified(Trajectory::SimplificationTolerances());
+	bool found = false;
+	for (std::size_t i = 1; i < simplified.size(); ++i) {
+		if (simplified.points[i].getMode() != simplified.points[i-1].getMode()) {
+			found = simplified.points[i].getTime() == original.points[switchIndex].getTime()
+					&& simplified.points[i-1].getTime() == original.points[switchIndex-1].getTime();
+		}
+	}
+	if (!found) {
+		throw std::runtime_error("Points where the mode changes were not kept");
+	}
+}
+
+void small_trajectory_test() {
+	Trajectory empty(rclcpp::get_logger("test"));
+	if (!empty.simplified(Trajectory::SimplificationTolerances()).points.empty()) {
+		throw std::runtime_error("Simplifying an empty trajectory added points");
+	}
+	auto pair = drive(TIME_STEP);
+	if (pair.simplified(Trajectory::SimplificationTolerances()).size() != 2) {
+		throw std::runtime_error("Simplifying a two point trajectory removed points");
+	}
+}
+
+void benchmark() {
+	using namespace std::chrono;
+	auto original = drive(BENCHMARK_DURATION);
+	Trajectory::SimplificationTolerances tolerances;
+	Trajectory::SimplificationResult result;
+	auto start = steady_clock::now();
+	auto simplified = original.simplified(tolerances, &result);
+	duration<double, std::milli> elapsed = steady_clock::now() - start;
+	check_within_tolerances(original, simplified, tolerances);
+	std::cout << "Simplified " << duration_cast<hours>(BENCHMARK_DURATION).count() << " h trajectory from "
+			  << result.inputPoints << " to " << result.outputPoints << " points (ratio "
+			  << result.compressionRatio() << ") in " << elapsed.count() << " ms, max deviation "
+			  << result.maxPositionDeviation_m << " m, " << result.maxHeadingDeviation_rad << " rad, "
+			  << result.maxVelocityDeviation_m_s << " m/s" << std::endl;
+}
@@ -0,0 +1,47 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include <cstring>
+#include <iostream>
+#include <rclcpp/logging.hpp>
+#include "trajectory.hpp"
+
+/*!
+ * \brief Converts a trajectory file between the text and binary formats. The input
+ *			format is detected from the file contents, and the output format from
+ *			the extension of the output file name. With --simplify, points which
+ *			can be interpolated within the default tolerances are removed.
+ */
+int main(int argc, char** argv) {
+	const bool simplify = argc == 4 && std::strcmp(argv[1], "--simplify") == 0;
+	if (argc != 3 && !simplify) {
+		std::cerr << "Usage: " << argv[0] << " [--simplify] <input trajectory> <output trajectory>" << std::endl
+				  << "A binary trajectory is written if the output ends in "
+				  << TRAJECTORY_BINARY_FILE_EXTENSION << ", otherwise a text trajectory." << std::endl;
+		return EXIT_FAILURE;
+	}
+	const char* input = argv[argc - 2];
+	const char* output = argv[argc - 1];
+	try {
+		ATOS::Trajectory trajectory(rclcpp::get_logger("convert_trajectory"));
+		trajectory.initializeFromPath(input);
+		if (simplify) {
+			ATOS::Trajectory::SimplificationResult result;
+			trajectory = trajectory.simplified(ATOS::Trajectory::SimplificationTolerances(), &result);
+			std::cout << "Simplified from " << result.inputPoints << " to " << result.outputPoints
+					  << " points (ratio " << result.compressionRatio() << "), max deviation "
+					  << result.maxPositionDeviation_m << " m, " << result.maxHeadingDeviation_rad << " rad, "
+					  << result.maxVelocityDeviation_m_s << " m/s" << std::endl;
+		}
+		trajectory.saveToPath(output);
+		std::cout << "Converted " << trajectory.size() << " points from " << input
+				  << " to " << output << std::endl;
+	}
+	catch (std::exception& e) {
+		std::cerr << "Conversion of " << input << " failed: " << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -9,8 +9,16 @@
 #include <cmath>
 #include <algorithm>
 #include <iomanip>
+#include <array>
+#include <charconv>
+#include <cstring>
+#include <string_view>
+#include <thread>
+#include "binarytrajectoryfile.hpp"
+#include "mappedfile.hpp"
 #include "regexpatterns.hpp"
 #include "trajectory.hpp"
+#include "trajectorycolumns.hpp"
 #include "CRSTransformation.hpp" // xyz2llh
 
 #if ROS_FOXY
@@ -46,7 +54,19 @@ Trajectory::Trajectory(const Trajectory& other) : Loggable(other.get_logger()) {
 	return *this;
 }
 
-atos_interfaces::msg::CartesianTrajectory Trajectory::toCartesianTrajectory(){
+/*!
+ * \brief Trajectory::toColumns Copies the trajectory points into struct-of-arrays
+ *			storage, which may be shared read-only between users.
+ */
+std::shared_ptr<const TrajectoryColumns> Trajectory::toColumns() const {
+	return TrajectoryColumns::fromPoints(this->points);
+}
+
+void Trajectory::initializeFromColumns(const TrajectoryColumns& columns) {
+	this->points = columns.toPoints();
+}
+
+atos_interfaces::msg::CartesianTrajectory Trajectory::toCartesianTrajectory() const {
 	atos_interfaces::msg::CartesianTrajectory trajMsg;
 	for (const auto& point : this->points){
 		atos_interfaces::msg::CartesianTrajectoryPoint pointMsg;
@@ -109,11 +129,14 @@ foxglove_msgs::msg::GeoJSON Trajectory::toGeoJSON(std::array<double,3> llh_0) co
 	std::stringstream ss;
 	ss << std::fixed; // supress scientific notation
 	ss << std::setprecision(12);
-	for (const auto& point : this->points){
-		double llh[3] = {llh_0[0], llh_0[1], llh_0[2]};
-		double offset[3] = {point.getXCoord(), point.getYCoord(), point.getZCoord()};
-		CRSTransformation::llhOffsetMeters(llh, offset);
-		ss << "[" << llh[1] << "," << llh[0] << "],"; // Flipped order
+	std::vector<double> llh(3 * this->points.size());
+	if (!this->points.empty()) {
+		const double* position = this->points.front().positionData();
+		CRSTransformation::llhOffsetMeters(llh_0, position, position + 1, nullptr,
+										   sizeof (TrajectoryPoint), this->points.size(), llh.data());
+	}
+	for (std::size_t i = 0; i < llh.size(); i += 3) {
+		ss << "[" << llh[i+1] << "," << llh[i] << "],"; // Flipped order
 	}
 	std::string positions = ss.str();
 	positions = positions.substr(0, positions.size()-1); // remove trailing ,
@@ -140,7 +163,7 @@ void Trajectory::initializeFromCartesianTrajectory(const atos_interfaces::msg::C
 	// TODO: add name to traj
 	
 	for (const auto &tp : traj.points){
-		TrajectoryPoint point(logger);
+		TrajectoryPoint point;
 		point.setTime(duration_cast<milliseconds>(seconds{tp.time_from_start.sec} + nanoseconds{tp.time_from_start.nanosec}));
 		point.setXCoord(tp.pose.position.x);
 		point.setYCoord(tp.pose.position.y);
@@ -159,95 +182,269 @@ void Trajectory::initializeFromCartesianTrajectory(const atos_interfaces::msg::C
 	}
 }
 
-void Trajectory::initializeFromFile(const std::string &fileName) {
+namespace {
+//! \brief Extracts the line starting at pos, like std::getline, and advances pos past it.
+bool nextLine(const char*& pos, const char* end, std::string_view& line) {
+	if (pos >= end) {
+		return false;
+	}
+	auto newline = static_cast<const char*>(std::memchr(pos, '\n', static_cast<size_t>(end - pos)));
+	auto lineEnd = newline != nullptr ? newline : end;
+	line = std::string_view(pos, static_cast<size_t>(lineEnd - pos));
+	pos = newline != nullptr ? newline + 1 : end;
+	return true;
+}
 
-	using namespace std;
-	char trajDirPath[PATH_MAX];
-	string errMsg;
-	smatch match;
-	ifstream file;
-	bool isHeaderParsedSuccessfully = false;
-	unsigned long nPoints = 0;
+//! \brief Parses a field matching RegexPatterns::floatPattern in full.
+bool parseFloatField(std::string_view field, double& value) {
+	auto p = field.begin(), end = field.end();
+	if (p != end && (*p == '+' || *p == '-')) {
+		++p;
+	}
+	auto digits = p;
+	while (p != end && std::isdigit(static_cast<unsigned char>(*p))) {
+		++p;
+	}
+	if (p != end && *p == '.') {
+		auto decimals = ++p;
+		while (p != end && std::isdigit(static_cast<unsigned char>(*p))) {
+			++p;
+		}
+		if (p == decimals) {
+			return false;
+		}
+	}
+	else if (p == digits) {
+		return false;
+	}
+	if (p != end) {
+		return false;
+	}
+	auto first = field.front() == '+' ? field.data() + 1 : field.data();
+#if __cpp_lib_to_chars >= 201611L
+	return std::from_chars(first, field.data() + field.size(), value).ec == std::errc();
+#else
+	value = std::strtod(std::string(first, field.data() + field.size()).c_str(), nullptr);
+	return true;
+#endif
+}
 
-	UtilGetTrajDirectoryPath(trajDirPath, sizeof (trajDirPath));
-	string trajFilePath(trajDirPath);
-	trajFilePath += fileName;
-
-	file.open(trajFilePath);
-	if (!file.is_open()) {
-		throw ifstream::failure("Unable to open file <" + trajFilePath + ">");
-	}
-
-	string line;
-	errMsg = "Encountered unexpected end of file while reading file <" + trajFilePath + ">";
-	for (unsigned long lineCount = 0; getline(file, line); lineCount++) {
-		if (lineCount == 0) {
-			if (regex_search(line, match, this->fileHeaderPattern)) {
-				this->id = stoi(match[1]);
-				this->name = match[2];
-				this->version = 0;
-				nPoints = stoul(match[6]);
-				this->points.reserve(nPoints);
-				isHeaderParsedSuccessfully = true;
-			}
-			else {
-				errMsg = "The header of trajectory file <" + trajFilePath + "> is badly formatted";
-				break;
-			}
+//! \brief Parses a field matching RegexPatterns::intPattern in full.
+bool parseIntField(std::string_view field, int& value) {
+	if (field.empty() || !std::all_of(field.begin(), field.end(),
+			[](char c) { return std::isdigit(static_cast<unsigned char>(c)); })) {
+		return false;
+	}
+	return std::from_chars(field.data(), field.data() + field.size(), value).ec == std::errc();
+}
+
+/*!
+ * \brief Parses a trajectory file line, accepting the same lines as the
+ *			Trajectory::fileLinePattern regex.
+ * \return true if the line was well formatted
+ */
+bool parseTrajectoryLine(std::string_view line, Trajectory::TrajectoryPoint& point) {
+	constexpr std::string_view lineBegin = "LINE;", lineEnd = "ENDLINE;";
+	constexpr size_t nFields = 11;
+	auto pos = line.find(lineBegin);
+	if (pos == std::string_view::npos) {
+		return false;
+	}
+	line.remove_prefix(pos + lineBegin.size());
+	std::array<std::string_view, nFields> fields;
+	for (auto& field : fields) {
+		auto separator = line.find(';');
+		if (separator == std::string_view::npos) {
+			return false;
 		}
-		else if (lineCount > 0 && !isHeaderParsedSuccessfully) {
-			errMsg = "Attempt to parse trajectory file <" + trajFilePath + "> before encountering header";
-			break;
+		field = line.substr(0, separator);
+		line.remove_prefix(separator + 1);
+	}
+	if (line.substr(0, lineEnd.size()) != lineEnd) {
+		return false;
+	}
+
+	double time, x, y, heading, curvature, value;
+	int mode;
+	if (!parseFloatField(fields[0], time) || !parseFloatField(fields[1], x)
+			|| !parseFloatField(fields[2], y) || !parseFloatField(fields[4], heading)
+			|| !parseFloatField(fields[9], curvature) || !parseIntField(fields[10], mode)) {
+		return false;
+	}
+	point.setTime(time);
+	point.setXCoord(x);
+	point.setYCoord(y);
+	point.setHeading(heading);
+	point.setCurvature(curvature);
+	point.setMode(static_cast<Trajectory::TrajectoryPoint::ModeType>(mode));
+
+	// Optional fields may be empty
+	const std::array<std::pair<size_t, void (Trajectory::TrajectoryPoint::*)(const double&)>, 5> optionalFields = {{
+		{3, &Trajectory::TrajectoryPoint::setZCoord},
+		{5, &Trajectory::TrajectoryPoint::setLongitudinalVelocity},
+		{6, &Trajectory::TrajectoryPoint::setLateralVelocity},
+		{7, &Trajectory::TrajectoryPoint::setLongitudinalAcceleration},
+		{8, &Trajectory::TrajectoryPoint::setLateralAcceleration}
+	}};
+	for (const auto& [index, setter] : optionalFields) {
+		if (fields[index].empty()) {
+			continue;
 		}
-		else if (lineCount > nPoints + 1) {
-			errMsg = "Trajectory line count of file <" + trajFilePath
-					+ "> does not match specified line count";
-			break;
+		if (!parseFloatField(fields[index], value)) {
+			return false;
 		}
-		else if (lineCount == nPoints + 1) {
-			if (regex_search(line, match, fileFooterPattern)) {
-				file.close();
-				RCLCPP_DEBUG(get_logger(), "Closed <%s>", trajFilePath.c_str());
+		(point.*setter)(value);
+	}
+	return true;
+}
+
+/*!
+ * \brief Decodes trajectory lines into points, splitting large trajectories
+ *			between threads.
+ * \return Index of the first badly formatted line, or the number of lines if all
+ *			were well formatted
+ */
+size_t decodeTrajectoryLines(
+		const std::vector<std::string_view>& lines,
+		std::vector<Trajectory::TrajectoryPoint>& points) {
+	constexpr size_t minLinesPerThread = 16384;
+	const size_t nThreads = std::clamp<size_t>(lines.size() / minLinesPerThread, 1,
+											   std::max(std::thread::hardware_concurrency(), 1U));
+	const size_t linesPerThread = (lines.size() + nThreads - 1) / nThreads;
+	std::vector<size_t> firstBadLine(nThreads, lines.size());
+
+	auto decodeRange = [&](const size_t thread) {
+		auto end = std::min(lines.size(), (thread + 1) * linesPerThread);
+		for (auto i = thread * linesPerThread; i < end; ++i) {
+			if (!parseTrajectoryLine(lines[i], points[i])) {
+				firstBadLine[thread] = i;
 				return;
 			}
-			else {
-				errMsg = "Final line of trajectory file <" + trajFilePath + "> badly formatted";
-				break;
-			}
 		}
-		else {
-			if (regex_search(line, match, fileLinePattern)) {
-				TrajectoryPoint point(get_logger());
-				point.setTime(stod(match[1]));
-				point.setXCoord(stod(match[2]));
-				point.setYCoord(stod(match[3]));
-				if (match[4].matched)
-					point.setZCoord(stod(match[4]));
-				point.setHeading(stod(match[5]));
-				if (match[6].matched)
-					point.setLongitudinalVelocity(stod(match[6]));
-				if (match[7].matched)
-					point.setLateralVelocity(stod(match[7]));
-				if (match[8].matched)
-					point.setLongitudinalAcceleration(stod(match[8]));
-				if (match[9].matched)
-					point.setLateralAcceleration(stod(match[9]));
-				point.setCurvature(stod(match[10]));
-				point.setMode(static_cast<Trajectory::TrajectoryPoint::ModeType>(stoi(match[11])));
-				points.push_back(point);
+	};
+	std::vector<std::thread> workers;
+	for (size_t thread = 1; thread < nThreads; ++thread) {
+		workers.emplace_back(decodeRange, thread);
+	}
+	decodeRange(0);
+	for (auto& worker : workers) {
+		worker.join();
+	}
+	return *std::min_element(firstBadLine.begin(), firstBadLine.end());
+}
+} // namespace
+
+/*!
+ * \brief Trajectory::initializeFromFile loads a trajectory file from the traj directory.
+ * \param fileName Name of a text or binary trajectory file
+ */
+void Trajectory::initializeFromFile(const std::string &fileName) {
+	char trajDirPath[PATH_MAX];
+	UtilGetTrajDirectoryPath(trajDirPath, sizeof (trajDirPath));
+	initializeFromPath(std::string(trajDirPath) + fileName);
+}
+
+/*!
+ * \brief Trajectory::initializeFromPath loads a trajectory file, detecting whether
+ *			it is a text or binary trajectory file.
+ * \param trajFilePath Path to the trajectory file
+ */
+void Trajectory::initializeFromPath(const std::string &trajFilePath) {
+
+	using namespace std;
+	smatch match;
+	unsigned long nPoints = 0;
+
+	auto startTime = chrono::steady_clock::now();
+	if (BinaryTrajectoryFile::isBinaryTrajectoryFile(trajFilePath)) {
+		BinaryTrajectoryFile binaryFile(trajFilePath);
+		this->id = static_cast<unsigned short>(binaryFile.header().ID);
+		this->name = binaryFile.header().name;
+		this->version = binaryFile.header().majorVersion;
+		// Points are built directly from the mapped columns. Missing optional values
+		// are stored as NaN, which is also how points mark them missing.
+		using Setter = void (TrajectoryPoint::*)(const double&);
+		const std::array<std::pair<BinaryTrajectoryFile::Column, Setter>, 5> optionalSetters = {{
+			{BinaryTrajectoryFile::Z, &TrajectoryPoint::setZCoord},
+			{BinaryTrajectoryFile::LONGITUDINAL_VELOCITY, &TrajectoryPoint::setLongitudinalVelocity},
+			{BinaryTrajectoryFile::LATERAL_VELOCITY, &TrajectoryPoint::setLateralVelocity},
+			{BinaryTrajectoryFile::LONGITUDINAL_ACCELERATION, &TrajectoryPoint::setLongitudinalAcceleration},
+			{BinaryTrajectoryFile::LATERAL_ACCELERATION, &TrajectoryPoint::setLateralAcceleration}
+		}};
+		std::vector<std::pair<const double*, Setter>> optionalColumns;
+		for (const auto& [column, setter] : optionalSetters) {
+			if (binaryFile.column(column) != nullptr) {
+				optionalColumns.emplace_back(binaryFile.column(column), setter);
 			}
-			else {
-				errMsg = "Line " + to_string(lineCount) + " of trajectory file <"
-						+ trajFilePath + "> badly formatted";
-				break;
+		}
+		const auto time = binaryFile.time_ms();
+		const auto x = binaryFile.column(BinaryTrajectoryFile::X);
+		const auto y = binaryFile.column(BinaryTrajectoryFile::Y);
+		const auto heading = binaryFile.column(BinaryTrajectoryFile::HEADING);
+		const auto curvature = binaryFile.column(BinaryTrajectoryFile::CURVATURE);
+		const auto mode = binaryFile.mode();
+		this->points.reserve(this->points.size() + binaryFile.size());
+		for (size_t i = 0; i < binaryFile.size(); ++i) {
+			TrajectoryPoint point;
+			point.setTime(chrono::milliseconds(time[i]));
+			point.setXCoord(x[i]);
+			point.setYCoord(y[i]);
+			point.setHeading(heading[i]);
+			point.setCurvature(curvature[i]);
+			point.setMode(static_cast<TrajectoryPoint::ModeType>(mode[i]));
+			for (const auto& [values, setter] : optionalColumns) {
+				(point.*setter)(values[i]);
 			}
+			this->points.push_back(point);
 		}
+		chrono::duration<double> elapsed = chrono::steady_clock::now() - startTime;
+		RCLCPP_DEBUG(get_logger(), "Loaded %lu points from binary file <%s> in %.3f ms",
+					 binaryFile.size(), trajFilePath.c_str(), elapsed.count() * 1e3);
+		return;
 	}
-	file.close();
-	RCLCPP_DEBUG(get_logger(), "Closed <%s>", trajFilePath.c_str());
-	throw invalid_argument(errMsg);
-}
 
+	MappedFile file(trajFilePath);
+	const char* pos = file.data();
+	const char* end = file.data() + file.size();
+	string_view line;
+	const string eofErrMsg = "Encountered unexpected end of file while reading file <" + trajFilePath + ">";
+
+	if (!nextLine(pos, end, line)) {
+		throw invalid_argument(eofErrMsg);
+	}
+	string header(line);
+	if (!regex_search(header, match, this->fileHeaderPattern)) {
+		throw invalid_argument("The header of trajectory file <" + trajFilePath + "> is badly formatted");
+	}
+	this->id = stoi(match[1]);
+	this->name = match[2];
+	this->version = 0;
+	nPoints = stoul(match[6]);
+
+	vector<string_view> lines;
+	lines.reserve(nPoints);
+	while (lines.size() < nPoints && nextLine(pos, end, line)) {
+		lines.push_back(line);
+	}
+	vector<TrajectoryPoint> parsedPoints(lines.size());
+	auto badLine = decodeTrajectoryLines(lines, parsedPoints);
+	if (badLine < lines.size()) {
+		throw invalid_argument("Line " + to_string(badLine + 1) + " of trajectory file <"
+							   + trajFilePath + "> badly formatted");
+	}
+	if (lines.size() < nPoints || !nextLine(pos, end, line)) {
+		throw invalid_argument(eofErrMsg);
+	}
+	if (line.find("ENDTRAJECTORY;") == string_view::npos) {
+		throw invalid_argument("Final line of trajectory file <" + trajFilePath + "> badly formatted");
+	}
+	this->points.insert(this->points.end(), parsedPoints.begin(), parsedPoints.end());
+
+	chrono::duration<double> elapsed = chrono::steady_clock::now() - startTime;
+	RCLCPP_DEBUG(get_logger(), "Parsed %lu points (%.1f MB) from <%s> in %.3f ms: %.1f MB/s, %.0f points/s",
+				 nPoints, file.size() / 1e6, trajFilePath.c_str(), elapsed.count() * 1e3,
+				 file.size() / 1e6 / elapsed.count(), nPoints / elapsed.count());
+}
 
 CartesianPosition Trajectory::TrajectoryPoint::getISOPosition() const {
 	CartesianPosition retval;
@@ -256,7 +453,7 @@ CartesianPosition Trajectory::TrajectoryPoint::getISOPosition() const {
 	try {
 		retval.zCoord_m = this->getZCoord();
 	} catch (std::out_of_range e) {
-		RCLCPP_WARN(get_logger(), "Casting trajectory point to cartesian position: optional z value assumed to be 0");
+		RCLCPP_WARN(rclcpp::get_logger("trajectory"), "Casting trajectory point to cartesian position: optional z value assumed to be 0");
 		retval.zCoord_m = 0.0;
 	}
 	retval.heading_rad = this->getHeading();
@@ -312,7 +509,7 @@ Trajectory::TrajectoryPoint Trajectory::TrajectoryPoint::relativeTo(
 		const TrajectoryPoint &other) const {
 
 	using namespace Eigen;
-	TrajectoryPoint relative(get_logger());
+	TrajectoryPoint relative;
 
 	relative.setTime(this->getTime());
 	relative.setHeading(this->getHeading() - other.getHeading());
@@ -347,10 +544,197 @@ Trajectory::TrajectoryPoint Trajectory::TrajectoryPoint::relativeTo(
 	return relative;
 }
 
+namespace {
+//! Kinematic quantities of a block of trajectory points, one array per quantity
+struct KinematicColumns {
+	std::vector<double> x, y, z, heading, vx, vy, ax, ay;
+
+	explicit KinematicColumns(const std::size_t n)
+		: x(n), y(n), z(n), heading(n), vx(n), vy(n), ax(n), ay(n) {}
+};
+
+//! Arrays used while computing a relative trajectory block by block
+struct RelativeKinematicsWorkspace {
+	static constexpr std::size_t blockSize = 1024;	//!< Points per block, small enough for the arrays to stay in cache
+
+	KinematicColumns self = KinematicColumns(blockSize);
+	KinematicColumns other = KinematicColumns(blockSize);
+	KinematicColumns relative = KinematicColumns(blockSize);
+	std::vector<double> curvature = std::vector<double>(blockSize);
+	std::vector<double> cosOther = std::vector<double>(blockSize);
+	std::vector<double> sinOther = std::vector<double>(blockSize);
+	std::vector<double> cosRelative = std::vector<double>(blockSize);
+	std::vector<double> sinRelative = std::vector<double>(blockSize);
+};
+
+inline double zeroNaN(const double value) {
+	return std::isnan(value) ? 0.0 : value;
+}
+
+//! \brief Wraps an angle to [-pi, pi).
+inline double wrapToPi(const double angle) {
+	return angle - 2*M_PI*std::floor((angle + M_PI) / (2*M_PI));
+}
+
+/*!
+ * \brief Samples the other trajectory at the time of each point in a block,
+ *			either at the nearest point as Trajectory::getNearest or by linear
+ *			interpolation between the surrounding points. Missing values are taken
+ *			to be zero. Both trajectories are traversed once if sorted by time.
+ * \param points Points of the trajectory to be aligned to
+ * \param first Index of the first point in the block
+ * \param count Number of points in the block
+ * \param other Points of the trajectory to be sampled
+ * \param alignment Sampling method
+ * \param after Merge position in other, kept between consecutive blocks
+ * \param aligned Output samples of the other trajectory
+ */
+void alignTo(
+		const std::vector<Trajectory::TrajectoryPoint>& points,
+		const std::size_t first,
+		const std::size_t count,
+		const std::vector<Trajectory::TrajectoryPoint>& other,
+		const Trajectory::AlignmentMode alignment,
+		std::size_t& after,
+		KinematicColumns& aligned) {
+	const auto m = other.size();
+
+	for (std::size_t j = 0; j < count; ++j) {
+		const auto i = first + j;
+		const auto t = points[i].getTime();
+		if (i > 0 && t < points[i-1].getTime()) {
+			after = 0; // Not sorted, restart the merge
+		}
+		// First point in other not earlier than t, as found by std::lower_bound
+		while (after < m && other[after].getTime() < t) {
+			++after;
+		}
+		std::size_t before, next;
+		double weight = 0.0;
+		if (after == 0) {
+			before = next = 0;
+		}
+		else if (after == m) {
+			before = next = m - 1;
+		}
+		else {
+			before = after - 1;
+			next = after;
+			const double tBefore = other[before].getTime().count();
+			const double tAfter = other[after].getTime().count();
+			if (alignment == Trajectory::AlignmentMode::LINEAR_INTERPOLATION) {
+				weight = (t.count() - tBefore) / (tAfter - tBefore);
+			}
+			else {
+				before = next = (tAfter - t.count()) < (t.count() - tBefore) ? after : before;
+			}
+		}
+
+		const auto& p0 = other[before];
+		const auto& p1 = other[next];
+		auto position0 = p0.getPosition(), position1 = p1.getPosition();
+		auto velocity0 = p0.getVelocity(), velocity1 = p1.getVelocity();
+		auto acceleration0 = p0.getAcceleration(), acceleration1 = p1.getAcceleration();
+		auto lerp = [weight](const double v0, const double v1) {
+			return zeroNaN(v0) + weight*(zeroNaN(v1) - zeroNaN(v0));
+		};
+		aligned.x[j] = lerp(position0[0], position1[0]);
+		aligned.y[j] = lerp(position0[1], position1[1]);
+		aligned.z[j] = lerp(position0[2], position1[2]);
+		aligned.heading[j] = p0.getHeading() + weight*wrapToPi(p1.getHeading() - p0.getHeading());
+		aligned.vx[j] = lerp(velocity0[0], velocity1[0]);
+		aligned.vy[j] = lerp(velocity0[1], velocity1[1]);
+		aligned.ax[j] = lerp(acceleration0[0], acceleration1[0]);
+		aligned.ay[j] = lerp(acceleration0[1], acceleration1[1]);
+	}
+}
+
+/*!
+ * \brief Computes the kinematics of a block of points relative to the other
+ *			trajectory sampled at the same times, as Trajectory::TrajectoryPoint::relativeTo
+ *			does for single points. Apart from the sin/cos loop, the loop is free of
+ *			branches and calls so that the compiler can vectorize it.
+ *
+ *			Reads ::self, where missing positions are zero but missing velocities and
+ *			accelerations are NaN, and ::other, without missing values. Writes
+ *			::relative and ::curvature.
+ */
+void computeRelativeKinematics(
+		const std::size_t count,
+		RelativeKinematicsWorkspace& ws) {
+	for (std::size_t i = 0; i < count; ++i) {
+		ws.relative.heading[i] = ws.self.heading[i] - ws.other.heading[i];
+		ws.cosOther[i] = std::cos(ws.other.heading[i]);
+		ws.sinOther[i] = std::sin(ws.other.heading[i]);
+		ws.cosRelative[i] = std::cos(ws.relative.heading[i]);
+		ws.sinRelative[i] = std::sin(ws.relative.heading[i]);
+	}
+
+	const double* __restrict__ x = ws.self.x.data();
+	const double* __restrict__ y = ws.self.y.data();
+	const double* __restrict__ z = ws.self.z.data();
+	const double* __restrict__ vx = ws.self.vx.data();
+	const double* __restrict__ vy = ws.self.vy.data();
+	const double* __restrict__ ax = ws.self.ax.data();
+	const double* __restrict__ ay = ws.self.ay.data();
+	const double* __restrict__ ox = ws.other.x.data();
+	const double* __restrict__ oy = ws.other.y.data();
+	const double* __restrict__ oz = ws.other.z.data();
+	const double* __restrict__ ovx = ws.other.vx.data();
+	const double* __restrict__ ovy = ws.other.vy.data();
+	const double* __restrict__ oax = ws.other.ax.data();
+	const double* __restrict__ oay = ws.other.ay.data();
+	const double* __restrict__ co = ws.cosOther.data();
+	const double* __restrict__ so = ws.sinOther.data();
+	const double* __restrict__ cr = ws.cosRelative.data();
+	const double* __restrict__ sr = ws.sinRelative.data();
+	double* __restrict__ rx = ws.relative.x.data();
+	double* __restrict__ ry = ws.relative.y.data();
+	double* __restrict__ rz = ws.relative.z.data();
+	double* __restrict__ rvx = ws.relative.vx.data();
+	double* __restrict__ rvy = ws.relative.vy.data();
+	double* __restrict__ rax = ws.relative.ax.data();
+	double* __restrict__ ray = ws.relative.ay.data();
+	double* __restrict__ k = ws.curvature.data();
+
+	for (std::size_t i = 0; i < count; ++i) {
+		// Position rotated into the frame of the other trajectory
+		const double dx = x[i] - ox[i];
+		const double dy = y[i] - oy[i];
+		rx[i] = co[i]*dx + so[i]*dy;
+		ry[i] = -so[i]*dx + co[i]*dy;
+		rz[i] = z[i] - oz[i];
+
+		// Velocity and acceleration of the other rotated by the relative heading
+		const double vxi = vx[i] == vx[i] ? vx[i] : 0.0;
+		const double vyi = vy[i] == vy[i] ? vy[i] : 0.0;
+		const double axi = ax[i] == ax[i] ? ax[i] : 0.0;
+		const double ayi = ay[i] == ay[i] ? ay[i] : 0.0;
+		rvx[i] = vxi - (cr[i]*ovx[i] - sr[i]*ovy[i]);
+		rvy[i] = vyi - (sr[i]*ovx[i] + cr[i]*ovy[i]);
+		rax[i] = axi - (cr[i]*oax[i] - sr[i]*oay[i]);
+		ray[i] = ayi - (sr[i]*oax[i] + cr[i]*oay[i]);
+
+		// K(t) = ||r'(t) x r''(t)|| / ||r'(t)||³, which is invariant to rotation.
+		// Missing velocity gives zero and missing acceleration NaN, as for single points
+		const double speed = std::sqrt(vx[i]*vx[i] + vy[i]*vy[i]);
+		const double cross = std::abs(vx[i]*ay[i] - vy[i]*ax[i]);
+		k[i] = speed > 0.001 ? cross / (speed*speed*speed) : 0.0;
+	}
+}
+} // namespace
+
+/*!
+ * \brief Trajectory::relativeTo Calculates this trajectory relative to another,
+ *			sampling the other trajectory at the time of each point of this one.
+ * \param other Trajectory to which the result is to be relative
+ * \param alignment Whether to sample the nearest point of the other trajectory,
+ *			or interpolate linearly between its points
+ * \return The relative trajectory
+ */
 Trajectory Trajectory::relativeTo(
-		const Trajectory &other) const {
-	using namespace Eigen;
-	// TODO check that ranges are sorted by time
+		const Trajectory &other,
+		const AlignmentMode alignment) const {
 	if (this->version != other.version) {
 		throw std::invalid_argument("Attempted to calculate relative trajectory "
 									"for two trajectories with differing versions");
@@ -360,12 +744,47 @@ Trajectory Trajectory::relativeTo(
 	relative.id = this->id;
 	relative.name = this->name + "_rel_" + other.name;
 	relative.version = this->version;
-	for (auto trajPt = this->points.begin(); trajPt != this->points.end(); ++trajPt) {
-		auto nearestTrajPtInOther = getNearest(other.points.begin(), other.points.end(), std::chrono::duration<double>(trajPt->getTime()).count());
-		// TODO maybe a check on time difference here
-		relative.points.push_back(trajPt->relativeTo(*nearestTrajPtInOther));
+	if (this->points.empty()) {
+		return relative;
+	}
+	if (other.points.empty()) {
+		throw std::invalid_argument("Attempted to calculate trajectory relative to empty trajectory");
 	}
 
+	const auto n = this->points.size();
+	RelativeKinematicsWorkspace ws;
+	std::size_t mergePosition = 0;
+	relative.points.resize(n);
+	for (std::size_t first = 0; first < n; first += ws.blockSize) {
+		const auto count = std::min(ws.blockSize, n - first);
+		for (std::size_t j = 0; j < count; ++j) {
+			const auto& pt = points[first + j];
+			auto position = pt.getPosition();
+			auto velocity = pt.getVelocity();
+			auto acceleration = pt.getAcceleration();
+			ws.self.x[j] = zeroNaN(position[0]);
+			ws.self.y[j] = zeroNaN(position[1]);
+			ws.self.z[j] = zeroNaN(position[2]);
+			ws.self.heading[j] = pt.getHeading();
+			ws.self.vx[j] = velocity[0];
+			ws.self.vy[j] = velocity[1];
+			ws.self.ax[j] = acceleration[0];
+			ws.self.ay[j] = acceleration[1];
+		}
+		alignTo(this->points, first, count, other.points, alignment, mergePosition, ws.other);
+		computeRelativeKinematics(count, ws);
+
+		for (std::size_t j = 0; j < count; ++j) {
+			auto& pt = relative.points[first + j];
+			pt.setTime(points[first + j].getTime());
+			pt.setHeading(ws.relative.heading[j]);
+			pt.setPosition(Eigen::Vector3d(ws.relative.x[j], ws.relative.y[j], ws.relative.z[j]));
+			pt.setVelocity(Eigen::Vector2d(ws.relative.vx[j], ws.relative.vy[j]));
+			pt.setAcceleration(Eigen::Vector2d(ws.relative.ax[j], ws.relative.ay[j]));
+			pt.setCurvature(ws.curvature[j]);
+			pt.setMode(points[first + j].getMode());
+		}
+	}
 	return relative;
 }
 
@@ -489,6 +908,167 @@ Trajectory Trajectory::rescaledToVelocity(
 	return newTrajectory;
 }
 
+namespace {
+//! Difference between two values which may be unset (NaN). Infinite if only one is set.
+double difference(const double actual, const double approximation) {
+	if (std::isnan(actual) || std::isnan(approximation)) {
+		return std::isnan(actual) == std::isnan(approximation) ? 0.0 : std::numeric_limits<double>::infinity();
+	}
+	return std::abs(actual - approximation);
+}
+
+//! Deviation divided by its tolerance, such that values above 1 exceed the tolerance
+double relativeDeviation(const double deviation, const double tolerance) {
+	if (tolerance > 0.0) {
+		return deviation / tolerance;
+	}
+	return deviation > 0.0 ? std::numeric_limits<double>::infinity() : 0.0;
+}
+
+struct PointDeviation {
+	double position_m = 0.0;
+	double heading_rad = 0.0;
+	double velocity_m_s = 0.0;
+};
+
+/*!
+ * \brief Deviation of a point from the point at the same time on the line between
+ *			first and last, interpolated linearly in time as when the trajectory is
+ *			followed. Heading is interpolated along the shorter turn.
+ */
+PointDeviation deviationFromChord(
+		const Trajectory::TrajectoryPoint& first,
+		const Trajectory::TrajectoryPoint& last,
+		const Trajectory::TrajectoryPoint& point) {
+	const auto span = (last.getTime() - first.getTime()).count();
+	const double f = span > 0 ? static_cast<double>((point.getTime() - first.getTime()).count()) / span : 0.0;
+	const double* p0 = first.positionData();
+	const double* p1 = last.positionData();
+	const double* p = point.positionData();
+	const Eigen::Vector2d v0 = first.getVelocity(), v1 = last.getVelocity(), v = point.getVelocity();
+
+	PointDeviation d;
+	const double dx = p[0] - (p0[0] + f * (p1[0] - p0[0]));
+	const double dy = p[1] - (p0[1] + f * (p1[1] - p0[1]));
+	const double dz = difference(p[2], p0[2] + f * (p1[2] - p0[2]));
+	d.position_m = std::sqrt(dx * dx + dy * dy + dz * dz);
+	const double turn = std::remainder(last.getHeading() - first.getHeading(), 2 * M_PI);
+	d.heading_rad = std::abs(std::remainder(point.getHeading() - (first.getHeading() + f * turn), 2 * M_PI));
+	d.velocity_m_s = std::hypot(difference(v[0], v0[0] + f * (v1[0] - v0[0])),
+								difference(v[1], v0[1] + f * (v1[1] - v0[1])));
+	return d;
+}
+} // namespace
+
+/*!
+ * \brief Trajectory::simplified Returns a copy of the trajectory with the points
+ *			removed which can be recovered, within the tolerances, by interpolating
+ *			linearly in time between the remaining points. Points are selected by
+ *			Douglas-Peucker on the deviation at equal times, so timing is kept as
+ *			well as the path. Each segment is split at the point deviating most
+ *			relative to the tolerances, which for heading keeps points in curves
+ *			in proportion to their curvature. Curvature and acceleration are not
+ *			bounded directly, only through the heading and velocity tolerances.
+ *			Points where the mode changes are kept, and segments longer than the
+ *			maximum point interval are split in time.
+ * \param tolerances Largest deviations allowed
+ * \param result Optional output of the point counts and largest deviations
+ * \return Simplified trajectory
+ */
+Trajectory Trajectory::simplified(
+		const SimplificationTolerances& tolerances,
+		SimplificationResult* result) const {
+	if (!this->isValid()) {
+		throw std::invalid_argument("Attempted to simplify invalid trajectory");
+	}
+	if (tolerances.position_m < 0.0 || tolerances.heading_rad < 0.0 || tolerances.velocity_m_s < 0.0
+			|| tolerances.maxPointInterval.count() < 0) {
+		throw std::invalid_argument("Attempted to simplify trajectory with negative tolerance");
+	}
+
+	const auto n = this->points.size();
+	SimplificationResult stats;
+	stats.inputPoints = n;
+	std::vector<char> keep(n, false);
+	if (n > 0) {
+		keep.front() = keep.back() = true;
+	}
+	for (std::size_t i = 1; i < n; ++i) {
+		if (points[i].getMode() != points[i-1].getMode()) {
+			keep[i-1] = keep[i] = true;
+		}
+	}
+
+	// Segments between kept points which remain to be checked, iteratively as
+	// long trajectories could otherwise recurse deeply
+	std::vector<std::pair<std::size_t,std::size_t>> segments;
+	for (std::size_t first = 0, last = 1; last < n; ++last) {
+		if (keep[last]) {
+			segments.emplace_back(first, last);
+			first = last;
+		}
+	}
+	while (!segments.empty()) {
+		const auto [first, last] = segments.back();
+		segments.pop_back();
+		if (last - first < 2) {
+			continue;
+		}
+		double maxError = 0.0;
+		std::size_t split = first + 1;
+		PointDeviation segmentMax;
+		for (auto i = first + 1; i < last; ++i) {
+			const auto d = deviationFromChord(points[first], points[last], points[i]);
+			const double error = std::max({relativeDeviation(d.position_m, tolerances.position_m),
+										   relativeDeviation(d.heading_rad, tolerances.heading_rad),
+										   relativeDeviation(d.velocity_m_s, tolerances.velocity_m_s)});
+			if (error > maxError) {
+				maxError = error;
+				split = i;
+			}
+			segmentMax.position_m = std::max(segmentMax.position_m, d.position_m);
+			segmentMax.heading_rad = std::max(segmentMax.heading_rad, d.heading_rad);
+			segmentMax.velocity_m_s = std::max(segmentMax.velocity_m_s, d.velocity_m_s);
+		}
+		const auto interval = points[last].getTime() - points[first].getTime();
+		const bool tooLong = tolerances.maxPointInterval.count() > 0 && interval > tolerances.maxPointInterval;
+		if (maxError <= 1.0 && !tooLong) {
+			stats.maxPositionDeviation_m = std::max(stats.maxPositionDeviation_m, segmentMax.position_m);
+			stats.maxHeadingDeviation_rad = std::max(stats.maxHeadingDeviation_rad, segmentMax.heading_rad);
+			stats.maxVelocityDeviation_m_s = std::max(stats.maxVelocityDeviation_m_s, segmentMax.velocity_m_s);
+			continue;
+		}
+		if (maxError <= 1.0) {
+			// Within tolerance but too long, split at the last point within the interval
+			const auto limit = points[first].getTime() + tolerances.maxPointInterval;
+			auto it = std::upper_bound(points.begin() + first + 1, points.begin() + last, limit,
+									   [](const std::chrono::milliseconds& t, const TrajectoryPoint& pt) {
+				return t < pt.getTime();
+			});
+			split = std::max(first + 1, static_cast<std::size_t>(it - points.begin()) - 1);
+		}
+		keep[split] = true;
+		segments.emplace_back(first, split);
+		segments.emplace_back(split, last);
+	}
+
+	Trajectory newTrajectory(get_logger());
+	newTrajectory.id = this->id;
+	newTrajectory.name = this->name + "_simplified";
+	newTrajectory.version = this->version;
+	newTrajectory.points.reserve(static_cast<std::size_t>(std::count(keep.begin(), keep.end(), true)));
+	for (std::size_t i = 0; i < n; ++i) {
+		if (keep[i]) {
+			newTrajectory.points.push_back(points[i]);
+		}
+	}
+	stats.outputPoints = newTrajectory.points.size();
+	if (result != nullptr) {
+		*result = stats;
+	}
+	return newTrajectory;
+}
+
 Trajectory Trajectory::createWilliamsonTurn(
 		double turnRadius,
 		double acceleration,
@@ -611,16 +1191,16 @@ Trajectory Trajectory::createWilliamsonTurn(
 	auto v1 = -1/radius*Eigen::ArrayXd::Ones(n0);
 	auto v2 = -1/radius*Eigen::ArrayXd::Ones(n1);
 	auto v3 = -1/radius*Eigen::ArrayXd::Zero(n2);
-	RCLCPP_DEBUG(startPoint.get_logger(), "curvatureArray rows: %ld, cols: %ld", curvatureArray.rows(), curvatureArray.cols());
-	RCLCPP_DEBUG(startPoint.get_logger(), "v1 rows: %ld, cols: %ld", v1.rows(), v1.cols());
-	RCLCPP_DEBUG(startPoint.get_logger(), "v2 rows: %ld, cols: %ld", v2.rows(), v2.cols());
-	RCLCPP_DEBUG(startPoint.get_logger(), "v3 rows: %ld, cols: %ld", v3.rows(), v3.cols());
+	RCLCPP_DEBUG(rclcpp::get_logger("trajectory"), "curvatureArray rows: %ld, cols: %ld", curvatureArray.rows(), curvatureArray.cols());
+	RCLCPP_DEBUG(rclcpp::get_logger("trajectory"), "v1 rows: %ld, cols: %ld", v1.rows(), v1.cols());
+	RCLCPP_DEBUG(rclcpp::get_logger("trajectory"), "v2 rows: %ld, cols: %ld", v2.rows(), v2.cols());
+	RCLCPP_DEBUG(rclcpp::get_logger("trajectory"), "v3 rows: %ld, cols: %ld", v3.rows(), v3.cols());
 	curvatureArray << -1/radius*Eigen::ArrayXd::Ones(n0), 1/radius*Eigen::ArrayXd::Ones(n1), Eigen::ArrayXd::Zero(n2);
 
 	//create trajectory points
 	std::vector<TrajectoryPoint> tempVector;
 	for(int i = 0; i < calculatedNoOfPoints; i++) {
-		TrajectoryPoint tempPoint(startPoint.get_logger());
+		TrajectoryPoint tempPoint;
 		tempPoint.setTime(timeArray[i]+startTime);
 		tempPoint.setXCoord(resM(0,i));
 		tempPoint.setYCoord(resM(1,i));
@@ -636,7 +1216,7 @@ Trajectory Trajectory::createWilliamsonTurn(
 		tempVector.push_back(tempPoint);
 	}
 
-	Trajectory retval(startPoint.get_logger());
+	Trajectory retval(rclcpp::get_logger("trajectory"));
 	retval.points = tempVector;
 	retval.name = "Williamson_x" + std::to_string(startPoint.getXCoord())
 			+ "_y" + std::to_string(startPoint.getYCoord())
@@ -696,40 +1276,53 @@ Trajectory Trajectory::reversed() const {
 }
 
 /*!
- * \brief Trajectory::saveToFile saves a .traj file of the trajectory to the traj directory.
- * \param fileName
- * \return
+ * \brief Trajectory::saveToFile saves a trajectory file to the traj directory.
+ * \param fileName Name of the file, a binary file is saved if it ends
+ *			in TRAJECTORY_BINARY_FILE_EXTENSION
  */
 void Trajectory::saveToFile(const std::string& fileName) const {
-	using std::string, std::smatch, std::ofstream;
 	char trajDirPath[PATH_MAX];
-
 	UtilGetTrajDirectoryPath(trajDirPath, sizeof (trajDirPath));
-	string trajFilePath(trajDirPath);
-	trajFilePath += fileName;
+	saveToPath(std::string(trajDirPath) + fileName);
+}
+
+/*!
+ * \brief Trajectory::saveToPath saves a trajectory file.
+ * \param trajFilePath Path of the file, a binary file is saved if it ends
+ *			in TRAJECTORY_BINARY_FILE_EXTENSION
+ */
+void Trajectory::saveToPath(const std::string& trajFilePath) const {
+	using std::string, std::smatch, std::ofstream;
+	const string binaryExtension = TRAJECTORY_BINARY_FILE_EXTENSION;
 
 	ofstream outputTraj;
 	RCLCPP_DEBUG(get_logger(), "Opening file %s", trajFilePath.c_str());
 	try {
+		if (trajFilePath.size() >= binaryExtension.size()
+				&& trajFilePath.compare(trajFilePath.size() - binaryExtension.size(),
+										binaryExtension.size(), binaryExtension) == 0) {
+			BinaryTrajectoryFile::write(trajFilePath, *toColumns(), this->id, this->name, this->version);
+			RCLCPP_DEBUG(get_logger(), "Wrote binary file %s", trajFilePath.c_str());
+			return;
+		}
 		outputTraj.open(trajFilePath);
 		RCLCPP_DEBUG(get_logger(), "Outputting trajectory to file");
-		outputTraj << "TRAJECTORY;" << this->id <<";" << this->name << ";" << this->version << ";" << this->points.size() << ";" <<  "\n";
+		// Format into one buffer and write it in a single call
+		std::string buffer = "TRAJECTORY;" + std::to_string(this->id) + ";" + this->name + ";"
+				+ std::to_string(this->version) + ";" + std::to_string(this->points.size()) + ";\n";
+		buffer.reserve(buffer.size() + (this->points.size() + 1) * 128);
+		char line[512];
 		for (const auto& point : points) {
-			outputTraj << "LINE;"
-					   << std::fixed << std::setprecision(2) << std::chrono::duration<double>(point.getTime()).count() << ";"
-					   << std::fixed << std::setprecision(6) << point.getXCoord() << ";"
-					   << std::fixed << std::setprecision(6) << point.getYCoord() << ";"
-					   << std::fixed << std::setprecision(6) << point.getZCoord() << ";"
-					   << std::fixed << std::setprecision(6) << point.getHeading() << ";"
-					   << std::fixed << std::setprecision(6) << point.getLongitudinalVelocity() << ";"
-					   << ";" //point.getLateralVelocity() << ";"
-					   <<  std::fixed << std::setprecision(6) <<(point.getLongitudinalAcceleration()) << ";"
-						<< ";" //point.getLateralAcceleration() << ";"
-						<< std::fixed << std::setprecision(6) << point.getCurvature() << ";"
-						<< std::fixed << std::setprecision(6) << point.getMode()
-						<<";ENDLINE;" << "\n";
-		}
-		outputTraj << "ENDTRAJECTORY;" <<  "\n";
+			auto length = snprintf(line, sizeof (line), "LINE;%.2f;%.6f;%.6f;%.6f;%.6f;%.6f;;%.6f;;%.6f;%d;ENDLINE;\n",
+								   std::chrono::duration<double>(point.getTime()).count(),
+								   point.getXCoord(), point.getYCoord(), point.getZCoord(),
+								   point.getHeading(), point.getLongitudinalVelocity(),
+								   point.getLongitudinalAcceleration(), point.getCurvature(),
+								   static_cast<int>(point.getMode()));
+			buffer.append(line, static_cast<size_t>(length));
+		}
+		buffer += "ENDTRAJECTORY;\n";
+		outputTraj.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
 		outputTraj.close();
 		RCLCPP_DEBUG(get_logger(), "Closed file %s", trajFilePath.c_str());
 	}
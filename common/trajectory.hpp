@@ -15,6 +15,7 @@
 #include <eigen3/Eigen/Dense>
 #include <math.h>
 #include <chrono>
+#include <memory>
 #include <nav_msgs/msg/path.hpp>
 #include <foxglove_msgs/msg/geo_json.hpp>
 
@@ -24,22 +25,30 @@
 #include "util.h"
 //! ATOS Namespace
 namespace ATOS {
+class TrajectoryColumns;
+
 class Trajectory : public Loggable {
 public:
-	class TrajectoryPoint : public Loggable {
+	/*!
+	 * \brief A single trajectory point. Points carry no logger, as a trajectory may
+	 *			hold a very large number of them. See TrajectoryColumns for compact storage.
+	 */
+	class TrajectoryPoint {
 	public:
 		typedef enum {
 			CONTROLLED_BY_DRIVE_FILE,
 			CONTROLLED_BY_VEHICLE
 		} ModeType;
 
-		TrajectoryPoint(rclcpp::Logger log) : Loggable(log) {
+		TrajectoryPoint() {
 			position[2] = std::numeric_limits<double>::quiet_NaN();
 			velocity[0] = std::numeric_limits<double>::quiet_NaN();
 			velocity[1] = std::numeric_limits<double>::quiet_NaN();
 			acceleration[0] = std::numeric_limits<double>::quiet_NaN();
 			acceleration[1] = std::numeric_limits<double>::quiet_NaN();
 		}
+		//! \brief Kept for source compatibility, the logger is not stored.
+		explicit TrajectoryPoint(rclcpp::Logger) : TrajectoryPoint() {}
 
 		~TrajectoryPoint() { }
 
@@ -65,6 +74,9 @@ public:
 
 		std::chrono::milliseconds getTime() const { return time; }
 		Eigen::Vector3d getPosition() const { return position; }
+		//! \brief Contiguous x, y, z coordinates, for transforming many points in place
+		double* positionData() { return position.data(); }
+		const double* positionData() const { return position.data(); }
 		double getXCoord() const { return position[0]; }
 		double getYCoord() const { return position[1]; }
 		double getZCoord() const {
@@ -145,18 +157,46 @@ public:
 	Trajectory& operator=(const Trajectory& other);
 
 	void initializeFromFile(const std::string& fileName);
+	void initializeFromPath(const std::string& path);
 	void initializeFromCartesianTrajectory(const atos_interfaces::msg::CartesianTrajectory& cartesianTrajectory);
-	Trajectory relativeTo(const Trajectory& other) const;
+	//! How a trajectory is sampled at times between its points
+	enum class AlignmentMode {
+		NEAREST_POINT,			//!< Use the point nearest in time
+		LINEAR_INTERPOLATION	//!< Interpolate linearly between the surrounding points
+	};
+	Trajectory relativeTo(const Trajectory& other, const AlignmentMode alignment = AlignmentMode::NEAREST_POINT) const;
 	static const_iterator getNearest(const_iterator first, const_iterator last, const double& time);
 	std::string toString() const;
-	atos_interfaces::msg::CartesianTrajectory toCartesianTrajectory();
+	atos_interfaces::msg::CartesianTrajectory toCartesianTrajectory() const;
 	nav_msgs::msg::Path toPath() const;
 	foxglove_msgs::msg::GeoJSON toGeoJSON(std::array<double,3> llh_0) const;
 	std::size_t size() const { return points.size(); }
 
 	void saveToFile(const std::string& fileName) const;
+	void saveToPath(const std::string& path) const;
 	Trajectory reversed() const;
 	Trajectory rescaledToVelocity(const double vel_m_s) const;
+
+	//! Largest deviations from the original points allowed when simplifying a trajectory.
+	//!	Heading stands in for curvature; acceleration is only bounded through velocity.
+	struct SimplificationTolerances {
+		double position_m = 0.05;
+		double heading_rad = 0.02;
+		double velocity_m_s = 0.1;
+		std::chrono::milliseconds maxPointInterval = std::chrono::seconds(1);	//!< Zero for no limit
+	};
+	//! Outcome of simplifying a trajectory
+	struct SimplificationResult {
+		std::size_t inputPoints = 0;
+		std::size_t outputPoints = 0;
+		double maxPositionDeviation_m = 0.0;		//!< Largest deviation of a removed point
+		double maxHeadingDeviation_rad = 0.0;
+		double maxVelocityDeviation_m_s = 0.0;
+		double compressionRatio() const {
+			return outputPoints > 0 ? static_cast<double>(inputPoints) / outputPoints : 1.0;
+		}
+	};
+	Trajectory simplified(const SimplificationTolerances& tolerances, SimplificationResult* result = nullptr) const;
 	static Trajectory createWilliamsonTurn(double turnRadius, double acceleration, double minSpeed, double maxSpeed, 
 										  TrajectoryPoint startPoint, std::chrono::milliseconds startTime = std::chrono::milliseconds(0));
 
@@ -172,6 +212,9 @@ public:
 	}
 
 	bool isValid() const;
+
+	std::shared_ptr<const TrajectoryColumns> toColumns() const;
+	void initializeFromColumns(const TrajectoryColumns& columns);
 private:
 	static const std::regex fileHeaderPattern;
 	static const std::regex fileLinePattern;
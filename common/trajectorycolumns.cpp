@@ -0,0 +1,104 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include "trajectorycolumns.hpp"
+
+namespace ATOS {
+
+void TrajectoryColumns::reserve(const std::size_t n) {
+	time_ms.reserve(n);
+	x_m.reserve(n);
+	y_m.reserve(n);
+	z_m.reserve(n);
+	heading_rad.reserve(n);
+	longitudinalVelocity_m_s.reserve(n);
+	lateralVelocity_m_s.reserve(n);
+	longitudinalAcceleration_m_s2.reserve(n);
+	lateralAcceleration_m_s2.reserve(n);
+	curvature.reserve(n);
+	mode.reserve(n);
+	validity.reserve(n);
+}
+
+void TrajectoryColumns::resize(const std::size_t n) {
+	time_ms.resize(n);
+	x_m.resize(n);
+	y_m.resize(n);
+	z_m.resize(n);
+	heading_rad.resize(n);
+	longitudinalVelocity_m_s.resize(n);
+	lateralVelocity_m_s.resize(n);
+	longitudinalAcceleration_m_s2.resize(n);
+	lateralAcceleration_m_s2.resize(n);
+	curvature.resize(n);
+	mode.resize(n);
+	validity.resize(n);
+}
+
+void TrajectoryColumns::push_back(const TrajectoryPoint& point) {
+	auto position = point.getPosition();
+	auto velocity = point.getVelocity();
+	auto acceleration = point.getAcceleration();
+	uint8_t valid = 0;
+	valid |= std::isnan(position[2]) ? 0 : Z_VALID;
+	valid |= std::isnan(velocity[0]) ? 0 : LONGITUDINAL_VELOCITY_VALID;
+	valid |= std::isnan(velocity[1]) ? 0 : LATERAL_VELOCITY_VALID;
+	valid |= std::isnan(acceleration[0]) ? 0 : LONGITUDINAL_ACCELERATION_VALID;
+	valid |= std::isnan(acceleration[1]) ? 0 : LATERAL_ACCELERATION_VALID;
+
+	time_ms.push_back(point.getTime().count());
+	x_m.push_back(position[0]);
+	y_m.push_back(position[1]);
+	z_m.push_back(valid & Z_VALID ? position[2] : 0.0);
+	heading_rad.push_back(point.getHeading());
+	longitudinalVelocity_m_s.push_back(valid & LONGITUDINAL_VELOCITY_VALID ? velocity[0] : 0.0);
+	lateralVelocity_m_s.push_back(valid & LATERAL_VELOCITY_VALID ? velocity[1] : 0.0);
+	longitudinalAcceleration_m_s2.push_back(valid & LONGITUDINAL_ACCELERATION_VALID ? acceleration[0] : 0.0);
+	lateralAcceleration_m_s2.push_back(valid & LATERAL_ACCELERATION_VALID ? acceleration[1] : 0.0);
+	curvature.push_back(point.getCurvature());
+	mode.push_back(static_cast<uint8_t>(point.getMode()));
+	validity.push_back(valid);
+}
+
+/*!
+ * \brief TrajectoryColumns::at Constructs the point at the specified index, for
+ *			code using the TrajectoryPoint interface.
+ */
+TrajectoryColumns::TrajectoryPoint TrajectoryColumns::at(const std::size_t index) const {
+	TrajectoryPoint point;
+	point.setTime(std::chrono::milliseconds(time_ms.at(index)));
+	point.setXCoord(x_m[index]);
+	point.setYCoord(y_m[index]);
+	if (isValid(index, Z_VALID))
+		point.setZCoord(z_m[index]);
+	point.setHeading(heading_rad[index]);
+	if (isValid(index, LONGITUDINAL_VELOCITY_VALID))
+		point.setLongitudinalVelocity(longitudinalVelocity_m_s[index]);
+	if (isValid(index, LATERAL_VELOCITY_VALID))
+		point.setLateralVelocity(lateralVelocity_m_s[index]);
+	if (isValid(index, LONGITUDINAL_ACCELERATION_VALID))
+		point.setLongitudinalAcceleration(longitudinalAcceleration_m_s2[index]);
+	if (isValid(index, LATERAL_ACCELERATION_VALID))
+		point.setLateralAcceleration(lateralAcceleration_m_s2[index]);
+	point.setCurvature(curvature[index]);
+	point.setMode(static_cast<TrajectoryPoint::ModeType>(mode[index]));
+	return point;
+}
+
+std::shared_ptr<const TrajectoryColumns> TrajectoryColumns::fromPoints(
+		const std::vector<TrajectoryPoint>& points) {
+	auto columns = std::make_shared<TrajectoryColumns>();
+	columns->reserve(points.size());
+	for (const auto& point : points) {
+		columns->push_back(point);
+	}
+	return columns;
+}
+
+std::vector<TrajectoryColumns::TrajectoryPoint> TrajectoryColumns::toPoints() const {
+	return std::vector<TrajectoryPoint>(begin(), end());
+}
+
+} // namespace ATOS
@@ -0,0 +1,100 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#ifndef TRAJECTORYCOLUMNS_H
+#define TRAJECTORYCOLUMNS_H
+
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+#include "trajectory.hpp"
+
+namespace ATOS {
+/*!
+ * \brief Struct-of-arrays storage of a trajectory. Each quantity is held in its own
+ *			contiguous array, and optional quantities are flagged in a per point
+ *			validity bitmask instead of by NaN. Instances are meant to be filled once
+ *			and then shared read-only, as std::shared_ptr<const TrajectoryColumns>.
+ *
+ *			Code written against Trajectory::TrajectoryPoint can read the columns
+ *			through ::at and the iterators, which construct points on the fly.
+ *
+ *			Trajectory itself still stores its points in Trajectory::points, which
+ *			much code modifies in place. Columns are built from it by
+ *			Trajectory::toColumns, or filled directly by binary trajectory loading.
+ */
+class TrajectoryColumns {
+public:
+	typedef Trajectory::TrajectoryPoint TrajectoryPoint;
+
+	//! Bits of the validity mask, one per optional quantity
+	typedef enum : uint8_t {
+		Z_VALID = 1 << 0,
+		LONGITUDINAL_VELOCITY_VALID = 1 << 1,
+		LATERAL_VELOCITY_VALID = 1 << 2,
+		LONGITUDINAL_ACCELERATION_VALID = 1 << 3,
+		LATERAL_ACCELERATION_VALID = 1 << 4
+	} ValidityFlag;
+
+	std::vector<int64_t> time_ms;
+	std::vector<double> x_m;
+	std::vector<double> y_m;
+	std::vector<double> z_m;
+	std::vector<double> heading_rad;
+	std::vector<double> longitudinalVelocity_m_s;
+	std::vector<double> lateralVelocity_m_s;
+	std::vector<double> longitudinalAcceleration_m_s2;
+	std::vector<double> lateralAcceleration_m_s2;
+	std::vector<double> curvature;
+	std::vector<uint8_t> mode;		//!< TrajectoryPoint::ModeType
+	std::vector<uint8_t> validity;	//!< Bitwise or of ValidityFlag
+
+	std::size_t size() const { return time_ms.size(); }
+	bool empty() const { return time_ms.empty(); }
+	bool isValid(const std::size_t index, const ValidityFlag flag) const { return validity[index] & flag; }
+	void reserve(const std::size_t n);
+	void resize(const std::size_t n);
+	void push_back(const TrajectoryPoint& point);
+	TrajectoryPoint at(const std::size_t index) const;
+
+	//! Iterator over the columns yielding TrajectoryPoint values
+	class const_iterator {
+	public:
+		typedef std::random_access_iterator_tag iterator_category;
+		typedef TrajectoryPoint value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const TrajectoryPoint* pointer;
+		typedef TrajectoryPoint reference;
+
+		const_iterator(const TrajectoryColumns* columns, std::size_t index) : columns(columns), index(index) {}
+		TrajectoryPoint operator*() const { return columns->at(index); }
+		TrajectoryPoint operator[](difference_type n) const { return columns->at(index + n); }
+		const_iterator& operator++() { ++index; return *this; }
+		const_iterator operator++(int) { auto ret = *this; ++index; return ret; }
+		const_iterator& operator--() { --index; return *this; }
+		const_iterator& operator+=(difference_type n) { index += n; return *this; }
+		const_iterator operator+(difference_type n) const { return const_iterator(columns, index + n); }
+		difference_type operator-(const const_iterator& other) const {
+			return static_cast<difference_type>(index) - static_cast<difference_type>(other.index);
+		}
+		bool operator==(const const_iterator& other) const { return index == other.index && columns == other.columns; }
+		bool operator!=(const const_iterator& other) const { return !(*this == other); }
+		bool operator<(const const_iterator& other) const { return index < other.index; }
+		std::size_t position() const { return index; }
+	private:
+		const TrajectoryColumns* columns;
+		std::size_t index;
+	};
+	const_iterator begin() const { return const_iterator(this, 0); }
+	const_iterator end() const { return const_iterator(this, size()); }
+
+	static std::shared_ptr<const TrajectoryColumns> fromPoints(const std::vector<TrajectoryPoint>& points);
+	std::vector<TrajectoryPoint> toPoints() const;
+};
+} // namespace ATOS
+
+#endif
@@ -30,6 +30,7 @@
 #include <sys/stat.h>
 #include <limits.h>
 #include <fcntl.h>
+#include <endian.h>
 
 
 #include "util.h"
@@ -792,6 +793,44 @@ int UtilObjectDataToString(const ObjectDataType monitorData, char *monitorDataSt
 	return 0;
 }
 
+/*!
+ * \brief UtilObjectDataToRVSSMonitorRecord Packs object monitor data into the fixed little endian layout
+ *			of the binary RVSS monitor channel
+ * \param objectData Monitor data of the object
+ * \param record Record to be filled
+ */
+void UtilObjectDataToRVSSMonitorRecord(const ObjectDataType * objectData, RVSSMonitorBinaryRecordType * record) {
+	const ObjectMonitorType *monr = &objectData->MonrData;
+	const dbl values[] = {
+		monr->position.xCoord_m, monr->position.yCoord_m, monr->position.zCoord_m, monr->position.heading_rad,
+		monr->speed.longitudinal_m_s, monr->speed.lateral_m_s,
+		monr->acceleration.longitudinal_m_s2, monr->acceleration.lateral_m_s2
+	};
+	uint64_t bits[sizeof (values) / sizeof (values[0])];
+	uint8_t validity = 0;
+
+	for (size_t i = 0; i < sizeof (values) / sizeof (values[0]); ++i) {
+		memcpy(&bits[i], &values[i], sizeof (bits[i]));
+		bits[i] = htole64(bits[i]);
+	}
+
+	validity |= monr->isTimestampValid ? RVSS_MONITOR_TIMESTAMP_VALID : 0;
+	validity |= monr->position.isPositionValid ? RVSS_MONITOR_POSITION_VALID : 0;
+	validity |= monr->position.isHeadingValid ? RVSS_MONITOR_HEADING_VALID : 0;
+	validity |= monr->speed.isLongitudinalValid ? RVSS_MONITOR_LONGITUDINAL_SPEED_VALID : 0;
+	validity |= monr->speed.isLateralValid ? RVSS_MONITOR_LATERAL_SPEED_VALID : 0;
+	validity |= monr->acceleration.isLongitudinalValid ? RVSS_MONITOR_LONGITUDINAL_ACCELERATION_VALID : 0;
+	validity |= monr->acceleration.isLateralValid ? RVSS_MONITOR_LATERAL_ACCELERATION_VALID : 0;
+
+	record->TransmitterIDU32 = htole32(objectData->ClientID);
+	record->ClientIPU32 = objectData->ClientIP;
+	record->TimestampU64 = htole64((uint64_t) monr->timestamp.tv_sec * 1000000 + (uint64_t) monr->timestamp.tv_usec);
+	memcpy(&record->XCoordDbl, bits, sizeof (bits));
+	record->ObjectStateU8 = (uint8_t) monr->state;
+	record->ValidityU8 = validity;
+	record->ReservedU16 = 0;
+}
+
 /*!
  * \brief UtilStringToMonitorData Converts the data from an ASCII string into a message queue monitor data struct
  * \param monrString String in which converted data is to be placed
@@ -2423,7 +2462,66 @@ int UtilParseTrajectoryFileFooter(char *line) {
 }
 
 /*!
- * \brief UtilCheckTrajectoryFileFormat Verifies that the file follows ISO format
+ * \brief UtilBinaryTrajectoryFileSize Calculates the size of a binary trajectory
+ *			file from its header
+ * \param header Header of the binary trajectory file, whose fieldMask has been
+ *			checked against TRAJECTORY_BINARY_KNOWN_FIELDS
+ * \return Expected size of the file in bytes
+ */
+size_t UtilBinaryTrajectoryFileSize(const TrajectoryBinaryFileHeader * header) {
+	// Time, x, y, heading and curvature are always present
+	size_t nColumns = 5;
+
+	for (uint32_t mask = header->fieldMask; mask != 0; mask >>= 1) {
+		nColumns += mask & 1;
+	}
+	return header->headerSize + header->numberOfPoints * (nColumns * sizeof (double) + sizeof (uint8_t));
+}
+
+/*!
+ * \brief UtilCheckBinaryTrajectoryFileFormat Verifies the header and size of a
+ *			binary trajectory file
+ * \param fp Opened binary trajectory file
+ * \param path Path to the file
+ * \return -1 if the file is not a valid binary trajectory file, 0 otherwise
+ */
+static int UtilCheckBinaryTrajectoryFileFormat(FILE * fp, const char *path) {
+	TrajectoryBinaryFileHeader header;
+	long fileSize;
+
+	if (fread(&header, sizeof (header), 1, fp) != 1) {
+		fprintf(stderr, "Failed to read header of binary trajectory file <%s>\n", path);
+		return -1;
+	}
+	if (header.formatVersion != TRAJECTORY_BINARY_VERSION || header.headerSize != sizeof (header)) {
+		fprintf(stderr, "Binary trajectory file <%s> has unsupported version %u\n", path,
+				header.formatVersion);
+		return -1;
+	}
+	if (memchr(header.name, '\0', sizeof (header.name)) == NULL) {
+		fprintf(stderr, "Name in header of binary trajectory file <%s> is not terminated\n", path);
+		return -1;
+	}
+	if (header.fieldMask & ~(uint32_t) TRAJECTORY_BINARY_KNOWN_FIELDS) {
+		fprintf(stderr, "Binary trajectory file <%s> has unknown fields 0x%x\n", path,
+				header.fieldMask & ~(uint32_t) TRAJECTORY_BINARY_KNOWN_FIELDS);
+		return -1;
+	}
+	if (fseek(fp, 0, SEEK_END) != 0 || (fileSize = ftell(fp)) < 0) {
+		fprintf(stderr, "Could not determine size of file <%s>\n", path);
+		return -1;
+	}
+	if ((size_t) fileSize != UtilBinaryTrajectoryFileSize(&header)) {
+		fprintf(stderr, "Binary trajectory file <%s> is %ld bytes but its header specifies %zu bytes\n",
+				path, fileSize, UtilBinaryTrajectoryFileSize(&header));
+		return -1;
+	}
+	return 0;
+}
+
+/*!
+ * \brief UtilCheckTrajectoryFileFormat Verifies that the file follows ISO format,
+ *			or the binary trajectory format
  * \param path Path to the file to be checked
  * \param pathLen Length of the path variable
  * \return -1 if the file does not follow the correct format, 0 otherwise
@@ -2432,7 +2530,7 @@ int UtilCheckTrajectoryFileFormat(const char *path, size_t pathLen) {
 	int retval = 0;
 	FILE *fp = fopen(path, "r");
 
-	char *line;
+	char *line = NULL;
 	size_t len = 0;
 	ssize_t read;
 
@@ -2440,6 +2538,7 @@ int UtilCheckTrajectoryFileFormat(const char *path, size_t pathLen) {
 
 	TrajectoryFileHeader header;
 	TrajectoryFileLine fileLine;
+	char magic[sizeof (TRAJECTORY_BINARY_MAGIC)];
 
 	memset(&fileLine, 0, sizeof (fileLine));
 
@@ -2448,6 +2547,15 @@ int UtilCheckTrajectoryFileFormat(const char *path, size_t pathLen) {
 		return -1;
 	}
 
+	if (fread(magic, sizeof (magic), 1, fp) == 1
+		&& memcmp(magic, TRAJECTORY_BINARY_MAGIC, sizeof (magic)) == 0) {
+		rewind(fp);
+		retval = UtilCheckBinaryTrajectoryFileFormat(fp, path);
+		fclose(fp);
+		return retval;
+	}
+	rewind(fp);
+
 	// Read line by line
 	while ((read = getline(&line, &len, fp)) != -1) {
 		row++;
@@ -125,6 +125,11 @@ extern "C"{
 #define MASTER_FILE_EXTENSION ".sync.m"
 #define SLAVE_FILE_EXTENSION ".sync.s"
 
+#define TRAJECTORY_BINARY_FILE_EXTENSION ".btraj"
+#define TRAJECTORY_BINARY_MAGIC "ATOSTRJ"
+#define TRAJECTORY_BINARY_VERSION 1
+#define TRAJECTORY_BINARY_NAME_LENGTH 64
+
 enum ConfigurationFileParameter {
 	CONFIGURATION_PARAMETER_SCENARIO_NAME,
 	CONFIGURATION_PARAMETER_ORIGIN_LATITUDE,
@@ -313,6 +318,41 @@ typedef struct {
 	uint8_t mode;
 } TrajectoryFileLine;
 
+//! Optional columns of a binary trajectory file
+typedef enum {
+	TRAJECTORY_FIELD_Z = 1 << 0,
+	TRAJECTORY_FIELD_LONGITUDINAL_VELOCITY = 1 << 1,
+	TRAJECTORY_FIELD_LATERAL_VELOCITY = 1 << 2,
+	TRAJECTORY_FIELD_LONGITUDINAL_ACCELERATION = 1 << 3,
+	TRAJECTORY_FIELD_LATERAL_ACCELERATION = 1 << 4
+} TrajectoryBinaryFieldType;
+//! Bitwise or of all TrajectoryBinaryFieldType, files flagging other fields are rejected
+#define TRAJECTORY_BINARY_KNOWN_FIELDS (TRAJECTORY_FIELD_Z | TRAJECTORY_FIELD_LONGITUDINAL_VELOCITY \
+	| TRAJECTORY_FIELD_LATERAL_VELOCITY | TRAJECTORY_FIELD_LONGITUDINAL_ACCELERATION \
+	| TRAJECTORY_FIELD_LATERAL_ACCELERATION)
+
+/*!
+ * \brief Header of a binary trajectory file. It is followed by one column per
+ *			quantity, each numberOfPoints long and in host byte order:
+ *			time [ms] as int64, x, y, (z), heading, (longitudinal velocity),
+ *			(lateral velocity), (longitudinal acceleration), (lateral acceleration)
+ *			and curvature as float64, and finally mode as uint8. Columns in
+ *			parentheses are only present if flagged in fieldMask, and points lacking
+ *			a value in a present column hold NaN.
+ */
+typedef struct {
+	char magic[8];				//!< TRAJECTORY_BINARY_MAGIC
+	uint16_t formatVersion;		//!< TRAJECTORY_BINARY_VERSION
+	uint16_t headerSize;		//!< Size of this header, at which the columns start
+	uint32_t fieldMask;			//!< Bitwise or of TrajectoryBinaryFieldType
+	uint32_t ID;
+	uint16_t majorVersion;
+	uint16_t minorVersion;
+	uint64_t numberOfPoints;
+	char name[TRAJECTORY_BINARY_NAME_LENGTH];
+	uint8_t reserved[32];
+} TrajectoryBinaryFileHeader;
+
 typedef struct
 {
   volatile U8 isGPSenabled;
@@ -596,8 +636,52 @@ typedef struct
   U8 SysCtrlStateU8;
 } RVSSATOSType;
 
+typedef struct
+{
+  U32 MessageLengthU32;
+  U32 ChannelCodeU32;
+  U16 FormatVersionU16;
+  U16 NumberOfRecordsU16;
+} RVSSMonitorBinaryHeaderType;
+
+//! Monitor data of one object, all fields little endian
+typedef struct
+{
+  U32 TransmitterIDU32;
+  U32 ClientIPU32;            //!< IPv4 address, network byte order
+  U64 TimestampU64;           //!< Microseconds since the Unix epoch
+  dbl XCoordDbl;
+  dbl YCoordDbl;
+  dbl ZCoordDbl;
+  dbl HeadingDbl;             //!< Radians
+  dbl LongitudinalSpeedDbl;
+  dbl LateralSpeedDbl;
+  dbl LongitudinalAccelerationDbl;
+  dbl LateralAccelerationDbl;
+  U8 ObjectStateU8;
+  U8 ValidityU8;              //!< Bitwise or of RVSSMonitorValidityFlag
+  U16 ReservedU16;
+} RVSSMonitorBinaryRecordType;
+
 #pragma pack(pop)
 
+#define RVSS_MONITOR_BINARY_FORMAT_VERSION 1
+
+//! Seqlocked shared memory holding the ObjectDataType of the latest MONR of each object,
+//! written by ObjectControl and read by SystemControl. Unused slots hold a zero ClientID.
+#define MONITOR_SNAPSHOT_MEMORY_NAME "objectMonitorSnapshots"
+#define MONITOR_SNAPSHOT_SLOTS 64
+
+typedef enum {
+	RVSS_MONITOR_TIMESTAMP_VALID = 1 << 0,
+	RVSS_MONITOR_POSITION_VALID = 1 << 1,
+	RVSS_MONITOR_HEADING_VALID = 1 << 2,
+	RVSS_MONITOR_LONGITUDINAL_SPEED_VALID = 1 << 3,
+	RVSS_MONITOR_LATERAL_SPEED_VALID = 1 << 4,
+	RVSS_MONITOR_LONGITUDINAL_ACCELERATION_VALID = 1 << 5,
+	RVSS_MONITOR_LATERAL_ACCELERATION_VALID = 1 << 6
+} RVSSMonitorValidityFlag;
+
 typedef enum {
     NORTHERN,
     SOUTHERN
@@ -657,10 +741,12 @@ int UtilCheckTrajectoryFileFormat(const char *path, size_t pathLen);
 int UtilParseTrajectoryFileHeader(char *headerLine, TrajectoryFileHeader * header);
 int UtilParseTrajectoryFileFooter(char *footerLine);
 int UtilParseTrajectoryFileLine(char *fileLine, TrajectoryFileLine * line);
+size_t UtilBinaryTrajectoryFileSize(const TrajectoryBinaryFileHeader * header);
 
 
 int UtilObjectDataToString(const ObjectDataType monrData, char* monrString, size_t stringLength);
 int UtilStringToMonitorData(const char* monrString, size_t stringLength, ObjectDataType * monrData);
+void UtilObjectDataToRVSSMonitorRecord(const ObjectDataType * objectData, RVSSMonitorBinaryRecordType * record);
 uint8_t UtilIsPositionNearTarget(CartesianPosition position, CartesianPosition target, double tolerance_m);
 uint8_t UtilIsAngleNearTarget(CartesianPosition position, CartesianPosition target, double tolerance);
 double UtilCalcPositionDelta(double P1Lat, double P1Long, double P2Lat, double P2Long, ObjectPosition *OP);
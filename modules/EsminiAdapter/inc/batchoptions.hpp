@@ -0,0 +1,32 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*!
+ * \brief Parsing of the esmini_batch command line options. Invalid values are
+ *			reported by throwing std::invalid_argument.
+ */
+namespace BatchOptions {
+//! Largest number of worker processes accepted
+constexpr std::size_t MAX_JOBS = 1024;
+
+//! Values overriding parameters declared in a scenario, as name and value
+typedef std::vector<std::pair<std::string,std::string>> ParameterValues;
+//! Values to extract a scenario for, as parameter name and values
+typedef std::pair<std::string,std::vector<std::string>> ParameterSweep;
+
+//! \brief Parses a number of worker processes between 1 and MAX_JOBS
+std::size_t parseJobCount(const std::string& argument);
+//! \brief Parses a parameter sweep of the form name=value,...
+ParameterSweep parseParameterSweep(const std::string& argument);
+//! \brief Every combination of the swept parameter values, with the parameters in sweep order
+std::vector<ParameterValues> combinations(const std::vector<ParameterSweep>& sweeps);
+}
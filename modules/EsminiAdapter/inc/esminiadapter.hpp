@@ -14,15 +14,21 @@
 #include "roschannels/statechange.hpp"
 #include <unordered_map>
 #include <filesystem>
+#include <future>
+#include <thread>
 #include "esmini/esminiLib.hpp"
 #include "esmini/esminiRMLib.hpp"
 #include "CRSTransformation.hpp"
+#include "objectposetable.hpp"
+#include "scenarioextractor.hpp"
+#include "trajectorycache.hpp"
 
 #include "trajectory.hpp"
 #include "atos_interfaces/srv/get_test_origin.hpp"
 #include "atos_interfaces/srv/get_object_trajectory.hpp"
 #include "atos_interfaces/srv/get_object_trigger_start.hpp"
 #include "atos_interfaces/srv/get_object_ip.hpp"
+#include "std_srvs/srv/trigger.hpp"
 
 /*!
  * \brief The EsminiAdapter class is a singleton class that 
@@ -36,6 +42,7 @@ public:
 	EsminiAdapter(EsminiAdapter const&) = delete;
     EsminiAdapter& operator=(EsminiAdapter const&) = delete;
 	static std::shared_ptr<EsminiAdapter> instance();
+	~EsminiAdapter();
 
 private:
 	EsminiAdapter();
@@ -53,6 +60,7 @@ private:
 	static std::shared_ptr<rclcpp::Service<atos_interfaces::srv::GetObjectTriggerStart>> startOnTriggerService;
 	static std::shared_ptr<rclcpp::Service<atos_interfaces::srv::GetObjectIp>> objectIpService;
 	static std::shared_ptr<rclcpp::Service<atos_interfaces::srv::GetTestOrigin>> testOriginService;
+	static std::shared_ptr<rclcpp::Service<std_srvs::srv::Trigger>> clearTrajectoryCacheService;
 
 
 	void onMonitorMessage(const ROSChannels::Monitor::message_type::SharedPtr monr, uint32_t id);
@@ -64,22 +72,15 @@ private:
 	static void onStaticStateChangeMessage(const ROSChannels::StateChange::message_type::SharedPtr);
 
 	static void onConnectedObjectIdsMessage(const ROSChannels::ConnectedObjectIds::message_type::SharedPtr msg);
-	static void reportObjectPosition(const ROSChannels::Monitor::message_type::SharedPtr monr, uint32_t id);
+	static ObjectPoseTable::Pose poseFromMonitor(const ROSChannels::Monitor::message_type& monr);
+	static void reportObjectPose(const int esminiObjectId, const ObjectPoseTable::Pose& pose);
 	static void executeActionIfStarted(const char* name, int type, int state);
 	static std::filesystem::path getOpenScenarioFileParameter();
-	static std::filesystem::path getOpenDriveFile();
 	static void setOpenScenarioFile(const std::filesystem::path&);
 	static void handleStoryBoardElementChange(const char* name, int type, int state);
 	static void handleActionElementStateChange(const char* name, int state);
 	static void InitializeEsmini();
-	static void getObjectStates(double timeStep, std::map<uint32_t,std::vector<SE_ScenarioObjectState>>& states);
-	static ATOS::Trajectory getTrajectoryFromObjectState(uint32_t,std::vector<SE_ScenarioObjectState>& states);
-	static std::string projStrFromGeoReference(RM_GeoReference& geoRef);
-	static std::map<uint32_t,ATOS::Trajectory> extractTrajectories(double timeStep, std::map<uint32_t,ATOS::Trajectory>& idToTraj);
-	static std::pair<uint32_t, std::string> parseAction(const std::string& action);
-	static bool isStartAction(const std::string& action);
 	static bool isSendDenmAction(const std::string& action);
-	static void collectStartAction(const char* name, int type, int state);
 	static ROSChannels::V2X::message_type denmFromTestOrigin(double *llh);
 
 	static void onRequestObjectTrajectory(
@@ -96,6 +97,9 @@ private:
 
 	static void onRequestTestOrigin(const std::shared_ptr<atos_interfaces::srv::GetTestOrigin::Request>,
 							std::shared_ptr<atos_interfaces::srv::GetTestOrigin::Response>);
+
+	static void onRequestClearTrajectoryCache(const std::shared_ptr<std_srvs::srv::Trigger::Request>,
+							std::shared_ptr<std_srvs::srv::Trigger::Response> res);
 	
 
 	static std::shared_ptr<rclcpp::Client<atos_interfaces::srv::GetTestOrigin>> testOriginClient;
@@ -105,7 +109,30 @@ private:
 	static std::map<uint32_t,std::string> idToIp;
 	static std::vector<uint32_t> delayedStartIds;
 
-	std::shared_ptr<CRSTransformation> crsTransformation;
+	//! Step timing of the simulation clock
+	struct SimulationClockStatistics {
+		uint64_t nSteps = 0;
+		uint64_t nOverruns = 0;			//!< Steps which took longer than the step period
+		uint64_t nSkippedPeriods = 0;	//!< Periods merged into a later step after an overrun
+		std::chrono::nanoseconds maxStepDuration = std::chrono::nanoseconds::zero();
+		std::chrono::nanoseconds totalStepDuration = std::chrono::nanoseconds::zero();
+	};
+
+	std::chrono::nanoseconds simulationStepPeriod;	//!< If zero, esmini is stepped on each MONR instead
+	std::thread simulationClockThread;
+	std::promise<void> stopSimulationClockSignal;
+	ObjectPoseTable reportedPoses;							//!< Latest MONR pose of each scenario object
+	std::unordered_map<uint32_t,std::size_t> idToPoseSlot;	//!< ATOS object ID to slot in reportedPoses
+	std::vector<int> poseSlotToEsminiId;
+	void startSimulationClock();
+	void stopSimulationClock();
+	void simulationClock(std::shared_future<void> stopRequest);
+
+	std::unique_ptr<TrajectoryCache> trajectoryCache;	//!< Null if trajectories are extracted on every init
+	bool simplifyTrajectories;
+	ATOS::Trajectory::SimplificationTolerances simplificationTolerances;
+
+	std::shared_ptr<const CRSTransformation> crsTransformation;
 	bool applyTrajTransform;
 	bool testOriginSet;
 
@@ -0,0 +1,42 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+/*!
+ * \brief Latest reported pose of each scenario object, written as monitor data
+ *			arrives and read by the simulation clock before each step. Each slot
+ *			is guarded by its own sequence lock: the single writer of a slot never
+ *			waits, and readers retry their copy if it was overwritten meanwhile.
+ */
+class ObjectPoseTable {
+public:
+	typedef struct {
+		double x_m, y_m, z_m;
+		double yaw_rad, pitch_rad, roll_rad;
+		double speed_m_s;
+	} Pose;
+
+	//! \brief Replaces the table with nSlots empty slots. Must not be called while in use.
+	void reset(const std::size_t nSlots);
+	std::size_t size() const { return nSlots; }
+	//! \brief Stores the latest pose of a slot. Must only be called from one thread per slot.
+	void store(const std::size_t slot, const Pose& pose);
+	//! \brief Latest pose of a slot. Returns false if no pose has been stored.
+	bool load(const std::size_t slot, Pose& pose) const;
+
+private:
+	//! Slots are cache line aligned so that writing one does not disturb readers of another
+	struct alignas(64) Slot {
+		std::atomic<uint32_t> sequence = {0};	//!< Odd while a write is in progress
+		Pose pose;
+	};
+	std::unique_ptr<Slot[]> slots;
+	std::size_t nSlots = 0;
+};
@@ -0,0 +1,107 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#pragma once
+
+#include <array>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "esmini/esminiLib.hpp"
+#include "esmini/esminiRMLib.hpp"
+#include "CRSTransformation.hpp"
+#include "loggable.hpp"
+#include "trajectory.hpp"
+#include "trajectorycache.hpp"
+
+/*!
+ * \brief Loads an OpenSCENARIO file into esmini and extracts the trajectories,
+ *			triggered starts and IPs of its objects by running it headless to its
+ *			end. The esmini API is process global, so only one scenario can be
+ *			loaded in a process at a time; scenarios are run in parallel by
+ *			running them in separate processes.
+ */
+class ScenarioExtractor : public Loggable {
+public:
+	//! Values overriding parameters declared in the scenario, as name and value
+	typedef TrajectoryCache::ParameterValues ParameterValues;
+
+	static constexpr double DEFAULT_TIME_STEP = 0.1;	//!< Simulation time step of the extraction [s]
+
+	explicit ScenarioExtractor(rclcpp::Logger log) : Loggable(log) {}
+	~ScenarioExtractor();
+	ScenarioExtractor(const ScenarioExtractor&) = delete;
+	ScenarioExtractor& operator=(const ScenarioExtractor&) = delete;
+
+	/*!
+	 * \brief Loads a scenario and reads the geo reference of its OpenDRIVE file,
+	 *			replacing any loaded scenario.
+	 * \throws std::runtime_error if esmini fails to load the scenario or OpenDRIVE file
+	 */
+	void load(const std::filesystem::path& oscFile, const ParameterValues& parameters = {});
+	/*!
+	 * \brief Computes the test origin and CRS transformation from the geo reference.
+	 *			Returns false if the OpenDRIVE file has no geo reference.
+	 * \throws std::exception if the geo reference cannot be converted
+	 */
+	bool applyGeoReference();
+	//! \brief Latitude, longitude and altitude of the test origin, set by ::applyGeoReference
+	const std::array<double,3>& origin() const { return llhOrigin; }
+	//! \brief Transformation from the OpenDRIVE CRS to one centered on the test origin, or null
+	std::shared_ptr<const CRSTransformation> transformation() const { return crsTransformation; }
+	/*!
+	 * \brief Key of the data extracted from the loaded scenario in a TrajectoryCache
+	 * \throws std::ifstream::failure if a scenario file could not be read
+	 */
+	std::string cacheKey(const double timeStep) const;
+	//! \brief Runs the loaded scenario to its end, returning the data of its objects, and unloads it
+	TrajectoryCache::Entry extract(const double timeStep);
+	//! \brief Unloads the scenario, if any
+	void close();
+
+	static std::pair<uint32_t, std::string> parseAction(const std::string& action);
+	static bool isStartAction(const std::string& action);
+
+private:
+	bool loaded = false;
+	std::filesystem::path oscFile;
+	std::filesystem::path odrFile;
+	ParameterValues parameters;
+	bool hasGeoReference = false;
+	RM_GeoReference geoReference;
+	std::string projStringFrom;
+	std::string projStringTo;
+	std::array<double,3> llhOrigin = {0.0, 0.0, 0.0};
+	std::shared_ptr<const CRSTransformation> crsTransformation;
+	std::vector<uint32_t> startedObjectIds;
+
+	//! IDs of a scenario object, parsed once before the simulation is run
+	typedef struct {
+		int esminiId;
+		uint32_t atosId;
+	} ObjectIndex;
+	/*!
+	 * \brief States of all objects at each simulation step, one column per state
+	 *			variable. The state of object j at step i is at index i*objectCount + j.
+	 */
+	typedef struct {
+		std::size_t objectCount = 0;
+		std::vector<float> time;	//!< Simulation time of each step [s], as the timestamp of SE_ScenarioObjectState
+		std::vector<float> x, y, z, h, speed, wheelAngle;
+	} ObjectStates;
+	std::vector<ObjectIndex> objects;	//!< Scenario objects by esmini object index
+
+	static ScenarioExtractor* extracting;	//!< Receives the esmini story board callbacks during ::extract
+	static void collectStartAction(const char* name, int type, int state);
+	std::filesystem::path getOpenDriveFile() const;
+	std::string projStrFromGeoReference(RM_GeoReference& geoRef) const;
+	void indexObjects();
+	void getObjectStates(double timeStep, ObjectStates& states);
+	ATOS::Trajectory getTrajectoryFromObjectStates(std::size_t object, const ObjectStates& states) const;
+};
@@ -0,0 +1,58 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "loggable.hpp"
+#include "trajectory.hpp"
+
+/*!
+ * \brief Persistent cache of the data extracted from a scenario by running it in
+ *			esmini. Entries are addressed by a hash of the OpenSCENARIO file, its
+ *			OpenDRIVE file and catalogs, and the extraction parameters, so that an
+ *			entry is not used once any of them has changed. Each entry is a directory
+ *			holding a binary trajectory file per object and an index of the remaining
+ *			data, and is replaced as a whole so that readers never see it half written.
+ */
+class TrajectoryCache : public Loggable {
+public:
+	//! Data extracted from a scenario
+	typedef struct {
+		std::map<uint32_t,ATOS::Trajectory> trajectories;
+		std::vector<uint32_t> delayedStartIds;	//!< Objects started by a trigger
+		std::map<uint32_t,std::string> ips;
+		std::unordered_map<int,int> esminiIds;	//!< ATOS object ID to esmini object ID
+	} Entry;
+	//! Values overriding parameters declared in a scenario, as name and value
+	typedef std::vector<std::pair<std::string,std::string>> ParameterValues;
+
+	TrajectoryCache(const std::filesystem::path& directory, rclcpp::Logger log);
+
+	/*!
+	 * \brief Key of the entry extracted from a scenario. Catalogs are found through
+	 *			the catalog directories of the OpenSCENARIO file.
+	 * \throws std::ifstream::failure if a file could not be read
+	 */
+	static std::string key(const std::filesystem::path& oscFile, const std::filesystem::path& odrFile,
+						   const double timeStep, const std::string& fromCRS, const std::string& toCRS,
+						   const ParameterValues& parameters = {});
+	//! \brief Loads the entry with the given key. Returns false if there is no readable entry.
+	bool load(const std::string& key, Entry& entry) const;
+	//! \brief Stores an entry, replacing any entry with the same key
+	void store(const std::string& key, const Entry& entry) const;
+	//! \brief Removes all entries and returns the number removed
+	std::size_t clear() const;
+
+private:
+	std::filesystem::path directory;
+};
@@ -0,0 +1,67 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include "batchoptions.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+#include <stdexcept>
+
+namespace BatchOptions {
+
+std::size_t parseJobCount(const std::string& argument) {
+	const std::invalid_argument error("Number of jobs " + argument + " is not between 1 and "
+									  + std::to_string(MAX_JOBS));
+	// std::stoul accepts a sign and wraps negative numbers, so only digits are allowed
+	if (argument.empty()
+			|| !std::all_of(argument.begin(), argument.end(), [](unsigned char c) { return std::isdigit(c); })) {
+		throw error;
+	}
+	unsigned long nJobs;
+	try {
+		nJobs = std::stoul(argument);
+	}
+	catch (std::out_of_range&) {
+		throw error;
+	}
+	if (nJobs == 0 || nJobs > MAX_JOBS) {
+		throw error;
+	}
+	return nJobs;
+}
+
+ParameterSweep parseParameterSweep(const std::string& argument) {
+	auto separator = argument.find('=');
+	if (separator == std::string::npos || separator == 0) {
+		throw std::invalid_argument("Parameter sweep " + argument + " is not of the form name=value,...");
+	}
+	std::vector<std::string> values;
+	std::istringstream valueStream(argument.substr(separator + 1));
+	for (std::string v; std::getline(valueStream, v, ',');) {
+		values.push_back(v);
+	}
+	if (values.empty()) {
+		throw std::invalid_argument("No values for parameter " + argument.substr(0, separator));
+	}
+	return {argument.substr(0, separator), values};
+}
+
+std::vector<ParameterValues> combinations(const std::vector<ParameterSweep>& sweeps) {
+	std::vector<ParameterValues> result = {{}};
+	for (const auto& [name, values] : sweeps) {
+		std::vector<ParameterValues> extended;
+		for (const auto& partial : result) {
+			for (const auto& value : values) {
+				extended.push_back(partial);
+				extended.back().emplace_back(name, value);
+			}
+		}
+		result = std::move(extended);
+	}
+	return result;
+}
+
+} // namespace BatchOptions
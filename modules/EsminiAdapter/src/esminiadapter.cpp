@@ -14,7 +14,6 @@
 #include <regex>
 
 #include "atos_interfaces/msg/cartesian_trajectory.hpp"
-#include "rclcpp/wait_for_message.hpp"
 #include "trajectory.hpp"
 #include "string_utility.hpp"
 #include "util.h"
@@ -25,6 +24,7 @@ using TestOriginSrv = atos_interfaces::srv::GetTestOrigin;
 using ObjectTrajectorySrv = atos_interfaces::srv::GetObjectTrajectory;
 using ObjectTriggerSrv = atos_interfaces::srv::GetObjectTriggerStart;
 using ObjectIpSrv = atos_interfaces::srv::GetObjectIp;
+using ClearCacheSrv = std_srvs::srv::Trigger;
 using std::placeholders::_1;
 using std::placeholders::_2;
 using namespace std::chrono_literals;
@@ -42,6 +42,7 @@ std::shared_ptr<rclcpp::Service<ObjectTrajectorySrv>> EsminiAdapter::objectTraje
 std::shared_ptr<rclcpp::Service<ObjectTriggerSrv>> EsminiAdapter::startOnTriggerService = std::shared_ptr<rclcpp::Service<ObjectTriggerSrv>>();
 std::shared_ptr<rclcpp::Service<ObjectIpSrv>> EsminiAdapter::objectIpService = std::shared_ptr<rclcpp::Service<ObjectIpSrv>>();
 std::shared_ptr<rclcpp::Service<TestOriginSrv>> EsminiAdapter::testOriginService = std::shared_ptr<rclcpp::Service<TestOriginSrv>>();
+std::shared_ptr<rclcpp::Service<ClearCacheSrv>> EsminiAdapter::clearTrajectoryCacheService = std::shared_ptr<rclcpp::Service<ClearCacheSrv>>();
 std::vector<uint32_t> EsminiAdapter::delayedStartIds = std::vector<uint32_t>();
 geographic_msgs::msg::GeoPose EsminiAdapter::testOrigin = geographic_msgs::msg::GeoPose();
 
@@ -55,6 +56,32 @@ EsminiAdapter::EsminiAdapter() : Module(moduleName),
 	testOriginSet(false)
  {
 	declare_parameter("open_scenario_file","");
+	declare_parameter("simulation_step_rate", 100);
+	auto rate = get_parameter("simulation_step_rate").as_int();
+	simulationStepPeriod = rate > 0 ? std::chrono::nanoseconds(std::chrono::seconds(1)) / rate
+									: std::chrono::nanoseconds::zero();
+	declare_parameter("use_trajectory_cache", true);
+	declare_parameter("simplify_trajectories", false);
+	declare_parameter("trajectory_position_tolerance", simplificationTolerances.position_m);
+	declare_parameter("trajectory_heading_tolerance", simplificationTolerances.heading_rad);
+	declare_parameter("trajectory_velocity_tolerance", simplificationTolerances.velocity_m_s);
+	declare_parameter("trajectory_max_point_interval",
+		std::chrono::duration<double>(simplificationTolerances.maxPointInterval).count());
+	simplifyTrajectories = get_parameter("simplify_trajectories").as_bool();
+	simplificationTolerances.position_m = get_parameter("trajectory_position_tolerance").as_double();
+	simplificationTolerances.heading_rad = get_parameter("trajectory_heading_tolerance").as_double();
+	simplificationTolerances.velocity_m_s = get_parameter("trajectory_velocity_tolerance").as_double();
+	simplificationTolerances.maxPointInterval = std::chrono::milliseconds(
+		static_cast<int64_t>(get_parameter("trajectory_max_point_interval").as_double() * 1000.0));
+	if (get_parameter("use_trajectory_cache").as_bool()) {
+		char path[MAX_FILE_PATH];
+		UtilGetTestDirectoryPath(path, MAX_FILE_PATH);
+		trajectoryCache = std::make_unique<TrajectoryCache>(std::string(path) + "cache/esmini", get_logger());
+	}
+}
+
+EsminiAdapter::~EsminiAdapter() {
+	stopSimulationClock();
 }
 
 /*!
@@ -80,32 +107,6 @@ std::filesystem::path EsminiAdapter::getOpenScenarioFileParameter()
 	}
 }
 
-/*!
- * \brief Fetches the open drive file path from the open scenario file parameter
- * \return Configured path
-*/
-std::filesystem::path EsminiAdapter::getOpenDriveFile()
-{
-	std::filesystem::path odrPath;
-	if (SE_GetODRFilename() != nullptr) {
-		odrPath = std::filesystem::path(SE_GetODRFilename()); 
-		RCLCPP_INFO(me->get_logger(), "Found ODR file %s", odrPath.string().c_str());
-	}
-	else {
-		RCLCPP_DEBUG(me->get_logger(), "No ODR file found");
-	}
-
-	if (odrPath.is_absolute()) {
-		return odrPath;
-	}
-	else {
-		char path[MAX_FILE_PATH];
-		UtilGetConfDirectoryPath(path, MAX_FILE_PATH);
-		return std::string(path) + odrPath.string();
-	}
-
-}
-
 /*!
  * \brief Sets the OpenSCENARIO file path to use
  * \param path OpenSCENARIO file path
@@ -173,12 +174,14 @@ void EsminiAdapter::onStaticStateChangeMessage(const ROSChannels::StateChange::m
 
 
 void EsminiAdapter::handleAbortCommand() {
+	me->stopSimulationClock();
 	SE_Close();
 	RCLCPP_INFO(me->get_logger(), "Esmini ScenarioEngine stopped due to Abort");
 }
 
 void EsminiAdapter::handleInitCommand()
 {
+	me->stopSimulationClock();
 	try {
 		setOpenScenarioFile(getOpenScenarioFileParameter());
 	}
@@ -198,6 +201,7 @@ void EsminiAdapter::handleInitCommand()
 
 void EsminiAdapter::onStaticExitMessage(const ROSChannels::Exit::message_type::SharedPtr)
 {
+	me->stopSimulationClock();
 	SE_Close();
 	RCLCPP_DEBUG(me->get_logger(),"Received exit command");
 	rclcpp::shutdown();
@@ -205,6 +209,7 @@ void EsminiAdapter::onStaticExitMessage(const ROSChannels::Exit::message_type::S
 
 void EsminiAdapter::handleStartCommand()
 {
+	me->stopSimulationClock();
 	if (SE_Init(me->oscFilePath.c_str(),0,0,0,0) < 0) {
 		throw std::runtime_error("Failed to initialize esmini with scenario file " + me->oscFilePath.string());
 	}
@@ -213,31 +218,97 @@ void EsminiAdapter::handleStartCommand()
 
 	SE_Step(); // Make sure that the scenario is started
 	RCLCPP_INFO(me->get_logger(), "Esmini ScenarioEngine started");
+	me->startSimulationClock();
 }
 
 /*!
- * \brief Split action into ID and action name.
- * \param actionName Action name in the form ActorObjectId,Action
- * \return pair of actor object ID and action name
-*/
-std::pair<uint32_t, std::string> EsminiAdapter::parseAction(const std::string& actionName)
+ * \brief Sets up the table of the latest MONR pose of each scenario object, and starts
+ *		a thread which steps esmini at the configured rate, reporting these poses before
+ *		each step. No thread is started if esmini is configured to step on each MONR.
+ */
+void EsminiAdapter::startSimulationClock()
 {
-	std::vector<std::string> res;
-	split(actionName, ',', res);
-	if (res.size() < 2){
-		throw std::runtime_error("Action name " + actionName + "  is not of the form ActorObjectId,Action");
+	// The slots are fixed while the scenario runs, so MONR callbacks, storyboard
+	// callbacks and the clock thread can look them up without locking
+	idToPoseSlot.clear();
+	poseSlotToEsminiId.clear();
+	for (const auto& [atosId, esminiId] : ATOStoEsminiObjectId) {
+		idToPoseSlot[atosId] = poseSlotToEsminiId.size();
+		poseSlotToEsminiId.push_back(esminiId);
+	}
+	reportedPoses.reset(poseSlotToEsminiId.size());
+	if (simulationStepPeriod == std::chrono::nanoseconds::zero()) {
+		return;
+	}
+	stopSimulationClockSignal = std::promise<void>();
+	simulationClockThread = std::thread(&EsminiAdapter::simulationClock, this,
+										stopSimulationClockSignal.get_future().share());
+}
+
+void EsminiAdapter::stopSimulationClock()
+{
+	if (simulationClockThread.joinable()) {
+		stopSimulationClockSignal.set_value();
+		simulationClockThread.join();
+		idToPoseSlot.clear();
 	}
-	return {std::stoul(res[0]), res[1]};
 }
 
 /*!
- * \brief Check if action is a start action.
- * \param action Action name
- * \return true if action is a start action, false otherwise
-*/
-bool EsminiAdapter::isStartAction(const std::string& action)
+ * \brief Steps esmini by the step period at absolute deadlines, so that scenario time and
+ *		trigger timing are independent of how many objects send MONR and when they arrive.
+ *		If a step overruns by whole periods, these are merged into the next step instead of
+ *		being caught up with a burst of steps, which keeps scenario time in line with real time.
+ * \param stopRequest Future which becomes ready when the clock should stop
+ */
+void EsminiAdapter::simulationClock(std::shared_future<void> stopRequest)
 {
-	return std::regex_search(action, std::regex("^(begin|start)", std::regex_constants::icase));
+	using namespace std::chrono;
+	using clock = steady_clock;
+	SimulationClockStatistics statistics;
+	ObjectPoseTable::Pose pose;
+	nanoseconds stepDuration = simulationStepPeriod;
+
+	RCLCPP_INFO(get_logger(), "Stepping esmini every %.1f ms", duration<double, std::milli>(simulationStepPeriod).count());
+	clock::time_point deadline = clock::now() + simulationStepPeriod;
+	while (stopRequest.wait_until(deadline) == std::future_status::timeout) {
+		const auto stepStart = clock::now();
+		for (std::size_t slot = 0; slot < reportedPoses.size(); ++slot) {
+			if (reportedPoses.load(slot, pose)) {
+				reportObjectPose(poseSlotToEsminiId[slot], pose);
+			}
+		}
+		SE_StepDT(static_cast<float>(duration<double>(stepDuration).count()));
+		const auto stepEnd = clock::now();
+
+		const auto elapsed = duration_cast<nanoseconds>(stepEnd - stepStart);
+		statistics.nSteps++;
+		statistics.nOverruns += elapsed > simulationStepPeriod ? 1 : 0;
+		statistics.maxStepDuration = std::max(statistics.maxStepDuration, elapsed);
+		statistics.totalStepDuration += elapsed;
+
+		deadline += simulationStepPeriod;
+		stepDuration = simulationStepPeriod;
+		auto overrun = stepEnd - deadline;
+		if (overrun >= simulationStepPeriod) {
+			auto nSkipped = overrun / simulationStepPeriod;
+			deadline += nSkipped * simulationStepPeriod;
+			stepDuration += nSkipped * simulationStepPeriod;
+			statistics.nSkippedPeriods += static_cast<uint64_t>(nSkipped);
+			RCLCPP_WARN(get_logger(), "Esmini step overran by %ld ms, merging %ld periods into the next step",
+						duration_cast<milliseconds>(overrun).count(), static_cast<long>(nSkipped));
+		}
+	}
+
+	if (statistics.nSteps > 0) {
+		RCLCPP_INFO(get_logger(), "Stepped esmini %lu times: mean step %.3f ms, max %.3f ms of a %.3f ms period, "
+					"%lu overruns, %lu periods merged",
+					statistics.nSteps,
+					duration<double, std::milli>(statistics.totalStepDuration).count() / statistics.nSteps,
+					duration<double, std::milli>(statistics.maxStepDuration).count(),
+					duration<double, std::milli>(simulationStepPeriod).count(),
+					statistics.nOverruns, statistics.nSkippedPeriods);
+	}
 }
 
 /*!
@@ -250,30 +321,6 @@ bool EsminiAdapter::isSendDenmAction(const std::string& action)
 	return std::regex_search(action, std::regex("denm", std::regex_constants::icase));
 }
 
-/*!
- * \brief Add delayed start to object state if start action occurred.
- * \param name Name of the StoryBoardElement whose state has changed.
- * \param type Possible values: STORY = 1, ACT = 2, MANEUVER_GROUP = 3, MANEUVER = 4, EVENT = 5, ACTION = 6, UNDEFINED_ELEMENT_TYPE = 0.
- * \param state new state, possible values: STANDBY = 1, RUNNING = 2, COMPLETE = 3, UNDEFINED_ELEMENT_STATE = 0.
- */
-void EsminiAdapter::collectStartAction(
-	const char* name,
-	int type,
-	int state)
-{
-	if (type != 6 || state != 2) { return; } // Only handle actions that are started
-	try {
-		auto [objectId, action] = parseAction(name);
-		if (isStartAction(action)) {
-			delayedStartIds.push_back(objectId);
-		}
-	}
-	catch (std::exception& e) {
-		RCLCPP_WARN(me->get_logger(), e.what());
-		return;
-	}
-}
-
 /*!
  * \brief Callback to be executed by esmini when story board state changes.
  * 		If story board element is an action, and the action is supported, the action is run.
@@ -311,8 +358,8 @@ void EsminiAdapter::handleActionElementStateChange(
 {
 	try
 	{
-		auto [objectId, action] = parseAction(name);
-		if (isStartAction(action) && state == 2) {
+		auto [objectId, action] = ScenarioExtractor::parseAction(name);
+		if (ScenarioExtractor::isStartAction(action) && state == 2) {
 			RCLCPP_INFO(me->get_logger(), "Running start action for object %d", objectId);
 			ROSChannels::StartObject::message_type startObjectMsg;
 			startObjectMsg.id = objectId;
@@ -320,12 +367,23 @@ void EsminiAdapter::handleActionElementStateChange(
 			me->startObjectPub.publish(startObjectMsg);
 		}
 		else if (isSendDenmAction(action) && state == 3) {
-			// Get the latest Monitor message
 			RCLCPP_INFO(me->get_logger(), "Running send DENM action triggered by object %d", objectId);
-			ROSChannels::Monitor::message_type monr;
-			rclcpp::wait_for_message(monr, me, std::string(me->get_namespace()) + "/object_" + std::to_string(objectId) + "/object_monitor", 10ms);
+			// Use the latest MONR pose, without waiting, since this runs within the esmini step
+			ObjectPoseTable::Pose pose;
+			auto slot = me->idToPoseSlot.find(objectId);
+			if (slot == me->idToPoseSlot.end() || !me->reportedPoses.load(slot->second, pose)) {
+				RCLCPP_WARN(me->get_logger(), "No position received from object %d, not sending DENM", objectId);
+				return;
+			}
+			geometry_msgs::msg::Point position;
+			position.x = pose.x_m;
+			position.y = pose.y_m;
+			position.z = pose.z_m;
+			if (me->applyTrajTransform) {
+				me->crsTransformation->apply(position, PJ_FWD);
+			}
 			double llh[3] = {me->testOrigin.position.latitude, me->testOrigin.position.longitude, me->testOrigin.position.altitude};
-			double offset[3] = {monr.pose.pose.position.x, monr.pose.pose.position.y, monr.pose.pose.position.z};
+			double offset[3] = {position.x, position.y, position.z};
 			CRSTransformation::llhOffsetMeters(llh, offset);
 			me->v2xPub.publish(denmFromTestOrigin(llh));
 		}
@@ -354,273 +412,68 @@ ROSChannels::V2X::message_type EsminiAdapter::denmFromTestOrigin(double *llh) {
 }
 
 /*!
- * \brief Utility function to convert a ROS MONR message to Esmini representation
- *			and report the object position to Esmini
+ * \brief Converts a ROS MONR message to the pose representation of Esmini
  * \param monr ROS Monitor message of an object
- * \param id The object ID to which the monr belongs
+ * \return Pose in the coordinate system of the scenario
  */
-void EsminiAdapter::reportObjectPosition(const Monitor::message_type::SharedPtr monr, uint32_t esminiObjectId){
-	// Conversions from ROS to Esmini
-	auto ori = monr->pose.pose.orientation;
+ObjectPoseTable::Pose EsminiAdapter::poseFromMonitor(const Monitor::message_type& monr){
+	ObjectPoseTable::Pose pose;
+	auto ori = monr.pose.pose.orientation;
 	auto quat = tf2::Quaternion(ori.x, ori.y, ori.z, ori.w);
 	tf2::Matrix3x3 m(quat);
-	double roll, pitch, yaw;
-	m.getRPY(roll, pitch, yaw);
+	m.getRPY(pose.roll_rad, pose.pitch_rad, pose.yaw_rad);
 
-	geometry_msgs::msg::Point pos = monr->pose.pose.position;
+	geometry_msgs::msg::Point pos = monr.pose.pose.position;
 	if (me->applyTrajTransform) {
 		me->crsTransformation->apply(pos, PJ_INV);
 	}
-	auto speed = monr->velocity.twist.linear;
+	pose.x_m = pos.x;
+	pose.y_m = pos.y;
+	pose.z_m = pos.z;
+	pose.speed_m_s = monr.velocity.twist.linear.x;
+	return pose;
+}
 
-	// Reporting to Esmini
+/*!
+ * \brief Reports the pose of an object to Esmini
+ * \param esminiObjectId Esmini ID of the object
+ * \param pose Pose in the coordinate system of the scenario
+ */
+void EsminiAdapter::reportObjectPose(const int esminiObjectId, const ObjectPoseTable::Pose& pose){
 	int timestamp = 0; // Not really used according to esmini documentation
-	SE_ReportObjectPos(esminiObjectId, timestamp, pos.x, pos.y, pos.z, yaw, pitch, roll);
-	SE_ReportObjectSpeed(esminiObjectId, speed.x);
+	SE_ReportObjectPos(esminiObjectId, timestamp, pose.x_m, pose.y_m, pose.z_m, pose.yaw_rad, pose.pitch_rad, pose.roll_rad);
+	SE_ReportObjectSpeed(esminiObjectId, pose.speed_m_s);
 }
 
 /*!
- * \brief Callback for MONR messages, reports the object position to esmini and advances the simulation time
+ * \brief Callback for MONR messages. If esmini is stepped at a fixed rate, stores the object pose
+ *		for the next step, otherwise reports the object position to esmini and advances the simulation time
  * \param monr ROS Monitor message of an object
  * \param id The object ID to which the monr belongs
 */
 void EsminiAdapter::onMonitorMessage(const Monitor::message_type::SharedPtr monr, uint32_t ATOSObjectId) {
-	if (me->ATOStoEsminiObjectId.find(ATOSObjectId) != me->ATOStoEsminiObjectId.end()){
-		auto esminiObjectId = me->ATOStoEsminiObjectId[ATOSObjectId];
-		reportObjectPosition(monr, esminiObjectId); // Report object position to esmini
-		SE_Step(); // Advance the "simulation world"-time
-	}
-	else{
-		RCLCPP_WARN(me->get_logger(), "Received MONR message for object with ATOS Object ID %d, but no such object exists in the scenario", ATOSObjectId);
-	}
-}
-
-/*!
- * \brief Given a vector of object states at different timesteps,
- *	creates a trajectory consisting of trajectory points, one for each timestep.
- * Note: If there is no difference between consecutive states, the trajectory point is not added.
- * \param id The object ID to which the trajectory belongs
- * \param states A vector of object states
- * \return A trajectory consisting of trajectory points, one for each state.
- */
-ATOS::Trajectory EsminiAdapter::getTrajectoryFromObjectState(
-	uint32_t id,
-	std::vector<SE_ScenarioObjectState>& states)
-{
-	ATOS::Trajectory trajectory(me->get_logger());
-	trajectory.name = "Esmini Trajectory for object " + std::to_string(id);
-	if (states.empty()) {
-		return trajectory;
-	}
-
-	RCLCPP_DEBUG(me->get_logger(), "Creating trajectory for object %d", id);
-	auto saveTp = [&](auto& state, auto& prevState) {
-		ATOS::Trajectory::TrajectoryPoint tp(me->get_logger());
-		double currLonVel = state.speed * cos(state.wheel_angle);
-		double currLatVel = state.speed * sin(state.wheel_angle);
-		double prevLonVel = prevState.speed * cos(prevState.wheel_angle);
-		double prevLatVel = prevState.speed * sin(prevState.wheel_angle);
-
-		tp.setXCoord(state.x);
-		tp.setYCoord(state.y);
-		tp.setZCoord(state.z);
-		tp.setHeading(state.h);
-		tp.setTime(state.timestamp);
-		tp.setCurvature(0); // TODO: implement support for different curvature, now only support straight lines
-		tp.setLongitudinalVelocity(currLonVel);
-		tp.setLateralVelocity(currLatVel);
-		if (state.timestamp != prevState.timestamp) {
-			tp.setLongitudinalAcceleration((currLonVel - prevLonVel) / (state.timestamp - prevState.timestamp));
-			tp.setLateralAcceleration((currLatVel - prevLatVel) / (state.timestamp - prevState.timestamp));
-		}
-		else {
-			tp.setLongitudinalAcceleration(0);
-			tp.setLateralAcceleration(0);
+	if (me->simulationStepPeriod != std::chrono::nanoseconds::zero()) {
+		auto slot = me->idToPoseSlot.find(ATOSObjectId);
+		if (slot != me->idToPoseSlot.end()) {
+			me->reportedPoses.store(slot->second, poseFromMonitor(*monr));
 		}
-
-		trajectory.points.push_back(tp);
-	};
-
-	if (states.size() > 1) {
-		for (auto it = states.begin()+1; it != states.end(); ++it) {
-			if (it->x == (it-1)->x && it->y == (it-1)->y && // Nothing interesting happens within 1 timestep, skip
-				it->z == (it-1)->z && it->h == (it-1)->h) {
-				continue;
-			}
-			saveTp(*it,*(it-1)); // Next timestep is different, save current one.
+		else if (me->ATOStoEsminiObjectId.find(ATOSObjectId) == me->ATOStoEsminiObjectId.end()) {
+			RCLCPP_WARN(me->get_logger(), "Received MONR message for object with ATOS Object ID %d, but no such object exists in the scenario", ATOSObjectId);
 		}
 	}
-	if (trajectory.points.size() == 0) {
-		saveTp(states.front(), states.front()); // Only one state or no points, save it.
-	}
-	auto startTime = trajectory.points.front().getTime();
-
-	// Subtract start time from all timesteps
-	for (auto& tp : trajectory.points){
-		tp.setTime(tp.getTime() - startTime);
-	}
-	return trajectory;
-}
-
-/*!
- * \brief Given a RM_georeference converts into a proj string
- * \param geoRef The geo reference to convert
- * \return The proj string
- */
-std::string EsminiAdapter::projStrFromGeoReference(RM_GeoReference& geoRef) {
-	std::string projStringFrom = "+proj=";
-	if (strlen(geoRef.proj_) != 0) {
-		projStringFrom += std::string(geoRef.proj_) + " ";
-	}
-	else {
-		throw std::runtime_error("No projection found in geo reference");
-	}
-	if (!std::isnan(geoRef.lat_0_)) {
-		projStringFrom += "+lat_0=" + std::to_string(geoRef.lat_0_) + " ";
-	}
-	if (!std::isnan(geoRef.lon_0_)) {
-		projStringFrom += "+lon_0=" + std::to_string(geoRef.lon_0_) + " ";
-	}
-	if (!std::isnan(geoRef.k_)) {
-		projStringFrom += "+k=" + std::to_string(geoRef.k_) + " ";
-	}
-	if (!std::isnan(geoRef.k_0_)) {
-		projStringFrom += "+k_0=" + std::to_string(geoRef.k_0_) + " ";
-	}
-	if (!std::isnan(geoRef.x_0_)) {
-		projStringFrom += "+x_0=" + std::to_string(geoRef.x_0_) + " ";
-	}
-	if (!std::isnan(geoRef.y_0_)) {
-		projStringFrom += "+y_0=" + std::to_string(geoRef.y_0_) + " ";
-	}
-	if (strlen(geoRef.ellps_) != 0) {
-		projStringFrom += "+ellps=" + std::string(geoRef.ellps_) + " ";
-	}
-	if (strlen(geoRef.units_) != 0) {
-		projStringFrom += "+units=" + std::string(geoRef.units_) + " ";
-	}
-	if (strlen(geoRef.vunits_) != 0) {
-		projStringFrom += "+vunits=" + std::string(geoRef.vunits_) + " ";
-	}
-	if (strlen(geoRef.datum_) != 0) {
-		projStringFrom += "+datum=" + std::string(geoRef.datum_) + " ";
-	}
-	if (strlen(geoRef.geo_id_grids_) != 0) {
-		projStringFrom += "+geoidgrids=" + std::string(geoRef.geo_id_grids_) + " ";
-	}
-	if (!std::isnan(geoRef.zone_)) {
-		projStringFrom += "+zone=" + std::to_string(geoRef.zone_) + " ";
-	}
-	if (geoRef.towgs84_ != 0) {
-		projStringFrom += "+towgs84=" + std::to_string(geoRef.towgs84_) + " ";
-	}
-	if (strlen(geoRef.axis_) != 0) {
-		projStringFrom += "+axis=" + std::string(geoRef.axis_) + " ";
-	}
-	if (!std::isnan(geoRef.lon_wrap_)) {
-		projStringFrom += "+lon_wrap=" + std::to_string(geoRef.lon_wrap_) + " ";
-	}
-	if (!std::isnan(geoRef.over_)) {
-		projStringFrom += "+over=" + std::to_string(geoRef.over_) + " ";
-	}
-	if (strlen(geoRef.pm_) != 0) {
-		projStringFrom += "+pm=" + std::string(geoRef.pm_) + " ";
-	}
-	projStringFrom += "+no_defs";
-	RCLCPP_DEBUG(me->get_logger(), "Created proj string: %s", projStringFrom.c_str());
-	return projStringFrom;
-}
-
-/*!
- * \brief Returns object states for each timestep by simulating the loaded scenario.
- *  The simulation is stopped if there is no vehicle movement and at least 
- * 	MIN_SCENARIO_TIME has passed or if more than MAX_SCENARIO_TIME has passed.
- *	Inspired by ScenarioGateway::WriteStatesToFile from esmini lib.
- *  
- * \param timeStep Time step to use for generating the trajectories
- * \param endTime End time of the simulation
- * \param states The return map of ids mapping to the respective object states at different timesteps
- * \return A map of object states, where the key is the object ID and the value is a vector of states
- */
-void EsminiAdapter::getObjectStates(
-	double timeStep,
-	std::map<uint32_t,std::vector<SE_ScenarioObjectState>>& states)
-{
-	double accumTime = 0.0;
-	auto pushCurrentState = [&](auto& st, auto& index) {
-		auto id = SE_GetId(index);
-		//SE_SetAlignModeZ(id, 0); // Disable Z-alignment, not implemented in esmini yet
-		SE_ScenarioObjectState s;
-		SE_GetObjectState(id, &s);
-		s.timestamp = accumTime;
-		st.at(std::stoi(SE_GetObjectName(id))).push_back(s);
-	};
-
-	// Populate States map with vector for each object containing the initial state
-	SE_StepDT(timeStep);
-	accumTime += timeStep;
-	for (int j = 0; j < SE_GetNumberOfObjects(); j++){
-		states[std::stoi(SE_GetObjectName(SE_GetId(j)))] = std::vector<SE_ScenarioObjectState>();
-		pushCurrentState(states, j);
-	}
-	constexpr double MIN_SCENARIO_TIME = 10.0;
-	constexpr double MAX_SCENARIO_TIME = 3600.0;
-	bool stopSimulation = false;
-	while (!stopSimulation) {
-		if (SE_GetQuitFlag() != 0) {
-			break;
-		}
-		
-		SE_StepDT(timeStep);
-		accumTime += timeStep;
-		for (int j = 0; j < SE_GetNumberOfObjects(); j++){
-			pushCurrentState(states, j);
+	else if (me->ATOStoEsminiObjectId.find(ATOSObjectId) != me->ATOStoEsminiObjectId.end()){
+		auto esminiObjectId = me->ATOStoEsminiObjectId[ATOSObjectId];
+		auto pose = poseFromMonitor(*monr);
+		auto slot = me->idToPoseSlot.find(ATOSObjectId);
+		if (slot != me->idToPoseSlot.end()) {
+			me->reportedPoses.store(slot->second, pose); // Read by storyboard actions
 		}
-		bool noMovement = std::all_of(states.begin(), states.end(), [&](auto& pair) {
-			return pair.second.back().speed < 0.1;
-		});
-		bool atLeastMinTimePassed = accumTime > MIN_SCENARIO_TIME;
-		bool moreThanMaxTimePassed = accumTime > MAX_SCENARIO_TIME;
-		stopSimulation = (noMovement && atLeastMinTimePassed) || moreThanMaxTimePassed;
-	}
-	if (accumTime > MAX_SCENARIO_TIME) {
-		RCLCPP_WARN(me->get_logger(), "Scenario time limit reached, stopping simulation");
-	}
-	else if (accumTime < MIN_SCENARIO_TIME + timeStep) {
-		RCLCPP_WARN(me->get_logger(), "Ran scenario for the minimum time %.2f, possibly no movement in scenario", MIN_SCENARIO_TIME);
+		reportObjectPose(esminiObjectId, pose); // Report object position to esmini
+		SE_Step(); // Advance the "simulation world"-time
 	}
-	RCLCPP_INFO(me->get_logger(), "Finished %f s simulation", accumTime);
-}
-
-
-/*!
- * \brief Runs the esmini simulator with the xosc file and returns the trajectories for each object
- * \param timeStep Time step to use for generating the trajectories
- * \param endTime End time of the simulation TODO: not nessescary if xosc has a stop trigger at the end of the scenario
- * \param idToTraj The return map of ids mapping to the respective trajectories
- * \return A map of ids mapping to the respective trajectories
- */
-std::map<uint32_t,ATOS::Trajectory> EsminiAdapter::extractTrajectories(
-	double timeStep,
-	std::map<uint32_t,ATOS::Trajectory>& idToTraj)
-{
-	// Get object states
-	std::map<uint32_t,std::vector<SE_ScenarioObjectState>> idToStates;
-	getObjectStates(timeStep, idToStates);
-
-	// Extract trajectories
-	for (auto& os : idToStates) {
-		auto id = os.first;
-		auto objectStates = os.second;
-		auto traj = getTrajectoryFromObjectState(id, objectStates);
-		// Apply CRS transform if OpenDrive CRS Transformation is defined
-		if (me->applyTrajTransform){
-			RCLCPP_DEBUG(me->get_logger(), "Applying CRS transformation to trajectory for object %d", id);
-			me->crsTransformation->apply(traj.points);
-		}
-		idToTraj.insert(std::pair<uint32_t,ATOS::Trajectory>(id, traj));
+	else{
+		RCLCPP_WARN(me->get_logger(), "Received MONR message for object with ATOS Object ID %d, but no such object exists in the scenario", ATOSObjectId);
 	}
-	return idToTraj;
 }
 
 /*!
@@ -640,77 +493,79 @@ void EsminiAdapter::InitializeEsmini()
 	SE_Close(); // Stop ScenarioEngine in case it is running
 	RM_Close(); // Stop RoadManager in case it is running
 
-	RCLCPP_INFO(me->get_logger(), "Initializing esmini with scenario file %s", me->oscFilePath.c_str());
-	if (SE_Init(me->oscFilePath.c_str(),1,0,0,0) < 0) { // Disable controllers, let DefaultController be used
-		throw std::runtime_error("Failed to initialize esmini with scenario file " + me->oscFilePath.string() + ". For more information, see " + logFilePath + ".");
+	ScenarioExtractor extractor(me->get_logger());
+	try {
+		extractor.load(me->oscFilePath);
 	}
-	auto odrFile = getOpenDriveFile();
-	if (RM_Init(odrFile.c_str()) < 0) {
-		throw std::runtime_error(std::string("Failed to initialize with odr file ").append(odrFile));
+	catch (std::runtime_error& e) {
+		throw std::runtime_error(std::string(e.what()) + ". For more information, see " + logFilePath + ".");
 	}
 
-	
-	// Call RM_GetOpenDriveGeoReference to get the RM_GeoReference struct
-	RM_GeoReference geoRef;
-	if (RM_GetOpenDriveGeoReference(&geoRef) == 0) {
-		try {
-			std::string projStringFrom = projStrFromGeoReference(geoRef);
-			std::string toDatum = "WGS84";
-			auto llh_0 = CRSTransformation::projToLLH(projStringFrom, toDatum);
-			RCLCPP_INFO(me->get_logger(), "llh origin: %lf, %lf, %lf", llh_0[0], llh_0[1], llh_0[2]);
+	try {
+		if (extractor.applyGeoReference()) {
+			auto llh_0 = extractor.origin();
 			me->testOrigin.position.latitude = llh_0[0];
 			me->testOrigin.position.longitude = llh_0[1];
 			me->testOrigin.position.altitude = llh_0[2];
 			me->testOriginSet = true;
-
-			std::string projStringTo = "+proj=tmerc +lat_0=" + std::to_string(llh_0[0]) + 
-													" +lon_0=" + std::to_string(llh_0[1]) + 
-													" +datum="+ toDatum + " +units=m +no_defs";
-
-			me->crsTransformation = std::make_shared<CRSTransformation>(projStringFrom, projStringTo);
+			me->crsTransformation = extractor.transformation();
 			me->applyTrajTransform = true;
-		} 
-		catch (std::exception& e) {
-			RCLCPP_ERROR(me->get_logger(), e.what());
-			return;
 		}
-	} else {
-		RCLCPP_WARN(me->get_logger(), "Failed to get OpenDRIVE geo reference from RoadManager");
 	}
-	RM_Close();
-	
-	for (int j = 0; j < SE_GetNumberOfObjects(); j++){
-		//SE_SetAlignModeZ(SE_GetId(j), 0); // Disable Z-alignment not implemented in esmini yet
+	catch (std::exception& e) {
+		RCLCPP_ERROR(me->get_logger(), e.what());
+		return;
 	}
-	// Register callbacks to figure out what actions need to be taken
-	SE_RegisterStoryBoardElementStateChangeCallback(&collectStartAction);
 
-	RCLCPP_INFO(me->get_logger(), "Starting extracting trajs");
-	double timeStep = 0.1;
-	me->extractTrajectories(timeStep, me->idToTraj);
-	RCLCPP_INFO(me->get_logger(), "Done extracting trajs");
-
-
-	RCLCPP_INFO(me->get_logger(), "Extracted %ld trajectories", me->idToTraj.size());
-	RCLCPP_INFO(me->get_logger(), "Number of objects with triggered start: %ld", me->delayedStartIds.size());
-
-	// Find object IPs as defined in VehicleCatalog file
-	for (int j = 0; j < SE_GetNumberOfObjects(); j++){
-		auto id = std::stoi(SE_GetObjectName(SE_GetId(j)));
-		auto ip = SE_GetObjectPropertyValue(j, "ip");
-		if (ip != nullptr){
-			me->idToIp[id] = std::string(ip);
+	double timeStep = ScenarioExtractor::DEFAULT_TIME_STEP;
+	std::string cacheKey;
+	TrajectoryCache::Entry extracted;
+	if (me->trajectoryCache) {
+		try {
+			cacheKey = extractor.cacheKey(timeStep);
+		}
+		catch (std::exception& e) {
+			RCLCPP_WARN(me->get_logger(), "Not using trajectory cache: %s", e.what());
 		}
 	}
-
-
-	// Populate the map tracking Object ID -> esmini index
-	for (int j = 0; j < SE_GetNumberOfObjects(); j++){
-		me->ATOStoEsminiObjectId[std::stoi(SE_GetObjectName(SE_GetId(j)))] = SE_GetId(j);
+	if (!cacheKey.empty() && me->trajectoryCache->load(cacheKey, extracted)) {
+		extractor.close();
+		RCLCPP_INFO(me->get_logger(), "Loaded %ld trajectories from trajectory cache entry %s",
+					extracted.trajectories.size(), cacheKey.c_str());
+		RCLCPP_INFO(me->get_logger(), "Number of objects with triggered start: %ld", extracted.delayedStartIds.size());
+	}
+	else {
+		extracted = extractor.extract(timeStep);
+		if (!cacheKey.empty()) {
+			try {
+				me->trajectoryCache->store(cacheKey, extracted);
+			}
+			catch (std::exception& e) {
+				RCLCPP_WARN(me->get_logger(), "Failed to store trajectory cache entry %s: %s", cacheKey.c_str(), e.what());
+			}
+		}
 	}
-	SE_Close(); // Stop ScenarioEngine
+	me->idToTraj = std::move(extracted.trajectories);
+	me->delayedStartIds = std::move(extracted.delayedStartIds);
+	me->idToIp = std::move(extracted.ips);
+	me->ATOStoEsminiObjectId = std::move(extracted.esminiIds);
 
-	RCLCPP_DEBUG(me->get_logger(), "Extracted trajectories");
+	if (me->simplifyTrajectories) {
+		for (auto& [id, traj] : me->idToTraj) {
+			ATOS::Trajectory::SimplificationResult result;
+			try {
+				traj = traj.simplified(me->simplificationTolerances, &result);
+			}
+			catch (std::invalid_argument& e) {
+				RCLCPP_WARN(me->get_logger(), "Not simplifying trajectory for object %d: %s", id, e.what());
+				continue;
+			}
+			RCLCPP_INFO(me->get_logger(), "Simplified trajectory for object %d from %ld to %ld points "
+						"(ratio %.1f, max deviation %.3f m, %.4f rad, %.3f m/s)", id, result.inputPoints,
+						result.outputPoints, result.compressionRatio(), result.maxPositionDeviation_m,
+						result.maxHeadingDeviation_rad, result.maxVelocityDeviation_m_s);
+		}
+	}
 
 	for (auto& it : me->idToTraj) {
 		auto id = it.first;
@@ -759,6 +614,28 @@ void EsminiAdapter::onRequestTestOrigin(
 }
 
 
+void EsminiAdapter::onRequestClearTrajectoryCache(
+	const std::shared_ptr<ClearCacheSrv::Request>,
+	std::shared_ptr<ClearCacheSrv::Response> res)
+{
+	if (!me->trajectoryCache) {
+		res->success = false;
+		res->message = "Trajectory cache is disabled";
+		return;
+	}
+	try {
+		auto nRemoved = me->trajectoryCache->clear();
+		res->success = true;
+		res->message = "Removed " + std::to_string(nRemoved) + " trajectory cache entries";
+		RCLCPP_INFO(me->get_logger(), "%s", res->message.c_str());
+	}
+	catch (std::exception& e) {
+		res->success = false;
+		res->message = e.what();
+		RCLCPP_ERROR(me->get_logger(), "Failed to clear trajectory cache: %s", e.what());
+	}
+}
+
 void EsminiAdapter::onRequestObjectStartOnTrigger(
 	const std::shared_ptr<ObjectTriggerSrv::Request> req,
 	std::shared_ptr<ObjectTriggerSrv::Response> res)
@@ -804,6 +681,8 @@ int EsminiAdapter::initializeModule() {
 		std::bind(&EsminiAdapter::onRequestObjectTrajectory, _1, _2));
 	me->testOriginService = me->create_service<atos_interfaces::srv::GetTestOrigin>(ServiceNames::getTestOrigin,
 		std::bind(&EsminiAdapter::onRequestTestOrigin, _1, _2));
+	me->clearTrajectoryCacheService = me->create_service<ClearCacheSrv>(ServiceNames::clearTrajectoryCache,
+		std::bind(&EsminiAdapter::onRequestClearTrajectoryCache, _1, _2));
 
 	return retval;
 }
\ No newline at end of file
@@ -0,0 +1,265 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <system_error>
+#include <thread>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <rclcpp/logging.hpp>
+#include "batchoptions.hpp"
+#include "scenarioextractor.hpp"
+#include "trajectorycache.hpp"
+#include "util.h"
+
+namespace fs = std::filesystem;
+
+/*!
+ * \brief Extracts the trajectories of many OpenSCENARIO files, or of one scenario
+ *			over sweeps of its parameters, into the trajectory cache of the esmini
+ *			adapter. esmini can only run one scenario per process, so each scenario
+ *			is extracted in a worker process of its own, running as many workers at
+ *			a time as there are cores.
+ */
+
+namespace {
+typedef struct {
+	fs::path oscFile;
+	ScenarioExtractor::ParameterValues parameters;
+} Job;
+
+typedef struct {
+	std::size_t nSucceeded = 0;
+	std::size_t nFailed = 0;
+	std::chrono::duration<double> wallTime = std::chrono::duration<double>::zero();
+} BatchResult;
+
+void printUsage(const char* program) {
+	std::cerr << "Usage: " << program << " [options] <scenario.xosc>..." << std::endl
+			  << "Extracts the trajectories of the scenarios into the esmini adapter trajectory cache." << std::endl
+			  << "Options:" << std::endl
+			  << "  -j, --jobs <n>            Number of worker processes, one per core by default, at most " << BatchOptions::MAX_JOBS << std::endl
+			  << "  -p, --param <name>=<v,..> Extract each scenario for each of the values of a parameter." << std::endl
+			  << "                            Repeat for more parameters to extract every combination." << std::endl
+			  << "  -c, --cache <directory>   Cache directory, the esmini adapter cache by default" << std::endl
+			  << "  -t, --time-step <s>       Simulation time step, " << ScenarioExtractor::DEFAULT_TIME_STEP
+			  << " s by default" << std::endl
+			  << "  -s, --scaling             Run the batch with 1, 2, 4 ... up to the number of jobs" << std::endl
+			  << "                            workers and report the wall time of each" << std::endl;
+}
+
+std::string describe(const Job& job) {
+	std::string description = job.oscFile.filename().string();
+	for (const auto& [name, value] : job.parameters) {
+		description += " " + name + "=" + value;
+	}
+	return description;
+}
+
+/*!
+ * \brief Extracts one scenario into the cache. Runs in a worker process.
+ * \return Exit status of the worker
+ */
+int runJob(const Job& job, const std::size_t worker, const fs::path& cacheDirectory, const double timeStep) {
+	auto logger = rclcpp::get_logger("esmini_batch");
+	auto logFilePath = std::string(getenv("HOME")) + "/.astazero/ATOS/logs/esmini_batch_" + std::to_string(worker) + ".log";
+	SE_SetLogFilePath(logFilePath.c_str());
+	try {
+		auto start = std::chrono::steady_clock::now();
+		ScenarioExtractor extractor(logger);
+		extractor.load(job.oscFile, job.parameters);
+		extractor.applyGeoReference();
+		auto key = extractor.cacheKey(timeStep);
+		auto entry = extractor.extract(timeStep);
+		TrajectoryCache(cacheDirectory, logger).store(key, entry);
+		std::size_t nPoints = 0;
+		for (const auto& it : entry.trajectories) {
+			nPoints += it.second.size();
+		}
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		std::ostringstream line;
+		line << describe(job) << ": " << entry.trajectories.size() << " objects, " << nPoints
+			 << " points in " << elapsed.count() << " s, entry " << key << std::endl;
+		std::cout << line.str() << std::flush;
+	}
+	catch (std::exception& e) {
+		std::cerr << "Extraction of " << describe(job) << " failed: " << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+/*!
+ * \brief Runs each job in a worker process of its own, with at most nWorkers at a time
+ */
+BatchResult runBatch(const std::vector<Job>& jobs, const std::size_t nWorkers,
+					 const fs::path& cacheDirectory, const double timeStep) {
+	BatchResult result;
+	std::map<pid_t, std::size_t> running;	//!< Worker process to worker slot
+	std::vector<bool> slotBusy(nWorkers, false);
+	std::size_t next = 0;
+	auto start = std::chrono::steady_clock::now();
+	while (next < jobs.size() || !running.empty()) {
+		while (running.size() < nWorkers && next < jobs.size()) {
+			auto slot = static_cast<std::size_t>(std::find(slotBusy.begin(), slotBusy.end(), false) - slotBusy.begin());
+			std::cout.flush();
+			std::cerr.flush();
+			pid_t pid = fork();
+			if (pid < 0) {
+				throw std::system_error(errno, std::generic_category(), "Failed to start worker process");
+			}
+			if (pid == 0) {
+				_exit(runJob(jobs[next], slot, cacheDirectory, timeStep));
+			}
+			running[pid] = slot;
+			slotBusy[slot] = true;
+			++next;
+		}
+		int status;
+		pid_t pid = waitpid(-1, &status, 0);
+		if (pid < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			throw std::system_error(errno, std::generic_category(), "Failed to wait for worker process");
+		}
+		auto it = running.find(pid);
+		if (it == running.end()) {
+			continue;
+		}
+		if (WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS) {
+			++result.nSucceeded;
+		}
+		else {
+			if (WIFSIGNALED(status)) {
+				std::cerr << "Worker process " << pid << " terminated by signal " << WTERMSIG(status) << std::endl;
+			}
+			++result.nFailed;
+		}
+		slotBusy[it->second] = false;
+		running.erase(it);
+	}
+	result.wallTime = std::chrono::steady_clock::now() - start;
+	return result;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+	std::size_t nJobs = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<BatchOptions::ParameterSweep> sweeps;
+	char path[MAX_FILE_PATH];
+	UtilGetTestDirectoryPath(path, MAX_FILE_PATH);
+	fs::path cacheDirectory = std::string(path) + "cache/esmini";
+	double timeStep = ScenarioExtractor::DEFAULT_TIME_STEP;
+	bool scaling = false;
+	std::vector<fs::path> scenarios;
+
+	try {
+		for (int i = 1; i < argc; ++i) {
+			const std::string arg = argv[i];
+			auto value = [&]() -> std::string {
+				if (i + 1 >= argc) {
+					throw std::invalid_argument("Missing value for " + arg);
+				}
+				return argv[++i];
+			};
+			if (arg == "-j" || arg == "--jobs") {
+				nJobs = BatchOptions::parseJobCount(value());
+			}
+			else if (arg == "-p" || arg == "--param") {
+				sweeps.push_back(BatchOptions::parseParameterSweep(value()));
+			}
+			else if (arg == "-c" || arg == "--cache") {
+				cacheDirectory = value();
+			}
+			else if (arg == "-t" || arg == "--time-step") {
+				timeStep = std::stod(value());
+				if (!(timeStep > 0.0)) {
+					throw std::invalid_argument("Time step must be positive");
+				}
+			}
+			else if (arg == "-s" || arg == "--scaling") {
+				scaling = true;
+			}
+			else if (arg == "-h" || arg == "--help") {
+				printUsage(argv[0]);
+				return EXIT_SUCCESS;
+			}
+			else if (!arg.empty() && arg[0] == '-') {
+				throw std::invalid_argument("Unknown option " + arg);
+			}
+			else {
+				fs::path scenario(arg);
+				if (!fs::is_regular_file(scenario) && scenario.is_relative()) {
+					char oscDirectory[MAX_FILE_PATH];
+					UtilGetOscDirectoryPath(oscDirectory, MAX_FILE_PATH);
+					scenario = fs::path(oscDirectory) / scenario;
+				}
+				if (!fs::is_regular_file(scenario)) {
+					throw std::invalid_argument("Could not open file " + arg);
+				}
+				scenarios.push_back(fs::absolute(scenario));
+			}
+		}
+	}
+	catch (std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		printUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (scenarios.empty()) {
+		printUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	std::vector<Job> jobs;
+	for (const auto& parameters : BatchOptions::combinations(sweeps)) {
+		for (const auto& scenario : scenarios) {
+			jobs.push_back({scenario, parameters});
+		}
+	}
+
+	std::vector<std::size_t> workerCounts;
+	if (scaling) {
+		for (std::size_t n = 1; n < nJobs; n *= 2) {
+			workerCounts.push_back(n);
+		}
+	}
+	workerCounts.push_back(nJobs);
+
+	std::size_t nFailed = 0;
+	std::vector<std::pair<std::size_t, BatchResult>> results;
+	try {
+		for (auto nWorkers : workerCounts) {
+			std::cout << "Extracting " << jobs.size() << " scenarios with " << nWorkers << " workers" << std::endl;
+			auto result = runBatch(jobs, nWorkers, cacheDirectory, timeStep);
+			nFailed += result.nFailed;
+			results.emplace_back(nWorkers, result);
+			std::cout << result.nSucceeded << " scenarios extracted, " << result.nFailed << " failed, in "
+					  << result.wallTime.count() << " s" << std::endl;
+		}
+	}
+	catch (std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+	if (scaling) {
+		std::cout << "Workers\tWall time [s]\tSpeedup\tEfficiency" << std::endl;
+		const double serialTime = results.front().second.wallTime.count();
+		for (const auto& [nWorkers, result] : results) {
+			const double speedup = serialTime / result.wallTime.count();
+			std::cout << nWorkers << "\t" << result.wallTime.count() << "\t" << speedup
+					  << "\t" << speedup / nWorkers << std::endl;
+		}
+	}
+	return nFailed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,33 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include "objectposetable.hpp"
+
+void ObjectPoseTable::reset(const std::size_t n) {
+	slots = n > 0 ? std::make_unique<Slot[]>(n) : nullptr;
+	nSlots = n;
+}
+
+void ObjectPoseTable::store(const std::size_t slot, const Pose& pose) {
+	auto& s = slots[slot];
+	const auto seq = s.sequence.load(std::memory_order_relaxed);
+	s.sequence.store(seq + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	s.pose = pose;
+
+	s.sequence.store(seq + 2, std::memory_order_release);
+}
+
+bool ObjectPoseTable::load(const std::size_t slot, Pose& pose) const {
+	const auto& s = slots[slot];
+	uint32_t seq;
+	do {
+		seq = s.sequence.load(std::memory_order_acquire);
+		pose = s.pose;
+		std::atomic_thread_fence(std::memory_order_acquire);
+	} while ((seq & 1) || seq != s.sequence.load(std::memory_order_relaxed));
+	return seq != 0;
+}
@@ -0,0 +1,465 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include "scenarioextractor.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <regex>
+
+#include "string_utility.hpp"
+#include "util.h"
+
+ScenarioExtractor* ScenarioExtractor::extracting = nullptr;
+
+ScenarioExtractor::~ScenarioExtractor()
+{
+	close();
+}
+
+void ScenarioExtractor::load(
+	const std::filesystem::path& oscFile,
+	const ParameterValues& parameters)
+{
+	close();
+	RM_Close(); // Stop RoadManager in case it is running
+	this->oscFile = oscFile;
+	this->parameters = parameters;
+	hasGeoReference = false;
+	crsTransformation.reset();
+
+	RCLCPP_INFO(get_logger(), "Initializing esmini with scenario file %s", oscFile.c_str());
+	int result;
+	if (parameters.empty()) {
+		result = SE_Init(oscFile.c_str(),1,0,0,0); // Disable controllers, let DefaultController be used
+	}
+	else {
+		std::vector<std::string> args = {"esmini", "--osc", oscFile.string(), "--headless", "--disable_controllers"};
+		for (const auto& [name, value] : parameters) {
+			args.push_back("--param");
+			args.push_back(name + "=" + value);
+		}
+		std::vector<const char*> argv;
+		for (const auto& arg : args) {
+			argv.push_back(arg.c_str());
+		}
+		result = SE_InitWithArgs(static_cast<int>(argv.size()), argv.data());
+	}
+	if (result < 0) {
+		throw std::runtime_error("Failed to initialize esmini with scenario file " + oscFile.string());
+	}
+	loaded = true;
+
+	odrFile = getOpenDriveFile();
+	if (RM_Init(odrFile.c_str()) < 0) {
+		throw std::runtime_error(std::string("Failed to initialize with odr file ").append(odrFile));
+	}
+	hasGeoReference = RM_GetOpenDriveGeoReference(&geoReference) == 0;
+	if (!hasGeoReference) {
+		RCLCPP_WARN(get_logger(), "Failed to get OpenDRIVE geo reference from RoadManager");
+	}
+	RM_Close();
+}
+
+bool ScenarioExtractor::applyGeoReference()
+{
+	if (!hasGeoReference) {
+		return false;
+	}
+	projStringFrom = projStrFromGeoReference(geoReference);
+	std::string toDatum = "WGS84";
+	auto llh_0 = CRSTransformation::projToLLH(projStringFrom, toDatum);
+	RCLCPP_INFO(get_logger(), "llh origin: %lf, %lf, %lf", llh_0[0], llh_0[1], llh_0[2]);
+	llhOrigin = {llh_0[0], llh_0[1], llh_0[2]};
+
+	projStringTo = "+proj=tmerc +lat_0=" + std::to_string(llh_0[0]) +
+				   " +lon_0=" + std::to_string(llh_0[1]) +
+				   " +datum="+ toDatum + " +units=m +no_defs";
+
+	crsTransformation = CRSTransformation::get(projStringFrom, projStringTo);
+	return true;
+}
+
+std::string ScenarioExtractor::cacheKey(const double timeStep) const
+{
+	return TrajectoryCache::key(oscFile, odrFile, timeStep,
+								crsTransformation ? projStringFrom : "",
+								crsTransformation ? projStringTo : "", parameters);
+}
+
+void ScenarioExtractor::close()
+{
+	if (loaded) {
+		SE_Close(); // Stop ScenarioEngine
+		loaded = false;
+	}
+}
+
+/*!
+ * \brief Fetches the open drive file path from the loaded scenario
+ * \return Configured path
+*/
+std::filesystem::path ScenarioExtractor::getOpenDriveFile() const
+{
+	std::filesystem::path odrPath;
+	if (SE_GetODRFilename() != nullptr) {
+		odrPath = std::filesystem::path(SE_GetODRFilename());
+		RCLCPP_INFO(get_logger(), "Found ODR file %s", odrPath.string().c_str());
+	}
+	else {
+		RCLCPP_DEBUG(get_logger(), "No ODR file found");
+	}
+
+	if (odrPath.is_absolute()) {
+		return odrPath;
+	}
+	else {
+		char path[MAX_FILE_PATH];
+		UtilGetConfDirectoryPath(path, MAX_FILE_PATH);
+		return std::string(path) + odrPath.string();
+	}
+}
+
+/*!
+ * \brief Split action into ID and action name.
+ * \param actionName Action name in the form ActorObjectId,Action
+ * \return pair of actor object ID and action name
+*/
+std::pair<uint32_t, std::string> ScenarioExtractor::parseAction(const std::string& actionName)
+{
+	std::vector<std::string> res;
+	split(actionName, ',', res);
+	if (res.size() < 2){
+		throw std::runtime_error("Action name " + actionName + "  is not of the form ActorObjectId,Action");
+	}
+	return {std::stoul(res[0]), res[1]};
+}
+
+/*!
+ * \brief Check if action is a start action.
+ * \param action Action name
+ * \return true if action is a start action, false otherwise
+*/
+bool ScenarioExtractor::isStartAction(const std::string& action)
+{
+	return std::regex_search(action, std::regex("^(begin|start)", std::regex_constants::icase));
+}
+
+/*!
+ * \brief Add delayed start to object state if start action occurred.
+ * \param name Name of the StoryBoardElement whose state has changed.
+ * \param type Possible values: STORY = 1, ACT = 2, MANEUVER_GROUP = 3, MANEUVER = 4, EVENT = 5, ACTION = 6, UNDEFINED_ELEMENT_TYPE = 0.
+ * \param state new state, possible values: STANDBY = 1, RUNNING = 2, COMPLETE = 3, UNDEFINED_ELEMENT_STATE = 0.
+ */
+void ScenarioExtractor::collectStartAction(
+	const char* name,
+	int type,
+	int state)
+{
+	if (type != 6 || state != 2 || extracting == nullptr) { return; } // Only handle actions that are started
+	try {
+		auto [objectId, action] = parseAction(name);
+		if (isStartAction(action)) {
+			extracting->startedObjectIds.push_back(objectId);
+		}
+	}
+	catch (std::exception& e) {
+		RCLCPP_WARN(extracting->get_logger(), e.what());
+		return;
+	}
+}
+
+/*!
+ * \brief Runs the loaded scenario to its end, extracting the trajectories,
+ *		triggered start objects, IPs and esmini IDs of its objects. Stops esmini.
+ * \param timeStep Time step of the simulation [s]
+ * \return The extracted data
+ */
+TrajectoryCache::Entry ScenarioExtractor::extract(const double timeStep)
+{
+	if (!loaded) {
+		throw std::logic_error("Attempted to extract trajectories without a loaded scenario");
+	}
+	TrajectoryCache::Entry entry;
+	startedObjectIds.clear();
+	// Register callbacks to figure out what actions need to be taken
+	extracting = this;
+	SE_RegisterStoryBoardElementStateChangeCallback(&collectStartAction);
+
+	RCLCPP_INFO(get_logger(), "Starting extracting trajs");
+	ObjectStates states;
+	try {
+		getObjectStates(timeStep, states);
+	}
+	catch (...) {
+		extracting = nullptr;
+		throw;
+	}
+	extracting = nullptr;
+	for (std::size_t j = 0; j < objects.size(); j++) {
+		auto id = objects[j].atosId;
+		auto traj = getTrajectoryFromObjectStates(j, states);
+		// Apply CRS transform if OpenDrive CRS Transformation is defined
+		if (crsTransformation) {
+			RCLCPP_DEBUG(get_logger(), "Applying CRS transformation to trajectory for object %d", id);
+			crsTransformation->apply(traj.points);
+		}
+		entry.trajectories.emplace(id, std::move(traj));
+	}
+	entry.delayedStartIds = startedObjectIds;
+	RCLCPP_INFO(get_logger(), "Done extracting trajs");
+
+	RCLCPP_INFO(get_logger(), "Extracted %ld trajectories", entry.trajectories.size());
+	RCLCPP_INFO(get_logger(), "Number of objects with triggered start: %ld", entry.delayedStartIds.size());
+
+	for (std::size_t j = 0; j < objects.size(); j++) {
+		// Find object IPs as defined in VehicleCatalog file
+		auto ip = SE_GetObjectPropertyValue(static_cast<int>(j), "ip");
+		if (ip != nullptr) {
+			entry.ips[objects[j].atosId] = std::string(ip);
+		}
+		// Populate the map tracking Object ID -> esmini index
+		entry.esminiIds[objects[j].atosId] = objects[j].esminiId;
+	}
+	close();
+
+	RCLCPP_DEBUG(get_logger(), "Extracted trajectories");
+	return entry;
+}
+
+/*!
+ * \brief Builds the table of the esmini and ATOS IDs of the scenario objects, so
+ *		that object names are looked up and parsed once rather than at every step.
+ * \throws std::invalid_argument if an object name is not an ATOS object ID
+ */
+void ScenarioExtractor::indexObjects()
+{
+	objects.clear();
+	const int nObjects = SE_GetNumberOfObjects();
+	objects.reserve(static_cast<std::size_t>(std::max(nObjects, 0)));
+	for (int j = 0; j < nObjects; j++) {
+		auto esminiId = SE_GetId(j);
+		objects.push_back({esminiId, static_cast<uint32_t>(std::stoi(SE_GetObjectName(esminiId)))});
+	}
+}
+
+/*!
+ * \brief Returns object states for each timestep by simulating the loaded scenario.
+ *  The simulation is stopped if there is no vehicle movement and at least
+ * 	MIN_SCENARIO_TIME has passed or if more than MAX_SCENARIO_TIME has passed.
+ *	Inspired by ScenarioGateway::WriteStatesToFile from esmini lib.
+ *
+ * \param timeStep Time step to use for generating the trajectories
+ * \param states The returned states of the objects in ::objects at each timestep
+ */
+void ScenarioExtractor::getObjectStates(
+	double timeStep,
+	ObjectStates& states)
+{
+	constexpr double MIN_SCENARIO_TIME = 10.0;
+	constexpr double MAX_SCENARIO_TIME = 3600.0;
+	constexpr double EXPECTED_SCENARIO_TIME = 600.0; // Longer scenarios grow the state columns
+	const auto wallStart = std::chrono::steady_clock::now();
+	double accumTime = 0.0;
+	std::size_t nMoving = 0;
+	auto pushCurrentStates = [&]() {
+		SE_ScenarioObjectState s;
+		nMoving = 0;
+		states.time.push_back(accumTime);
+		for (const auto& object : objects) {
+			//SE_SetAlignModeZ(object.esminiId, 0); // Disable Z-alignment, not implemented in esmini yet
+			SE_GetObjectState(object.esminiId, &s);
+			states.x.push_back(s.x);
+			states.y.push_back(s.y);
+			states.z.push_back(s.z);
+			states.h.push_back(s.h);
+			states.speed.push_back(s.speed);
+			states.wheelAngle.push_back(s.wheel_angle);
+			nMoving += !(s.speed < 0.1);
+		}
+	};
+
+	// The objects of the scenario are known once the initial step is taken
+	SE_StepDT(timeStep);
+	accumTime += timeStep;
+	indexObjects();
+	states = ObjectStates();
+	states.objectCount = objects.size();
+	const auto expectedSteps = static_cast<std::size_t>(EXPECTED_SCENARIO_TIME / timeStep) + 1;
+	states.time.reserve(expectedSteps);
+	for (auto column : {&states.x, &states.y, &states.z, &states.h, &states.speed, &states.wheelAngle}) {
+		column->reserve(expectedSteps * objects.size());
+	}
+	pushCurrentStates();
+
+	bool stopSimulation = false;
+	while (!stopSimulation) {
+		if (SE_GetQuitFlag() != 0) {
+			break;
+		}
+
+		SE_StepDT(timeStep);
+		accumTime += timeStep;
+		pushCurrentStates();
+		bool noMovement = nMoving == 0;
+		bool atLeastMinTimePassed = accumTime > MIN_SCENARIO_TIME;
+		bool moreThanMaxTimePassed = accumTime > MAX_SCENARIO_TIME;
+		stopSimulation = (noMovement && atLeastMinTimePassed) || moreThanMaxTimePassed;
+	}
+	if (accumTime > MAX_SCENARIO_TIME) {
+		RCLCPP_WARN(get_logger(), "Scenario time limit reached, stopping simulation");
+	}
+	else if (accumTime < MIN_SCENARIO_TIME + timeStep) {
+		RCLCPP_WARN(get_logger(), "Ran scenario for the minimum time %.2f, possibly no movement in scenario", MIN_SCENARIO_TIME);
+	}
+	std::chrono::duration<double> wallTime = std::chrono::steady_clock::now() - wallStart;
+	RCLCPP_INFO(get_logger(), "Finished %f s simulation of %ld objects in %.3f s (%.1f simulated s per s)",
+				accumTime, objects.size(), wallTime.count(), accumTime / std::max(wallTime.count(), 1e-9));
+}
+
+/*!
+ * \brief Given the states of all objects at different timesteps, creates a
+ *	trajectory for one of them consisting of trajectory points, one for each timestep.
+ * Note: If there is no difference between consecutive states, the trajectory point is not added.
+ * \param object Index in ::objects of the object to which the trajectory belongs
+ * \param states The object states
+ * \return A trajectory consisting of trajectory points, one for each state.
+ */
+ATOS::Trajectory ScenarioExtractor::getTrajectoryFromObjectStates(
+	std::size_t object,
+	const ObjectStates& states) const
+{
+	const auto id = objects.at(object).atosId;
+	ATOS::Trajectory trajectory(get_logger());
+	trajectory.name = "Esmini Trajectory for object " + std::to_string(id);
+	const auto nSteps = states.time.size();
+	if (nSteps == 0) {
+		return trajectory;
+	}
+
+	RCLCPP_DEBUG(get_logger(), "Creating trajectory for object %d", id);
+	const auto stride = states.objectCount;
+	auto saveTp = [&](std::size_t step, std::size_t prevStep) {
+		const auto i = step * stride + object;
+		const auto p = prevStep * stride + object;
+		ATOS::Trajectory::TrajectoryPoint tp;
+		double currLonVel = states.speed[i] * cos(states.wheelAngle[i]);
+		double currLatVel = states.speed[i] * sin(states.wheelAngle[i]);
+		double prevLonVel = states.speed[p] * cos(states.wheelAngle[p]);
+		double prevLatVel = states.speed[p] * sin(states.wheelAngle[p]);
+		double dt = states.time[step] - states.time[prevStep];
+
+		tp.setXCoord(states.x[i]);
+		tp.setYCoord(states.y[i]);
+		tp.setZCoord(states.z[i]);
+		tp.setHeading(states.h[i]);
+		tp.setTime(states.time[step]);
+		tp.setCurvature(0); // TODO: implement support for different curvature, now only support straight lines
+		tp.setLongitudinalVelocity(currLonVel);
+		tp.setLateralVelocity(currLatVel);
+		if (dt != 0.0) {
+			tp.setLongitudinalAcceleration((currLonVel - prevLonVel) / dt);
+			tp.setLateralAcceleration((currLatVel - prevLatVel) / dt);
+		}
+		else {
+			tp.setLongitudinalAcceleration(0);
+			tp.setLateralAcceleration(0);
+		}
+
+		trajectory.points.push_back(tp);
+	};
+
+	trajectory.points.reserve(nSteps);
+	for (std::size_t step = 1; step < nSteps; ++step) {
+		const auto i = step * stride + object;
+		const auto p = i - stride;
+		if (states.x[i] == states.x[p] && states.y[i] == states.y[p] && // Nothing interesting happens within 1 timestep, skip
+			states.z[i] == states.z[p] && states.h[i] == states.h[p]) {
+			continue;
+		}
+		saveTp(step, step - 1); // Next timestep is different, save current one.
+	}
+	if (trajectory.points.size() == 0) {
+		saveTp(0, 0); // Only one state or no points, save it.
+	}
+	auto startTime = trajectory.points.front().getTime();
+
+	// Subtract start time from all timesteps
+	for (auto& tp : trajectory.points){
+		tp.setTime(tp.getTime() - startTime);
+	}
+	return trajectory;
+}
+
+/*!
+ * \brief Given a RM_georeference converts into a proj string
+ * \param geoRef The geo reference to convert
+ * \return The proj string
+ */
+std::string ScenarioExtractor::projStrFromGeoReference(RM_GeoReference& geoRef) const {
+	std::string projStringFrom = "+proj=";
+	if (strlen(geoRef.proj_) != 0) {
+		projStringFrom += std::string(geoRef.proj_) + " ";
+	}
+	else {
+		throw std::runtime_error("No projection found in geo reference");
+	}
+	if (!std::isnan(geoRef.lat_0_)) {
+		projStringFrom += "+lat_0=" + std::to_string(geoRef.lat_0_) + " ";
+	}
+	if (!std::isnan(geoRef.lon_0_)) {
+		projStringFrom += "+lon_0=" + std::to_string(geoRef.lon_0_) + " ";
+	}
+	if (!std::isnan(geoRef.k_)) {
+		projStringFrom += "+k=" + std::to_string(geoRef.k_) + " ";
+	}
+	if (!std::isnan(geoRef.k_0_)) {
+		projStringFrom += "+k_0=" + std::to_string(geoRef.k_0_) + " ";
+	}
+	if (!std::isnan(geoRef.x_0_)) {
+		projStringFrom += "+x_0=" + std::to_string(geoRef.x_0_) + " ";
+	}
+	if (!std::isnan(geoRef.y_0_)) {
+		projStringFrom += "+y_0=" + std::to_string(geoRef.y_0_) + " ";
+	}
+	if (strlen(geoRef.ellps_) != 0) {
+		projStringFrom += "+ellps=" + std::string(geoRef.ellps_) + " ";
+	}
+	if (strlen(geoRef.units_) != 0) {
+		projStringFrom += "+units=" + std::string(geoRef.units_) + " ";
+	}
+	if (strlen(geoRef.vunits_) != 0) {
+		projStringFrom += "+vunits=" + std::string(geoRef.vunits_) + " ";
+	}
+	if (strlen(geoRef.datum_) != 0) {
+		projStringFrom += "+datum=" + std::string(geoRef.datum_) + " ";
+	}
+	if (strlen(geoRef.geo_id_grids_) != 0) {
+		projStringFrom += "+geoidgrids=" + std::string(geoRef.geo_id_grids_) + " ";
+	}
+	if (!std::isnan(geoRef.zone_)) {
+		projStringFrom += "+zone=" + std::to_string(geoRef.zone_) + " ";
+	}
+	if (geoRef.towgs84_ != 0) {
+		projStringFrom += "+towgs84=" + std::to_string(geoRef.towgs84_) + " ";
+	}
+	if (strlen(geoRef.axis_) != 0) {
+		projStringFrom += "+axis=" + std::string(geoRef.axis_) + " ";
+	}
+	if (!std::isnan(geoRef.lon_wrap_)) {
+		projStringFrom += "+lon_wrap=" + std::to_string(geoRef.lon_wrap_) + " ";
+	}
+	if (!std::isnan(geoRef.over_)) {
+		projStringFrom += "+over=" + std::to_string(geoRef.over_) + " ";
+	}
+	if (strlen(geoRef.pm_) != 0) {
+		projStringFrom += "+pm=" + std::string(geoRef.pm_) + " ";
+	}
+	projStringFrom += "+no_defs";
+	RCLCPP_DEBUG(get_logger(), "Created proj string: %s", projStringFrom.c_str());
+	return projStringFrom;
+}
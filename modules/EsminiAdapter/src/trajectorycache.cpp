@@ -0,0 +1,257 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include "trajectorycache.hpp"
+#include "binarytrajectoryfile.hpp"
+#include "mappedfile.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <regex>
+#include <system_error>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+//! Increased whenever extraction or the entry format changes, so that older entries are not used
+constexpr uint32_t CACHE_FORMAT_VERSION = 1;
+constexpr char INDEX_MAGIC[8] = {'A', 'T', 'O', 'S', 'E', 'S', 'M', 'C'};
+constexpr uint32_t MAX_IP_LENGTH = 256;
+const std::string INDEX_FILE_NAME = "index.bin";
+
+//! 64 bit FNV-1a hash
+class Hash {
+public:
+	void add(const void* data, const std::size_t length) {
+		auto bytes = static_cast<const unsigned char*>(data);
+		for (std::size_t i = 0; i < length; ++i) {
+			value = (value ^ bytes[i]) * 0x100000001b3ULL;
+		}
+	}
+	template<typename T>
+	void addValue(const T& v) { add(&v, sizeof (v)); }
+	void addString(const std::string& s) {
+		addValue<uint64_t>(s.size());
+		add(s.data(), s.size());
+	}
+	void addFile(const fs::path& path) {
+		ATOS::MappedFile file(path.string());
+		addValue<uint64_t>(file.size());
+		add(file.data(), file.size());
+	}
+	std::string hex() const {
+		char buffer[17];
+		std::snprintf(buffer, sizeof (buffer), "%016llx", static_cast<unsigned long long>(value));
+		return buffer;
+	}
+private:
+	uint64_t value = 0xcbf29ce484222325ULL;
+};
+
+//! Catalog directories listed in the CatalogLocations of an OpenSCENARIO file
+std::vector<fs::path> catalogDirectories(const fs::path& oscFile) {
+	static const std::regex directoryPattern(R"(<Directory\s+path\s*=\s*["']([^"']*)["'])");
+	ATOS::MappedFile file(oscFile.string());
+	const std::string_view contents(file.data(), file.size());
+	auto begin = contents.find("<CatalogLocations");
+	auto end = contents.find("</CatalogLocations>", begin);
+	std::vector<fs::path> directories;
+	if (begin == std::string_view::npos || end == std::string_view::npos) {
+		return directories;
+	}
+	const std::string locations(contents.substr(begin, end - begin));
+	for (auto it = std::sregex_iterator(locations.begin(), locations.end(), directoryPattern);
+		 it != std::sregex_iterator(); ++it) {
+		fs::path directory((*it)[1].str());
+		directories.push_back(directory.is_absolute() ? directory : oscFile.parent_path() / directory);
+	}
+	return directories;
+}
+
+std::string trajectoryFileName(const uint32_t id) {
+	return std::to_string(id) + TRAJECTORY_BINARY_FILE_EXTENSION;
+}
+
+template<typename T>
+void writeValue(std::ofstream& out, const T& v) {
+	out.write(reinterpret_cast<const char*>(&v), sizeof (v));
+}
+
+template<typename T>
+T readValue(std::ifstream& in) {
+	T v;
+	in.read(reinterpret_cast<char*>(&v), sizeof (v));
+	return v;
+}
+} // namespace
+
+TrajectoryCache::TrajectoryCache(
+	const fs::path& directory,
+	rclcpp::Logger log)
+	: Loggable(log), directory(directory)
+{
+}
+
+std::string TrajectoryCache::key(
+	const fs::path& oscFile,
+	const fs::path& odrFile,
+	const double timeStep,
+	const std::string& fromCRS,
+	const std::string& toCRS,
+	const ParameterValues& parameters)
+{
+	Hash hash;
+	hash.addValue(CACHE_FORMAT_VERSION);
+	hash.addFile(oscFile);
+	if (fs::is_regular_file(odrFile)) {
+		hash.addFile(odrFile);
+	}
+	else {
+		hash.addString("");
+	}
+	for (const auto& catalogDirectory : catalogDirectories(oscFile)) {
+		std::vector<fs::path> catalogs;
+		std::error_code ec;
+		for (const auto& file : fs::directory_iterator(catalogDirectory, ec)) {
+			if (file.is_regular_file()) {
+				catalogs.push_back(file.path());
+			}
+		}
+		std::sort(catalogs.begin(), catalogs.end());
+		hash.addValue<uint64_t>(catalogs.size());
+		for (const auto& catalog : catalogs) {
+			hash.addString(catalog.filename().string());
+			hash.addFile(catalog);
+		}
+	}
+	hash.addValue(timeStep);
+	hash.addString(fromCRS);
+	hash.addString(toCRS);
+	// Without parameters the key is left as before parameters could be given
+	if (!parameters.empty()) {
+		hash.addValue<uint64_t>(parameters.size());
+		for (const auto& [name, value] : parameters) {
+			hash.addString(name);
+			hash.addString(value);
+		}
+	}
+	return hash.hex();
+}
+
+bool TrajectoryCache::load(
+	const std::string& key,
+	Entry& entry) const
+{
+	const auto entryDirectory = directory / key;
+	if (!fs::is_directory(entryDirectory)) {
+		return false;
+	}
+	try {
+		std::ifstream in(entryDirectory / INDEX_FILE_NAME, std::ios::binary);
+		in.exceptions(std::ios::failbit | std::ios::badbit | std::ios::eofbit);
+		char magic[sizeof (INDEX_MAGIC)];
+		in.read(magic, sizeof (magic));
+		if (std::memcmp(magic, INDEX_MAGIC, sizeof (magic)) != 0
+				|| readValue<uint32_t>(in) != CACHE_FORMAT_VERSION) {
+			RCLCPP_WARN(get_logger(), "Ignoring trajectory cache entry %s of unknown format", key.c_str());
+			return false;
+		}
+		Entry loaded;
+		for (auto n = readValue<uint32_t>(in); n > 0; --n) {
+			auto atosId = readValue<int32_t>(in);
+			loaded.esminiIds[atosId] = readValue<int32_t>(in);
+		}
+		for (auto n = readValue<uint32_t>(in); n > 0; --n) {
+			loaded.delayedStartIds.push_back(readValue<uint32_t>(in));
+		}
+		for (auto n = readValue<uint32_t>(in); n > 0; --n) {
+			auto id = readValue<uint32_t>(in);
+			auto length = readValue<uint32_t>(in);
+			if (length > MAX_IP_LENGTH) {
+				throw std::invalid_argument("IP of object " + std::to_string(id) + " too long");
+			}
+			std::string ip(length, '\0');
+			in.read(ip.data(), length);
+			loaded.ips[id] = ip;
+		}
+		for (auto n = readValue<uint32_t>(in); n > 0; --n) {
+			auto id = readValue<uint32_t>(in);
+			ATOS::Trajectory trajectory(get_logger());
+			trajectory.initializeFromPath((entryDirectory / trajectoryFileName(id)).string());
+			loaded.trajectories.emplace(id, trajectory);
+		}
+		entry = std::move(loaded);
+		return true;
+	}
+	catch (std::exception& e) {
+		RCLCPP_WARN(get_logger(), "Ignoring unreadable trajectory cache entry %s: %s", key.c_str(), e.what());
+		return false;
+	}
+}
+
+void TrajectoryCache::store(
+	const std::string& key,
+	const Entry& entry) const
+{
+	const auto entryDirectory = directory / key;
+	const auto temporaryDirectory = directory / (key + ".tmp" + std::to_string(getpid()));
+	fs::remove_all(temporaryDirectory);
+	fs::create_directories(temporaryDirectory);
+	try {
+		for (const auto& [id, trajectory] : entry.trajectories) {
+			ATOS::BinaryTrajectoryFile::write((temporaryDirectory / trajectoryFileName(id)).string(),
+											  *trajectory.toColumns(), trajectory.id, trajectory.name,
+											  trajectory.version);
+		}
+		std::ofstream out;
+		out.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+		out.open(temporaryDirectory / INDEX_FILE_NAME, std::ios::binary | std::ios::trunc);
+		out.write(INDEX_MAGIC, sizeof (INDEX_MAGIC));
+		writeValue(out, CACHE_FORMAT_VERSION);
+		writeValue(out, static_cast<uint32_t>(entry.esminiIds.size()));
+		for (const auto& [atosId, esminiId] : entry.esminiIds) {
+			writeValue(out, static_cast<int32_t>(atosId));
+			writeValue(out, static_cast<int32_t>(esminiId));
+		}
+		writeValue(out, static_cast<uint32_t>(entry.delayedStartIds.size()));
+		for (const auto id : entry.delayedStartIds) {
+			writeValue(out, id);
+		}
+		writeValue(out, static_cast<uint32_t>(entry.ips.size()));
+		for (const auto& [id, ip] : entry.ips) {
+			writeValue(out, id);
+			writeValue(out, static_cast<uint32_t>(ip.size()));
+			out.write(ip.data(), static_cast<std::streamsize>(ip.size()));
+		}
+		writeValue(out, static_cast<uint32_t>(entry.trajectories.size()));
+		for (const auto& it : entry.trajectories) {
+			writeValue(out, it.first);
+		}
+		out.close();
+
+		fs::remove_all(entryDirectory);
+		fs::rename(temporaryDirectory, entryDirectory);
+	}
+	catch (...) {
+		std::error_code ec;
+		fs::remove_all(temporaryDirectory, ec);
+		throw;
+	}
+	RCLCPP_DEBUG(get_logger(), "Stored trajectory cache entry %s", key.c_str());
+}
+
+std::size_t TrajectoryCache::clear() const
+{
+	std::size_t nRemoved = 0;
+	std::error_code ec;
+	for (const auto& entryDirectory : fs::directory_iterator(directory, ec)) {
+		fs::remove_all(entryDirectory.path());
+		++nRemoved;
+	}
+	return nRemoved;
+}
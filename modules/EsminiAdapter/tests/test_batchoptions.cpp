@@ -0,0 +1,133 @@
+#include "batchoptions.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#define N_BENCHMARK_PARAMETERS 5
+#define N_BENCHMARK_VALUES 10
+using namespace BatchOptions;
+
+static void job_count_test();
+static void parameter_sweep_test();
+static void combinations_test();
+static void benchmark();
+static bool throws_invalid_argument(void (*parse)(const std::string&), const std::string& argument);
+
+int main(int argc, char** argv) {
+	try {
+		job_count_test();
+		parameter_sweep_test();
+		combinations_test();
+		benchmark();
+		exit(EXIT_SUCCESS);
+	}
+	catch (std::exception& e) {
+		std::cerr << "Test " << __FILE__ << " failed: " << std::endl
+				  << e.what() << std::endl;
+		exit(EXIT_FAILURE);
+	}
+}
+
+bool throws_invalid_argument(void (*parse)(const std::string&), const std::string& argument) {
+	try {
+		parse(argument);
+	}
+	catch (std::invalid_argument&) {
+		return true;
+	}
+	return false;
+}
+
+/*!
+ * \brief Job counts from 1 to MAX_JOBS are accepted. Anything else is rejected,
+ *			in particular negative numbers, which std::stoul wraps to huge counts.
+ */
+void job_count_test() {
+	if (parseJobCount("1") != 1 || parseJobCount("8") != 8 || parseJobCount(std::to_string(MAX_JOBS)) != MAX_JOBS) {
+		throw std::runtime_error("Valid job count parsed wrongly");
+	}
+	auto parse = [](const std::string& argument) { parseJobCount(argument); };
+	for (const std::string& argument : std::vector<std::string>{"", "0", "-1", "+4", " 4", "4 ", "4x", "x", "1.5",
+			std::to_string(MAX_JOBS + 1), "18446744073709551615", "99999999999999999999999"}) {
+		if (!throws_invalid_argument(parse, argument)) {
+			throw std::runtime_error("Job count \"" + argument + "\" was accepted");
+		}
+	}
+}
+
+/*!
+ * \brief A sweep is split at the first '=' into the name and comma separated
+ *			values, of which there must be at least one.
+ */
+void parameter_sweep_test() {
+	const std::vector<std::pair<std::string, ParameterSweep>> valid = {
+		{"EgoSpeed=10", {"EgoSpeed", {"10"}}},
+		{"EgoSpeed=10,20,30", {"EgoSpeed", {"10", "20", "30"}}},
+		{"Offset=-1.5,,2", {"Offset", {"-1.5", "", "2"}}},
+		{"Expression=a=b", {"Expression", {"a=b"}}}
+	};
+	for (const auto& [argument, expected] : valid) {
+		if (parseParameterSweep(argument) != expected) {
+			throw std::runtime_error("Parameter sweep \"" + argument + "\" parsed wrongly");
+		}
+	}
+	auto parse = [](const std::string& argument) { parseParameterSweep(argument); };
+	for (const std::string& argument : std::vector<std::string>{"", "EgoSpeed", "=10", "EgoSpeed="}) {
+		if (!throws_invalid_argument(parse, argument)) {
+			throw std::runtime_error("Parameter sweep \"" + argument + "\" was accepted");
+		}
+	}
+}
+
+/*!
+ * \brief Without sweeps there is one combination, with no parameters, so that
+ *			each scenario is extracted once. Otherwise every combination of values
+ *			occurs once, the last sweep varying fastest.
+ */
+void combinations_test() {
+	auto none = combinations({});
+	if (none.size() != 1 || !none.front().empty()) {
+		throw std::runtime_error("Without sweeps there should be one empty combination");
+	}
+	auto result = combinations({{"A", {"1", "2"}}, {"B", {"x", "y", "z"}}, {"C", {"c"}}});
+	const std::vector<ParameterValues> expected = {
+		{{"A", "1"}, {"B", "x"}, {"C", "c"}},
+		{{"A", "1"}, {"B", "y"}, {"C", "c"}},
+		{{"A", "1"}, {"B", "z"}, {"C", "c"}},
+		{{"A", "2"}, {"B", "x"}, {"C", "c"}},
+		{{"A", "2"}, {"B", "y"}, {"C", "c"}},
+		{{"A", "2"}, {"B", "z"}, {"C", "c"}}
+	};
+	if (result != expected) {
+		throw std::runtime_error("Got " + std::to_string(result.size()) + " combinations, or in the wrong order");
+	}
+}
+
+/*!
+ * \brief Reports the time taken to expand a large sweep into its combinations.
+ */
+void benchmark() {
+	using namespace std::chrono;
+	std::vector<ParameterSweep> sweeps;
+	for (int p = 0; p < N_BENCHMARK_PARAMETERS; ++p) {
+		std::string argument = "Parameter" + std::to_string(p) + "=";
+		for (int v = 0; v < N_BENCHMARK_VALUES; ++v) {
+			argument += (v > 0 ? "," : "") + std::to_string(v * 0.5);
+		}
+		sweeps.push_back(parseParameterSweep(argument));
+	}
+	auto start = steady_clock::now();
+	auto result = combinations(sweeps);
+	duration<double> elapsed = steady_clock::now() - start;
+	std::size_t expected = 1;
+	for (int p = 0; p < N_BENCHMARK_PARAMETERS; ++p) {
+		expected *= N_BENCHMARK_VALUES;
+	}
+	if (result.size() != expected) {
+		throw std::runtime_error("Got " + std::to_string(result.size()) + " combinations, expected " + std::to_string(expected));
+	}
+	std::cout << "Expanded " << result.size() << " combinations in " << elapsed.count() << " s: "
+			  << result.size() / elapsed.count() << " combinations/s" << std::endl;
+}
@@ -27,6 +27,7 @@ extern "C" {
 
 #include "module.hpp"
 #include "journalmodelcollection.hpp"
+#include "journalreplay.hpp"
 /*------------------------------------------------------------
   -- Function declarations.
   ------------------------------------------------------------*/
@@ -40,6 +41,7 @@ private:
   std::string scenarioName;
 
 	JournalModelCollection journals;
+	JournalReplay replay;
 
 	void onArmMessage(const ROSChannels::Arm::message_type::SharedPtr) override;
 	void onStopMessage(const ROSChannels::Stop::message_type::SharedPtr) override;
@@ -10,6 +10,7 @@
 #include <chrono>
 #include <string>
 #include <vector>
+#include <limits>
 #include "journalmodel.hpp"
 #include "loggable.hpp"
 
@@ -25,6 +26,13 @@ public:
 	void placeStopBookmarks();
 	void insertNonBookmarked();
 	int dumpToFile(std::string filename);
+	//! \brief Sets the interval of the test in seconds since epoch, as otherwise done
+	//!			by placing the start and stop bookmarks.
+	void setTimeInterval(const double start, const double stop) {
+		startTime = start;
+		stopTime = stop;
+	}
+	static fs::path getLatestOutputJournal(const std::string &fileName);
 	std::string toString() const {
 		std::string retval = "";
 		for (const auto &journal : *this) {
@@ -38,10 +46,13 @@ public:
 private:
 	std::chrono::time_point<std::chrono::system_clock, std::chrono::days> startDay;
 	std::chrono::time_point<std::chrono::system_clock, std::chrono::days> stopDay;
+	double startTime = 0.0;	//!< Time of start bookmarks [s since epoch]
+	double stopTime = std::numeric_limits<double>::infinity();	//!< Time of stop bookmarks [s since epoch]
 
 
     static std::string getDateAsString(const std::chrono::system_clock::time_point &date);
     static std::string getCurrentDateAsString();
+    static std::streampos findIndexedPosition(const fs::path &journalFile, const double time);
     static std::vector<fs::path> getJournalFilesFrom(const std::chrono::system_clock::time_point &date);
     static std::vector<fs::path> getJournalFilesFromToday() {
 	    return getJournalFilesFrom(std::chrono::system_clock::now());
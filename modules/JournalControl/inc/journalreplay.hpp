@@ -0,0 +1,67 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#ifndef JOURNALREPLAY_HPP
+#define JOURNALREPLAY_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "journalmodel.hpp"
+#include "loggable.hpp"
+#include "roschannels/monitorchannel.hpp"
+
+/*!
+ * \brief The JournalReplay class re-publishes monitor data recorded in a journal
+ *			on the object monitor topics, paced by the recorded time of each entry.
+ *			Both binary journals and text journals (module or merged) can be read.
+ */
+class JournalReplay : public Loggable {
+public:
+	JournalReplay(rclcpp::Node& node, rclcpp::Logger log) : Loggable(log), node(node) {}
+	~JournalReplay() { stop(); }
+
+	/*!
+	 * \brief Starts replaying a journal in the background, stopping any ongoing replay.
+	 * \param journal Path to the journal to be replayed
+	 * \param speed Playback speed relative to recorded time, or 0 to publish as
+	 *			fast as possible
+	 */
+	void start(const fs::path& journal, const double speed);
+	//! \brief Stops an ongoing replay and waits for it to finish.
+	void stop();
+	bool isRunning() const { return running; }
+
+private:
+	//! A monitor entry read from a journal
+	struct Record {
+		double recordTime;	//!< Time at which the entry was journalled [s since epoch]
+		uint32_t objectId;
+		ObjectMonitorType monitorData;
+	};
+
+	rclcpp::Node& node;
+	std::map<uint32_t,std::unique_ptr<ROSChannels::Monitor::Pub>> monitorPubs;
+	std::thread replayThread;
+	std::atomic<bool> running = false;
+	bool stopRequested = false;
+	std::mutex stopMutex;
+	std::condition_variable stopCondition;
+
+	void replay(const fs::path journal, const double speed);
+	bool waitUntil(const std::chrono::steady_clock::time_point& time);
+	void publish(const Record& record);
+
+	static bool isBinaryJournal(std::istream& istrm);
+	static bool readBinaryRecord(std::istream& istrm, Record& record);
+	static bool readTextRecord(std::istream& istrm, Record& record);
+	static bool parseTextMonitor(const std::string& line, Record& record);
+};
+
+#endif // JOURNALREPLAY_HPP
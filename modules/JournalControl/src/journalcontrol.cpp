@@ -43,6 +43,7 @@ static void signalHandler(int signo);
 JournalControl::JournalControl()
 	: Module(JournalControl::moduleName),
 	journals(get_logger()),
+	replay(*this, get_logger()),
 	armSub(*this, std::bind(&JournalControl::onArmMessage, this, _1)),
 	stopSub(*this, std::bind(&JournalControl::onStopMessage, this, _1)),
 	abortSub(*this, std::bind(&JournalControl::onAbortMessage, this, _1)),
@@ -51,6 +52,8 @@ JournalControl::JournalControl()
 {
 	declare_parameter("scenario_name", "default_scenario_name");
 	get_parameter("scenario_name", scenarioName);
+	declare_parameter("replay_file", "");
+	declare_parameter("replay_speed", 1.0);
 	initialize();
 }
 
@@ -89,7 +92,16 @@ void JournalControl::onAbortMessage(const Abort::message_type::SharedPtr msg)
 
 void JournalControl::onReplayMessage(const Replay::message_type::SharedPtr)
 {
-	RCLCPP_WARN(get_logger(), "Replay function out of date");
+	try {
+		// Parameters are read on each request, so they can be changed between replays
+		fs::path journal = get_parameter("replay_file").as_string();
+		if (journal.empty()) {
+			journal = JournalModelCollection::getLatestOutputJournal(scenarioName);
+		}
+		replay.start(journal, get_parameter("replay_speed").as_double());
+	} catch (std::exception &e) {
+		RCLCPP_ERROR(get_logger(), "Failed to start replay: %s", e.what());
+	}
 }
 
 void Module::onExitMessage(const Exit::message_type::SharedPtr){
@@ -10,9 +10,14 @@
 #include <fstream>
 #include <iterator>
 #include <algorithm>
+#include <numeric>
+#include <queue>
+#include <limits>
+#include <cstdlib>
 
 
 #define DATE_STRING_MAX_LEN 20
+#define MERGE_BUFFER_SIZE (1024*1024)
 
 /*!
  * \brief placeStartBookmarks Stores references to the current end of file of all journals.
@@ -34,6 +39,8 @@ void JournalModelCollection::placeStartBookmarks() {
 		this->insert(journal);
 	}
 	using namespace std::chrono;
+	this->startTime = duration<double>(system_clock::now().time_since_epoch()).count();
+	this->stopTime = std::numeric_limits<double>::infinity();
 	this->startDay = floor<days>(system_clock::now());
 }
 
@@ -59,6 +66,7 @@ void JournalModelCollection::placeStopBookmarks() {
 		matchingJournal->containedFiles.insert(journalFile);
 	}
 	using namespace std::chrono;
+	this->stopTime = duration<double>(system_clock::now().time_since_epoch()).count();
 	this->stopDay = floor<days>(system_clock::now());
 }
 
@@ -167,7 +175,11 @@ int JournalModelCollection::dumpToFile(std::string fileName) {
 
 	fs::path journalDirPath(std::string(journalDir) + fileName + JOURNAL_FILE_ENDING);
 
-	std::ofstream ostrm(journalDirPath);
+	// Buffers must be set before opening, and outlive the streams using them
+	std::vector<char> outputBuffer(MERGE_BUFFER_SIZE);
+	std::ofstream ostrm;
+	ostrm.rdbuf()->pubsetbuf(outputBuffer.data(), static_cast<std::streamsize>(outputBuffer.size()));
+	ostrm.open(journalDirPath);
 	if (!ostrm.is_open()) {
 		RCLCPP_ERROR(get_logger(), "Unable to open %s for writing", journalDirPath.c_str());
 		return -1;
@@ -175,101 +187,98 @@ int JournalModelCollection::dumpToFile(std::string fileName) {
 
 	/*!
 	 * \brief The JournalFileSection struct is used to keep track of reading one
-	 *			file section which is part of a journal.
+	 *			file section which is part of a journal. Lines without a timestamp
+	 *			continue a multi-line record, and inherit the time of the line before.
 	 */
 	struct JournalFileSection {
 		fs::path path;				//!< Path to the file referred to
+		std::vector<char> buffer;	//!< Read buffer for ::istrm member
 		std::ifstream istrm;		//!< Input stream for accessing the file
-		std::streampos beg;			//!< First character index of relevant section
-		std::streampos end;			//!< Last character index of relevant section
 		std::string lastRead;		//!< Last read string from ::istrm member
+		double lastTime = -std::numeric_limits<double>::infinity();	//!< Time of ::lastRead
+		double endTime = std::numeric_limits<double>::infinity();	//!< Time after which reading stops
 		unsigned int nReadRows = 0;	//!< Number of rows read from ::istrm member
-		//! The < operator tells which of two is oldest at its last read line
-		bool operator< (const JournalFileSection &other) const {
-			std::istringstream strThis(lastRead), strOther(other.lastRead);
-			double timeThis = 0.0, timeOther = 0.0;
-			strThis >> timeThis;
-			strOther >> timeOther;
-			return timeThis < timeOther;
+
+		//! \brief Reads the next line and its time. Returns false at end of section.
+		bool readNext() {
+			if (!std::getline(istrm, lastRead)) {
+				return false;
+			}
+			char* timeEnd = nullptr;
+			auto time = std::strtod(lastRead.c_str(), &timeEnd);
+			if (timeEnd != lastRead.c_str() && *timeEnd == ':') {
+				lastTime = time;
+			}
+			nReadRows++;
+			return lastTime <= endTime;
 		}
 	};
 
 	RCLCPP_INFO(get_logger(), "Creating output log for journals\n%s", this->toString().c_str());
-	// Fill a vector with all files pertaining to recorded data,
-	// along with the correct start and stop references.
-	// After this, the vector contains opened streams positioned
-	// for reading at the line closest to the start time.
+	// Fill a vector with all files pertaining to recorded data, along
+	// with the time bounds of the test. After this, the vector contains
+	// opened streams positioned at the first line after the start time.
 	std::vector<JournalFileSection> inputFiles;
+	inputFiles.reserve(std::accumulate(this->begin(), this->end(), size_t(0),
+		[](size_t n, const JournalModel& journal) { return n + journal.containedFiles.size(); }));
 	for (const auto &journal : *this) {
 		for (const fs::path &file : journal.containedFiles) {
 			JournalFileSection &section = inputFiles.emplace_back();
 			section.path = file;
+			section.endTime = this->stopTime;
+			section.buffer.resize(MERGE_BUFFER_SIZE);
+			section.istrm.rdbuf()->pubsetbuf(section.buffer.data(), static_cast<std::streamsize>(section.buffer.size()));
 			section.istrm.open(file);
-			if (section.istrm.is_open()) {
-				RCLCPP_DEBUG(get_logger(), "Opened file %s", file.c_str());
-				if (file == journal.startReference.getFilePath()) {
-					section.beg = journal.startReference.getPosition();
-				}
-				else {
-					section.istrm.seekg(0, section.istrm.beg);
-					section.beg = section.istrm.tellg();
-				}
-
-				if (file == journal.stopReference.getFilePath()) {
-					section.end = journal.stopReference.getPosition();
-				}
-				else {
-					section.istrm.seekg(0, section.istrm.end);
-					section.end = section.istrm.tellg();
-				}
-				section.istrm.seekg(section.beg);
-
-				if (section.end - section.beg < 0) {
-					RCLCPP_ERROR(get_logger(), "End precedes beginning in file %s: beg @%ld, end @%ld",
-							   file.c_str(), (long int)section.beg, (long int)section.end);
-					section.istrm.close();
-					inputFiles.pop_back();
-				}
-				else if (section.beg == section.end) {
-					RCLCPP_DEBUG(get_logger(), "No data found");
-					section.istrm.close();
-					inputFiles.pop_back();
-				}
-				else if (!std::getline(section.istrm, section.lastRead)) {
-					RCLCPP_DEBUG(get_logger(), "Failed to read line");
-					section.istrm.close();
-					inputFiles.pop_back();
-				}
-				else {
-					section.nReadRows++;
-				}
-			}
-			else {
+			if (!section.istrm.is_open()) {
 				RCLCPP_ERROR(get_logger(), "Unable to open %s for reading", file.c_str());
 				inputFiles.pop_back();
 				retval = -1;
+				continue;
+			}
+			RCLCPP_DEBUG(get_logger(), "Opened file %s", file.c_str());
+			// Records are written shortly after they are stamped, so a byte position
+			// stored at the start time is a lower bound. Otherwise, seek by time.
+			std::streampos beg = 0;
+			if (file == journal.startReference.getFilePath()) {
+				beg = journal.startReference.getPosition();
+			}
+			else {
+				beg = findIndexedPosition(file, this->startTime);
+			}
+			section.istrm.seekg(beg);
+
+			bool hasData;
+			do {
+				hasData = section.readNext();
+			} while (hasData && section.lastTime < this->startTime);
+			if (!hasData) {
+				RCLCPP_DEBUG(get_logger(), "No data found in file %s", file.c_str());
+				inputFiles.pop_back();
 			}
 		}
 	}
 
-	// Each iteration, transfer the line starting with the oldest timestamp to the output file and read the next
-	while(!inputFiles.empty()) {
-		std::vector<JournalFileSection>::iterator oldestFile = std::min_element(inputFiles.begin(), inputFiles.end());
-		ostrm << oldestFile->lastRead << std::endl;
-		if (!std::getline(oldestFile->istrm, oldestFile->lastRead)) {
-			RCLCPP_DEBUG(get_logger(), "Reached end of journal file %s, read %u rows",
-					   oldestFile->path.c_str(), oldestFile->nReadRows);
-			oldestFile->istrm.close();
-			inputFiles.erase(oldestFile);
-		}
-		else if (oldestFile->nReadRows > oldestFile->end - oldestFile->beg) {
-			RCLCPP_DEBUG(get_logger(), "Read %u rows from journal file %s",
-					   oldestFile->nReadRows, oldestFile->path.c_str());
-			oldestFile->istrm.close();
-			inputFiles.erase(oldestFile);
+	// Each iteration, transfer the line with the oldest timestamp to the output file and
+	// read the next from the same file. The heap holds indices to sections, oldest on top.
+	auto isNewer = [&inputFiles](const size_t a, const size_t b) {
+		return inputFiles[a].lastTime > inputFiles[b].lastTime;
+	};
+	std::priority_queue<size_t, std::vector<size_t>, decltype(isNewer)> oldestFiles(isNewer);
+	for (size_t i = 0; i < inputFiles.size(); ++i) {
+		oldestFiles.push(i);
+	}
+	while (!oldestFiles.empty()) {
+		auto oldest = oldestFiles.top();
+		oldestFiles.pop();
+		auto& section = inputFiles[oldest];
+		ostrm << section.lastRead << '\n';
+		if (section.readNext()) {
+			oldestFiles.push(oldest);
 		}
 		else {
-			oldestFile->nReadRows++;
+			RCLCPP_DEBUG(get_logger(), "Read %u rows from journal file %s",
+					   section.nReadRows, section.path.c_str());
+			section.istrm.close();
 		}
 	}
 
@@ -278,6 +287,58 @@ int JournalModelCollection::dumpToFile(std::string fileName) {
 	return retval;
 }
 
+/*!
+ * \brief getLatestOutputJournal Finds the most recently written journal generated
+ *			by ::dumpToFile with the specified name.
+ * \param fileName Name passed to ::dumpToFile
+ * \return Path to the journal
+ */
+fs::path JournalModelCollection::getLatestOutputJournal(const std::string &fileName) {
+	char journalDir[PATH_MAX] = {'\0'};
+	UtilGetJournalDirectoryPath(journalDir, sizeof (journalDir));
+	fs::path latest;
+	fs::file_time_type latestTime;
+	for (const auto &entry : fs::directory_iterator(std::string(journalDir))) {
+		auto entryFileName = entry.path().filename().string();
+		if (fs::is_regular_file(entry.status())
+				&& entry.path().extension() == JOURNAL_FILE_ENDING
+				&& entryFileName.rfind(fileName + "_", 0) == 0
+				&& (latest.empty() || entry.last_write_time() > latestTime)) {
+			latest = entry.path();
+			latestTime = entry.last_write_time();
+		}
+	}
+	if (latest.empty()) {
+		throw std::runtime_error("No journal named " + fileName + " found in " + journalDir);
+	}
+	return latest;
+}
+
+/*!
+ * \brief findIndexedPosition Looks up the position of the last indexed record
+ *			recorded before the specified time, using the sparse index written
+ *			alongside a journal. Since records may be written slightly out of
+ *			order, the lookup is made some margin before the specified time.
+ * \param journalFile Journal for which the position is to be found
+ * \param time Time in seconds since epoch
+ * \return Position from which to begin reading, or the beginning of the file
+ *			if no index exists
+ */
+std::streampos JournalModelCollection::findIndexedPosition(const fs::path &journalFile, const double time) {
+	constexpr double reorderMargin = 1.0;
+	std::ifstream istrm(journalFile.string() + JOURNAL_INDEX_FILE_ENDING);
+	double indexedTime;
+	long offset;
+	std::streampos position = 0;
+	while (istrm >> indexedTime >> offset) {
+		if (indexedTime >= time - reorderMargin) {
+			break;
+		}
+		position = offset;
+	}
+	return position;
+}
+
 /*!
  * \brief getCurrentDateAsString Creates a string on the format YYYY-MM-DD of the current date.
  * \return A std::string containing the current date
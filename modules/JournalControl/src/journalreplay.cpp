@@ -0,0 +1,238 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include "journalreplay.hpp"
+#include "journal.hpp"
+
+#include <arpa/inet.h>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+#define TEXT_MONITOR_FIELD_COUNT 15
+
+void JournalReplay::start(
+		const fs::path& journal,
+		const double speed) {
+	stop();
+	if (!fs::exists(journal)) {
+		throw std::invalid_argument("Journal " + journal.string() + " does not exist");
+	}
+	if (!std::isfinite(speed) || speed < 0.0) {
+		throw std::invalid_argument("Invalid replay speed " + std::to_string(speed));
+	}
+	{
+		std::lock_guard<std::mutex> lock(stopMutex);
+		stopRequested = false;
+	}
+	running = true;
+	replayThread = std::thread(&JournalReplay::replay, this, journal, speed);
+}
+
+void JournalReplay::stop() {
+	{
+		std::lock_guard<std::mutex> lock(stopMutex);
+		stopRequested = true;
+	}
+	stopCondition.notify_all();
+	if (replayThread.joinable()) {
+		replayThread.join();
+	}
+}
+
+/*!
+ * \brief Sleeps until the specified time, or until a stop is requested.
+ * \return false if a stop was requested, true otherwise
+ */
+bool JournalReplay::waitUntil(
+		const std::chrono::steady_clock::time_point& time) {
+	std::unique_lock<std::mutex> lock(stopMutex);
+	return !stopCondition.wait_until(lock, time, [this]{ return stopRequested; });
+}
+
+void JournalReplay::replay(
+		const fs::path journal,
+		const double speed) {
+	using namespace std::chrono;
+	std::ifstream istrm(journal, std::ios_base::in | std::ios_base::binary);
+	unsigned long nPublished = 0;
+	try {
+		if (!istrm.is_open()) {
+			throw std::runtime_error("Unable to open " + journal.string() + " for reading");
+		}
+		auto readRecord = isBinaryJournal(istrm) ? readBinaryRecord : readTextRecord;
+		if (speed > 0.0) {
+			RCLCPP_INFO(get_logger(), "Replaying %s at %.2fx speed", journal.c_str(), speed);
+		}
+		else {
+			RCLCPP_INFO(get_logger(), "Replaying %s as fast as possible", journal.c_str());
+		}
+
+		Record record;
+		double firstRecordTime = 0.0;
+		steady_clock::time_point startTime;
+		while (readRecord(istrm, record)) {
+			if (nPublished == 0) {
+				firstRecordTime = record.recordTime;
+				startTime = steady_clock::now();
+			}
+			if (speed > 0.0) {
+				auto offset = duration<double>((record.recordTime - firstRecordTime) / speed);
+				if (!waitUntil(startTime + duration_cast<steady_clock::duration>(offset))) {
+					break;
+				}
+			}
+			else if (nPublished % 1024 == 0 && !waitUntil(steady_clock::time_point::min())) {
+				break;
+			}
+			publish(record);
+			nPublished++;
+		}
+		auto elapsed = duration<double>(steady_clock::now() - startTime).count();
+		RCLCPP_INFO(get_logger(), "Replayed %lu monitor messages from %s in %.3f s",
+					nPublished, journal.c_str(), nPublished > 0 ? elapsed : 0.0);
+	} catch (std::exception& e) {
+		RCLCPP_ERROR(get_logger(), "Replay of %s failed after %lu messages: %s",
+					 journal.c_str(), nPublished, e.what());
+	}
+	running = false;
+}
+
+void JournalReplay::publish(
+		const Record& record) {
+	auto pub = monitorPubs.find(record.objectId);
+	if (pub == monitorPubs.end()) {
+		pub = monitorPubs.emplace(record.objectId,
+			std::make_unique<ROSChannels::Monitor::Pub>(node, record.objectId)).first;
+	}
+	pub->second->publish(ROSChannels::Monitor::fromISOMonr(record.objectId, record.monitorData));
+}
+
+/*!
+ * \brief Checks for a binary journal file header, and verifies that the records
+ *			were written with the same layout as this build reads. If no header is
+ *			found the stream is rewound.
+ */
+bool JournalReplay::isBinaryJournal(
+		std::istream& istrm) {
+	JournalBinaryFileHeader header;
+	if (istrm.read(reinterpret_cast<char*>(&header), sizeof (header))
+			&& std::memcmp(header.magic, JOURNAL_BINARY_MAGIC, sizeof (JOURNAL_BINARY_MAGIC)) == 0) {
+		if (header.version != JOURNAL_BINARY_VERSION
+				|| header.monitorRecordSize != sizeof (JournalBinaryMonitorRecord)) {
+			throw std::runtime_error("Binary journal version " + std::to_string(header.version)
+									 + " is incompatible with this version of ATOS");
+		}
+		return true;
+	}
+	istrm.clear();
+	istrm.seekg(0);
+	return false;
+}
+
+bool JournalReplay::readBinaryRecord(
+		std::istream& istrm,
+		Record& record) {
+	JournalBinaryRecordHeader header;
+	while (istrm.read(reinterpret_cast<char*>(&header), sizeof (header))) {
+		if (header.type == JOURNAL_RECORD_MONITOR_DATA && header.length == sizeof (JournalBinaryMonitorRecord)) {
+			JournalBinaryMonitorRecord data;
+			if (!istrm.read(reinterpret_cast<char*>(&data), sizeof (data))) {
+				return false;
+			}
+			record.recordTime = header.recordTime;
+			record.objectId = data.clientID;
+			record.monitorData = data.monitorData;
+			return true;
+		}
+		istrm.ignore(header.length);
+	}
+	return false;
+}
+
+bool JournalReplay::readTextRecord(
+		std::istream& istrm,
+		Record& record) {
+	std::string line;
+	while (std::getline(istrm, line)) {
+		if (parseTextMonitor(line, record)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/*!
+ * \brief Parses a line written by JournalRecordMonitorData to a text journal.
+ * \return false if the line does not hold monitor data
+ */
+bool JournalReplay::parseTextMonitor(
+		const std::string& line,
+		Record& record) {
+	static const std::unordered_map<std::string,ObjectStateType> objectStates = [] {
+		std::unordered_map<std::string,ObjectStateType> states;
+		for (auto state : {OBJECT_STATE_UNKNOWN, OBJECT_STATE_INIT, OBJECT_STATE_ARMED,
+				OBJECT_STATE_DISARMED, OBJECT_STATE_RUNNING, OBJECT_STATE_POSTRUN,
+				OBJECT_STATE_REMOTE_CONTROL, OBJECT_STATE_ABORTING, OBJECT_STATE_PRE_ARMING,
+				OBJECT_STATE_PRE_RUNNING}) {
+			states[objectStateToASCII(state)] = state;
+		}
+		return states;
+	}();
+
+	char* end = nullptr;
+	record.recordTime = std::strtod(line.c_str(), &end);
+	if (end == line.c_str() || *end != ':') {
+		return false;
+	}
+	std::vector<std::string> fields;
+	std::istringstream data(std::string(end + 1));
+	for (std::string field; std::getline(data, field, ';');) {
+		fields.push_back(field);
+	}
+	struct in_addr ip;
+	if (fields.size() < TEXT_MONITOR_FIELD_COUNT
+			|| inet_pton(AF_INET, fields[2].c_str(), &ip) != 1) {
+		return false;
+	}
+	auto id = std::strtoul(fields[1].c_str(), &end, 10);
+	if (end == fields[1].c_str()) {
+		return false;
+	}
+	record.objectId = static_cast<uint32_t>(id);
+
+	auto parse = [](const std::string& field, double& value) {
+		value = std::strtod(field.c_str(), nullptr);
+		return !std::isnan(value);
+	};
+	auto& monr = record.monitorData;
+	monr = {};
+	double timestamp;
+	if ((monr.isTimestampValid = parse(fields[0], timestamp))) {
+		monr.timestamp.tv_sec = static_cast<time_t>(std::floor(timestamp));
+		monr.timestamp.tv_usec = static_cast<suseconds_t>(std::round((timestamp - std::floor(timestamp)) * 1e6));
+	}
+	monr.position.isPositionValid = parse(fields[3], monr.position.xCoord_m)
+			& parse(fields[4], monr.position.yCoord_m)
+			& parse(fields[5], monr.position.zCoord_m);
+	monr.position.isXcoordValid = monr.position.isYcoordValid = monr.position.isZcoordValid
+			= monr.position.isPositionValid;
+	monr.position.isHeadingValid = parse(fields[6], monr.position.heading_rad);
+	monr.speed.isLongitudinalValid = parse(fields[7], monr.speed.longitudinal_m_s);
+	monr.speed.isLateralValid = parse(fields[8], monr.speed.lateral_m_s);
+	monr.acceleration.isLongitudinalValid = parse(fields[9], monr.acceleration.longitudinal_m_s2);
+	monr.acceleration.isLateralValid = parse(fields[10], monr.acceleration.lateral_m_s2);
+	monr.drivingDirection = fields[11] == "FWD" ? OBJECT_DRIVE_DIRECTION_FORWARD
+						  : fields[11] == "REV" ? OBJECT_DRIVE_DIRECTION_BACKWARD
+												: OBJECT_DRIVE_DIRECTION_UNAVAILABLE;
+	auto state = objectStates.find(fields[12]);
+	monr.state = state != objectStates.end() ? state->second : OBJECT_STATE_UNKNOWN;
+	monr.armReadiness = fields[13] == "READY_TO_ARM" ? OBJECT_READY_TO_ARM
+					  : fields[13] == "NOT_READY_TO_ARM" ? OBJECT_NOT_READY_TO_ARM
+														 : OBJECT_READY_TO_ARM_UNAVAILABLE;
+	return true;
+}
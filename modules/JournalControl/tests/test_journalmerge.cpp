@@ -0,0 +1,246 @@
+#include "journalmodelcollection.hpp"
+#include "journal.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define N_INDEX_TEST_RECORDS 50000
+#define N_BENCHMARK_JOURNALS 4
+#define BENCHMARK_JOURNAL_SIZE_MB 256
+#define BENCHMARK_MULTILINE_INTERVAL 50
+
+static void merge_test(const fs::path& dataDir, const fs::path& journalDir);
+static void index_test(const fs::path& journalDir);
+static void benchmark(const fs::path& journalDir, const unsigned long sizeMB);
+static std::vector<std::string> read_lines(const fs::path& file);
+
+/*!
+ * \brief Merges the journals in the directory given as first argument, checks
+ *			the sparse index written by the journal writer and reports the merge
+ *			throughput on synthetic journals. The total benchmark journal size in
+ *			MB can be given as second argument. The journals are written to a
+ *			temporary home directory.
+ */
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		std::cerr << "Usage: " << argv[0] << " <journal directory> [benchmark size in MB]" << std::endl;
+		exit(EXIT_FAILURE);
+	}
+	char home[] = "/tmp/test_journalmerge_XXXXXX";
+	if (mkdtemp(home) == nullptr) {
+		std::cerr << "Unable to create temporary directory" << std::endl;
+		exit(EXIT_FAILURE);
+	}
+	setenv("HOME", home, 1);
+	char journalDir[PATH_MAX] = {'\0'};
+	UtilGetJournalDirectoryPath(journalDir, sizeof (journalDir));
+
+	int retval = EXIT_SUCCESS;
+	try {
+		fs::create_directories(journalDir);
+		merge_test(argv[1], journalDir);
+		index_test(journalDir);
+		benchmark(journalDir, argc > 2 ? std::stoul(argv[2]) : BENCHMARK_JOURNAL_SIZE_MB);
+	}
+	catch (std::exception& e) {
+		std::cerr << "Test " << __FILE__ << " failed: " << std::endl
+				  << e.what() << std::endl;
+		retval = EXIT_FAILURE;
+	}
+	fs::remove_all(home);
+	exit(retval);
+}
+
+std::vector<std::string> read_lines(const fs::path& file) {
+	std::ifstream istrm(file);
+	if (!istrm.is_open()) {
+		throw std::runtime_error("Unable to open " + file.string());
+	}
+	std::vector<std::string> lines;
+	for (std::string line; std::getline(istrm, line); ) {
+		lines.push_back(line);
+	}
+	return lines;
+}
+
+/*!
+ * \brief Merges three journals over the interval 1000 s to 1010 s. ObjectControl
+ *			spans two files and SystemControl holds a multi-line record, both with
+ *			start bookmarks. Supervision has no start bookmark, so its file is read
+ *			from the position in its index. The record before that position was
+ *			written more than the reordering margin late and is skipped.
+ */
+void merge_test(const fs::path& dataDir, const fs::path& journalDir) {
+	for (const auto& entry : fs::directory_iterator(dataDir)) {
+		fs::copy_file(entry.path(), journalDir / entry.path().filename(), fs::copy_options::overwrite_existing);
+	}
+	auto logger = rclcpp::get_logger("test_journalmerge");
+	JournalModelCollection journals(logger);
+	auto addJournal = [&](const std::string& moduleName, const std::vector<std::string>& files,
+			const bool isBookmarked) {
+		JournalModel journal(logger);
+		journal.moduleName = moduleName;
+		for (const auto& file : files) {
+			journal.containedFiles.insert(journalDir / file);
+		}
+		if (isBookmarked) {
+			journal.startReference.place(journalDir / files.front(), true);
+		}
+		journals.insert(journal);
+	};
+	addJournal("ObjectControl", {"ObjectControl-2026-01-01.jnl", "ObjectControl-2026-01-02.jnl"}, true);
+	addJournal("SystemControl", {"SystemControl-2026-01-01.jnl"}, true);
+	addJournal("Supervision", {"Supervision-2026-01-01.jnl"}, false);
+	journals.setTimeInterval(1000.0, 1010.0);
+
+	if (journals.dumpToFile("merged") != 0) {
+		throw std::runtime_error("Merging journals failed");
+	}
+	const std::vector<std::string> expected = {
+		"1000.100000: ObjectControl A1",
+		"1000.200000: SystemControl B1",
+		"1001.300000: Supervision C1",
+		"1002.100000: ObjectControl A2",
+		"1003.500000: SystemControl multi-line record",
+		"  continued without timestamp",
+		"  last line",
+		"1004.100000: ObjectControl A3",
+		"1005.200000: SystemControl B2",
+		"1006.100000: ObjectControl A4",
+		"1007.300000: Supervision C2",
+		"1010.000000: SystemControl at stop"
+	};
+	auto merged = read_lines(JournalModelCollection::getLatestOutputJournal("merged"));
+	for (size_t i = 0; i < std::max(merged.size(), expected.size()); ++i) {
+		auto line = i < merged.size() ? merged[i] : "<end of file>";
+		auto expectedLine = i < expected.size() ? expected[i] : "<end of file>";
+		if (line != expectedLine) {
+			throw std::runtime_error("Merged line " + std::to_string(i + 1) + " was \"" + line
+									 + "\", expected \"" + expectedLine + "\"");
+		}
+	}
+}
+
+/*!
+ * \brief Writes a journal of several megabytes and checks that its index has an
+ *			entry at the start and then at least every JOURNAL_INDEX_INTERVAL bytes,
+ *			each pointing to the start of a record stamped with the indexed time.
+ */
+void index_test(const fs::path& journalDir) {
+	if (JournalInit("IndexTest", rclcpp::get_logger("test_journalmerge")) == -1) {
+		throw std::runtime_error("Unable to open journal");
+	}
+	for (int i = 0; i < N_INDEX_TEST_RECORDS; ++i) {
+		while (JournalRecordData(JOURNAL_RECORD_STRING, "Index test record %d, padded to a typical record length", i) == -1) {
+			std::this_thread::yield();
+		}
+	}
+	JournalClose();
+
+	fs::path journalFile;
+	for (const auto& entry : fs::directory_iterator(journalDir)) {
+		if (entry.path().extension() == JOURNAL_FILE_ENDING
+				&& entry.path().filename().string().rfind("IndexTest-", 0) == 0) {
+			journalFile = entry.path();
+		}
+	}
+	if (journalFile.empty()) {
+		throw std::runtime_error("Journal file not found in " + journalDir.string());
+	}
+	std::ifstream journal(journalFile, std::ios_base::binary);
+	std::string contents((std::istreambuf_iterator<char>(journal)), std::istreambuf_iterator<char>());
+	std::ifstream index(journalFile.string() + JOURNAL_INDEX_FILE_ENDING);
+	if (!index.is_open()) {
+		throw std::runtime_error("Index of " + journalFile.string() + " not found");
+	}
+
+	double indexedTime;
+	long offset, previousOffset = -1;
+	size_t nEntries = 0;
+	while (index >> indexedTime >> offset) {
+		if (nEntries == 0 && offset != 0) {
+			throw std::runtime_error("First index entry at offset " + std::to_string(offset));
+		}
+		if (previousOffset >= 0 && offset - previousOffset < JOURNAL_INDEX_INTERVAL) {
+			throw std::runtime_error("Index entries at offsets " + std::to_string(previousOffset)
+									 + " and " + std::to_string(offset) + " are too close");
+		}
+		if (offset >= static_cast<long>(contents.size()) || (offset > 0 && contents[offset - 1] != '\n')) {
+			throw std::runtime_error("Index entry at offset " + std::to_string(offset) + " is not at a record");
+		}
+		if (std::strtod(contents.c_str() + offset, nullptr) != indexedTime) {
+			throw std::runtime_error("Record at offset " + std::to_string(offset) + " is not stamped with the indexed time");
+		}
+		previousOffset = offset;
+		++nEntries;
+	}
+	// Entries are placed at the first record of a batch, so gaps may exceed the interval somewhat
+	if (nEntries < contents.size() / (2 * JOURNAL_INDEX_INTERVAL)) {
+		throw std::runtime_error("Only " + std::to_string(nEntries) + " index entries for "
+								 + std::to_string(contents.size()) + " bytes");
+	}
+}
+
+/*!
+ * \brief Reports the time taken to merge synthetic journals with interleaved
+ *			monitor data lines and occasional multi-line records.
+ */
+void benchmark(const fs::path& journalDir, const unsigned long sizeMB) {
+	using namespace std::chrono;
+	auto logger = rclcpp::get_logger("test_journalmerge");
+	JournalModelCollection journals(logger);
+	const size_t journalSize = sizeMB * 1024 * 1024 / N_BENCHMARK_JOURNALS;
+	size_t nLines = 0, nBytes = 0;
+	for (int j = 0; j < N_BENCHMARK_JOURNALS; ++j) {
+		auto path = journalDir / ("Benchmark" + std::to_string(j) + "-2026-01-01" + JOURNAL_FILE_ENDING);
+		FILE* fp = fopen(path.c_str(), "w");
+		if (fp == nullptr) {
+			throw std::runtime_error("Unable to create " + path.string());
+		}
+		size_t size = 0;
+		for (long i = 0; size < journalSize; ++i) {
+			const double time = 1000.0 + i * 1e-3 + j * 1e-4;
+			int length = i % BENCHMARK_MULTILINE_INTERVAL == 0
+					? fprintf(fp, "%f: <!> Benchmark event %ld\n\tcontinued on a second line\n", time, i)
+					: fprintf(fp, "%f: %d 10.0.0.%d 4 %.3f %.3f 0.000 %.3f 12.500 0.000 0.100 0.000\n",
+							  time, j, j + 1, i * 0.0125, j * 3.5, std::fmod(i * 0.001, 6.283));
+			if (length < 0) {
+				fclose(fp);
+				throw std::runtime_error("Unable to write to " + path.string());
+			}
+			size += static_cast<size_t>(length);
+			nLines += i % BENCHMARK_MULTILINE_INTERVAL == 0 ? 2 : 1;
+		}
+		fclose(fp);
+		nBytes += size;
+
+		JournalModel journal(logger);
+		journal.moduleName = path.stem().string();
+		journal.containedFiles.insert(path);
+		journal.startReference.place(path, true);
+		journals.insert(journal);
+	}
+	journals.setTimeInterval(0.0, std::numeric_limits<double>::infinity());
+
+	auto start = steady_clock::now();
+	if (journals.dumpToFile("benchmark") != 0) {
+		throw std::runtime_error("Merging benchmark journals failed");
+	}
+	duration<double> elapsed = steady_clock::now() - start;
+	auto merged = JournalModelCollection::getLatestOutputJournal("benchmark");
+	if (fs::file_size(merged) != nBytes) {
+		throw std::runtime_error("Merged journal is " + std::to_string(fs::file_size(merged))
+								 + " bytes, expected " + std::to_string(nBytes));
+	}
+	std::cout << "Merged " << N_BENCHMARK_JOURNALS << " journals of " << nBytes / 1e6 << " MB and "
+			  << nLines << " lines in " << elapsed.count() << " s: " << nBytes / 1e6 / elapsed.count()
+			  << " MB/s, " << nLines / elapsed.count() << " lines/s" << std::endl;
+}
@@ -0,0 +1,45 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <sys/time.h>
+
+#include "iso22133.h"
+
+/*!
+ * \brief Short history of anchor monitor data, written by the anchor subscription
+ *			and read by the listener thread of a relative object. The history is
+ *			guarded by a sequence lock: the single writer never waits and readers
+ *			retry their copy if it was overwritten while they read it.
+ *
+ *			Readers request the anchor state at a given time, which is interpolated
+ *			between the two surrounding samples or extrapolated from the nearest
+ *			one using the anchor velocity. Extrapolation is limited to
+ *			::maxExtrapolationTime, beyond which the anchor is held where it was
+ *			then, so that lost anchor data cannot move it arbitrarily far.
+ */
+class AnchorStateHistory {
+public:
+	static constexpr std::size_t capacity = 16;	//!< Number of anchor samples kept
+	static constexpr double maxExtrapolationTime = 0.5;	//!< Longest time an anchor sample is extrapolated [s]
+
+	//! \brief Stores a new anchor sample. Must only be called from one thread.
+	void push(const ObjectMonitorType& anchor);
+	//! \brief Anchor state at the specified time, or the latest state if time is invalid.
+	//!		Returns false if no anchor data has been received.
+	bool stateAt(const struct timeval& time, const bool isTimeValid, ObjectMonitorType& state) const;
+	//! \brief Latest anchor state. Returns false if no anchor data has been received.
+	bool latest(ObjectMonitorType& state) const;
+
+private:
+	std::array<ObjectMonitorType, capacity> samples = {};
+	std::size_t newest = 0;		//!< Index of the latest sample
+	std::size_t count = 0;		//!< Number of stored samples
+	std::atomic<uint32_t> sequence = {0};	//!< Odd while a write is in progress
+};
@@ -9,6 +9,7 @@
 #include <chrono>
 #include <future>
 #include <netinet/in.h>
+#include <sys/socket.h>
 #include "loggable.hpp"
 #include "iso22133.h"
 #include "trajectory.hpp"
@@ -28,17 +29,45 @@ public:
 		  receiveBuffer(bufferLength, 0)
 	{}
 	Channel(int type, rclcpp::Logger log, int id = 0) : Channel(1024, type, log, id) {}
+
+	//! \brief Statistics collected during a bulk transfer, e.g. a trajectory upload
+	struct TransferStatistics {
+		size_t bytes = 0;		//!< Number of bytes handed to the socket
+		size_t syscalls = 0;	//!< Number of send calls needed
+		std::chrono::steady_clock::duration duration = std::chrono::steady_clock::duration::zero();
+	};
+
 	struct sockaddr_in addr = {};
 	int socket = -1;
 	int channelType = 0; //!< SOCK_STREAM or SOCK_DGRAM
 	int objectId = 0;
 	int transmitterId = 0;
 	int sentMessageCounter = 0;
-	int receivedMessageCounter = 0;
+	int receivedMessageCounter = 0;	//!< Number of received messages which have been decoded
 	std::vector<char> transmitBuffer;
 	std::vector<char> receiveBuffer;
+	std::vector<char> trajectoryBuffer;	//!< Staging buffer for encoded TRAJ chunks, allocated on first upload
+	TransferStatistics lastTrajectoryUpload;
 
 	ISOMessageID pendingMessageType(bool awaitNext = false);
+	//! \brief Makes the next queued datagram the buffered message. Datagrams are read
+	//!			from the socket in batches of up to ::receiveBatchSize with one recvmmsg
+	//!			call, each stamped with its kernel receive time. Until it has been decoded,
+	//!			::pendingMessageType and the decoding operators refer to the buffered
+	//!			message instead of peeking at the socket. Only valid for datagram channels.
+	//! \return Type of the received message, or MESSAGE_ID_INVALID if none was queued.
+	ISOMessageID receiveMessage();
+	bool hasBufferedMessage() const { return bufferedBytes > 0; }
+	//! \brief Whether datagrams read by the latest recvmmsg call remain to be received.
+	//!			These no longer make the socket readable.
+	bool hasQueuedMessages() const { return batch.next < batch.count; }
+	void discardBufferedMessage() { bufferedBytes = 0; bufferedMessageType = MESSAGE_ID_INVALID; }
+	//! \brief Discards the buffered message and everything queued on the socket. Used
+	//!			to drop messages which no handler consumed, since their length is unknown.
+	void discardPendingMessages();
+	//! \brief Time at which the pending message was received, as stamped by the kernel
+	//!			if available and otherwise the current time.
+	struct timeval *getReceiveTime(struct timeval *tv) const;
 	std::string remoteIP() const;
 	bool isValid() const { return socket != -1; }
 	void connect(std::shared_future<void> stopRequest,
@@ -58,5 +87,35 @@ public:
 	friend Channel& operator>>(Channel&,GeneralResponseMessageType&);
 
 protected:
+	//! Size of the chunks in which TRAJ messages are flushed to the socket
+	static constexpr size_t trajectoryChunkSize = 64 * 1024;
+
+	//! Maximum number of datagrams read per recvmmsg call
+	static constexpr unsigned int receiveBatchSize = 16;
+
+	//! Datagrams read by the latest recvmmsg call, stored in fixed size slots
+	struct ReceiveBatch {
+		std::vector<char> data;
+		std::vector<char> control;
+		std::vector<struct mmsghdr> headers;
+		std::vector<struct iovec> iovecs;
+		std::vector<struct timeval> receiveTimes;
+		std::vector<bool> isKernelTimestamped;
+		size_t slotSize = 0;
+		size_t count = 0;
+		size_t next = 0;
+	} batch;
+
+	size_t bufferedBytes = 0;	//!< Length of message read by ::receiveMessage, zero if none
+	size_t bufferedSlot = 0;	//!< Batch slot holding the buffered message
+	ISOMessageID bufferedMessageType = MESSAGE_ID_INVALID;
+
 	MessageHeaderType *populateHeaderType(MessageHeaderType *header);
+	const char* receivedData() const {
+		return hasBufferedMessage() ? batch.data.data() + bufferedSlot*batch.slotSize : receiveBuffer.data();
+	}
+	size_t receivedLength() const { return hasBufferedMessage() ? bufferedBytes : receiveBuffer.size(); }
+	size_t receiveBatch();
+	void consumeMessage(const size_t length);
+	void sendChunk(const char* data, size_t length, bool moreToCome, TransferStatistics& stats);
 };
\ No newline at end of file
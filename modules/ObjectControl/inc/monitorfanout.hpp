@@ -0,0 +1,53 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#pragma once
+
+#include <cstdint>
+#include <netinet/in.h>
+
+#include "CRSTransformation.hpp"
+#include "channel.hpp"
+#include "util.h"
+#include "roschannels/monitorchannel.hpp"
+#include "roschannels/navsatfixchannel.hpp"
+
+/*!
+ * \brief Converts each MONR of an object once into a compact record, from which the
+ *			monitor, NavSatFix and journal records are derived. The flat earth scale
+ *			factors of the object origin are cached until the origin changes, and the
+ *			derived messages are written into caller provided instances so that these
+ *			can be reused between MONRs.
+ */
+class MonitorFanOut {
+public:
+	//! \brief Monitor data of one MONR, converted to the units and conventions of ROS
+	typedef struct {
+		uint32_t objectId;
+		int32_t stamp_sec;
+		uint32_t stamp_nanosec;
+		uint8_t state;
+		double x_m, y_m, z_m;		//!< Zero where not valid, as in the monitor message
+		double orientationZ, orientationW;	//!< Heading as a rotation about the z axis
+		double longitudinalVelocity_m_s, lateralVelocity_m_s;
+		double longitudinalAcceleration_m_s2, lateralAcceleration_m_s2;
+	} Record;
+
+	//! \brief Converts a MONR, replacing the current record
+	void update(const MonitorMessage& monr, const GeographicPositionType& origin, const in_addr_t clientIP);
+
+	const Record& record() const { return current; }
+	//! \brief Journal entry of the current record
+	const ObjectDataType& journalData() const { return journal; }
+	//! \brief Writes the current record into every field set by ROSChannels::Monitor::fromISOMonr
+	void toMonitor(ROSChannels::Monitor::message_type& msg) const;
+	//! \brief Writes the current record into every field set by ROSChannels::NavSatFix::fromROSMonr
+	void toNavSatFix(ROSChannels::NavSatFix::message_type& msg) const;
+
+private:
+	Record current = {};
+	ObjectDataType journal = {};
+	CRSTransformation::LLHOffset originOffset;
+};
@@ -8,6 +8,7 @@
 #include <future>
 #include <chrono>
 #include <netinet/in.h>
+#include <sys/eventfd.h>
 #include "iso22133.h"
 #include "loggable.hpp"
 #include "channel.hpp"
@@ -26,7 +27,7 @@ public:
 		: Loggable(log),
 			cmd(SOCK_STREAM, log, id),
 			mntr(SOCK_DGRAM, log, id) {
-			pipe(interruptionPipeFds);
+			interruptionFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
 		}
 
 	bool isValid() const;
@@ -36,10 +37,9 @@ public:
 	void disconnect();
 	ISOMessageID pendingMessageType(bool awaitNext = false);
 	void interruptSocket() {
-		int i = 1;
-		write(interruptionPipeFds[1], &i, sizeof(i));
-		close(interruptionPipeFds[1]);
+		uint64_t i = 1;
+		write(interruptionFd, &i, sizeof(i));
 	}
 private:
-	int interruptionPipeFds[2];
+	int interruptionFd = -1;	//!< Event signalled to unblock a thread waiting in ::pendingMessageType
 };
\ No newline at end of file
@@ -18,6 +18,7 @@
 #include "atosTime.h"
 #include "testobject.hpp"
 #include "objectlistener.hpp"
+#include "objectreactor.hpp"
 #include "roschannels/commandchannels.hpp"
 #include "roschannels/monitorchannel.hpp"
 #include "roschannels/remotecontrolchannels.hpp"
@@ -26,6 +27,8 @@
 #include "roschannels/controlsignalchannel.hpp"
 #include "roschannels/objstatechangechannel.hpp"
 #include "roschannels/statechange.hpp"
+#include "roschannels/diagnosticschannel.hpp"
+#include "seqlockmem.h"
 #include "atos_interfaces/srv/get_object_ids.hpp"
 #include "atos_interfaces/srv/get_object_trajectory.hpp"
 #include "atos_interfaces/srv/get_object_ip.hpp"
@@ -37,6 +40,7 @@
 // Forward declarations
 class ObjectControlState;
 class ObjectListener;
+class ObjectReactor;
 
 namespace AbstractKinematics {
 	class Idle;
@@ -120,6 +124,7 @@ class ObjectControl : public Module
 	friend class AbsoluteKinematics::RemoteControlled;
 
 	friend class ObjectListener;
+	friend class ObjectReactor;
 
 public:
 	ObjectControl(std::shared_ptr<rclcpp::executors::MultiThreadedExecutor>);
@@ -135,6 +140,27 @@ public:
 		bool isActive;
 	} DataInjectionMap;
 
+	//! \brief Outcome of uploading the configuration to a single object.
+	typedef struct {
+		bool success = false;
+		std::string error;
+		std::chrono::steady_clock::duration duration = std::chrono::steady_clock::duration::zero();
+	} UploadResult;
+	typedef std::map<uint32_t,UploadResult> UploadReport;
+
+	//! \brief Timing of the heartbeats sent to a single object, relative to the
+	//!			deadlines of the heartbeat loop.
+	typedef struct {
+		uint64_t nSent = 0;
+		uint64_t nLate = 0;		//!< Heartbeats sent a full period or more after their deadline, or skipped
+		std::chrono::nanoseconds maxLateness = std::chrono::nanoseconds::zero();	//!< Largest delay from deadline to send
+		std::chrono::nanoseconds totalLateness = std::chrono::nanoseconds::zero();
+		std::chrono::nanoseconds maxJitter = std::chrono::nanoseconds::zero();		//!< Largest change in lateness between consecutive heartbeats
+		std::chrono::nanoseconds totalJitter = std::chrono::nanoseconds::zero();
+		std::chrono::nanoseconds lastLateness = std::chrono::nanoseconds::zero();
+	} HeartbeatStatistics;
+	typedef std::map<uint32_t,HeartbeatStatistics> HeartbeatReport;
+
 	typedef struct {
 		uint16_t actionID;
 		uint32_t objectID;
@@ -233,6 +259,7 @@ private:
 	void onRemoteControlEnableMessage(const ROSChannels::RemoteControlEnable::message_type::SharedPtr);
 	void onRemoteControlDisableMessage(const ROSChannels::RemoteControlDisable::message_type::SharedPtr);
 	void onObjectStateChangeMessage(const ROSChannels::ObjectStateChange::message_type::SharedPtr);
+	void onGeofenceBreachMessage(const ROSChannels::GeofenceBreach::message_type::SharedPtr);
 	void onControlSignalMessage(const ROSChannels::ControlSignal::message_type::SharedPtr);
 	void onPathMessage(const ROSChannels::Path::message_type::SharedPtr,const uint32_t);
 	void onRequestState(const std::shared_ptr<atos_interfaces::srv::GetObjectControlState::Request>,
@@ -244,11 +271,17 @@ private:
 	ObjectControlState* state;					//!< State of module
 	std::map<uint32_t,std::shared_ptr<TestObject>> objects;		//!< List of configured test participants
 	std::map<uint32_t,ObjectListener> objectListeners;
+	std::unique_ptr<ObjectReactor> reactor;		//!< Handles all objects' messages if io_reactor_threads > 0
 	std::map<uint16_t,std::function<void()>> storedActions;
+	UploadReport uploadReport;					//!< Per object outcome of the most recent configuration uploads
+	std::mutex uploadReportMutex;
 	std::mutex monitorTimeMutex;
 	static constexpr auto heartbeatPeriod = std::chrono::milliseconds(1000 / HEAB_FREQUENCY_HZ);
 	std::thread safetyThread;
 	std::promise<void> stopHeartbeatSignal;
+	HeartbeatReport heartbeatReport;			//!< Per object heartbeat timing since the heartbeat thread started
+	std::shared_ptr<SeqlockMemory> monitorSnapshots;	//!< Latest monitor data of each object, read by SystemControl
+	std::mutex heartbeatReportMutex;
 
 	std::shared_future<void> connStopReqFuture;	//!< Request to stop a connection attempt
 	std::promise<void> connStopReqPromise;		//!< Promise that the above value will be emitted
@@ -272,14 +305,18 @@ private:
 	std::shared_ptr<ROSChannels::ControlSignal::Sub> controlSignalSub;	//!< Pointer to subscriber to receive control signal messages with percentage
 	ROSChannels::ResetTestObjects::Sub scnResetTestObjectsSub;	//!< Subscriber to scenario reset test requests
 	ROSChannels::ReloadObjectSettings::Sub scnReloadObjectSettingsSub;	//!< Subscriber to scenario reset test requests
+	ROSChannels::GeofenceBreach::Sub geofenceBreachSub;	//!< Subscriber to objects breaching geofences
 
 	rclcpp::TimerBase::SharedPtr objectsConnectedTimer;	//!< Timer to periodically publish connected objects
+	rclcpp::TimerBase::SharedPtr heartbeatReportTimer;	//!< Timer to periodically publish heartbeat timing
 
 	ROSChannels::Failure::Pub failurePub;					//!< Publisher to scenario failure reports
 	ROSChannels::Abort::Pub scnAbortPub;					//!< Publisher to scenario abort reports
 	ROSChannels::ObjectsConnected::Pub objectsConnectedPub;	//!< Publisher to report that objects have been connected
 	ROSChannels::ConnectedObjectIds::Pub connectedObjectIdsPub;	//!< Publisher to periodically report connected object ids
 	ROSChannels::StateChange::Pub stateChangePub;			//!< Publisher to report state changes
+	ROSChannels::Diagnostics::Pub diagnosticsPub;			//!< Publisher to periodically report heartbeat timing
+	std::map<uint32_t,uint64_t> publishedLateHeartbeats;	//!< Late heartbeats per object at the last diagnostics report
 	std::unordered_map<uint32_t,ROSChannels::Path::Pub> pathPublishers;
 	std::unordered_map<uint32_t,ROSChannels::GNSSPath::Pub> gnssPathPublishers;
 	rclcpp::Client<atos_interfaces::srv::GetObjectIds>::SharedPtr idClient;	//!< Client to request object ids
@@ -310,7 +347,18 @@ private:
 	void publishObjectIds();
 
 	void startSafetyThread();
+	//! \brief Checks for MONR timeouts and sends HEAB to all connected objects once
+	//!			per heartbeat period, until ::stopHeartbeatSignal is set. Objects are
+	//!			visited in a flat array captured at start, and sends do not block.
 	void heartbeat();
+	//! \brief Get a copy of the heartbeat timing of the running heartbeat thread,
+	//!			updated once per second.
+	HeartbeatReport getHeartbeatReport();
+	//! \brief Log a summary of the per object heartbeat timing.
+	void logHeartbeatReport(const HeartbeatReport& report) const;
+	//! \brief Publish the per object heartbeat timing as diagnostics, with a warning
+	//!			level for objects which were sent late heartbeats since the last report.
+	void publishHeartbeatReport();
 
 	//! Configuration methods
 	//! \brief Read the configured object and trajectory files and load related data
@@ -318,13 +366,21 @@ private:
 	void loadScenario();
 	//! \brief Read all object files and fill the list of TestObjects.
 	void loadObjectFiles();
+	//! \brief Mark all monitor snapshot slots as unused.
+	void clearMonitorSnapshots();
 	//! \brief Transform the scenario trajectories relative to the trajectory of the
 	//!			specified object.
 	void transformScenarioRelativeTo(const uint32_t objectID);
-	//! \brief Upload the configuration in the ScenarioHandler to all connected objects.
-	void uploadAllConfigurations();
-	//! \brief Upload the configuration in the ScenarioHandler to the connected obj	std::unique_ptr<ScenarioHandler> scenarioHandler;
-	void uploadObjectConfiguration(const uint32_t id);
+	//! \brief Upload the configuration to all connected objects concurrently, using at
+	//!			most max_parallel_uploads worker threads. Failures are collected per object
+	//!			in the returned report instead of aborting the remaining uploads.
+	UploadReport uploadAllConfigurations();
+	//! \brief Upload the configuration to the specified object and record the outcome.
+	UploadResult uploadObjectConfiguration(const uint32_t id);
+	//! \brief Log a summary of the per object upload outcomes.
+	void logUploadReport(const UploadReport& report) const;
+	//! \brief Get a copy of the upload outcomes recorded since the last connection attempt.
+	UploadReport getUploadReport();
 	//! \brief Clear loaded data and object list.
 	void clearScenario();
 
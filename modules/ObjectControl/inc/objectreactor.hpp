@@ -0,0 +1,75 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#pragma once
+
+#include "testobject.hpp"
+#include "loggable.hpp"
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ObjectControl;
+
+/*!
+ * \brief The ObjectReactor class is an alternative to running one ObjectListener
+ *			thread per object. A small, fixed number of epoll threads own the
+ *			monitor and command sockets of all connected objects, and dispatch
+ *			messages to the objects as they arrive. Each object is served by
+ *			exactly one thread, so its messages are handled in order.
+ */
+class ObjectReactor : public Loggable
+{
+public:
+	ObjectReactor(
+		ObjectControl*,
+		const unsigned int nThreads,
+		const bool pinThreads,
+		rclcpp::Logger
+	);
+	~ObjectReactor();
+
+	//! \brief Start handling messages from a connected object.
+	void add(std::shared_ptr<TestObject>);
+	//! \brief Stop handling messages from an object. Does not close its sockets.
+	void remove(const uint32_t id);
+private:
+	struct Registration;
+	//! Identifies which socket of which object an epoll event refers to
+	struct Source {
+		Registration* owner;
+		bool isMonitor;
+	};
+	struct Registration {
+		std::shared_ptr<TestObject> obj;
+		int epollFd = -1;
+		int monitorSocket = -1;
+		int commandSocket = -1;
+		std::atomic<bool> active;
+		Source sources[2];
+	};
+	struct Worker {
+		int epollFd = -1;
+		std::thread thread;
+	};
+
+	static constexpr int maxEventsPerWait = 64;
+
+	ObjectControl* handler;
+	int stopFd = -1;	//!< Event signalled to make all worker threads exit
+	std::vector<Worker> workers;
+	std::mutex registrationMutex;
+	//! Registrations are only freed on destruction, since a worker may still hold
+	//! an event referring to one which has been removed
+	std::vector<std::unique_ptr<Registration>> registrations;
+	std::map<uint32_t,Registration*> activeRegistrations;
+	size_t nextWorker = 0;
+
+	void run(const int epollFd);
+	void deactivate(Registration&);
+};
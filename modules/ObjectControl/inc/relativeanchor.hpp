@@ -17,7 +17,7 @@ public:
 	RelativeAnchor& operator=(const RelativeAnchor&) = delete;
 	RelativeAnchor& operator=(RelativeAnchor&&) = default;
 
-    virtual void publishMonr(const ROSChannels::Monitor::message_type) override;
+    virtual void publishMonr(const ROSChannels::Monitor::message_type&) override;
 
 private:
     ROSChannels::Monitor::AnchorPub anchorPub;
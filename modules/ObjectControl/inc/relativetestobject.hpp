@@ -6,6 +6,7 @@
 #pragma once
 
 #include "testobject.hpp"
+#include "anchorstate.hpp"
 #include "roschannels/monitorchannel.hpp"
 #include "positioning.h"
 
@@ -25,6 +26,6 @@ private:
     virtual MonitorMessage readMonitorMessage() override;
     
     ROSChannels::Monitor::AnchorSub anchorSub;
-    ObjectMonitorType lastAnchorMonr;
+    AnchorStateHistory anchorHistory;
     void updateAnchor(const ROSChannels::Monitor::message_type::SharedPtr);
 };
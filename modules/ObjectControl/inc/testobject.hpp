@@ -12,6 +12,8 @@
 #include <vector>
 #include "trajectory.hpp"
 #include "objectconfig.hpp"
+#include "monitorfanout.hpp"
+#include "seqlockmem.h"
 #include "osi_handler.hpp"
 #include "roschannels/controlsignalchannel.hpp"
 #include "roschannels/navsatfixchannel.hpp"
@@ -47,7 +49,7 @@ public:
 
 	virtual uint32_t getTransmitterID() const { return conf.getTransmitterID(); }
 	virtual std::string getTrajectoryFileName() const { return conf.getTrajectoryFileName(); }
-	virtual ATOS::Trajectory getTrajectory() const { return conf.getTrajectory(); }
+	virtual std::shared_ptr<const ATOS::Trajectory> getTrajectory() const { return conf.getTrajectory(); }
 	virtual GeographicPositionType getOrigin() const { return conf.getOrigin(); }
 	virtual ObjectStateType getState(const bool awaitUpdate);
 	virtual ObjectStateType getState(const bool awaitUpdate, const std::chrono::milliseconds timeout);
@@ -64,6 +66,8 @@ public:
 	virtual void setObjectConfig(ObjectConfig& newObjectConfig);
 	virtual void setTriggerStart(const bool startOnTrigger = true);
 	virtual void setOrigin(const GeographicPositionType&);
+	//! \brief Set the shared memory slot to which the latest monitor data is written.
+	virtual void setMonitorSnapshotSlot(std::shared_ptr<SeqlockMemory> memory, const unsigned int slot);
 	virtual void interruptSocket() { comms.interruptSocket();}
 	
 	virtual bool isAnchor() const { return conf.isAnchor(); }
@@ -94,8 +98,8 @@ public:
 					 const std::chrono::system_clock::time_point& timestamp);
 
 	virtual void sendControlSignal(const ControlSignalPercentage::SharedPtr csp);
-	virtual void publishMonr(const ROSChannels::Monitor::message_type);
-	virtual void publishNavSatFix(const ROSChannels::NavSatFix::message_type);
+	virtual void publishMonr(const ROSChannels::Monitor::message_type&);
+	virtual void publishNavSatFix(const ROSChannels::NavSatFix::message_type&);
 
 	virtual std::chrono::milliseconds getTimeSinceLastMonitor() const {
 		if (lastMonitorTime.time_since_epoch().count() == 0) {
@@ -128,6 +132,14 @@ public:
 		return retval;
 	}
 	virtual void handleISOMessage(bool awaitNext = false);
+	//! \brief Reads and handles all datagrams queued on the monitor channel, reading
+	//!			each one from the socket exactly once. Intended for event driven callers
+	//!			which have been notified that the monitor socket is readable.
+	virtual void handleQueuedMonitorMessages();
+	//! \brief Handles a message pending on the command channel.
+	virtual void handleCommandMessage();
+	virtual int getMonitorSocket() const { return comms.mntr.socket; }
+	virtual int getCommandSocket() const { return comms.cmd.socket; }
 
 protected:
 	using clock = std::chrono::steady_clock;
@@ -136,6 +148,11 @@ protected:
 	ObjectStateType state = OBJECT_STATE_UNKNOWN;
 	std::shared_ptr<ROSChannels::Monitor::Pub> monrPub;
 	std::shared_ptr<ROSChannels::NavSatFix::Pub> navSatFixPub;
+	MonitorFanOut monitorFanOut;	//!< Conversion of the latest MONR for publishing
+	ROSChannels::Monitor::message_type monitorMessage;		//!< Reused for each MONR
+	ROSChannels::NavSatFix::message_type navSatFixMessage;	//!< Reused for each MONR
+	std::shared_ptr<SeqlockMemory> monitorSnapshots;	//!< Memory to which the latest monitor data is written, if set
+	unsigned int monitorSnapshotSlot = 0;			//!< Slot of this object in ::monitorSnapshots
 	std::shared_ptr<ROSChannels::Path::Sub> pathSub;
 	std::shared_ptr<ROSChannels::ObjectStateChange::Pub> stateChangePub;
 	std::shared_ptr<ROSChannels::Path::message_type> lastReceivedPath;
@@ -143,6 +160,8 @@ protected:
 	virtual void onPathMessage(const ROSChannels::Path::message_type::SharedPtr msg, int id);
 	virtual void publishMonitor(MonitorMessage& monr);
 	virtual void publishStateChange(ObjectStateType &prevObjState);
+	virtual void dispatchISOMessage(const ISOMessageID message);
+	void dispatchCommandMessage(const ISOMessageID message);
 
 	ObjectConfig conf;
 
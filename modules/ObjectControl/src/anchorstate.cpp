@@ -0,0 +1,146 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include "anchorstate.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+double seconds(const struct timeval& tv) {
+	return static_cast<double>(tv.tv_sec) + static_cast<double>(tv.tv_usec) * 1e-6;
+}
+
+double wrapToPi(const double angle) {
+	return std::remainder(angle, 2.0*M_PI);
+}
+
+double lerp(const double a, const double b, const double fraction) {
+	return a + fraction*(b - a);
+}
+
+/*!
+ * \brief extrapolate Moves the anchor sample along its velocity vector
+ * \param state Anchor sample to move
+ * \param dt Time to move it, in seconds, limited to AnchorStateHistory::maxExtrapolationTime
+ */
+void extrapolate(ObjectMonitorType& state, double dt) {
+	if (!state.speed.isLongitudinalValid || !state.speed.isLateralValid
+			|| !state.position.isHeadingValid) {
+		return;
+	}
+	dt = std::clamp(dt, -AnchorStateHistory::maxExtrapolationTime, AnchorStateHistory::maxExtrapolationTime);
+	const double c = std::cos(state.position.heading_rad);
+	const double s = std::sin(state.position.heading_rad);
+	state.position.xCoord_m += (c*state.speed.longitudinal_m_s - s*state.speed.lateral_m_s)*dt;
+	state.position.yCoord_m += (s*state.speed.longitudinal_m_s + c*state.speed.lateral_m_s)*dt;
+}
+
+/*!
+ * \brief interpolate Linearly interpolates between two anchor samples
+ * \param before Earlier sample, overwritten by the result
+ * \param after Later sample
+ * \param fraction Position in time between the samples, in [0,1]
+ */
+void interpolate(ObjectMonitorType& before, const ObjectMonitorType& after, const double fraction) {
+	before.position.xCoord_m = lerp(before.position.xCoord_m, after.position.xCoord_m, fraction);
+	before.position.yCoord_m = lerp(before.position.yCoord_m, after.position.yCoord_m, fraction);
+	before.position.zCoord_m = lerp(before.position.zCoord_m, after.position.zCoord_m, fraction);
+	before.position.heading_rad = before.position.heading_rad
+			+ fraction*wrapToPi(after.position.heading_rad - before.position.heading_rad);
+	before.position.isPositionValid = before.position.isPositionValid && after.position.isPositionValid;
+	before.position.isHeadingValid = before.position.isHeadingValid && after.position.isHeadingValid;
+	before.speed.longitudinal_m_s = lerp(before.speed.longitudinal_m_s, after.speed.longitudinal_m_s, fraction);
+	before.speed.lateral_m_s = lerp(before.speed.lateral_m_s, after.speed.lateral_m_s, fraction);
+	before.speed.isLongitudinalValid = before.speed.isLongitudinalValid && after.speed.isLongitudinalValid;
+	before.speed.isLateralValid = before.speed.isLateralValid && after.speed.isLateralValid;
+	before.acceleration.longitudinal_m_s2 = lerp(before.acceleration.longitudinal_m_s2,
+												 after.acceleration.longitudinal_m_s2, fraction);
+	before.acceleration.lateral_m_s2 = lerp(before.acceleration.lateral_m_s2,
+											after.acceleration.lateral_m_s2, fraction);
+	before.acceleration.isLongitudinalValid = before.acceleration.isLongitudinalValid
+			&& after.acceleration.isLongitudinalValid;
+	before.acceleration.isLateralValid = before.acceleration.isLateralValid
+			&& after.acceleration.isLateralValid;
+}
+
+} // namespace
+
+void AnchorStateHistory::push(const ObjectMonitorType& anchor) {
+	const auto seq = sequence.load(std::memory_order_relaxed);
+	sequence.store(seq + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	newest = count == 0 ? 0 : (newest + 1) % capacity;
+	samples[newest] = anchor;
+	count = count < capacity ? count + 1 : capacity;
+
+	sequence.store(seq + 2, std::memory_order_release);
+}
+
+bool AnchorStateHistory::latest(ObjectMonitorType& state) const {
+	uint32_t seq;
+	bool found;
+	do {
+		seq = sequence.load(std::memory_order_acquire);
+		found = count > 0;
+		state = samples[newest];
+		std::atomic_thread_fence(std::memory_order_acquire);
+	} while ((seq & 1) || seq != sequence.load(std::memory_order_relaxed));
+	return found;
+}
+
+bool AnchorStateHistory::stateAt(
+		const struct timeval& time,
+		const bool isTimeValid,
+		ObjectMonitorType& state) const {
+	if (!isTimeValid) {
+		return latest(state);
+	}
+	const double t = seconds(time);
+	ObjectMonitorType after;
+	bool hasBefore, hasAfter;
+	uint32_t seq;
+	do {
+		seq = sequence.load(std::memory_order_acquire);
+		hasBefore = hasAfter = false;
+		// Walk from the newest sample towards older ones until one precedes the requested time
+		for (std::size_t i = 0, idx = newest; i < count; ++i, idx = (idx + capacity - 1) % capacity) {
+			const auto& sample = samples[idx];
+			if (!sample.isTimestampValid) {
+				continue;
+			}
+			if (seconds(sample.timestamp) <= t) {
+				state = sample;
+				hasBefore = true;
+				break;
+			}
+			after = sample;
+			hasAfter = true;
+		}
+		if (!hasBefore && !hasAfter && count > 0) {
+			state = samples[newest];
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+	} while ((seq & 1) || seq != sequence.load(std::memory_order_relaxed));
+
+	if (hasBefore && hasAfter) {
+		const double span = seconds(after.timestamp) - seconds(state.timestamp);
+		interpolate(state, after, span > 0.0 ? (t - seconds(state.timestamp)) / span : 0.0);
+	}
+	else if (hasBefore) {
+		extrapolate(state, t - seconds(state.timestamp));
+	}
+	else if (hasAfter) {
+		state = after;
+		extrapolate(state, t - seconds(state.timestamp));
+	}
+	else {
+		return seq != 0;
+	}
+	state.timestamp = time;
+	return true;
+}
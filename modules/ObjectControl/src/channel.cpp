@@ -6,6 +6,8 @@
 #include "channel.hpp"
 #include "iso22133.h"
 #include <cstring>
+#include <sys/socket.h>
+#include <sys/uio.h>
 #include "atosTime.h"
 #include "header.h"
 
@@ -18,8 +20,12 @@ Channel& operator<<(Channel& chnl, const HeabMessageDataType& heartbeat) {
 	if (nBytes < 0) {
 		throw std::invalid_argument(std::string("Failed to encode HEAB message: ") + strerror(errno));
 	}
-	nBytes = send(chnl.socket, chnl.transmitBuffer.data(), static_cast<size_t>(nBytes), 0);
-	if (nBytes < 0) {
+	// Never block the heartbeat loop, a full send buffer only drops this heartbeat
+	nBytes = send(chnl.socket, chnl.transmitBuffer.data(), static_cast<size_t>(nBytes), MSG_DONTWAIT);
+	if (nBytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+		RCLCPP_WARN(chnl.get_logger(), "Dropped HEAB to object %d: send buffer full", chnl.objectId);
+	}
+	else if (nBytes < 0) {
 		throw std::runtime_error(std::string("Failed to send HEAB: ") + strerror(errno));
 	}
 	return chnl;
@@ -38,55 +44,72 @@ Channel& operator<<(Channel& chnl, const ObjectSettingsType& settings) {
 	return chnl;
 }
 
+/*!
+ * \brief Encodes a trajectory as TRAJ header, points and footer into a large
+ *			staging buffer, and flushes it to the socket in chunks of
+ *			::trajectoryChunkSize bytes rather than sending each point separately.
+ */
 Channel& operator<<(Channel& chnl, const ATOS::Trajectory& traj) {
+	using namespace std::chrono;
 	ssize_t nBytes;
+	size_t used = 0;
+	auto& buffer = chnl.trajectoryBuffer;
+	auto& stats = chnl.lastTrajectoryUpload;
+	const auto startTime = steady_clock::now();
+
+	stats = Channel::TransferStatistics();
+	if (buffer.size() < Channel::trajectoryChunkSize) {
+		buffer.resize(Channel::trajectoryChunkSize);
+	}
+	// Any single TRAJ element fits in transmitBuffer, so flush when less than that remains
+	auto makeRoom = [&]() {
+		if (buffer.size() - used < chnl.transmitBuffer.size()) {
+			chnl.sendChunk(buffer.data(), used, true, stats);
+			used = 0;
+		}
+	};
 
 	// TRAJ header
 	MessageHeaderType header;
 	nBytes = encodeTRAJMessageHeader(chnl.populateHeaderType(&header),
 				traj.id, TRAJECTORY_INFO_RELATIVE_TO_ORIGIN, traj.name.c_str(),traj.name.length(),
-				static_cast<uint32_t>(traj.points.size()), chnl.transmitBuffer.data(),
-				chnl.transmitBuffer.size(), false);
+				static_cast<uint32_t>(traj.points.size()), buffer.data() + used,
+				buffer.size() - used, false);
 	if (nBytes < 0) {
 		throw std::invalid_argument(std::string("Failed to encode TRAJ message: ") + strerror(errno));
 	}
-	nBytes = send(chnl.socket, chnl.transmitBuffer.data(), static_cast<size_t>(nBytes), 0);
-	if (nBytes < 0) {
-		throw std::runtime_error(std::string("Failed to send TRAJ message header: ") + strerror(errno));
-	}
+	used += static_cast<size_t>(nBytes);
 
 	// TRAJ points
 	for (const auto& pt : traj.points) {
-		struct timeval relTime;
+		makeRoom();
+		struct timeval relTime = to_timeval(pt.getTime());
 		CartesianPosition pos = pt.getISOPosition();
 		SpeedType spd = pt.getISOVelocity();
 		AccelerationType acc = pt.getISOAcceleration();
 
-		relTime = to_timeval(pt.getTime());
-
 		nBytes = encodeTRAJMessagePoint(&relTime, pos, spd, acc, static_cast<float>(pt.getCurvature()),
-										chnl.transmitBuffer.data(), chnl.transmitBuffer.size(), false);
+										buffer.data() + used, buffer.size() - used, false);
 		if (nBytes < 0) {
-			// TODO what to do here?
 			throw std::invalid_argument(std::string("Failed to encode TRAJ message point: ") + strerror(errno));
 		}
-		nBytes = send(chnl.socket, chnl.transmitBuffer.data(), static_cast<size_t>(nBytes), 0);
-
-		if (nBytes < 0) {
-			// TODO what to do here?
-			throw std::runtime_error(std::string("Failed to send TRAJ message point: ") + strerror(errno));
-		}
+		used += static_cast<size_t>(nBytes);
 	}
 
 	// TRAJ footer
-	nBytes = encodeTRAJMessageFooter(chnl.transmitBuffer.data(), chnl.transmitBuffer.size(), false);
+	makeRoom();
+	nBytes = encodeTRAJMessageFooter(buffer.data() + used, buffer.size() - used, false);
 	if (nBytes < 0) {
 		throw std::invalid_argument(std::string("Failed to encode TRAJ message footer: ") + strerror(errno));
 	}
-	nBytes = send(chnl.socket, chnl.transmitBuffer.data(), static_cast<size_t>(nBytes), 0);
-	if (nBytes < 0) {
-		throw std::runtime_error(std::string("Failed to send TRAJ message footer: ") + strerror(errno));
-	}
+	used += static_cast<size_t>(nBytes);
+	chnl.sendChunk(buffer.data(), used, false, stats);
+
+	stats.duration = steady_clock::now() - startTime;
+	auto seconds = duration<double>(stats.duration).count();
+	RCLCPP_DEBUG(chnl.get_logger(), "Uploaded trajectory %s (%lu points): %lu bytes in %lu send calls, %.1f kB/s",
+				 traj.name.c_str(), traj.points.size(), stats.bytes, stats.syscalls,
+				 seconds > 0.0 ? stats.bytes / seconds / 1000.0 : 0.0);
 	return chnl;
 }
 
@@ -120,20 +143,18 @@ Channel& operator<<(Channel& chnl, const StartMessageType& strt) {
 Channel& operator>>(Channel& chnl, MonitorMessage& monitor) {
 	if (chnl.pendingMessageType() == MESSAGE_ID_MONR) {
 		struct timeval tv;
-		TimeSetToCurrentSystemTime(&tv);
+		chnl.getReceiveTime(&tv);
 		HeaderType header;
-		decodeISOHeader(chnl.receiveBuffer.data(), chnl.receiveBuffer.size(), &header, false);
+		decodeISOHeader(chnl.receivedData(), chnl.receivedLength(), &header, false);
 		monitor.first = header.transmitterID;
-		auto nBytes = decodeMONRMessage(chnl.receiveBuffer.data(), chnl.receiveBuffer.size(), tv,
+		auto nBytes = decodeMONRMessage(chnl.receivedData(), chnl.receivedLength(), tv,
 										&monitor.second, false);
 		if (nBytes < 0) {
+			chnl.discardBufferedMessage();
 			throw std::invalid_argument("Failed to decode MONR message");
 		}
 		else {
-			nBytes = recv(chnl.socket, chnl.receiveBuffer.data(), static_cast<size_t>(nBytes), 0);
-			if (nBytes <= 0) {
-				throw std::runtime_error("Unable to clear from socket buffer");
-			}
+			chnl.consumeMessage(static_cast<size_t>(nBytes));
 		}
 	}
 	return chnl;
@@ -141,15 +162,13 @@ Channel& operator>>(Channel& chnl, MonitorMessage& monitor) {
 
 Channel& operator>>(Channel& chnl, ObjectPropertiesType& prop) {
 	if (chnl.pendingMessageType() == MESSAGE_ID_VENDOR_SPECIFIC_ASTAZERO_OPRO) {
-		auto nBytes = decodeOPROMessage(&prop, chnl.receiveBuffer.data(), chnl.receiveBuffer.size(), false);
+		auto nBytes = decodeOPROMessage(&prop, chnl.receivedData(), chnl.receivedLength(), false);
 		if (nBytes < 0) {
+			chnl.discardBufferedMessage();
 			throw std::invalid_argument(strerror(errno));
 		}
 		else {
-			nBytes = recv(chnl.socket, chnl.receiveBuffer.data(), static_cast<size_t>(nBytes), 0);
-			if (nBytes <= 0) {
-				throw std::runtime_error("Unable to clear from socket buffer");
-			}
+			chnl.consumeMessage(static_cast<size_t>(nBytes));
 		}
 	}
 	return chnl;
@@ -157,15 +176,13 @@ Channel& operator>>(Channel& chnl, ObjectPropertiesType& prop) {
 
 Channel& operator>>(Channel& chnl, GeneralResponseMessageType& grem) {
 	if (chnl.pendingMessageType() == MESSAGE_ID_GREM) {
-		auto nBytes = decodeGREMMessage(chnl.receiveBuffer.data(), chnl.receiveBuffer.size(), &grem, false);
+		auto nBytes = decodeGREMMessage(chnl.receivedData(), chnl.receivedLength(), &grem, false);
 		if (nBytes < 0) {
+			chnl.discardBufferedMessage();
 			throw std::invalid_argument(strerror(errno));
 		}
 		else {
-			nBytes = recv(chnl.socket, chnl.receiveBuffer.data(), static_cast<size_t>(nBytes), 0);
-			if (nBytes <= 0) {
-				throw std::runtime_error("Unable to clear from socket buffer");
-			}
+			chnl.consumeMessage(static_cast<size_t>(nBytes));
 		}
 	}
 	return chnl;
@@ -211,6 +228,12 @@ std::string Channel::remoteIP() const {
 }
 
 ISOMessageID Channel::pendingMessageType(bool awaitNext) {
+	if (this->hasBufferedMessage()) {
+		return this->bufferedMessageType;
+	}
+	if (this->hasQueuedMessages()) {
+		return this->receiveMessage();
+	}
 	auto result = recv(this->socket, this->receiveBuffer.data(), this->receiveBuffer.size(), (awaitNext ? 0 : MSG_DONTWAIT) | MSG_PEEK);
 	if (result < 0 && !awaitNext && (errno == EAGAIN || errno == EWOULDBLOCK)) {
 		return MESSAGE_ID_INVALID;
@@ -231,6 +254,170 @@ ISOMessageID Channel::pendingMessageType(bool awaitNext) {
 	}
 }
 
+/*!
+ * \brief Sends a buffer in its entirety, retrying on partial writes. If more data
+ *			is to follow, the kernel is told to hold back partially filled segments.
+ */
+void Channel::sendChunk(
+		const char* data,
+		size_t length,
+		bool moreToCome,
+		TransferStatistics& stats) {
+	struct iovec iov;
+	struct msghdr msg = {};
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+
+	while (length > 0) {
+		iov.iov_base = const_cast<char*>(data);
+		iov.iov_len = length;
+		auto nBytes = sendmsg(this->socket, &msg, moreToCome ? MSG_MORE : 0);
+		stats.syscalls++;
+		if (nBytes < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			throw std::runtime_error(std::string("Failed to send TRAJ message: ") + strerror(errno));
+		}
+		data += nBytes;
+		length -= static_cast<size_t>(nBytes);
+		stats.bytes += static_cast<size_t>(nBytes);
+	}
+}
+
+ISOMessageID Channel::receiveMessage() {
+	if (this->hasBufferedMessage()) {
+		return this->bufferedMessageType;
+	}
+	if (this->channelType != SOCK_DGRAM) {
+		throw std::logic_error("Attempted to receive whole messages on a stream channel");
+	}
+	if (batch.next >= batch.count && this->receiveBatch() == 0) {
+		return MESSAGE_ID_INVALID;
+	}
+	auto slot = batch.next++;
+	auto length = static_cast<size_t>(batch.headers[slot].msg_len);
+	if (length == 0) {
+		return this->receiveMessage();	// Empty datagram, nothing to decode
+	}
+	auto data = batch.data.data() + slot*batch.slotSize;
+	ISOMessageID retval = getISOMessageType(data, length, false);
+	if (retval == MESSAGE_ID_INVALID) {
+		throw std::runtime_error("Non-ISO message received from " + this->remoteIP());
+	}
+	this->bufferedSlot = slot;
+	this->bufferedBytes = length;
+	this->bufferedMessageType = retval;
+	return retval;
+}
+
+/*!
+ * \brief Reads as many queued datagrams as fit in the batch with a single recvmmsg
+ *			call, and extracts their kernel receive timestamps.
+ * \return Number of datagrams read.
+ */
+size_t Channel::receiveBatch() {
+	constexpr size_t controlSize = CMSG_SPACE(sizeof (struct timespec));
+	if (batch.headers.empty()) {
+		batch.slotSize = receiveBuffer.size();
+		batch.data.resize(receiveBatchSize * batch.slotSize);
+		batch.control.resize(receiveBatchSize * controlSize);
+		batch.headers.resize(receiveBatchSize);
+		batch.iovecs.resize(receiveBatchSize);
+		batch.receiveTimes.resize(receiveBatchSize);
+		batch.isKernelTimestamped.resize(receiveBatchSize);
+	}
+	// The kernel overwrites lengths, so reinitialise the headers before every call
+	for (unsigned int i = 0; i < receiveBatchSize; ++i) {
+		batch.iovecs[i].iov_base = batch.data.data() + i*batch.slotSize;
+		batch.iovecs[i].iov_len = batch.slotSize;
+		auto& hdr = batch.headers[i].msg_hdr;
+		hdr = {};
+		hdr.msg_iov = &batch.iovecs[i];
+		hdr.msg_iovlen = 1;
+		hdr.msg_control = batch.control.data() + i*controlSize;
+		hdr.msg_controllen = controlSize;
+	}
+	batch.count = batch.next = 0;
+
+	int result;
+	do {
+		result = recvmmsg(this->socket, batch.headers.data(), receiveBatchSize, MSG_DONTWAIT, nullptr);
+	} while (result < 0 && errno == EINTR);
+	if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+		return 0;
+	}
+	else if (result < 0) {
+		throw std::runtime_error(std::string("Failed to receive messages (recvmmsg: ") + strerror(errno) + ")");
+	}
+
+	for (int i = 0; i < result; ++i) {
+		auto& hdr = batch.headers[i].msg_hdr;
+		batch.isKernelTimestamped[i] = false;
+		for (auto cmsg = CMSG_FIRSTHDR(&hdr); cmsg != nullptr; cmsg = CMSG_NXTHDR(&hdr, cmsg)) {
+			if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+				struct timespec ts;
+				memcpy(&ts, CMSG_DATA(cmsg), sizeof (ts));
+				batch.receiveTimes[i].tv_sec = ts.tv_sec;
+				batch.receiveTimes[i].tv_usec = ts.tv_nsec / 1000;
+				batch.isKernelTimestamped[i] = true;
+			}
+		}
+		if (!batch.isKernelTimestamped[i]) {
+			TimeSetToCurrentSystemTime(&batch.receiveTimes[i]);
+		}
+	}
+	batch.count = static_cast<size_t>(result);
+	return batch.count;
+}
+
+struct timeval *Channel::getReceiveTime(
+		struct timeval *tv) const {
+	if (this->hasBufferedMessage()) {
+		*tv = batch.receiveTimes[bufferedSlot];
+		return tv;
+	}
+	return TimeSetToCurrentSystemTime(tv);
+}
+
+/*!
+ * \brief Marks a decoded message as handled. A message buffered by ::receiveMessage
+ *			is simply discarded, otherwise the peeked bytes are drained from the socket.
+ */
+void Channel::consumeMessage(
+		const size_t length) {
+	this->receivedMessageCounter++;
+	if (this->hasBufferedMessage()) {
+		this->discardBufferedMessage();
+		return;
+	}
+	auto nBytes = recv(this->socket, this->receiveBuffer.data(), length, 0);
+	if (nBytes <= 0) {
+		throw std::runtime_error("Unable to clear from socket buffer");
+	}
+}
+
+void Channel::discardPendingMessages() {
+	this->discardBufferedMessage();
+	batch.next = batch.count;
+	while (true) {
+		auto nBytes = recv(this->socket, this->receiveBuffer.data(), this->receiveBuffer.size(), MSG_DONTWAIT);
+		if (nBytes < 0 && errno == EINTR) {
+			continue;
+		}
+		else if (nBytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			return;
+		}
+		else if (nBytes < 0) {
+			throw std::runtime_error(std::string("Failed to discard pending messages (recv: ")
+									 + strerror(errno) + ")");
+		}
+		else if (nBytes == 0 && this->channelType == SOCK_STREAM) {
+			throw std::runtime_error("Connection reset by peer");
+		}
+	}
+}
+
 MessageHeaderType *Channel::populateHeaderType(MessageHeaderType *header) {
 	memset(header, 0, sizeof (MessageHeaderType));
 	header->transmitterID = this->transmitterId;
@@ -271,6 +458,14 @@ void Channel::connect(
 		throw std::runtime_error(errMsg.str());
 	}
 
+	if (this->channelType == SOCK_DGRAM) {
+		// Have the kernel stamp each datagram with its receive time
+		int enable = 1;
+		if (setsockopt(this->socket, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof (enable)) < 0) {
+			RCLCPP_WARN(get_logger(), "Unable to enable receive timestamps: %s", strerror(errno));
+		}
+	}
+
 	// Begin connection attempt
 	RCLCPP_INFO(get_logger(), "Attempting %s connection to %s:%u", type.c_str(), ipString,
 			   ntohs(this->addr.sin_port));
@@ -303,4 +498,6 @@ void Channel::disconnect() {
 		}
 		this->socket = -1;
 	}
+	this->discardBufferedMessage();
+	batch.count = batch.next = 0;
 }
\ No newline at end of file
@@ -0,0 +1,93 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include "monitorfanout.hpp"
+#include "atosTime.h"
+
+#include <cmath>
+
+static const std::string FRAME_ID = "map"; // TODO
+
+void MonitorFanOut::update(
+		const MonitorMessage& monr,
+		const GeographicPositionType& origin,
+		const in_addr_t clientIP) {
+	const auto& data = monr.second;
+	current.objectId = monr.first;
+	current.stamp_sec = static_cast<int32_t>(data.timestamp.tv_sec);
+	current.stamp_nanosec = static_cast<uint32_t>(data.timestamp.tv_usec * 1000);
+	current.state = data.state;
+	if (data.position.isPositionValid) {
+		current.x_m = data.position.xCoord_m;
+		current.y_m = data.position.yCoord_m;
+		current.z_m = data.position.isZcoordValid ? data.position.zCoord_m : 0.0;
+	}
+	else {
+		current.x_m = current.y_m = current.z_m = 0.0;
+	}
+	current.orientationZ = data.position.isHeadingValid ? std::sin(data.position.heading_rad / 2.0) : 0.0;
+	current.orientationW = data.position.isHeadingValid ? std::cos(data.position.heading_rad / 2.0) : 1.0;
+	current.longitudinalVelocity_m_s = data.speed.isLongitudinalValid ? data.speed.longitudinal_m_s : 0.0;
+	current.lateralVelocity_m_s = data.speed.isLateralValid ? data.speed.lateral_m_s : 0.0;
+	current.longitudinalAcceleration_m_s2 =
+		data.acceleration.isLongitudinalValid ? data.acceleration.longitudinal_m_s2 : 0.0;
+	current.lateralAcceleration_m_s2 = data.acceleration.isLateralValid ? data.acceleration.lateral_m_s2 : 0.0;
+
+	const std::array<double,3> llhOrigin = {origin.latitude_deg, origin.longitude_deg, origin.altitude_m};
+	if (llhOrigin != originOffset.origin()) {
+		originOffset = CRSTransformation::LLHOffset(llhOrigin);
+	}
+
+	journal.origin.Latitude = origin.latitude_deg;
+	journal.origin.Longitude = origin.longitude_deg;
+	journal.origin.Altitude = origin.altitude_m;
+	journal.Enabled = OBJECT_ENABLED;
+	journal.ClientIP = clientIP;
+	journal.ClientID = monr.first;
+	TimeSetToCurrentSystemTime(&journal.lastPositionUpdate);
+	journal.propertiesReceived = false;
+	journal.MonrData = data;
+}
+
+void MonitorFanOut::toMonitor(ROSChannels::Monitor::message_type& msg) const {
+	for (auto header : {&msg.atos_header.header, &msg.pose.header, &msg.velocity.header, &msg.acceleration.header}) {
+		header->stamp.sec = current.stamp_sec;
+		header->stamp.nanosec = current.stamp_nanosec;
+		header->frame_id = FRAME_ID;
+	}
+	msg.atos_header.object_id = current.objectId;
+	msg.object_state.state = current.state;
+	msg.pose.pose.position.x = current.x_m;
+	msg.pose.pose.position.y = current.y_m;
+	msg.pose.pose.position.z = current.z_m;
+	msg.pose.pose.orientation.x = 0.0;
+	msg.pose.pose.orientation.y = 0.0;
+	msg.pose.pose.orientation.z = current.orientationZ;
+	msg.pose.pose.orientation.w = current.orientationW;
+	msg.velocity.twist.linear.x = current.longitudinalVelocity_m_s;
+	msg.velocity.twist.linear.y = current.lateralVelocity_m_s;
+	msg.velocity.twist.linear.z = 0;
+	msg.velocity.twist.angular.x = 0;
+	msg.velocity.twist.angular.y = 0;
+	msg.velocity.twist.angular.z = 0;
+	msg.acceleration.accel.linear.x = current.longitudinalAcceleration_m_s2;
+	msg.acceleration.accel.linear.y = current.lateralAcceleration_m_s2;
+	msg.acceleration.accel.linear.z = 0;
+	msg.acceleration.accel.angular.x = 0;
+	msg.acceleration.accel.angular.y = 0;
+	msg.acceleration.accel.angular.z = 0;
+}
+
+void MonitorFanOut::toNavSatFix(ROSChannels::NavSatFix::message_type& msg) const {
+	double llh[3];
+	originOffset.apply(current.x_m, current.y_m, current.z_m, llh);
+	msg.header.stamp.sec = current.stamp_sec;
+	msg.header.stamp.nanosec = current.stamp_nanosec;
+	msg.header.frame_id = FRAME_ID;
+	msg.latitude = llh[0];
+	msg.longitude = llh[1];
+	msg.altitude = llh[2];
+	msg.status.status = sensor_msgs::msg::NavSatStatus::STATUS_FIX;
+}
@@ -8,6 +8,14 @@
 void ObjectConnection::connect(
 		std::shared_future<void> stopRequest,
 		const std::chrono::milliseconds retryPeriod) {
+	if (this->interruptionFd == -1) {
+		this->interruptionFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	}
+	else {
+		// Discard interruptions aimed at a previous connection
+		uint64_t count;
+		read(this->interruptionFd, &count, sizeof(count));
+	}
 	try {
 		this->cmd.connect(stopRequest, retryPeriod);
 		this->mntr.connect(stopRequest, retryPeriod);
@@ -38,21 +46,30 @@ bool ObjectConnection::isValid() const {
 void ObjectConnection::disconnect() {
 	this->cmd.disconnect();
 	this->mntr.disconnect();
-	close(this->interruptionPipeFds[0]);
-	close(this->interruptionPipeFds[1]);
+	if (this->interruptionFd != -1) {
+		close(this->interruptionFd);
+		this->interruptionFd = -1;
+	}
 }
 
 ISOMessageID ObjectConnection::pendingMessageType(bool awaitNext) {
+	if (this->mntr.hasBufferedMessage()) {
+		return this->mntr.pendingMessageType();
+	}
+	if (this->mntr.hasQueuedMessages()) {
+		// Already read from the socket, so select would not report them
+		return this->mntr.receiveMessage();
+	}
 	if (awaitNext) {
 		if (!isValid()) {
 			throw std::invalid_argument("Attempted to check pending message type for unconnected object");
 		}
 		fd_set fds;
 		FD_ZERO(&fds);
-		FD_SET(interruptionPipeFds[0], &fds);
+		FD_SET(interruptionFd, &fds);
 		FD_SET(mntr.socket, &fds);
 		FD_SET(cmd.socket, &fds);
-		auto result = select(std::max({mntr.socket,cmd.socket,interruptionPipeFds[0]})+1,
+		auto result = select(std::max({mntr.socket,cmd.socket,interruptionFd})+1,
 							 &fds, nullptr, nullptr, nullptr);
 		if (result < 0) {
 			throw std::runtime_error(std::string("Failed socket operation (select: ") + strerror(errno) + ")"); // TODO clearer
@@ -60,12 +77,13 @@ ISOMessageID ObjectConnection::pendingMessageType(bool awaitNext) {
 		else if (!isValid()) {
 			throw std::invalid_argument("Connection invalidated during select call");
 		}
-		else if (FD_ISSET(interruptionPipeFds[0], &fds)){
-			close(interruptionPipeFds[0]);
+		else if (FD_ISSET(interruptionFd, &fds)){
+			uint64_t count;
+			read(interruptionFd, &count, sizeof(count));
 			throw std::range_error("Select call was interrupted");
 		}
 		else if (FD_ISSET(mntr.socket, &fds)) {
-			return this->mntr.pendingMessageType();
+			return this->mntr.receiveMessage();
 		}
 		else if (FD_ISSET(cmd.socket, &fds)) {
 			return this->cmd.pendingMessageType();
@@ -73,7 +91,7 @@ ISOMessageID ObjectConnection::pendingMessageType(bool awaitNext) {
 		throw std::logic_error("Call to select returned unexpectedly: " + std::to_string(result));
 	}
 	else {
-		auto retval = this->mntr.pendingMessageType();
+		auto retval = this->mntr.receiveMessage();
 		return retval != MESSAGE_ID_INVALID ? retval : this->cmd.pendingMessageType();
 	}
 }
\ No newline at end of file
@@ -13,6 +13,7 @@
 #include <thread>
 #include <dirent.h>
 #include <exception>
+#include <atomic>
 
 #include "state.hpp"
 #include "util.h"
@@ -45,14 +46,27 @@ ObjectControl::ObjectControl(std::shared_ptr<rclcpp::executors::MultiThreadedExe
 	objectStateChangeSub(*this, std::bind(&ObjectControl::onObjectStateChangeMessage, this, _1)),
 	scnResetTestObjectsSub(*this, std::bind(&ObjectControl::onResetTestObjectsMessage, this, _1)),
 	scnReloadObjectSettingsSub(*this, std::bind(&ObjectControl::onReloadObjectSettingsMessage, this, _1)),
+	geofenceBreachSub(*this, std::bind(&ObjectControl::onGeofenceBreachMessage, this, _1)),
 	failurePub(*this),
 	scnAbortPub(*this),
 	objectsConnectedPub(*this),
 	connectedObjectIdsPub(*this),
-	stateChangePub(*this)
+	stateChangePub(*this),
+	diagnosticsPub(*this)
 {
 	this->declare_parameter("max_missing_heartbeats", 100);
+	this->declare_parameter("max_parallel_uploads", 8);
+	this->declare_parameter("io_reactor_threads", 0);
+	this->declare_parameter("io_reactor_pin_threads", false);
+	this->declare_parameter("journal_format", "text");
+	this->declare_parameter("relative_trajectory_interpolation", false);
 	objectsConnectedTimer = create_wall_timer(1000ms, std::bind(&ObjectControl::publishObjectIds, this));
+	heartbeatReportTimer = create_wall_timer(1000ms, std::bind(&ObjectControl::publishHeartbeatReport, this));
+	monitorSnapshots.reset(createSeqlockMemory(MONITOR_SNAPSHOT_MEMORY_NAME, MONITOR_SNAPSHOT_SLOTS,
+											   sizeof (ObjectDataType), nullptr), closeSeqlockMemory);
+	if (!monitorSnapshots) {
+		RCLCPP_WARN(get_logger(), "Unable to open monitor snapshot memory, monitor data will not be shared");
+	}
 	idClient = create_client<atos_interfaces::srv::GetObjectIds>(ServiceNames::getObjectIds);
 	originClient = create_client<atos_interfaces::srv::GetTestOrigin>(ServiceNames::getTestOrigin);
 	trajectoryClient = create_client<atos_interfaces::srv::GetObjectTrajectory>(ServiceNames::getObjectTrajectory);
@@ -65,7 +79,15 @@ ObjectControl::ObjectControl(std::shared_ptr<rclcpp::executors::MultiThreadedExe
 	// Set the initial state
 	this->state = static_cast<ObjectControlState*>(new AbstractKinematics::Idle);
 	// Create test journal
-	if (JournalInit(get_name(), get_logger()) == -1) {
+	auto journalFormat = JOURNAL_FORMAT_TEXT;
+	auto journalFormatName = this->get_parameter("journal_format").as_string();
+	if (journalFormatName == "binary") {
+		journalFormat = JOURNAL_FORMAT_BINARY;
+	}
+	else if (journalFormatName != "text") {
+		RCLCPP_WARN(get_logger(), "Unknown journal format %s, using text", journalFormatName.c_str());
+	}
+	if (JournalInit(get_name(), get_logger(), journalFormat) == -1) {
 		RCLCPP_ERROR(get_logger(), "Unable to create test journal");
 	}
 };
@@ -287,11 +309,18 @@ void ObjectControl::loadScenario() {
 		auto idResponse = future.get();
 		RCLCPP_INFO(get_logger(), "Received %lu configured object ids", idResponse->ids.size());
 
+		unsigned int snapshotSlot = 0;
 		for (const auto id : idResponse->ids) {
 			auto object = std::make_shared<TestObject>(id);
 			exec->add_node(object);
 			objects.emplace(id, object);
 			objects.at(id)->setTransmitterID(id);
+			if (monitorSnapshots && snapshotSlot < getNumberOfSeqlockSlots(monitorSnapshots.get())) {
+				objects.at(id)->setMonitorSnapshotSlot(monitorSnapshots, snapshotSlot++);
+			}
+			else if (monitorSnapshots) {
+				RCLCPP_WARN(get_logger(), "No monitor snapshot slot left for object %u", id);
+			}
 
 			auto trajectoryCallback = [id, this](const rclcpp::Client<atos_interfaces::srv::GetObjectTrajectory>::SharedFuture future) {
 				auto trajResponse = future.get();
@@ -468,13 +497,16 @@ std::map<uint32_t,ObjectStateType> ObjectControl::getObjectStates() const {
 
 void ObjectControl::transformScenarioRelativeTo(
 		const uint32_t objectID) {
+	const auto alignment = this->get_parameter("relative_trajectory_interpolation").as_bool()
+			? ATOS::Trajectory::AlignmentMode::LINEAR_INTERPOLATION
+			: ATOS::Trajectory::AlignmentMode::NEAREST_POINT;
 	for (auto& id : getVehicleIDs()) {
 		if (id == objectID) {
 			// Skip for now TODO also here - maybe?
 			continue;
 		}
 		auto traj = objects.at(id)->getTrajectory();
-		auto relTraj = traj.relativeTo(objects.at(objectID)->getTrajectory());
+		auto relTraj = traj->relativeTo(*objects.at(objectID)->getTrajectory(), alignment);
 
 		objects.at(id)->setTrajectory(relTraj);
 	}
@@ -483,12 +515,29 @@ void ObjectControl::transformScenarioRelativeTo(
 void ObjectControl::clearScenario() {
 	objects.clear();
 	storedActions.clear();
+	clearMonitorSnapshots();
+}
+
+void ObjectControl::clearMonitorSnapshots() {
+	if (!monitorSnapshots) {
+		return;
+	}
+	const ObjectDataType unused = {};
+	for (unsigned int slot = 0; slot < getNumberOfSeqlockSlots(monitorSnapshots.get()); ++slot) {
+		if (getSeqlockSlotVersion(monitorSnapshots.get(), slot) != 0) {
+			writeSeqlockSlot(monitorSnapshots.get(), slot, &unused);
+		}
+	}
 }
 
 
 void ObjectControl::beginConnectionAttempt() {
 	connStopReqPromise = std::promise<void>();
 	connStopReqFuture = connStopReqPromise.get_future();
+	{
+		std::lock_guard<std::mutex> lock(uploadReportMutex);
+		uploadReport.clear();
+	}
 
 	RCLCPP_DEBUG(get_logger(), "Initiating connection attempt");
 	for (const auto id : getVehicleIDs()) {
@@ -517,6 +566,7 @@ void ObjectControl::disconnectObjects() {
 		// Attempted to stop when none in progress
 	}
 	objectListeners.clear();
+	reactor.reset();
 	for (const auto id : getVehicleIDs()) {
 		objects.at(id)->disconnect();
 	}
@@ -524,19 +574,85 @@ void ObjectControl::disconnectObjects() {
 
 void ObjectControl::disconnectObject(
 		const uint32_t id) {
+	if (reactor) {
+		reactor->remove(id);
+	}
 	objects.at(id)->disconnect();
 	objectListeners.erase(id);
 }
 
-void ObjectControl::uploadAllConfigurations() {
-	for (auto& id : getVehicleIDs()) {
-		this->uploadObjectConfiguration(id);
+ObjectControl::UploadReport ObjectControl::uploadAllConfigurations() {
+	const auto ids = getVehicleIDs();
+	UploadReport report;
+	if (ids.empty()) {
+		return report;
+	}
+	// Insert all entries up front so that workers only touch their own values
+	for (const auto id : ids) {
+		report[id] = UploadResult();
+	}
+
+	auto maxWorkers = this->get_parameter("max_parallel_uploads").as_int();
+	auto nWorkers = std::min(ids.size(), static_cast<size_t>(std::max(maxWorkers, 1L)));
+	std::atomic<size_t> nextIndex(0);
+	auto worker = [&]() {
+		for (auto i = nextIndex++; i < ids.size(); i = nextIndex++) {
+			report.at(ids[i]) = this->uploadObjectConfiguration(ids[i]);
+		}
+	};
+
+	RCLCPP_INFO(get_logger(), "Uploading configuration to %lu objects using %lu workers", ids.size(), nWorkers);
+	auto startTime = clock::now();
+	std::vector<std::thread> workers;
+	for (size_t i = 1; i < nWorkers; ++i) {
+		workers.emplace_back(worker);
+	}
+	worker();
+	for (auto& t : workers) {
+		t.join();
 	}
+	RCLCPP_INFO(get_logger(), "Configuration upload finished in %.3f s",
+				std::chrono::duration<double>(clock::now() - startTime).count());
+	logUploadReport(report);
+	return report;
 }
 
-void ObjectControl::uploadObjectConfiguration(
+ObjectControl::UploadResult ObjectControl::uploadObjectConfiguration(
 		const uint32_t id) {
-	objects.at(id)->sendSettings();
+	UploadResult result;
+	auto startTime = clock::now();
+	try {
+		objects.at(id)->sendSettings();
+		result.success = true;
+	}
+	catch (std::exception& e) {
+		result.error = e.what();
+	}
+	result.duration = clock::now() - startTime;
+
+	std::lock_guard<std::mutex> lock(uploadReportMutex);
+	uploadReport[id] = result;
+	return result;
+}
+
+void ObjectControl::logUploadReport(
+		const UploadReport& report) const {
+	using namespace std::chrono;
+	for (const auto& [id, result] : report) {
+		if (result.success) {
+			RCLCPP_INFO(get_logger(), "Uploaded configuration to object %u in %.3f s", id,
+						duration<double>(result.duration).count());
+		}
+		else {
+			RCLCPP_ERROR(get_logger(), "Failed to upload configuration to object %u after %.3f s: %s", id,
+						 duration<double>(result.duration).count(), result.error.c_str());
+		}
+	}
+}
+
+ObjectControl::UploadReport ObjectControl::getUploadReport() {
+	std::lock_guard<std::mutex> lock(uploadReportMutex);
+	return uploadReport;
 }
 
 void ObjectControl::startSafetyThread() {
@@ -548,43 +664,178 @@ void ObjectControl::startSafetyThread() {
 }
 
 void ObjectControl::heartbeat() {
+	using namespace std::chrono;
 	auto stopRequest = stopHeartbeatSignal.get_future();
-	clock::time_point nextHeartbeat = clock::now();
 
-	RCLCPP_DEBUG(get_logger(), "Starting heartbeat thread");
-	while (stopRequest.wait_until(nextHeartbeat) == std::future_status::timeout) {
-		nextHeartbeat += heartbeatPeriod;
+	// The set of objects does not change while connected, so a flat copy
+	// avoids map lookups and allocations in the loop
+	struct HeartbeatTarget {
+		uint32_t id;
+		std::shared_ptr<TestObject> obj;
+		HeartbeatStatistics statistics;
+	};
+	std::vector<HeartbeatTarget> targets;
+	targets.reserve(objects.size());
+	for (const auto& [id, obj] : objects) {
+		targets.push_back({id, obj, HeartbeatStatistics()});
+	}
+	{
+		std::lock_guard<std::mutex> lock(heartbeatReportMutex);
+		heartbeatReport.clear();
+		for (const auto& target : targets) {
+			heartbeatReport[target.id] = target.statistics;
+		}
+	}
+	auto recordHeartbeat = [](HeartbeatStatistics& stats, const nanoseconds lateness) {
+		auto jitter = stats.nSent > 0 ? abs(lateness - stats.lastLateness) : nanoseconds::zero();
+		stats.nSent++;
+		stats.nLate += lateness >= heartbeatPeriod ? 1 : 0;
+		stats.maxLateness = std::max(stats.maxLateness, lateness);
+		stats.totalLateness += lateness;
+		stats.maxJitter = std::max(stats.maxJitter, jitter);
+		stats.totalJitter += jitter;
+		stats.lastLateness = lateness;
+	};
 
+	clock::time_point deadline = clock::now();
+	unsigned long tick = 0;
+	RCLCPP_DEBUG(get_logger(), "Starting heartbeat thread");
+	while (stopRequest.wait_until(deadline) == std::future_status::timeout) {
 		// Check time since MONR for all objects
-		for (const auto& id : getVehicleIDs()) {
-			if (objects.at(id)->isConnected()) {
-				auto diff = objects.at(id)->getTimeSinceLastMonitor();
-				if (diff > objects.at(id)->getMaxAllowedMonitorPeriod()) {
-					RCLCPP_WARN(get_logger(), "MONR timeout for object %u: %ld ms > %ld ms", id,
-							   diff.count(), objects.at(id)->getMaxAllowedMonitorPeriod().count());
-					objects.at(id)->disconnect();
-					this->state->disconnectedFromObject(*this, id);
+		for (auto& target : targets) {
+			if (target.obj->isConnected()) {
+				auto diff = target.obj->getTimeSinceLastMonitor();
+				if (diff > target.obj->getMaxAllowedMonitorPeriod()) {
+					RCLCPP_WARN(get_logger(), "MONR timeout for object %u: %ld ms > %ld ms", target.id,
+							   diff.count(), target.obj->getMaxAllowedMonitorPeriod().count());
+					target.obj->disconnect();
+					this->state->disconnectedFromObject(*this, target.id);
 				}
 			}
 		}
 
 		// Send heartbeat
-		for (const auto& id : getVehicleIDs()) {
+		const auto ccStatus = this->state->asControlCenterStatus();
+		for (auto& target : targets) {
 			try {
-				if (objects.at(id)->isConnected()) {
-					objects.at(id)->sendHeartbeat(this->state->asControlCenterStatus());
+				if (target.obj->isConnected()) {
+					target.obj->sendHeartbeat(ccStatus);
+					recordHeartbeat(target.statistics, duration_cast<nanoseconds>(clock::now() - deadline));
 				}
 			}
 			catch (std::exception& e) {
 				RCLCPP_WARN(get_logger(), e.what());
-				objects.at(id)->disconnect();
-				this->state->disconnectedFromObject(*this, id);
+				target.obj->disconnect();
+				this->state->disconnectedFromObject(*this, target.id);
+			}
+		}
+
+		// Skip periods which have already passed instead of sending a burst of heartbeats
+		deadline += heartbeatPeriod;
+		auto overrun = clock::now() - deadline;
+		if (overrun >= heartbeatPeriod) {
+			auto nSkipped = overrun / heartbeatPeriod;
+			deadline += nSkipped * heartbeatPeriod;
+			RCLCPP_WARN(get_logger(), "Heartbeat loop overran by %ld ms, skipping %ld heartbeats",
+						duration_cast<milliseconds>(overrun).count(), static_cast<long>(nSkipped));
+			for (auto& target : targets) {
+				target.statistics.nLate += static_cast<uint64_t>(nSkipped);
 			}
 		}
+
+		if (++tick % HEAB_FREQUENCY_HZ == 0) {
+			std::lock_guard<std::mutex> lock(heartbeatReportMutex);
+			for (const auto& target : targets) {
+				heartbeatReport[target.id] = target.statistics;
+			}
+		}
+	}
+	{
+		std::lock_guard<std::mutex> lock(heartbeatReportMutex);
+		for (const auto& target : targets) {
+			heartbeatReport[target.id] = target.statistics;
+		}
+	}
+	logHeartbeatReport(getHeartbeatReport());
+	{
+		// Only the running heartbeat thread is reported as diagnostics
+		std::lock_guard<std::mutex> lock(heartbeatReportMutex);
+		heartbeatReport.clear();
 	}
 	RCLCPP_INFO(get_logger(), "Heartbeat thread exiting");
 }
 
+ObjectControl::HeartbeatReport ObjectControl::getHeartbeatReport() {
+	std::lock_guard<std::mutex> lock(heartbeatReportMutex);
+	return heartbeatReport;
+}
+
+void ObjectControl::logHeartbeatReport(
+		const HeartbeatReport& report) const {
+	using namespace std::chrono;
+	for (const auto& [id, stats] : report) {
+		if (stats.nSent == 0) {
+			continue;
+		}
+		auto toMs = [](const nanoseconds t) { return duration<double, std::milli>(t).count(); };
+		if (stats.nLate > 0) {
+			RCLCPP_WARN(get_logger(), "Sent %lu heartbeats to object %u, %lu late: lateness mean %.3f ms "
+						"max %.3f ms, jitter mean %.3f ms max %.3f ms", stats.nSent, id, stats.nLate,
+						toMs(stats.totalLateness) / stats.nSent, toMs(stats.maxLateness),
+						toMs(stats.totalJitter) / stats.nSent, toMs(stats.maxJitter));
+		}
+		else {
+			RCLCPP_INFO(get_logger(), "Sent %lu heartbeats to object %u: lateness mean %.3f ms "
+						"max %.3f ms, jitter mean %.3f ms max %.3f ms", stats.nSent, id,
+						toMs(stats.totalLateness) / stats.nSent, toMs(stats.maxLateness),
+						toMs(stats.totalJitter) / stats.nSent, toMs(stats.maxJitter));
+		}
+	}
+}
+
+void ObjectControl::publishHeartbeatReport() {
+	using namespace std::chrono;
+	using diagnostic_msgs::msg::DiagnosticStatus;
+	using diagnostic_msgs::msg::KeyValue;
+	auto report = getHeartbeatReport();
+	if (report.empty()) {
+		publishedLateHeartbeats.clear();
+		return;
+	}
+	auto toMs = [](const nanoseconds t) { return duration<double, std::milli>(t).count(); };
+	auto keyValue = [](const std::string& key, const auto value) {
+		KeyValue kv;
+		kv.key = key;
+		kv.value = std::to_string(value);
+		return kv;
+	};
+	ROSChannels::Diagnostics::message_type msg;
+	msg.header.stamp = now();
+	for (const auto& [id, stats] : report) {
+		// Counts restart when the heartbeat thread is restarted
+		auto previousLate = publishedLateHeartbeats[id];
+		auto nNewLate = stats.nLate >= previousLate ? stats.nLate - previousLate : stats.nLate;
+		publishedLateHeartbeats[id] = stats.nLate;
+
+		DiagnosticStatus status;
+		status.name = std::string(get_name()) + ": heartbeat to object " + std::to_string(id);
+		status.hardware_id = std::to_string(id);
+		status.level = nNewLate > 0 ? DiagnosticStatus::WARN : DiagnosticStatus::OK;
+		status.message = nNewLate > 0 ? std::to_string(nNewLate) + " late heartbeats" : "Heartbeats on time";
+		const auto nSent = std::max<uint64_t>(stats.nSent, 1);
+		status.values = {
+			keyValue("sent", stats.nSent),
+			keyValue("late", stats.nLate),
+			keyValue("lateness_mean_ms", toMs(stats.totalLateness) / nSent),
+			keyValue("lateness_max_ms", toMs(stats.maxLateness)),
+			keyValue("jitter_mean_ms", toMs(stats.totalJitter) / nSent),
+			keyValue("jitter_max_ms", toMs(stats.maxJitter))
+		};
+		msg.status.push_back(status);
+	}
+	diagnosticsPub.publish(msg);
+}
+
 OsiHandler::LocalObjectGroundTruth_t ObjectControl::buildOSILocalGroundTruth(
 		const MonitorMessage& monr) const {
 
@@ -627,6 +878,16 @@ void ObjectControl::injectObjectData(const MonitorMessage &monr) {
 void ObjectControl::startListeners() {
 	RCLCPP_DEBUG(get_logger(), "Starting listeners");
 	objectListeners.clear();
+	reactor.reset();
+	auto nReactorThreads = this->get_parameter("io_reactor_threads").as_int();
+	if (nReactorThreads > 0) {
+		reactor = std::make_unique<ObjectReactor>(this, static_cast<unsigned int>(nReactorThreads),
+			this->get_parameter("io_reactor_pin_threads").as_bool(), get_logger());
+		for (const auto& id : getVehicleIDs()) {
+			reactor->add(objects.at(id));
+		}
+		return;
+	}
 	for (const auto& id : getVehicleIDs()) {
 		objectListeners.try_emplace(id, this, objects.at(id), get_logger());
 	}
@@ -651,7 +912,6 @@ void ObjectControl::connectToObject(
 		if (!obj->isConnected()) {
 			try {
 				obj->establishConnection(connStopReq);
-				obj->sendSettings();
 			}
 			catch (std::runtime_error& e) {
 				RCLCPP_ERROR(get_logger(), "Connection attempt for object %u failed: %s",
@@ -660,6 +920,13 @@ void ObjectControl::connectToObject(
 				return;
 				// TODO connection failed event?
 			}
+			auto upload = this->uploadObjectConfiguration(obj->getTransmitterID());
+			if (!upload.success) {
+				RCLCPP_ERROR(get_logger(), "Configuration upload for object %u failed: %s",
+						   obj->getTransmitterID(), upload.error.c_str());
+				obj->disconnect();
+				return;
+			}
 			try {
 				int initializingMonrs = maxConnMonrs;
 				int connectionHeartbeats = maxConnHeabs;
@@ -808,15 +1075,15 @@ void ObjectControl::reloadScenarioTrajectories() {
 */
 void ObjectControl::republishTrajectoryPaths(uint32_t id){
 	// Update the GUI with the new trajectory in local coordinates
-	ATOS::Trajectory traj = objects.at(id)->getTrajectory();
+	auto traj = objects.at(id)->getTrajectory();
 	this->pathPublishers.emplace(id, ROSChannels::Path::Pub(*this, id));
-	this->pathPublishers.at(id).publish(traj.toPath());
+	this->pathPublishers.at(id).publish(traj->toPath());
 
 	// Update the GUI with the new trajectory in global coordinates
 	GeographicPositionType origin = objects.at(id)->getOrigin();
 	std::array<double,3> llh_0 = {origin.latitude_deg, origin.longitude_deg, origin.altitude_m};
 	this->gnssPathPublishers.emplace(id, ROSChannels::GNSSPath::Pub(*this, id));
-	this->gnssPathPublishers.at(id).publish(traj.toGeoJSON(llh_0));
+	this->gnssPathPublishers.at(id).publish(traj->toGeoJSON(llh_0));
 }
 
 /**
@@ -884,7 +1151,7 @@ void ObjectControl::setObjectTrajectory(uint32_t id){
 		// Get the current trajectory and create a request for the return trajectory service
 		auto returnTrajectoryRequest = std::make_shared<atos_interfaces::srv::GetObjectReturnTrajectory::Request>();
 		returnTrajectoryRequest->id = id;
-		returnTrajectoryRequest->trajectory = objects.at(id)->getTrajectory().toCartesianTrajectory();
+		returnTrajectoryRequest->trajectory = objects.at(id)->getTrajectory()->toCartesianTrajectory();
 		auto pos = objects.at(id)->getLastMonitorData().position;
 		returnTrajectoryRequest->position.x = pos.xCoord_m;
 		returnTrajectoryRequest->position.y = pos.yCoord_m;
@@ -947,6 +1214,18 @@ void ObjectControl::onObjectStateChangeMessage(const ObjectStateChange::message_
 	}
 }
 
+void ObjectControl::onGeofenceBreachMessage(const GeofenceBreach::message_type::SharedPtr msg) {
+	for (const auto id : msg->ids) {
+		RCLCPP_WARN(get_logger(), "Object %u is in breach of a geofence", id);
+	}
+	// Aborting is only possible while objects may be moving under test control
+	const auto currentState = this->state->asNumber();
+	if (currentState == OBC_STATE_ARMED || currentState == OBC_STATE_RUNNING) {
+		RCLCPP_WARN(get_logger(), "Aborting test due to geofence breach");
+		sendAbortNotification();
+	}
+}
+
 void ObjectControl::allClearObjects() {
 	// Send allClear to all connected objects
 	for (auto& id : getVehicleIDs()) {
@@ -1028,9 +1307,9 @@ void ObjectControl::publishScenarioInfoToJournal() {
 			 << "\t - ID: " << object.first << "\n" 
 			 << "\t - IP: " << ip_str << "\n"
 			 << "\t - Origin: (" << testObject->getOrigin().latitude_deg << ", " << testObject->getOrigin().longitude_deg << ", " << testObject->getOrigin().altitude_m << ")\n"
-			 << "\t - Trajectory size: " << testObject->getTrajectory().size() << "\n"
+			 << "\t - Trajectory size: " << traj->size() << "\n"
 			 << "\t - Trajectory: \n";
-		for (const auto& point : traj.points) {
+		for (const auto& point : traj->points) {
 			ss << "\t\t" << point.toString() << "\n";
 		}
 
@@ -0,0 +1,182 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include "objectreactor.hpp"
+#include "objectcontrol.hpp"
+#include "state.hpp"
+
+#include <array>
+#include <cstring>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+ObjectReactor::ObjectReactor(
+		ObjectControl* sh,
+		const unsigned int nThreads,
+		const bool pinThreads,
+		rclcpp::Logger log) :
+	Loggable(log),
+	handler(sh),
+	workers(std::max(nThreads, 1U)) {
+
+	stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (stopFd < 0) {
+		throw std::runtime_error(std::string("Failed to create reactor stop event: ") + strerror(errno));
+	}
+
+	for (auto& worker : workers) {
+		worker.epollFd = epoll_create1(EPOLL_CLOEXEC);
+		if (worker.epollFd < 0) {
+			throw std::runtime_error(std::string("Failed to create epoll instance: ") + strerror(errno));
+		}
+		// A null pointer identifies the stop event
+		epoll_event ev = {};
+		ev.events = EPOLLIN;
+		ev.data.ptr = nullptr;
+		if (epoll_ctl(worker.epollFd, EPOLL_CTL_ADD, stopFd, &ev) < 0) {
+			throw std::runtime_error(std::string("Failed to register reactor stop event: ") + strerror(errno));
+		}
+	}
+
+	const auto nCPUs = std::max(std::thread::hardware_concurrency(), 1U);
+	for (unsigned int i = 0; i < workers.size(); ++i) {
+		auto& worker = workers[i];
+		worker.thread = std::thread(&ObjectReactor::run, this, worker.epollFd);
+
+		if (pinThreads) {
+			cpu_set_t cpus;
+			CPU_ZERO(&cpus);
+			CPU_SET(i % nCPUs, &cpus);
+			if (pthread_setaffinity_np(worker.thread.native_handle(), sizeof (cpus), &cpus) != 0) {
+				RCLCPP_WARN(get_logger(), "Unable to pin reactor thread %u to CPU %u", i, i % nCPUs);
+			}
+		}
+	}
+	RCLCPP_DEBUG(get_logger(), "Started %lu reactor threads", workers.size());
+}
+
+ObjectReactor::~ObjectReactor() {
+	RCLCPP_DEBUG(get_logger(), "Awaiting reactor thread exit");
+	uint64_t stop = 1;
+	write(stopFd, &stop, sizeof (stop));
+	for (auto& worker : workers) {
+		if (worker.thread.joinable()) {
+			worker.thread.join();
+		}
+		close(worker.epollFd);
+	}
+	close(stopFd);
+	RCLCPP_DEBUG(get_logger(), "Reactor threads exited");
+}
+
+void ObjectReactor::add(
+		std::shared_ptr<TestObject> obj) {
+	if (!obj->isConnected()) {
+		throw std::invalid_argument("Attempted to add disconnected object to reactor");
+	}
+	std::lock_guard<std::mutex> lock(registrationMutex);
+	auto id = obj->getTransmitterID();
+	auto previous = activeRegistrations.find(id);
+	if (previous != activeRegistrations.end()) {
+		deactivate(*previous->second);
+		activeRegistrations.erase(previous);
+	}
+
+	auto reg = std::make_unique<Registration>();
+	reg->obj = obj;
+	reg->epollFd = workers[nextWorker++ % workers.size()].epollFd;
+	reg->monitorSocket = obj->getMonitorSocket();
+	reg->commandSocket = obj->getCommandSocket();
+	reg->active = true;
+	reg->sources[0] = {reg.get(), true};
+	reg->sources[1] = {reg.get(), false};
+
+	epoll_event ev = {};
+	ev.events = EPOLLIN;
+	ev.data.ptr = &reg->sources[0];
+	if (epoll_ctl(reg->epollFd, EPOLL_CTL_ADD, reg->monitorSocket, &ev) < 0) {
+		throw std::runtime_error(std::string("Failed to register monitor socket: ") + strerror(errno));
+	}
+	ev.data.ptr = &reg->sources[1];
+	if (epoll_ctl(reg->epollFd, EPOLL_CTL_ADD, reg->commandSocket, &ev) < 0) {
+		epoll_ctl(reg->epollFd, EPOLL_CTL_DEL, reg->monitorSocket, nullptr);
+		throw std::runtime_error(std::string("Failed to register command socket: ") + strerror(errno));
+	}
+	RCLCPP_DEBUG(get_logger(), "Handling messages from object %u in reactor", id);
+	activeRegistrations[id] = reg.get();
+	registrations.push_back(std::move(reg));
+}
+
+void ObjectReactor::remove(
+		const uint32_t id) {
+	std::lock_guard<std::mutex> lock(registrationMutex);
+	auto reg = activeRegistrations.find(id);
+	if (reg != activeRegistrations.end()) {
+		deactivate(*reg->second);
+		activeRegistrations.erase(reg);
+	}
+}
+
+void ObjectReactor::deactivate(
+		Registration& reg) {
+	if (reg.active.exchange(false)) {
+		// Sockets may already have been closed, in which case the kernel removed them
+		epoll_ctl(reg.epollFd, EPOLL_CTL_DEL, reg.monitorSocket, nullptr);
+		epoll_ctl(reg.epollFd, EPOLL_CTL_DEL, reg.commandSocket, nullptr);
+	}
+}
+
+void ObjectReactor::run(
+		const int epollFd) {
+	std::array<epoll_event, maxEventsPerWait> events;
+	while (true) {
+		auto nEvents = epoll_wait(epollFd, events.data(), static_cast<int>(events.size()), -1);
+		if (nEvents < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			RCLCPP_ERROR(get_logger(), "Reactor wait failed: %s", strerror(errno));
+			return;
+		}
+		for (int i = 0; i < nEvents; ++i) {
+			auto source = static_cast<Source*>(events[i].data.ptr);
+			if (source == nullptr) {
+				return; // Stop requested
+			}
+			auto& reg = *source->owner;
+			if (!reg.active) {
+				continue;
+			}
+			auto id = reg.obj->getTransmitterID();
+			try {
+				if (events[i].events & EPOLLERR) {
+					throw std::runtime_error("Socket error for object " + std::to_string(id));
+				}
+				if (source->isMonitor) {
+					reg.obj->handleQueuedMonitorMessages();
+				}
+				else {
+					reg.obj->handleCommandMessage();
+				}
+			} catch (std::invalid_argument& e) {
+				RCLCPP_ERROR(get_logger(), e.what());
+			} catch (std::runtime_error& e) {
+				RCLCPP_ERROR(get_logger(), e.what());
+				{
+					std::lock_guard<std::mutex> lock(registrationMutex);
+					deactivate(reg);
+					auto current = activeRegistrations.find(id);
+					if (current != activeRegistrations.end() && current->second == &reg) {
+						activeRegistrations.erase(current);
+					}
+				}
+				reg.obj->disconnect();
+				handler->state->disconnectedFromObject(*handler, id);
+			}
+		}
+	}
+}
@@ -19,7 +19,7 @@ RelativeAnchor::RelativeAnchor(RelativeAnchor&& other) :
 {
 }
 
-RelativeAnchor::publishMonr(const ROSChannels::Monitor::message_type monr) {
+RelativeAnchor::publishMonr(const ROSChannels::Monitor::message_type& monr) {
 	monrPub.publish(monr);
 	anchorPub.publish(monr);
 }
\ No newline at end of file
@@ -68,6 +68,7 @@ void AbstractKinematics::Connecting::objectAborting(
 
 void AbstractKinematics::Connecting::allObjectsConnected(
 		ObjectControl& handler) {
+	handler.logUploadReport(handler.getUploadReport());
 	handler.startListeners();
 	handler.notifyObjectsConnected();
 }
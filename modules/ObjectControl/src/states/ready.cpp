@@ -60,7 +60,16 @@ void AbstractKinematics::Ready::resetTestObjectsRequest(
 void AbstractKinematics::Ready::reloadObjectSettingsRequest(
 		ObjectControl& handler) {
 	handler.reloadScenarioTrajectories();
-	handler.uploadAllConfigurations();
+	auto report = handler.uploadAllConfigurations();
+	std::string failedIDs;
+	for (const auto& [id, result] : report) {
+		if (!result.success) {
+			failedIDs += " " + std::to_string(id);
+		}
+	}
+	if (!failedIDs.empty()) {
+		throw std::runtime_error("Configuration upload failed for object(s)" + failedIDs);
+	}
 }
 
 /*! ******************************************************
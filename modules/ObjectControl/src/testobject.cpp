@@ -61,6 +61,13 @@ void TestObject::setOrigin(const GeographicPositionType& pos){
 	this->conf.setOrigin(pos);
 }
 
+void TestObject::setMonitorSnapshotSlot(
+		std::shared_ptr<SeqlockMemory> memory,
+		const unsigned int slot) {
+	this->monitorSnapshots = memory;
+	this->monitorSnapshotSlot = slot;
+}
+
 void TestObject::setCommandAddress(
 		const sockaddr_in &newAddr) {
 	if (!this->comms.isConnected()) {
@@ -152,6 +159,61 @@ MonitorMessage TestObject::awaitNextMonitor() {
 
 void TestObject::handleISOMessage(bool awaitNext) {
 	auto message = this->comms.pendingMessageType(awaitNext);
+	bool isFromMonitorChannel = this->comms.mntr.hasBufferedMessage();
+	if (!isFromMonitorChannel) {
+		this->dispatchCommandMessage(message);
+		return;
+	}
+	this->dispatchISOMessage(message);
+	// Drop anything the handlers did not consume, so it is not seen again
+	this->comms.mntr.discardBufferedMessage();
+}
+
+void TestObject::handleQueuedMonitorMessages() {
+	for (auto message = this->comms.mntr.receiveMessage(); message != MESSAGE_ID_INVALID;
+		 message = this->comms.mntr.receiveMessage()) {
+		try {
+			this->dispatchISOMessage(message);
+		} catch (std::invalid_argument& e) {
+			// Keep going, since the remaining datagrams of the batch no longer make
+			// the socket readable and would otherwise wait for the next datagram
+			RCLCPP_ERROR(get_logger(), e.what());
+		}
+		// Drop anything the handlers did not consume, so it is not seen again
+		this->comms.mntr.discardBufferedMessage();
+	}
+}
+
+void TestObject::handleCommandMessage() {
+	this->dispatchCommandMessage(this->comms.cmd.pendingMessageType());
+}
+
+/*!
+ * \brief Handles a message peeked from the command channel. A message which no
+ *			handler consumed would otherwise stay on the socket and keep it readable,
+ *			so it is discarded.
+ */
+void TestObject::dispatchCommandMessage(const ISOMessageID message) {
+	if (message == MESSAGE_ID_INVALID) {
+		return;
+	}
+	const auto nConsumed = this->comms.cmd.receivedMessageCounter;
+	auto discardUnconsumed = [&]() {
+		if (this->comms.cmd.receivedMessageCounter == nConsumed) {
+			RCLCPP_WARN(get_logger(), "Discarding unhandled message of type %d from command channel", message);
+			this->comms.cmd.discardPendingMessages();
+		}
+	};
+	try {
+		this->dispatchISOMessage(message);
+	} catch (std::invalid_argument&) {
+		discardUnconsumed();
+		throw;
+	}
+	discardUnconsumed();
+}
+
+void TestObject::dispatchISOMessage(const ISOMessageID message) {
 	switch (message) {
 	case MESSAGE_ID_MONR: 
 		{
@@ -211,11 +273,11 @@ ObjectStateType TestObject::getState(
 	return this->getState();
 }
 
-void TestObject::publishMonr(const ROSChannels::Monitor::message_type monr){
+void TestObject::publishMonr(const ROSChannels::Monitor::message_type& monr){
 	monrPub->publish(monr);
 }
 
-void TestObject::publishNavSatFix(const ROSChannels::NavSatFix::message_type navSatFix){
+void TestObject::publishNavSatFix(const ROSChannels::NavSatFix::message_type& navSatFix){
 	navSatFixPub->publish(navSatFix);
 }
 
@@ -301,7 +363,7 @@ void TestObject::sendSettings() {
 }
 
 void TestObject::sendTrajectory() {
-	this->comms.cmd << conf.getTrajectory();
+	this->comms.cmd << *conf.getTrajectory();
 }
 
 void TestObject::sendArm() {
@@ -348,19 +410,24 @@ void TestObject::sendControlSignal(const ControlSignalPercentage::SharedPtr csp)
 }
 
 void TestObject::publishMonitor(MonitorMessage& monr){
+	// Convert once, then derive each output from the converted record
+	monitorFanOut.update(monr, this->getOrigin(), this->comms.cmd.addr.sin_addr.s_addr);
+
 	// Publish to journal
-	auto objData = this->getAsObjectData();
-	objData.MonrData = monr.second;
-	JournalRecordMonitorData(&objData);
+	JournalRecordMonitorData(&monitorFanOut.journalData());
+
+	// Publish to shared memory
+	if (monitorSnapshots) {
+		writeSeqlockSlot(monitorSnapshots.get(), monitorSnapshotSlot, &monitorFanOut.journalData());
+	}
 
 	// Publish to ROS topic
-	auto rosMonr = ROSChannels::Monitor::fromISOMonr(monr.first,monr.second);
-	publishMonr(rosMonr);
+	monitorFanOut.toMonitor(monitorMessage);
+	publishMonr(monitorMessage);
 
 	// TODO: Make a translator node that listens on Monitor topic and does this..
-	auto origin = this->getOrigin();
-	std::array<double,3> llh_0 = {origin.latitude_deg, origin.longitude_deg, origin.altitude_m};
-	publishNavSatFix(ROSChannels::NavSatFix::fromROSMonr(llh_0, rosMonr));
+	monitorFanOut.toNavSatFix(navSatFixMessage);
+	publishNavSatFix(navSatFixMessage);
 }
 
 void TestObject::publishStateChange(ObjectStateType &prevObjState){
@@ -0,0 +1,295 @@
+#include "anchorstate.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#define POS_TOL_M 1e-9
+#define HDG_TOL_RAD 1e-9
+#define N_WRITES 2000000
+#define N_READER_THREADS 3
+#define N_BENCHMARK_OPERATIONS 1000000
+
+static void empty_test();
+static void interpolation_test();
+static void heading_wrap_test();
+static void extrapolation_clamp_test();
+static void stress_test();
+static void benchmark();
+static ObjectMonitorType sample(const long time_ms, const double x);
+static struct timeval to_timeval(const double time_s);
+static void check_near(const double actual, const double expected, const double tolerance, const std::string& what);
+
+int main(int argc, char** argv) {
+	try {
+		empty_test();
+		interpolation_test();
+		heading_wrap_test();
+		extrapolation_clamp_test();
+		stress_test();
+		benchmark();
+		exit(EXIT_SUCCESS);
+	}
+	catch (std::exception& e) {
+		std::cerr << "Test " << __FILE__ << " failed: " << std::endl
+				  << e.what() << std::endl;
+		exit(EXIT_FAILURE);
+	}
+}
+
+/*!
+ * \brief Anchor sample at the specified time, whose other quantities are all
+ *			derived from x so that a sample mixed from several writes can be
+ *			detected. Velocity is invalid, so that the sample is not extrapolated.
+ */
+ObjectMonitorType sample(const long time_ms, const double x) {
+	ObjectMonitorType monr = {};
+	monr.timestamp.tv_sec = time_ms / 1000;
+	monr.timestamp.tv_usec = (time_ms % 1000) * 1000;
+	monr.isTimestampValid = true;
+	monr.position.xCoord_m = x;
+	monr.position.yCoord_m = 2.0 * x;
+	monr.position.zCoord_m = -x;
+	monr.position.heading_rad = 0.0;
+	monr.position.isPositionValid = true;
+	monr.position.isHeadingValid = true;
+	monr.speed.longitudinal_m_s = 3.0 * x;
+	monr.speed.lateral_m_s = 0.0;
+	monr.speed.isLongitudinalValid = false;
+	monr.speed.isLateralValid = false;
+	return monr;
+}
+
+struct timeval to_timeval(const double time_s) {
+	struct timeval tv;
+	tv.tv_sec = static_cast<time_t>(std::floor(time_s));
+	tv.tv_usec = static_cast<suseconds_t>(std::lround((time_s - std::floor(time_s)) * 1e6));
+	return tv;
+}
+
+void check_near(const double actual, const double expected, const double tolerance, const std::string& what) {
+	if (!(std::abs(actual - expected) <= tolerance)) {
+		throw std::runtime_error(what + " was " + std::to_string(actual) + ", expected " + std::to_string(expected));
+	}
+}
+
+/*!
+ * \brief Without anchor data no state is returned, whether or not a time is given.
+ */
+void empty_test() {
+	AnchorStateHistory history;
+	ObjectMonitorType state;
+	if (history.latest(state) || history.stateAt(to_timeval(1.0), true, state)
+			|| history.stateAt(to_timeval(1.0), false, state)) {
+		throw std::runtime_error("Empty anchor history returned a state");
+	}
+}
+
+/*!
+ * \brief Between two samples every quantity is interpolated linearly, and the
+ *			result is stamped with the requested time. An invalid time gives the
+ *			latest sample.
+ */
+void interpolation_test() {
+	AnchorStateHistory history;
+	ObjectMonitorType state;
+	auto first = sample(1000, 0.0), second = sample(1100, 1.0);
+	first.position.heading_rad = 0.1;
+	second.position.heading_rad = 0.3;
+	history.push(first);
+	history.push(second);
+
+	auto time = to_timeval(1.025);
+	if (!history.stateAt(time, true, state)) {
+		throw std::runtime_error("No interpolated anchor state");
+	}
+	check_near(state.position.xCoord_m, 0.25, POS_TOL_M, "Interpolated x");
+	check_near(state.position.yCoord_m, 0.5, POS_TOL_M, "Interpolated y");
+	check_near(state.position.zCoord_m, -0.25, POS_TOL_M, "Interpolated z");
+	check_near(state.position.heading_rad, 0.15, HDG_TOL_RAD, "Interpolated heading");
+	check_near(state.speed.longitudinal_m_s, 0.75, POS_TOL_M, "Interpolated longitudinal speed");
+	if (state.timestamp.tv_sec != time.tv_sec || state.timestamp.tv_usec != time.tv_usec) {
+		throw std::runtime_error("Interpolated state not stamped with the requested time");
+	}
+
+	if (!history.stateAt(time, false, state)) {
+		throw std::runtime_error("No latest anchor state");
+	}
+	check_near(state.position.xCoord_m, 1.0, POS_TOL_M, "Latest x");
+}
+
+/*!
+ * \brief Headings on either side of north are interpolated through north, not
+ *			the long way round.
+ */
+void heading_wrap_test() {
+	AnchorStateHistory history;
+	ObjectMonitorType state;
+	auto first = sample(1000, 0.0), second = sample(1100, 0.0);
+	first.position.heading_rad = 2*M_PI - 0.1;
+	second.position.heading_rad = 0.1;
+	history.push(first);
+	history.push(second);
+
+	history.stateAt(to_timeval(1.05), true, state);
+	check_near(std::remainder(state.position.heading_rad, 2*M_PI), 0.0, HDG_TOL_RAD, "Heading interpolated across north");
+	history.stateAt(to_timeval(1.075), true, state);
+	check_near(std::remainder(state.position.heading_rad, 2*M_PI), 0.05, HDG_TOL_RAD, "Heading interpolated past north");
+}
+
+/*!
+ * \brief Outside the stored samples the anchor is moved along its velocity, by
+ *			at most AnchorStateHistory::maxExtrapolationTime, both after the newest
+ *			sample and before the oldest one still stored.
+ */
+void extrapolation_clamp_test() {
+	AnchorStateHistory history;
+	ObjectMonitorType state;
+	const double maxTime = AnchorStateHistory::maxExtrapolationTime;
+	for (std::size_t i = 0; i < AnchorStateHistory::capacity + 4; ++i) {
+		auto monr = sample(1000 + 100 * static_cast<long>(i), 0.0);
+		monr.position.xCoord_m = 10.0 * i;
+		monr.position.yCoord_m = 0.0;
+		monr.position.heading_rad = M_PI / 2;
+		monr.speed.longitudinal_m_s = 2.0;
+		monr.speed.lateral_m_s = -1.0;
+		monr.speed.isLongitudinalValid = true;
+		monr.speed.isLateralValid = true;
+		history.push(monr);
+	}
+	// Heading north, longitudinal speed moves the anchor along y and lateral speed along -x
+	const double newestTime = 1.0 + 0.1 * (AnchorStateHistory::capacity + 3);
+	const double newestX = 10.0 * (AnchorStateHistory::capacity + 3);
+	const double oldestTime = 1.0 + 0.1 * 4, oldestX = 40.0;
+	const std::vector<std::pair<double, double>> cases = {
+		{newestTime + 0.2, 0.2},
+		{newestTime + maxTime, maxTime},
+		{newestTime + 10.0, maxTime},
+		{oldestTime - 0.2, -0.2},
+		{oldestTime - 10.0, -maxTime}
+	};
+	for (const auto& [time, expectedDt] : cases) {
+		if (!history.stateAt(to_timeval(time), true, state)) {
+			throw std::runtime_error("No extrapolated anchor state");
+		}
+		const double baseX = time > newestTime ? newestX : oldestX;
+		const std::string what = "Anchor extrapolated to " + std::to_string(time) + " s";
+		check_near(state.position.xCoord_m, baseX + 1.0 * expectedDt, 1e-6, what + ", x");
+		check_near(state.position.yCoord_m, 2.0 * expectedDt, 1e-6, what + ", y");
+	}
+}
+
+/*!
+ * \brief Pushes samples from one thread while several threads read the latest
+ *			and interpolated states. Interpolation preserves the relations between
+ *			the quantities of a sample, so every state read must satisfy them.
+ */
+void stress_test() {
+	AnchorStateHistory history;
+	history.push(sample(0, 0.0));
+	std::atomic<bool> writerDone(false);
+	std::atomic<long> latestWritten(0);
+	std::atomic<uint64_t> nTorn(0), nReads(0);
+
+	std::thread writer([&]() {
+		for (long n = 1; n <= N_WRITES; ++n) {
+			history.push(sample(n, static_cast<double>(n)));
+			latestWritten.store(n, std::memory_order_relaxed);
+		}
+		writerDone = true;
+	});
+	std::vector<std::thread> readers;
+	for (int r = 0; r < N_READER_THREADS; ++r) {
+		readers.emplace_back([&, r]() {
+			ObjectMonitorType state;
+			uint64_t reads = 0, torn = 0;
+			while (!writerDone.load()) {
+				bool found;
+				switch ((reads + r) % 3) {
+				case 0:
+					// The latest sample keeps its timestamp, which must match x
+					found = history.latest(state)
+							&& state.timestamp.tv_sec * 1000 + state.timestamp.tv_usec / 1000 == std::lround(state.position.xCoord_m);
+					break;
+				case 1:
+					// Between the samples a few writes back, which are likely still stored
+					found = history.stateAt(to_timeval(std::max((latestWritten.load(std::memory_order_relaxed) - 4.5) * 1e-3, 0.0)),
+											true, state);
+					break;
+				default:
+					// Before all stored samples, so the oldest is read, which is the next to be overwritten
+					found = history.stateAt(to_timeval(0.0), true, state);
+					break;
+				}
+				const double x = state.position.xCoord_m;
+				const double tolerance = POS_TOL_M * std::max(1.0, std::abs(x));
+				if (!found || std::abs(state.position.yCoord_m - 2.0 * x) > tolerance
+						|| std::abs(state.position.zCoord_m + x) > tolerance
+						|| std::abs(state.speed.longitudinal_m_s - 3.0 * x) > tolerance) {
+					++torn;
+				}
+				++reads;
+			}
+			nTorn += torn;
+			nReads += reads;
+		});
+	}
+	writer.join();
+	for (auto& reader : readers) {
+		reader.join();
+	}
+
+	ObjectMonitorType state;
+	if (!history.latest(state) || state.position.xCoord_m != N_WRITES) {
+		throw std::runtime_error("Latest anchor state was not the last written");
+	}
+	if (nTorn > 0) {
+		throw std::runtime_error(std::to_string(nTorn) + " of " + std::to_string(nReads) + " reads were torn");
+	}
+	std::cout << "Stress test: " << nReads << " consistent reads during " << N_WRITES << " writes" << std::endl;
+}
+
+/*!
+ * \brief Reports the time taken per MONR to store an anchor sample and to look
+ *			up the anchor state at the time of a relative object MONR, alone and
+ *			while another thread stores samples.
+ */
+void benchmark() {
+	using namespace std::chrono;
+	AnchorStateHistory history;
+	ObjectMonitorType state;
+
+	auto start = steady_clock::now();
+	for (long i = 0; i < N_BENCHMARK_OPERATIONS; ++i) {
+		history.push(sample(i, static_cast<double>(i)));
+	}
+	auto pushTime = duration<double, std::nano>(steady_clock::now() - start) / N_BENCHMARK_OPERATIONS;
+
+	// Relative object MONR a varying number of anchor samples behind the newest
+	start = steady_clock::now();
+	for (long i = 0; i < N_BENCHMARK_OPERATIONS; ++i) {
+		history.stateAt(to_timeval((N_BENCHMARK_OPERATIONS - 1 - i % AnchorStateHistory::capacity - 0.5) * 1e-3), true, state);
+	}
+	auto stateAtTime = duration<double, std::nano>(steady_clock::now() - start) / N_BENCHMARK_OPERATIONS;
+
+	std::atomic<bool> stop(false);
+	std::thread writer([&]() {
+		for (long n = N_BENCHMARK_OPERATIONS; !stop.load(std::memory_order_relaxed); ++n) {
+			history.push(sample(n, static_cast<double>(n)));
+		}
+	});
+	start = steady_clock::now();
+	for (long i = 0; i < N_BENCHMARK_OPERATIONS; ++i) {
+		history.stateAt(to_timeval((N_BENCHMARK_OPERATIONS + i) * 1e-3), true, state);
+	}
+	auto contendedStateAtTime = duration<double, std::nano>(steady_clock::now() - start) / N_BENCHMARK_OPERATIONS;
+	stop = true;
+	writer.join();
+
+	std::cout << "Per MONR: push " << pushTime.count() << " ns, stateAt " << stateAtTime.count()
+			  << " ns, stateAt during pushes " << contendedStateAtTime.count() << " ns" << std::endl;
+}
@@ -29,17 +29,23 @@
 #include "atosTime.h"
 #include "datadictionary.h"
 #include "util.h"
+#include "seqlockmem.h"
+#include "geofence.hpp"
 #include "roschannels/commandchannels.hpp"
 #include "roschannels/remotecontrolchannels.hpp"
 
+#include <atomic>
 #include <chrono>
 #include <map>
+#include <set>
+#include <thread>
+#include <vector>
 
 class SystemControl : public Module
 {
 public:
 	SystemControl();
-	const int64_t getQueueEmptyPollPeriod();
+	~SystemControl();
 	bool isWorking();
 	bool shouldExit();
 	void initialize();
@@ -48,12 +54,19 @@ public:
 	void processUserCommand();
 	void sendUnsolicitedData();
 	void pollModuleStatus();
+	void checkGeofences();
+	void startEventWatcher();
+	void stopEventWatcher();
+	void rearmEventWatcher();
+	std::chrono::nanoseconds getTimeUntilNextEvent();
 
 private:
 	static inline std::string const module_name = "system_control";
 	//const std::string module_name = std::string("SystemControl");
 	/* constants and datatypes */
-	const int64_t QUEUE_EMPTY_POLL_PERIOD_NS = 10000000;
+	static constexpr std::chrono::seconds MAX_IDLE_WAIT = std::chrono::seconds(1);
+	//! Time a file transfer may stall before it is aborted
+	static constexpr std::chrono::milliseconds FILE_TRANSFER_IDLE_TIMEOUT = std::chrono::milliseconds(3000);
 
 	static const int SYSTEM_CONTROL_RESPONSE_CODE_OK = 0x0001;
 	static const int SYSTEM_CONTROL_RESPONSE_CODE_ERROR = 0x0F10;
@@ -79,6 +92,8 @@ private:
 	static const int SYSTEM_CONTROL_ARGUMENT_MAX_LENGTH = 32;
 
 	static const int SYSTEM_CONTROL_RVSS_DATA_BUFFER = 128;
+	//! Largest binary RVSS monitor datagram, chosen to avoid IP fragmentation
+	static const int SYSTEM_CONTROL_RVSS_MONITOR_BINARY_BUFFER = 1400;
 
 	static const int TCP_RECV_BUFFER_SIZE = 2048;
 	
@@ -177,7 +192,9 @@ private:
 													U8 SysCtrlState, U8 Debug);
 	I32 SystemControlBuildRVSSAspChannelMessage(char * RVSSData, U32 * RVSSDataLengthU32, U8 Debug);
 	int32_t SystemControlSendRVSSMonitorChannelMessages(int *socket, struct sockaddr_in *addr);
-	void SystemControlUpdateRVSSSendTime(struct timeval *currentRVSSSendTime, uint8_t RVSSRate_Hz);
+	int32_t SystemControlSendRVSSMonitorBinaryMessages(int *socket, struct sockaddr_in *addr);
+	void SystemControlSendRVSSMonitorBinaryDatagram(int *socket, struct sockaddr_in *addr, uint16_t numberOfRecords);
+	void SystemControlUpdateRVSSSendTime(struct timeval *currentRVSSSendTime, uint16_t RVSSRate_Hz);
 
 	I32 SystemControlGetStatusMessage(const char *respondingModule, U8 debug);
 
@@ -232,6 +249,25 @@ private:
 	struct in_addr ip_addr;
 	I32 RVSSChannelSocket;
 	struct timeval nextRVSSSendTime = { 0, 0 };
+	std::chrono::steady_clock::time_point nextModulePollTime;
+
+	ATOS::GeofenceEngine geofenceEngine;
+	uint16_t geofenceCheckRate_Hz = 0;		//!< If 0, positions are not checked against geofences
+	std::chrono::steady_clock::time_point nextGeofenceCheckTime;
+	std::vector<uint32_t> geofenceTransmitterIDs;	//!< Reused between geofence checks
+	std::vector<ATOS::GeofenceEngine::Position> geofencePositions;
+	std::vector<ATOS::GeofenceEngine::Breach> geofenceBreaches;
+	std::set<uint32_t> breachingObjectIDs;	//!< Objects in breach of a geofence at the last check
+	void loadGeofences();
+
+	int eventPollFd = -1;					//!< epoll instance watched by the event watcher
+	int wakeFd = -1;						//!< eventfd for waking the main loop
+	int watchedClientSocket = -1;			//!< User control socket registered with eventPollFd
+	std::atomic<bool> stopWatcher = false;
+	std::thread eventWatcher;
+	bool userControlDataPending = false;	//!< A complete command is buffered and not yet handled
+	void watchEvents();
+	void wakeUp();
 
 	OBCState_t objectControlState = OBC_STATE_UNDEFINED;
 	SystemControlCommand_t SystemControlCommand = Idle_0;
@@ -277,8 +313,14 @@ private:
 
 	char RVSSData[SYSTEM_CONTROL_RVSS_DATA_BUFFER];
 	U32 RVSSMessageLengthU32;
+	char RVSSMonitorBinaryData[SYSTEM_CONTROL_RVSS_MONITOR_BINARY_BUFFER];
+	uint16_t RVSSMonitorBinaryRate_Hz = 0;	//!< If 0, the binary monitor channel is sent at the RVSS rate
+	struct timeval nextRVSSMonitorBinarySendTime = { 0, 0 };
+	std::vector<uint32_t> RVSSTransmitterIDs;	//!< Reused between RVSS monitor messages
+	SeqlockMemory* monitorSnapshots = nullptr;	//!< Latest monitor data of each object, written by ObjectControl
 	U16 PCDMessageCodeU16;
 	char RxFilePath[MAX_FILE_PATH];
+	bool fileTransferChecksum = false;	//!< Log a CRC-32 of each uploaded file
 
 	std::map<std::string, std::chrono::steady_clock::time_point> moduleResponseTable;
 
@@ -296,6 +338,7 @@ private:
 	ROSChannels::RemoteControlDisable::Pub remoteControlDisablePub;
 	ROSChannels::Exit::Pub exitPub;
 	ROSChannels::GetStatus::Pub getStatusPub;
+	ROSChannels::GeofenceBreach::Pub geofenceBreachPub;
 
 	ROSChannels::Failure::Sub failureSub;
 	ROSChannels::GetStatusResponse::Sub getStatusResponseSub;
@@ -33,18 +33,21 @@ void systemcontrol_task(int argc, char** argv){
 	}
 
 	rclcpp::executors::SingleThreadedExecutor executor;
+	sc->startEventWatcher();
 
 	while (rclcpp::ok() && !sc->shouldExit()){
 		sc->receiveUserCommand();
 		sc->processUserCommand();
 		sc->sendUnsolicitedData();
 		sc->pollModuleStatus();
+		sc->checkGeofences();
 
-		// If SystemControl is not in work state and clientResult < 0 then wait at most QUEUE_EMPTY_POLL_PERIOD for a msg
-		// else keep running at full speed.
-		const int64_t sleeptime=sc->isWorking() ? 0 : sc->getQueueEmptyPollPeriod();
-		executor.spin_node_once(sc,duration<int64_t,nanoseconds::period>(sleeptime));
+		// Sleep until a ROS message or user control data arrives, or until the next scheduled
+		// task is due. A zero timeout would only check for ready work without waiting.
+		sc->rearmEventWatcher();
+		executor.spin_node_once(sc, sc->getTimeUntilNextEvent());
 	}
+	sc->stopEventWatcher();
 	ReadWriteAccess_t dataDictOperationResult = DataDictionaryDestructor();
 	if (dataDictOperationResult != WRITE_OK && dataDictOperationResult != READ_WRITE_OK) {
 		util_error("Unable to clear shared memory space");
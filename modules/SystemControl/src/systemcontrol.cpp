@@ -4,12 +4,20 @@
  * file, You can obtain one at https://mozilla.org/MPL/2.0/.
  */
 #include "systemcontrol.hpp"
+#include "filetransfer.hpp"
+#include <algorithm>
 #include <cstdio>
+#include <filesystem>
+#include <mutex>
+#include <system_error>
 #include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 
 #define SYSTEM_CONTROL_SERVICE_POLL_TIME_MS 5000
 #define SYSTEM_CONTROL_TASK_PERIOD_MS 1
 #define SYSTEM_CONTROL_RVSS_TIME_MS 10
+#define SYSTEM_CONTROL_ACCEPT_POLL_TIME_MS 100
 
 #define SYSTEM_CONTROL_GETSTATUS_TIME_MS 5000
 #define SYSTEM_CONTROL_GETSTATUS_TIMEOUT_MS 2000
@@ -26,6 +34,7 @@
 #define RVSS_MONITOR_CHANNEL 2
 #define RVSS_ATOS_CHANNEL 4
 #define RVSS_ASP_CHANNEL 8
+#define RVSS_MONITOR_BINARY_CHANNEL 16
 
 #define ENABLE_COMMAND_STRING "ENABLE"
 #define DISABLE_COMMAND_STRING "DISABLE"
@@ -59,12 +68,24 @@ remoteControlEnablePub(*this),
 remoteControlDisablePub(*this),
 exitPub(*this),
 getStatusPub(*this),
+geofenceBreachPub(*this),
 failureSub(*this, std::bind(&SystemControl::onFailureMessage, this, _1)),
 getStatusResponseSub(*this, std::bind(&SystemControl::onGetStatusResponse, this, _1))
 {
+	this->declare_parameter("rvss_binary_monitor_rate", 0);
+	auto rate = this->get_parameter("rvss_binary_monitor_rate").as_int();
+	RVSSMonitorBinaryRate_Hz = static_cast<uint16_t>(std::clamp<int64_t>(rate, 0, UINT16_MAX));
+	this->declare_parameter("file_transfer_checksum", false);
+	fileTransferChecksum = this->get_parameter("file_transfer_checksum").as_bool();
+	this->declare_parameter("geofence_check_rate", 0);
+	rate = this->get_parameter("geofence_check_rate").as_int();
+	geofenceCheckRate_Hz = static_cast<uint16_t>(std::clamp<int64_t>(rate, 0, UINT16_MAX));
 }; 
 
-const int64_t SystemControl::getQueueEmptyPollPeriod(){return QUEUE_EMPTY_POLL_PERIOD_NS;}
+SystemControl::~SystemControl() {
+	stopEventWatcher();
+	closeSeqlockMemory(monitorSnapshots);
+}
 
 void SystemControl::onAbortMessage(const Abort::message_type::SharedPtr){}
 
@@ -119,6 +140,7 @@ void SystemControl::signalHandler(int signo) {
 	if (signo == SIGINT) {
 		RCLCPP_WARN(get_logger(), "Caught keyboard interrupt");
 		iExit = 1;
+		wakeUp();
 	}
 	else {
 		RCLCPP_ERROR(get_logger(), "Caught unhandled signal");
@@ -154,10 +176,17 @@ void SystemControl::initialize(){
 
 		DataDictionaryGetRVSSRateU8(&RVSSRateU8);
 		RCLCPP_INFO(get_logger(), "Real-time variable subscription service rate set to %u Hz", RVSSRateU8);
+
+		monitorSnapshots = createSeqlockMemory(MONITOR_SNAPSHOT_MEMORY_NAME, MONITOR_SNAPSHOT_SLOTS,
+											   sizeof (ObjectDataType), nullptr);
+		if (monitorSnapshots == nullptr) {
+			RCLCPP_WARN(get_logger(), "Unable to open monitor snapshot memory - binary RVSS monitor data cannot be sent");
+		}
 	}
 	else {
 		throw std::runtime_error("Unable to initialize data dictionary");
 	}
+	loadGeofences();
 	if (ModeU8 == 0) {
 
 	}
@@ -436,6 +465,14 @@ void SystemControl::sendUnsolicitedData(){
 			}
 		}
 	}
+
+	// The binary monitor channel runs on its own schedule so it can be sent faster than the other channels
+	if (RVSSChannelSocket != 0 && RVSSConfigU32 & RVSS_MONITOR_BINARY_CHANNEL
+			&& timercmp(&tvTime, &nextRVSSMonitorBinarySendTime, >)) {
+		SystemControlUpdateRVSSSendTime(&nextRVSSMonitorBinarySendTime,
+										RVSSMonitorBinaryRate_Hz == 0 ? RVSSRateU8 : RVSSMonitorBinaryRate_Hz);
+		SystemControlSendRVSSMonitorBinaryMessages(&RVSSChannelSocket, &RVSSChannelAddr);
+	}
 }
 
 void SystemControl::processUserCommand()
@@ -600,6 +637,7 @@ void SystemControl::processUserCommand()
 				SystemControlDeleteGeofence(SystemControlArgument[0], sizeof (SystemControlArgument[0]));
 			SystemControlSendControlResponse(SYSTEM_CONTROL_RESPONSE_CODE_OK, "DeleteGeofence:",
 												ControlResponseBuffer, 1, &ClientSocket, 0);
+			loadGeofences();
 		}
 		else {
 			RCLCPP_ERROR(get_logger(),
@@ -647,6 +685,7 @@ void SystemControl::processUserCommand()
 			*ControlResponseBuffer = SystemControlClearGeofences();
 			SystemControlSendControlResponse(SYSTEM_CONTROL_RESPONSE_CODE_OK, "ClearGeofences:",
 												ControlResponseBuffer, 1, &ClientSocket, 0);
+			loadGeofences();
 		}
 		else {
 			RCLCPP_ERROR(get_logger(),
@@ -782,9 +821,9 @@ void SystemControl::processUserCommand()
 			}
 			else if (ControlResponseBuffer[0] == PATH_INVALID_MISSING) {
 				RCLCPP_INFO(get_logger(), "Failed receiving file: %s", SystemControlArgument[0]);
-				SystemControlReceiveRxData(&ClientSocket, RxFilePath, SystemControlArgument[1],
+				// Read and discard the file data to keep the control connection in sync
+				SystemControlReceiveRxData(&ClientSocket, "", SystemControlArgument[1],
 											STR_SYSTEM_CONTROL_RX_PACKET_SIZE, ControlResponseBuffer, 0);
-				SystemControlDeleteFileDirectory(RxFilePath, ControlResponseBuffer, 0);
 				ControlResponseBuffer[0] = PATH_INVALID_MISSING;
 			}
 			else {
@@ -796,6 +835,10 @@ void SystemControl::processUserCommand()
 
 			SystemControlSendControlResponse(SYSTEM_CONTROL_RESPONSE_CODE_OK, "SubUploadFile:",
 												ControlResponseBuffer, 1, &ClientSocket, 0);
+			if (ControlResponseBuffer[0] == FILE_UPLOADED
+					&& atoi(SystemControlArgument[3]) == ATOS_GEOFENCE_FILE_TYPE) {
+				loadGeofences();
+			}
 
 		}
 		else {
@@ -1146,11 +1189,263 @@ void SystemControl::processUserCommand()
 }
 
 void SystemControl::pollModuleStatus() {
-	static auto nextPollTime = std::chrono::steady_clock::now();
 	constexpr auto pollPeriod = std::chrono::seconds(1);
-	if (std::chrono::steady_clock::now() > nextPollTime) {
+	if (std::chrono::steady_clock::now() > nextModulePollTime) {
 		getStatusPub.publish(ROSChannels::GetStatus::message_type());
-		nextPollTime = std::chrono::steady_clock::now() + pollPeriod;
+		nextModulePollTime = std::chrono::steady_clock::now() + pollPeriod;
+	}
+}
+
+/*!
+ * \brief loadGeofences Replaces the geofences checked against object positions with those
+ *			in the geofence directory. Files which cannot be read are reported and skipped.
+ */
+void SystemControl::loadGeofences() {
+	if (geofenceCheckRate_Hz == 0) {
+		return;
+	}
+	char path[MAX_FILE_PATH];
+	UtilGetGeofenceDirectoryPath(path, sizeof (path));
+	std::vector<std::string> errors;
+	try {
+		geofenceEngine = ATOS::GeofenceEngine::fromDirectory(path, &errors);
+	}
+	catch (std::filesystem::filesystem_error& e) {
+		RCLCPP_ERROR(get_logger(), "Failed to read geofence directory: %s", e.what());
+		geofenceEngine = ATOS::GeofenceEngine();
+	}
+	for (const auto& error : errors) {
+		RCLCPP_ERROR(get_logger(), "Skipped geofence file: %s", error.c_str());
+	}
+	breachingObjectIDs.clear();
+	RCLCPP_INFO(get_logger(), "Loaded %zu geofences", geofenceEngine.geofences().size());
+}
+
+/*!
+ * \brief checkGeofences Checks the latest positions of all objects against the loaded geofences
+ *			while objects are connected. Objects which have newly breached a geofence are reported,
+ *			and while objects are armed or running all objects in breach are reported at each
+ *			check, so that an object which was already outside when the test was armed or
+ *			started causes an abort.
+ */
+void SystemControl::checkGeofences() {
+	using namespace std::chrono;
+	if (geofenceCheckRate_Hz == 0 || geofenceEngine.empty() || steady_clock::now() < nextGeofenceCheckTime) {
+		return;
+	}
+	nextGeofenceCheckTime = steady_clock::now() + duration_cast<steady_clock::duration>(
+				duration<double>(1.0 / geofenceCheckRate_Hz));
+
+	if (objectControlState != OBC_STATE_CONNECTED && objectControlState != OBC_STATE_ARMED
+			&& objectControlState != OBC_STATE_RUNNING && objectControlState != OBC_STATE_REMOTECTRL) {
+		breachingObjectIDs.clear();
+		return;
+	}
+
+	uint32_t numberOfObjects;
+	if (DataDictionaryGetNumberOfObjects(&numberOfObjects) != READ_OK) {
+		RCLCPP_ERROR(get_logger(), "Data dictionary number of objects read error - geofences cannot be checked");
+		return;
+	}
+	if (geofenceTransmitterIDs.size() < numberOfObjects) {
+		geofenceTransmitterIDs.resize(numberOfObjects);
+	}
+	if (DataDictionaryGetObjectTransmitterIDs(geofenceTransmitterIDs.data(), numberOfObjects) != READ_OK) {
+		RCLCPP_ERROR(get_logger(), "Data dictionary transmitter ID read error - geofences cannot be checked");
+		return;
+	}
+
+	geofencePositions.clear();
+	ObjectMonitorType monitorData;
+	struct timeval recvTime;
+	for (uint32_t i = 0; i < numberOfObjects; ++i) {
+		const uint32_t transmitterID = geofenceTransmitterIDs[i];
+		if (transmitterID == 0
+				|| (DataDictionaryGetMonitorDataReceiveTime(transmitterID, &recvTime) == READ_OK
+					&& !timerisset(&recvTime))
+				|| DataDictionaryGetMonitorData(transmitterID, &monitorData) != READ_OK
+				|| !monitorData.position.isPositionValid) {
+			continue;
+		}
+		geofencePositions.push_back({transmitterID, monitorData.position.xCoord_m, monitorData.position.yCoord_m,
+									 monitorData.position.zCoord_m, monitorData.position.isZcoordValid});
+	}
+
+	geofenceEngine.check(geofencePositions, geofenceBreaches);
+	const bool isTestActive = objectControlState == OBC_STATE_ARMED || objectControlState == OBC_STATE_RUNNING;
+	std::set<uint32_t> breaching;
+	ROSChannels::GeofenceBreach::message_type msg;
+	for (const auto& breach : geofenceBreaches) {
+		if (!breaching.insert(breach.objectId).second) {
+			continue;
+		}
+		const bool isNewBreach = !breachingObjectIDs.count(breach.objectId);
+		if (isNewBreach) {
+			RCLCPP_WARN(get_logger(), "Object %u breached geofence %s", breach.objectId,
+						geofenceEngine.geofences()[breach.geofence].name.c_str());
+		}
+		if (isNewBreach || isTestActive) {
+			msg.ids.push_back(breach.objectId);
+		}
+	}
+	breachingObjectIDs.swap(breaching);
+	if (!msg.ids.empty()) {
+		geofenceBreachPub.publish(msg);
+	}
+}
+
+/*!
+ * \brief startEventWatcher Starts a thread which waits for data on the user control socket
+ *			and wakes the main loop when there is any. The main loop itself waits in the ROS
+ *			executor, and is woken by triggering the node's guard condition.
+ */
+void SystemControl::startEventWatcher() {
+	if ((eventPollFd = epoll_create1(EPOLL_CLOEXEC)) == -1) {
+		throw std::runtime_error(std::string("Failed to create epoll instance: ") + strerror(errno));
+	}
+	if ((wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) == -1) {
+		throw std::runtime_error(std::string("Failed to create eventfd: ") + strerror(errno));
+	}
+	struct epoll_event event = {};
+	event.events = EPOLLIN;
+	event.data.fd = wakeFd;
+	if (epoll_ctl(eventPollFd, EPOLL_CTL_ADD, wakeFd, &event) == -1) {
+		throw std::runtime_error(std::string("Failed to watch eventfd: ") + strerror(errno));
+	}
+	stopWatcher = false;
+	eventWatcher = std::thread(&SystemControl::watchEvents, this);
+}
+
+void SystemControl::stopEventWatcher() {
+	if (eventWatcher.joinable()) {
+		stopWatcher = true;
+		wakeUp();
+		eventWatcher.join();
+	}
+	if (wakeFd != -1) {
+		close(wakeFd);
+		wakeFd = -1;
+	}
+	if (eventPollFd != -1) {
+		close(eventPollFd);
+		eventPollFd = -1;
+	}
+	watchedClientSocket = -1;
+}
+
+/*!
+ * \brief rearmEventWatcher Registers the current user control socket with the event watcher.
+ *			The socket is watched in one-shot mode, so that the watcher does not spin while the
+ *			main loop has yet to read the data, and must be rearmed after each read.
+ */
+void SystemControl::rearmEventWatcher() {
+	if (eventPollFd == -1) {
+		return;
+	}
+	const int socket = ClientSocket > 0 ? ClientSocket : -1;
+	struct epoll_event event = {};
+	event.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+	event.data.fd = socket;
+	if (socket != watchedClientSocket) {
+		if (watchedClientSocket != -1) {
+			// Fails harmlessly if the socket was closed, as that removes it from the epoll set
+			epoll_ctl(eventPollFd, EPOLL_CTL_DEL, watchedClientSocket, nullptr);
+		}
+		if (socket != -1 && epoll_ctl(eventPollFd, EPOLL_CTL_ADD, socket, &event) == -1) {
+			RCLCPP_ERROR(get_logger(), "Failed to watch user control socket: %s", strerror(errno));
+			watchedClientSocket = -1;
+			return;
+		}
+		watchedClientSocket = socket;
+	}
+	else if (socket != -1 && epoll_ctl(eventPollFd, EPOLL_CTL_MOD, socket, &event) == -1
+			 && !(errno == ENOENT && epoll_ctl(eventPollFd, EPOLL_CTL_ADD, socket, &event) == 0)) {
+		// ENOENT if the socket was closed and its descriptor reused by a new connection
+		RCLCPP_ERROR(get_logger(), "Failed to rearm user control socket watch: %s", strerror(errno));
+	}
+}
+
+/*!
+ * \brief getTimeUntilNextEvent Computes how long the main loop may wait for ROS messages or user
+ *			control data before it has to run again to send RVSS data, poll module status, check
+ *			geofences or progress a command in work.
+ * \return Time until the main loop needs to run
+ */
+std::chrono::nanoseconds SystemControl::getTimeUntilNextEvent() {
+	using namespace std::chrono;
+	if (userControlDataPending) {
+		return nanoseconds(0);
+	}
+
+	nanoseconds timeout = std::min<nanoseconds>(MAX_IDLE_WAIT, nextModulePollTime - steady_clock::now());
+	if (geofenceCheckRate_Hz > 0 && !geofenceEngine.empty()) {
+		timeout = std::min<nanoseconds>(timeout, nextGeofenceCheckTime - steady_clock::now());
+	}
+	if (isWorking()) {
+		// Object control state is read from the data dictionary, which gives no notification of changes
+		timeout = std::min<nanoseconds>(timeout, milliseconds(SYSTEM_CONTROL_TASK_PERIOD_MS));
+	}
+	if (RVSSChannelSocket != 0 && RVSSConfigU32 > 0) {
+		struct timeval now, remaining;
+		TimeSetToCurrentSystemTime(&now);
+		auto timeUntil = [&](const struct timeval& deadline) -> nanoseconds {
+			if (!timercmp(&deadline, &now, >)) {
+				return nanoseconds(0);
+			}
+			timersub(&deadline, &now, &remaining);
+			return seconds(remaining.tv_sec) + microseconds(remaining.tv_usec);
+		};
+		timeout = std::min(timeout, timeUntil(nextRVSSSendTime));
+		if (RVSSConfigU32 & RVSS_MONITOR_BINARY_CHANNEL) {
+			timeout = std::min(timeout, timeUntil(nextRVSSMonitorBinarySendTime));
+		}
+	}
+	return std::max(timeout, nanoseconds(0));
+}
+
+/*!
+ * \brief watchEvents Waits for user control data or a wakeup request, and wakes the main loop
+ *			by triggering the node's guard condition, which interrupts the executor's wait.
+ */
+void SystemControl::watchEvents() {
+	struct epoll_event events[2];
+	while (!stopWatcher) {
+		int nEvents = epoll_wait(eventPollFd, events, sizeof (events) / sizeof (events[0]), -1);
+		if (nEvents == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			RCLCPP_ERROR(get_logger(), "Failed to wait for events: %s", strerror(errno));
+			return;
+		}
+		for (int i = 0; i < nEvents; ++i) {
+			if (events[i].data.fd == wakeFd) {
+				uint64_t count;
+				while (read(wakeFd, &count, sizeof (count)) > 0);
+			}
+		}
+		auto nodeBase = this->get_node_base_interface();
+#if ROS_FOXY
+		std::lock_guard<std::recursive_mutex> lock(nodeBase->get_notify_guard_condition_mutex());
+		if (rcl_trigger_guard_condition(nodeBase->get_notify_guard_condition()) != RCL_RET_OK) {
+			RCLCPP_ERROR(get_logger(), "Failed to wake executor: %s", rcl_get_error_string().str);
+			rcl_reset_error();
+		}
+#else
+		nodeBase->get_notify_guard_condition().trigger();
+#endif
+	}
+}
+
+/*!
+ * \brief wakeUp Makes the main loop run as soon as possible. Safe to call from signal handlers.
+ */
+void SystemControl::wakeUp() {
+	if (wakeFd != -1) {
+		const uint64_t one = 1;
+		if (write(wakeFd, &one, sizeof (one)) == -1) {
+			// Counter full, so a wakeup is already pending
+		}
 	}
 }
 
@@ -1240,6 +1535,8 @@ ssize_t SystemControl::SystemControlReceiveUserControlData(I32 socket, char * da
 			memmove(recvBuffer, recvBuffer + messageLength, bytesInBuffer);
 		}
 	}
+	userControlDataPending = bytesInBuffer > 0
+			&& memmem(recvBuffer, bytesInBuffer, endOfMessagePattern, sizeof (endOfMessagePattern) - 1) != NULL;
 
 	return readResult;
 }
@@ -1511,7 +1808,11 @@ I32 SystemControl::SystemControlInitServer(int *ClientSocket, int *ServerHandle,
 	if (fcntl(*ServerHandle, F_SETFL, sockFlags))
 		util_error("Error calling fcntl");
 
+	struct pollfd serverPoll = { *ServerHandle, POLLIN, 0 };
 	do {
+		// Sleep until a connection is pending, waking regularly to check for exit requests
+		if (poll(&serverPoll, 1, SYSTEM_CONTROL_ACCEPT_POLL_TIME_MS) == -1 && errno != EINTR)
+			util_error("Failed to wait for connection");
 		*ClientSocket = accept(*ServerHandle, (struct sockaddr *)&cli_addr, &cli_length);
 		if ((*ClientSocket == -1 && errno != EAGAIN && errno != EWOULDBLOCK) || iExit)
 			util_error("Failed to establish connection");
@@ -2248,7 +2549,6 @@ I32 SystemControl::SystemControlCreateDirectory(const char * Path, char * Return
 I32 SystemControl::SystemControlUploadFile(const char * Filename, const char * FileSize, const char * PacketSize, const char * FileType, char * ReturnValue,
 							char * CompleteFilePath, U8 Debug) {
 
-	FILE *fd;
 	char CompletePath[MAX_FILE_PATH];
 
 	memset(CompletePath, 0, sizeof (CompletePath));
@@ -2277,16 +2577,6 @@ I32 SystemControl::SystemControlUploadFile(const char * Filename, const char * F
 		break;
 	default:
 		RCLCPP_ERROR(get_logger(), "Received invalid file type upload request");
-		//Create temporary file for handling data anyway
-		UtilGetTestDirectoryPath(CompletePath, sizeof (CompletePath));
-		strcat(CompletePath, "/file.tmp");
-		fd = fopen(CompletePath, "r");
-		if (fd != NULL) {
-			fclose(fd);
-			remove(CompletePath);	//Remove file if exist
-		}
-		fd = fopen(CompletePath, "w+");	//Create the temporary file
-
 		*ReturnValue = PATH_INVALID_MISSING;
 		return -1;
 	}
@@ -2302,153 +2592,78 @@ I32 SystemControl::SystemControlUploadFile(const char * Filename, const char * F
 		RCLCPP_WARN(get_logger(),"CompleteFilePath: %s", CompleteFilePath);
 	}
 
-	if (atoi(PacketSize) > SYSTEM_CONTROL_RX_PACKET_SIZE) {	//Check packet size
-		*ReturnValue = SERVER_PREPARED_BIG_PACKET_SIZE;
-		return 0;
-	}
-
-	fd = fopen(CompletePath, "r");
-	if (fd != NULL) {
-		fclose(fd);
-		remove(CompletePath);	//Remove file if exist
-		RCLCPP_INFO(get_logger(), "Deleted existing file <%s>", CompletePath);
-	}
-
-	fd = fopen(CompletePath, "w+");	//Create the file
-	if (fd != NULL) {
-		*ReturnValue = SERVER_PREPARED;	//Server prepared
-		fclose(fd);
+	// The upload is written to a temporary file and renamed over any existing
+	// file once complete, so only check that the directory can be written to
+	std::string directory = std::filesystem::path(CompletePath).parent_path().string();
+	if (access(directory.c_str(), W_OK) != 0) {
+		RCLCPP_ERROR(get_logger(), "Unable to write to directory <%s>: %s", directory.c_str(), strerror(errno));
+		*ReturnValue = PATH_INVALID_MISSING;
 		return 0;
 	}
-	else {
-		//Failed to open path create temporary file
-		UtilGetTestDirectoryPath(CompletePath, sizeof (CompletePath));
-		strcat(CompletePath, "/file.tmp");
-		fd = fopen(CompletePath, "r");
-		if (fd != NULL) {
-			fclose(fd);
-			remove(CompletePath);	//Remove file if exist
-		}
-		fd = fopen(CompletePath, "w+");	//Create the temporary file
-
-		*ReturnValue = PATH_INVALID_MISSING;
 
+	if (atoi(PacketSize) > SYSTEM_CONTROL_RX_PACKET_SIZE) {	//Check packet size
+		*ReturnValue = SERVER_PREPARED_BIG_PACKET_SIZE;
 		return 0;
 	}
 
-	return -1;
+	*ReturnValue = SERVER_PREPARED;	//Server prepared
+	return 0;
 }
 
 
 I32 SystemControl::SystemControlReceiveRxData(I32 * sockfd, const char * Path, const char * FileSize, const char * PacketSize, char * ReturnValue,
 							   U8 Debug) {
 
-	FILE *fd;
-	char CompletePath[MAX_FILE_PATH];
-
-	bzero(CompletePath, MAX_FILE_PATH);
-	//UtilGetTestDirectoryPath(CompletePath, sizeof (CompletePath));
-	strcat(CompletePath, Path);
-	U32 FileSizeU32 = atoi(FileSize);
-	U16 PacketSizeU16 = atoi(PacketSize);
-	I32 ClientStatus = 0, Time1 = 0, Time2 = 0, TimeDiff = 0, i = 0, j = 0;
-	char RxBuffer[SYSTEM_CONTROL_RX_PACKET_SIZE];
-	U32 TotalRxCount = 0, TransmissionCount = (U32) (FileSizeU32 / PacketSizeU16), RestCount =
-		FileSizeU32 % PacketSizeU16;
-	struct timeval CurTime;
-
+	// The data is a byte stream, so it is received in large chunks regardless of packet size
+	size_t FileSizeBytes = strtoul(FileSize, NULL, 10);
+	ATOS::FileTransfer::Statistics statistics;
+	ATOS::FileTransfer::Result result;
 
 	if (Debug) {
 		RCLCPP_WARN(get_logger(),"Receive Rx data:");
 		RCLCPP_WARN(get_logger(),"Path: %s", Path);
 		RCLCPP_WARN(get_logger(),"FileSize: %s", FileSize);
 		RCLCPP_WARN(get_logger(),"PacketSize: %s", PacketSize);
-		RCLCPP_WARN(get_logger(),"CompletePath: %s", CompletePath);
 	}
 
+	try {
+		result = ATOS::FileTransfer::receive(*sockfd, Path, FileSizeBytes, FILE_TRANSFER_IDLE_TIMEOUT,
+											 &statistics, fileTransferChecksum);
+	}
+	catch (std::system_error& e) {
+		RCLCPP_ERROR(get_logger(), "Failed to receive file: %s", e.what());
+		*ReturnValue = TIME_OUT;
+		return -1;
+	}
 
-
-	fd = fopen(CompletePath, "w+");
-	if (fd != NULL) {
-
-		gettimeofday(&CurTime, NULL);
-		Time1 = CurTime.tv_sec * 1000 + CurTime.tv_usec / 1000;
-
-		while (TotalRxCount < FileSizeU32 && TimeDiff < 3000) {
-			gettimeofday(&CurTime, NULL);
-			Time2 = CurTime.tv_sec * 1000 + CurTime.tv_usec / 1000;
-
-
-			if (i == TransmissionCount) {
-				PacketSizeU16 = RestCount;
-			}
-
-			bzero(RxBuffer, PacketSizeU16);
-			ClientStatus = recv(*sockfd, RxBuffer, PacketSizeU16, MSG_WAITALL);
-
-			if (ClientStatus > 0) {
-				i++;
-				fwrite(RxBuffer, 1, ClientStatus, fd);
-				fflush(fd);
-				if (Debug) {
-					printf("%d, %d, %d, %d, %d, %d :", i, ClientStatus, TotalRxCount, TimeDiff, PacketSizeU16,
-						   FileSizeU32);
-					for (j = 0; j < 10; j++)
-						printf("%x-", RxBuffer[j]);
-					printf("...\n");
-				}
-				TotalRxCount = TotalRxCount + ClientStatus;
-				gettimeofday(&CurTime, NULL);
-				Time1 = CurTime.tv_sec * 1000 + CurTime.tv_usec / 1000;
-			}
-
-
-			TimeDiff = abs(Time1 - Time2);
-		}
-
-		fclose(fd);
-
-		if (TotalRxCount == FileSizeU32) {
-			*ReturnValue = FILE_UPLOADED;
-		}
-		else if (TotalRxCount > FileSizeU32) {
-			*ReturnValue = FILE_TO_MUCH_DATA;
-			remove(CompletePath);
-			RCLCPP_INFO(get_logger(), "CORRUPT FILE, REMOVING...");
-		}
-		else {
-			*ReturnValue = TIME_OUT;
-			remove(CompletePath);
-			RCLCPP_INFO(get_logger(), "CORRUPT FILE, REMOVING...");
+	if (result == ATOS::FileTransfer::COMPLETE) {
+		*ReturnValue = FILE_UPLOADED;
+		if (fileTransferChecksum) {
+			RCLCPP_INFO(get_logger(), "Received file <%s>, CRC-32 %08X", Path, statistics.checksum);
 		}
-
-		RCLCPP_INFO(get_logger(), "Rec count = %d, Req count = %d", TotalRxCount, FileSizeU32);
-
+	}
+	else {
+		*ReturnValue = TIME_OUT;
+		RCLCPP_INFO(get_logger(), "CORRUPT FILE, REMOVING...");
 	}
 
+	RCLCPP_INFO(get_logger(), "Rec count = %zu, Req count = %zu, %.1f MiB/s", statistics.bytesTransferred,
+				FileSizeBytes, statistics.bytesTransferred / 1048576.0
+				/ std::max(std::chrono::duration<double>(statistics.duration).count(), 1e-6));
+
 	return 0;
 }
 
 
 I32 SystemControl::SystemControlSendFileContent(I32 * sockfd, const char * Path, const char * PacketSize, char * ReturnValue, U8 Remove,
 								 U8 Debug) {
-	FILE *fd;
 	char CompletePath[MAX_FILE_PATH];
 
 	bzero(CompletePath, MAX_FILE_PATH);
 	UtilGetTestDirectoryPath(CompletePath, sizeof (CompletePath));
 	strcat(CompletePath, Path);
-	U32 FileSizeU32 = 0;
-	U16 PacketSizeU16 = atoi(PacketSize);
-	I32 ClientStatus = 0, Time1 = 0, Time2 = 0, TimeDiff = 0, i = 0, j = 0;
-	char TxBuffer[SYSTEM_CONTROL_TX_PACKET_SIZE];
-	U32 TotalRxCount = 0, TransmissionCount = 0, RestCount = 0;
-	struct timeval CurTime;
-	struct stat st;
-
-	stat(CompletePath, &st);
-	TransmissionCount = (U32) (st.st_size) / PacketSizeU16;
-	RestCount = (U32) (st.st_size) % PacketSizeU16;
+	ATOS::FileTransfer::Statistics statistics;
+	ATOS::FileTransfer::Result result;
 
 	if (Debug) {
 		RCLCPP_WARN(get_logger(),"Send file content:");
@@ -2457,33 +2672,24 @@ I32 SystemControl::SystemControlSendFileContent(I32 * sockfd, const char * Path,
 		RCLCPP_WARN(get_logger(),"%s", CompletePath);
 	}
 
-	fd = fopen(CompletePath, "r");
-
-	if (fd != NULL) {
-
-		for (i = 0; i < TransmissionCount; i++) {
-			bzero(TxBuffer, PacketSizeU16);
-			fread(TxBuffer, 1, PacketSizeU16, fd);
-			//SystemControlSendBytes(TxBuffer, PacketSizeU16, sockfd, 0); //Send a packet
-			UtilSendTCPData((uint8_t*) "System Control", (uint8_t*) TxBuffer, PacketSizeU16, sockfd, 0);
-		}
-
-		if (RestCount > 0) {
-			bzero(TxBuffer, PacketSizeU16);
-			fread(TxBuffer, 1, RestCount, fd);
-			//SystemControlSendBytes(TxBuffer, RestCount, sockfd, 0); //Send the rest
-			UtilSendTCPData((uint8_t*) "System Control", (uint8_t*) TxBuffer, RestCount, sockfd, 0);
-		}
-
-		fclose(fd);
-
-		if (Remove)
-			remove(CompletePath);
+	try {
+		result = ATOS::FileTransfer::send(*sockfd, CompletePath, FILE_TRANSFER_IDLE_TIMEOUT, &statistics);
+	}
+	catch (std::system_error& e) {
+		RCLCPP_ERROR(get_logger(), "Failed to send file: %s", e.what());
+		return -1;
+	}
 
-		RCLCPP_INFO(get_logger(), "Sent file: %s, total size = %d, transmissions = %d", CompletePath,
-				   (PacketSizeU16 * TransmissionCount + RestCount), i + 1);
+	if (Remove)
+		remove(CompletePath);
 
+	if (result != ATOS::FileTransfer::COMPLETE) {
+		RCLCPP_ERROR(get_logger(), "Sending file %s %s after %zu bytes", CompletePath,
+					 result == ATOS::FileTransfer::TIMED_OUT ? "timed out" : "was interrupted",
+					 statistics.bytesTransferred);
+		return -1;
 	}
+	RCLCPP_INFO(get_logger(), "Sent file: %s, total size = %zu", CompletePath, statistics.bytesTransferred);
 
 	return 0;
 }
@@ -2498,7 +2704,7 @@ I32 SystemControl::SystemControlSendFileContent(I32 * sockfd, const char * Path,
  * \param RVSSRate_Hz Rate at which RVSS messages are to be sent - if this parameter is 0 the value
  *			is clamped to 1 Hz
  */
-void SystemControl::SystemControlUpdateRVSSSendTime(struct timeval *currentRVSSSendTime, uint8_t RVSSRate_Hz) {
+void SystemControl::SystemControlUpdateRVSSSendTime(struct timeval *currentRVSSSendTime, uint16_t RVSSRate_Hz) {
 	struct timeval RVSSTimeInterval, timeDiff, currentTime;
 
 	RVSSRate_Hz = RVSSRate_Hz == 0 ? 1 : RVSSRate_Hz;	// Minimum frequency 1 Hz
@@ -2600,7 +2806,6 @@ int32_t SystemControl::SystemControlSendRVSSMonitorChannelMessages(int *socket,
 	uint32_t RVSSChannel = RVSS_MONITOR_CHANNEL;
 	char RVSSData[MAX_MONR_STRING_LENGTH];
 	char *monitorDataString = RVSSData + sizeof (messageLength) + sizeof (RVSSChannel);
-	uint32_t *transmitterIDs = NULL;
 	uint32_t numberOfObjects;
 	ObjectDataType monitorData;
 
@@ -2611,16 +2816,14 @@ int32_t SystemControl::SystemControlSendRVSSMonitorChannelMessages(int *socket,
 		return -1;
 	}
 
-	// Allocate an array for objects' transmitter IDs
-	transmitterIDs = (uint32_t*) malloc(numberOfObjects * sizeof (uint32_t));
-	if (transmitterIDs == NULL) {
-		RCLCPP_ERROR(get_logger(), "Memory allocation error - RVSS messages cannot be sent");
-		return -1;
+	// The array for objects' transmitter IDs only grows when objects are added
+	if (RVSSTransmitterIDs.size() < numberOfObjects) {
+		RVSSTransmitterIDs.resize(numberOfObjects);
 	}
+	uint32_t *transmitterIDs = RVSSTransmitterIDs.data();
 
 	// Get transmitter IDs for all connected objects
 	if (DataDictionaryGetObjectTransmitterIDs(transmitterIDs, numberOfObjects) != READ_OK) {
-		free(transmitterIDs);
 		RCLCPP_ERROR(get_logger(),
 				   "Data dictionary transmitter ID read error - RVSS messages cannot be sent");
 		return -1;
@@ -2678,10 +2881,76 @@ int32_t SystemControl::SystemControlSendRVSSMonitorChannelMessages(int *socket,
 			}
 		}
 	}
-	free(transmitterIDs);
 	return retval;
 }
 
+/*!
+ * \brief SystemControlSendRVSSMonitorBinaryMessages Sends the latest monitoring data of all objects as fixed
+ *			size binary records, packing as many records as fit into each datagram. Each object's data is
+ *			read from the monitor snapshot memory in a single consistent copy.
+ * \param socket Socket descriptor pointer for RVSS socket
+ * \param addr Address struct pointer for RVSS socket
+ * \return 0 on success, -1 otherwise
+ */
+int32_t SystemControl::SystemControlSendRVSSMonitorBinaryMessages(int *socket, struct sockaddr_in *addr) {
+	static constexpr uint16_t recordsPerDatagram =
+			(SYSTEM_CONTROL_RVSS_MONITOR_BINARY_BUFFER - sizeof (RVSSMonitorBinaryHeaderType))
+			/ sizeof (RVSSMonitorBinaryRecordType);
+	auto records = reinterpret_cast<RVSSMonitorBinaryRecordType*>(
+				RVSSMonitorBinaryData + sizeof (RVSSMonitorBinaryHeaderType));
+	uint16_t numberOfRecords = 0;
+	ObjectDataType objectData;
+	int32_t retval = 0;
+
+	if (monitorSnapshots == nullptr) {
+		return -1;	// Reported when opening the memory
+	}
+
+	for (unsigned int slot = 0; slot < getNumberOfSeqlockSlots(monitorSnapshots); ++slot) {
+		if (getSeqlockSlotVersion(monitorSnapshots, slot) == 0) {
+			continue;	// No monitor data written yet
+		}
+		if (readSeqlockSlot(monitorSnapshots, slot, &objectData) == 0) {
+			RCLCPP_ERROR(get_logger(), "Monitor snapshot read error in slot %u - RVSS message cannot be sent", slot);
+			retval = -1;
+			continue;
+		}
+		if (objectData.ClientID == 0) {
+			continue;	// Slot not in use
+		}
+		UtilObjectDataToRVSSMonitorRecord(&objectData, &records[numberOfRecords++]);
+		if (numberOfRecords == recordsPerDatagram) {
+			SystemControlSendRVSSMonitorBinaryDatagram(socket, addr, numberOfRecords);
+			numberOfRecords = 0;
+		}
+	}
+	if (numberOfRecords > 0) {
+		SystemControlSendRVSSMonitorBinaryDatagram(socket, addr, numberOfRecords);
+	}
+	return retval;
+}
+
+/*!
+ * \brief SystemControlSendRVSSMonitorBinaryDatagram Completes the header of the binary monitor data buffer
+ *			and sends the specified number of records from it
+ * \param socket Socket descriptor pointer for RVSS socket
+ * \param addr Address struct pointer for RVSS socket
+ * \param numberOfRecords Number of records filled in after the header
+ */
+void SystemControl::SystemControlSendRVSSMonitorBinaryDatagram(
+		int *socket,
+		struct sockaddr_in *addr,
+		uint16_t numberOfRecords) {
+	RVSSMonitorBinaryHeaderType header;
+	const uint32_t messageLength = sizeof (header) + numberOfRecords * sizeof (RVSSMonitorBinaryRecordType);
+	header.MessageLengthU32 = htole32(messageLength);
+	header.ChannelCodeU32 = htole32(RVSS_MONITOR_BINARY_CHANNEL);
+	header.FormatVersionU16 = htole16(RVSS_MONITOR_BINARY_FORMAT_VERSION);
+	header.NumberOfRecordsU16 = htole16(numberOfRecords);
+	memcpy(RVSSMonitorBinaryData, &header, sizeof (header));
+	UtilSendUDPData((uint8_t*) module_name.c_str(), socket, addr, (uint8_t*) RVSSMonitorBinaryData, messageLength, 0);
+}
+
 
 /*
 SystemControlBuildRVSSAspChannelMessage shall be used for sending ASP-debug data. The message is stored in *RVSSData.